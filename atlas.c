@@ -0,0 +1,346 @@
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "atlas.h"
+#include "batch.h"
+#include "parallel.h"
+#include "bmp.h"
+
+// HELPER MACROS
+// ================================================================================
+
+#define CHECK_NULL(ptr)    \
+    {                      \
+        if ((ptr) == NULL) \
+        {                  \
+            return NULL;   \
+        }                  \
+    }
+
+/* horizontal segment of the skyline */
+struct skyline_node
+{
+    uint32_t x;
+    uint32_t y; // lowest free row of the segment, counted from the top
+    uint32_t width;
+};
+
+/* copying shared by all bands */
+struct blit_pass
+{
+    const struct atlas_sprite *sprites;
+    struct bmp_image *atlas;
+};
+
+// HELPER DECLARATION
+// ================================================================================
+
+extern struct bmp_image *create_bmp(const struct bmp_header *header, uint32_t width, uint32_t height);
+
+/**
+ * Copy band of sprites into the atlas.
+ *
+ * @param ctx the `blit_pass` structure
+ * @param start index of the first sprite of the band
+ * @param end one past the index of the last sprite of the band
+ */
+void blit_sprites(void *ctx, uint32_t start, uint32_t end);
+
+/**
+ * Order sprites from the tallest, wider first on ties.
+ *
+ * @param a pointer to the first sprite pointer
+ * @param b pointer to the second sprite pointer
+ * @return negative if the first sprite goes first
+ */
+int compare_sprites(const void *a, const void *b);
+
+/**
+ * Find lowest position of the skyline holding rectangle.
+ *
+ * @param nodes the skyline
+ * @param count number of nodes
+ * @param atlas_width width of the atlas
+ * @param width width of the rectangle
+ * @param height height of the rectangle
+ * @param y receives top row of the position
+ * @return index of the node where the rectangle starts or count, if it does not fit
+ */
+size_t skyline_find(const struct skyline_node *nodes, size_t count, uint32_t atlas_width, uint32_t width, uint32_t height, uint32_t *y);
+
+/**
+ * Raise skyline by placed rectangle.
+ *
+ * @param nodes the skyline with room for one more node
+ * @param count number of nodes
+ * @param index node where the rectangle starts
+ * @param width width of the rectangle
+ * @param bottom first free row below the rectangle
+ * @return new number of nodes
+ */
+size_t skyline_add(struct skyline_node *nodes, size_t count, size_t index, uint32_t width, uint32_t bottom);
+
+// PUBLIC IMPLEMENTATION
+// ================================================================================
+
+struct atlas_sprite *load_atlas_sprites(char *const *paths, size_t count)
+{
+    struct bmp_image **images = read_bmp_files(paths, count);
+    CHECK_NULL(images);
+
+    struct atlas_sprite *sprites = calloc(count, sizeof(struct atlas_sprite));
+    if (sprites == NULL)
+    {
+        free_bmp_images(images, count);
+        return NULL;
+    }
+
+    for (size_t i = 0; i < count; i++)
+    {
+        sprites[i].name = paths[i];
+        sprites[i].image = images[i];
+    }
+
+    free(images);
+    return sprites;
+}
+
+void free_atlas_sprites(struct atlas_sprite *sprites, size_t count)
+{
+    if (sprites == NULL)
+    {
+        return;
+    }
+
+    for (size_t i = 0; i < count; i++)
+    {
+        free_bmp_image(sprites[i].image);
+    }
+    free(sprites);
+}
+
+bool pack_atlas(struct atlas_sprite *sprites, size_t count, uint32_t width, uint32_t *atlas_width, uint32_t *atlas_height)
+{
+    if (sprites == NULL || count == 0 || atlas_width == NULL || atlas_height == NULL)
+    {
+        return false;
+    }
+
+    uint64_t area = 0;
+    uint32_t max_width = 0;
+    for (size_t i = 0; i < count; i++)
+    {
+        const struct bmp_header *header = sprites[i].image->header;
+        area += (uint64_t)header->width * header->height;
+        max_width = header->width > max_width ? header->width : max_width;
+    }
+
+    if (width == 0)
+    {
+        double side = ceil(sqrt((double)area));
+        width = side > max_width ? (uint32_t)side : max_width;
+    }
+    if (max_width > width)
+    {
+        return false;
+    }
+
+    // every placed sprite adds at most one node
+    struct atlas_sprite **order = malloc(count * sizeof(struct atlas_sprite *));
+    struct skyline_node *nodes = malloc((count + 1) * sizeof(struct skyline_node));
+    if (order == NULL || nodes == NULL)
+    {
+        free(order);
+        free(nodes);
+        return false;
+    }
+
+    for (size_t i = 0; i < count; i++)
+    {
+        order[i] = &sprites[i];
+    }
+    qsort(order, count, sizeof(struct atlas_sprite *), compare_sprites);
+
+    size_t nodes_count = 1;
+    nodes[0] = (struct skyline_node){0, 0, width};
+    uint32_t height = 0;
+    for (size_t i = 0; i < count; i++)
+    {
+        const struct bmp_header *header = order[i]->image->header;
+        uint32_t y = 0;
+        size_t index = skyline_find(nodes, nodes_count, width, header->width, header->height, &y);
+
+        order[i]->x = nodes[index].x;
+        order[i]->y = y;
+        nodes_count = skyline_add(nodes, nodes_count, index, header->width, y + header->height);
+        height = y + header->height > height ? y + header->height : height;
+    }
+
+    free(order);
+    free(nodes);
+
+    *atlas_width = width;
+    *atlas_height = height;
+    return true;
+}
+
+struct bmp_image *build_atlas(const struct atlas_sprite *sprites, size_t count, uint32_t width, uint32_t height)
+{
+    CHECK_NULL(sprites);
+    if (count == 0 || count > UINT32_MAX)
+    {
+        return NULL;
+    }
+
+    for (size_t i = 0; i < count; i++)
+    {
+        const struct bmp_header *header = sprites[i].image->header;
+        if ((uint64_t)sprites[i].x + header->width > width || (uint64_t)sprites[i].y + header->height > height)
+        {
+            return NULL;
+        }
+    }
+
+    struct bmp_image *atlas = create_bmp(sprites[0].image->header, width, height);
+    CHECK_NULL(atlas);
+    memset(atlas->data, 0, (size_t)atlas->stride * height);
+
+    struct blit_pass pass = {sprites, atlas};
+    parallel_rows((uint32_t)count, blit_sprites, &pass);
+
+    return atlas;
+}
+
+bool write_atlas_manifest(FILE *stream, const struct atlas_sprite *sprites, size_t count, uint32_t width, uint32_t height, bool csv)
+{
+    if (stream == NULL || sprites == NULL)
+    {
+        return false;
+    }
+
+    if (csv)
+    {
+        fprintf(stream, "name,x,y,width,height\n");
+        for (size_t i = 0; i < count; i++)
+        {
+            const struct bmp_header *header = sprites[i].image->header;
+            fprintf(stream, "%s,%u,%u,%u,%u\n", sprites[i].name, sprites[i].x, sprites[i].y, header->width, header->height);
+        }
+        return !ferror(stream);
+    }
+
+    fprintf(stream, "{\n  \"width\": %u,\n  \"height\": %u,\n  \"sprites\": [", width, height);
+    for (size_t i = 0; i < count; i++)
+    {
+        const struct bmp_header *header = sprites[i].image->header;
+        fprintf(stream, "%s\n    {\"name\": ", i == 0 ? "" : ",");
+        write_json_string(stream, sprites[i].name);
+        fprintf(stream, ", \"x\": %u, \"y\": %u, \"width\": %u, \"height\": %u}", sprites[i].x, sprites[i].y, header->width, header->height);
+    }
+    fprintf(stream, "\n  ]\n}\n");
+
+    return !ferror(stream);
+}
+
+// HELPER IMPLEMENTATION
+// ================================================================================
+
+void blit_sprites(void *ctx, uint32_t start, uint32_t end)
+{
+    const struct blit_pass *pass = ctx;
+    uint32_t atlas_height = pass->atlas->header->height;
+
+    for (uint32_t i = start; i < end; i++)
+    {
+        const struct atlas_sprite *sprite = &pass->sprites[i];
+        uint32_t height = sprite->image->header->height;
+        size_t row_bytes = sprite->image->header->width * sizeof(struct pixel);
+
+        // both images are stored bottom up, the bottom sprite row lands lowest
+        uint32_t bottom_row = atlas_height - (sprite->y + height);
+        for (uint32_t row = 0; row < height; row++)
+        {
+            memcpy(bmp_row(pass->atlas, bottom_row + row) + sprite->x, bmp_row(sprite->image, row), row_bytes);
+        }
+    }
+}
+
+int compare_sprites(const void *a, const void *b)
+{
+    const struct bmp_header *first = (*(const struct atlas_sprite *const *)a)->image->header;
+    const struct bmp_header *second = (*(const struct atlas_sprite *const *)b)->image->header;
+
+    if (first->height != second->height)
+    {
+        return first->height > second->height ? -1 : 1;
+    }
+    if (first->width != second->width)
+    {
+        return first->width > second->width ? -1 : 1;
+    }
+    return 0;
+}
+
+size_t skyline_find(const struct skyline_node *nodes, size_t count, uint32_t atlas_width, uint32_t width, uint32_t height, uint32_t *y)
+{
+    size_t best = count;
+    uint64_t best_bottom = UINT64_MAX;
+
+    for (size_t i = 0; i < count && (uint64_t)nodes[i].x + width <= atlas_width; i++)
+    {
+        // rectangle rests on the highest segment it spans
+        uint32_t top = 0;
+        uint64_t spanned = 0;
+        for (size_t j = i; spanned < width; j++)
+        {
+            top = nodes[j].y > top ? nodes[j].y : top;
+            spanned += nodes[j].width;
+        }
+
+        if ((uint64_t)top + height < best_bottom)
+        {
+            best = i;
+            best_bottom = (uint64_t)top + height;
+            *y = top;
+        }
+    }
+    return best;
+}
+
+size_t skyline_add(struct skyline_node *nodes, size_t count, size_t index, uint32_t width, uint32_t bottom)
+{
+    uint32_t x = nodes[index].x;
+    uint32_t right = x + width;
+
+    // drop segments covered by the rectangle, shorten the last one partly covered
+    size_t next = index;
+    while (next < count && nodes[next].x + nodes[next].width <= right)
+    {
+        next++;
+    }
+    if (next < count && nodes[next].x < right)
+    {
+        nodes[next].width -= right - nodes[next].x;
+        nodes[next].x = right;
+    }
+
+    memmove(&nodes[index + 1], &nodes[next], (count - next) * sizeof(struct skyline_node));
+    count = count - next + index + 1;
+    nodes[index] = (struct skyline_node){x, bottom, width};
+
+    // merge neighbours of the same level
+    if (index + 1 < count && nodes[index + 1].y == bottom)
+    {
+        nodes[index].width += nodes[index + 1].width;
+        memmove(&nodes[index + 1], &nodes[index + 2], (count - index - 2) * sizeof(struct skyline_node));
+        count--;
+    }
+    if (index > 0 && nodes[index - 1].y == bottom)
+    {
+        nodes[index - 1].width += nodes[index].width;
+        memmove(&nodes[index], &nodes[index + 1], (count - index - 1) * sizeof(struct skyline_node));
+        count--;
+    }
+    return count;
+}
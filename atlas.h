@@ -0,0 +1,93 @@
+#ifndef _ATLAS_H
+#define _ATLAS_H
+
+#include <stdio.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "bmp.h"
+
+
+/**
+ * Image placed into an atlas.
+ */
+struct atlas_sprite {
+    const char* name;           // file name written to the manifest
+    struct bmp_image* image;
+    uint32_t x;                 // left column in the atlas
+    uint32_t y;                 // top row in the atlas, counted from the top
+};
+
+
+/**
+ * Load sprites from files.
+ *
+ * Files are loaded in parallel, `name` of every sprite is set to its path
+ * and position is left zero.
+ *
+ * @arg paths paths of BMP files
+ * @arg count number of files
+ * @return array of sprites, which must be freed with `free_atlas_sprites()`, or NULL if a file cannot be loaded
+ */
+struct atlas_sprite* load_atlas_sprites(char* const* paths, size_t count);
+
+
+/**
+ * Free sprites and their images.
+ *
+ * @arg sprites the sprites
+ * @arg count number of sprites
+ */
+void free_atlas_sprites(struct atlas_sprite* sprites, size_t count);
+
+
+/**
+ * Pack sprites into rectangle of given width.
+ *
+ * Skyline bottom-left packer: sprites are placed from the tallest one, every
+ * sprite at the lowest position of the skyline where it fits, leftmost on
+ * ties. Sets position of every sprite.
+ *
+ * @arg sprites the sprites
+ * @arg count number of sprites
+ * @arg width width of the atlas, 0 chooses width of a square holding the area of all sprites
+ * @arg atlas_width receives width of the atlas
+ * @arg atlas_height receives height of the atlas
+ * @return true on success, false if there are no sprites, a sprite is wider than width or memory allocation failed
+ */
+bool pack_atlas(struct atlas_sprite* sprites, size_t count, uint32_t width, uint32_t* atlas_width, uint32_t* atlas_height);
+
+
+/**
+ * Copy packed sprites into one image.
+ *
+ * Sprites are copied row by row in parallel, area not covered by any sprite
+ * is black. Header is derived from the header of the first sprite.
+ *
+ * @arg sprites the packed sprites
+ * @arg count number of sprites
+ * @arg width width of the atlas
+ * @arg height height of the atlas
+ * @return the atlas or NULL, if there are no sprites, a sprite is out of the atlas or memory allocation failed
+ */
+struct bmp_image* build_atlas(const struct atlas_sprite* sprites, size_t count, uint32_t width, uint32_t height);
+
+
+/**
+ * Write coordinates of packed sprites.
+ *
+ * JSON object with atlas dimensions and array of sprites, or CSV with header
+ * `name,x,y,width,height`. Coordinates are counted from the top-left corner.
+ *
+ * @arg stream opened output stream
+ * @arg sprites the packed sprites
+ * @arg count number of sprites
+ * @arg width width of the atlas
+ * @arg height height of the atlas
+ * @arg csv write CSV instead of JSON
+ * @return true if the manifest was written
+ */
+bool write_atlas_manifest(FILE* stream, const struct atlas_sprite* sprites, size_t count, uint32_t width, uint32_t height, bool csv);
+
+#endif
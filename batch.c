@@ -0,0 +1,304 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdatomic.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "batch.h"
+#include "parallel.h"
+#include "bmp.h"
+
+// HELPER MACROS
+// ================================================================================
+
+#define CHECK_NULL(ptr)    \
+    {                      \
+        if ((ptr) == NULL) \
+        {                  \
+            return NULL;   \
+        }                  \
+    }
+
+#define WRITE_BUFFER_MAX (8 << 20) // larger files are written in several chunks
+
+/* mapped file holding pixels of an image */
+struct mapping
+{
+    void *address;
+    size_t size;
+};
+
+/* loading shared by all bands */
+struct load_pass
+{
+    struct bmp_image **images;
+    char *const *paths;
+    atomic_bool failed;
+};
+
+// HELPER DECLARATION
+// ================================================================================
+
+extern struct bmp_image *read_bmp_external(const void *data, size_t size, void (*release)(void *owner), void *owner);
+
+/**
+ * Unmap file once its pixels are not used.
+ *
+ * @param owner the `mapping` structure
+ */
+void unmap_file(void *owner);
+
+/**
+ * Load band of files.
+ *
+ * @param ctx the `load_pass` structure
+ * @param start index of the first file of the band
+ * @param end one past the index of the last file of the band
+ */
+void load_files(void *ctx, uint32_t start, uint32_t end);
+
+// PUBLIC IMPLEMENTATION
+// ================================================================================
+
+struct bmp_image **read_bmp_files(char *const *paths, size_t count)
+{
+    CHECK_NULL(paths);
+    if (count == 0 || count > UINT32_MAX)
+    {
+        return NULL;
+    }
+
+    struct load_pass pass = {calloc(count, sizeof(struct bmp_image *)), paths, false};
+    CHECK_NULL(pass.images);
+
+    parallel_rows((uint32_t)count, load_files, &pass);
+
+    if (atomic_load(&pass.failed))
+    {
+        free_bmp_images(pass.images, count);
+        return NULL;
+    }
+    return pass.images;
+}
+
+void free_bmp_images(struct bmp_image **images, size_t count)
+{
+    if (images == NULL)
+    {
+        return;
+    }
+
+    for (size_t i = 0; i < count; i++)
+    {
+        free_bmp_image(images[i]);
+    }
+    free(images);
+}
+
+bool write_bmp_file(const char *path, const struct bmp_image *image)
+{
+    if (path == NULL || image == NULL)
+    {
+        return false;
+    }
+
+    FILE *stream = fopen(path, "wb");
+    if (stream == NULL)
+    {
+        return false;
+    }
+
+    size_t size = image->header->size < WRITE_BUFFER_MAX ? image->header->size : WRITE_BUFFER_MAX;
+    char *buffer = malloc(size);
+    if (buffer != NULL)
+    {
+        setvbuf(stream, buffer, _IOFBF, size);
+    }
+
+    bool success = write_bmp(stream, image);
+    success = fclose(stream) == 0 && success;
+
+    free(buffer);
+    return success;
+}
+
+struct bmp_image *map_bmp_file(const char *path)
+{
+    CHECK_NULL(path);
+
+    int fd = open(path, O_RDONLY);
+    if (fd < 0)
+    {
+        return NULL;
+    }
+
+    struct stat info;
+    void *address = MAP_FAILED;
+    if (fstat(fd, &info) == 0 && S_ISREG(info.st_mode) && info.st_size > 0)
+    {
+        address = mmap(NULL, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    }
+
+    // pipes and other special files are read through stdio
+    if (address == MAP_FAILED)
+    {
+        FILE *stream = fdopen(fd, "rb");
+        if (stream == NULL)
+        {
+            close(fd);
+            return NULL;
+        }
+        struct bmp_image *image = read_bmp(stream);
+        fclose(stream);
+        return image;
+    }
+    close(fd);
+
+    struct mapping *mapping = malloc(sizeof(struct mapping));
+    struct bmp_image *image = NULL;
+    if (mapping != NULL)
+    {
+        *mapping = (struct mapping){address, (size_t)info.st_size};
+        image = read_bmp_external(address, mapping->size, unmap_file, mapping);
+    }
+    if (image == NULL)
+    {
+        munmap(address, (size_t)info.st_size);
+        free(mapping);
+    }
+    return image;
+}
+
+bool output_pattern_valid(const char *pattern)
+{
+    if (pattern == NULL)
+    {
+        return false;
+    }
+
+    int conversions = 0;
+    for (const char *c = pattern; *c != '\0'; c++)
+    {
+        if (*c != '%')
+        {
+            continue;
+        }
+        if (*++c == '%')
+        {
+            continue;
+        }
+
+        c += strspn(c, "0-+ ");
+        c += strspn(c, "0123456789");
+        if (*c != 'd' && *c != 'i' && *c != 'u')
+        {
+            return false;
+        }
+        conversions++;
+    }
+    return conversions == 1;
+}
+
+bool format_output_path(char *path, size_t size, const char *pattern, size_t index)
+{
+    int length = snprintf(path, size, pattern, (unsigned)index);
+    return length >= 0 && (size_t)length < size;
+}
+
+bool outputs_replace_inputs(char *const *paths, size_t count, const char *pattern)
+{
+    struct stat *inputs = malloc(count * sizeof(struct stat));
+    bool *exists = malloc(count * sizeof(bool));
+    if (inputs == NULL || exists == NULL)
+    {
+        free(inputs);
+        free(exists);
+        return true;
+    }
+
+    for (size_t i = 0; i < count; i++)
+    {
+        exists[i] = stat(paths[i], &inputs[i]) == 0;
+    }
+
+    bool replaced = false;
+    for (size_t i = 0; !replaced && i < count; i++)
+    {
+        char path[FILENAME_MAX];
+        struct stat output;
+        if (!format_output_path(path, sizeof(path), pattern, i) || stat(path, &output) != 0)
+        {
+            continue;
+        }
+        for (size_t j = 0; !replaced && j < count; j++)
+        {
+            replaced = exists[j] && inputs[j].st_dev == output.st_dev && inputs[j].st_ino == output.st_ino;
+        }
+    }
+
+    free(inputs);
+    free(exists);
+    return replaced;
+}
+
+bool manifest_csv(const char *path)
+{
+    const char *extension = strrchr(path, '.');
+    return extension != NULL && strcmp(extension, ".csv") == 0;
+}
+
+void write_json_string(FILE *stream, const char *text)
+{
+    fputc('"', stream);
+    for (const unsigned char *c = (const unsigned char *)text; *c != '\0'; c++)
+    {
+        if (*c == '"' || *c == '\\')
+        {
+            fprintf(stream, "\\%c", *c);
+        }
+        else if (*c < 0x20)
+        {
+            fprintf(stream, "\\u%04x", *c);
+        }
+        else
+        {
+            fputc(*c, stream);
+        }
+    }
+    fputc('"', stream);
+}
+
+// HELPER IMPLEMENTATION
+// ================================================================================
+
+void load_files(void *ctx, uint32_t start, uint32_t end)
+{
+    struct load_pass *pass = ctx;
+
+    for (uint32_t i = start; i < end; i++)
+    {
+        FILE *stream = fopen(pass->paths[i], "rb");
+        pass->images[i] = read_bmp(stream);
+        if (stream != NULL)
+        {
+            fclose(stream);
+        }
+        if (pass->images[i] == NULL)
+        {
+            fprintf(stderr, "Error: Unable to read %s.\n", pass->paths[i]);
+            atomic_store(&pass->failed, true);
+        }
+    }
+}
+
+void unmap_file(void *owner)
+{
+    struct mapping *mapping = owner;
+    munmap(mapping->address, mapping->size);
+    free(mapping);
+}
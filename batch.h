@@ -0,0 +1,115 @@
+#ifndef _BATCH_H
+#define _BATCH_H
+
+#include <stdio.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+#include "bmp.h"
+
+
+/**
+ * Load images from files.
+ *
+ * Files are loaded in parallel.
+ *
+ * @arg paths paths of BMP files
+ * @arg count number of files
+ * @return array of images, which must be freed with `free_bmp_images()`, or NULL if a file cannot be loaded
+ */
+struct bmp_image** read_bmp_files(char* const* paths, size_t count);
+
+
+/**
+ * Free array of images.
+ *
+ * @arg images the images, NULL items are skipped
+ * @arg count number of images
+ */
+void free_bmp_images(struct bmp_image** images, size_t count);
+
+
+/**
+ * Load image from mapped file.
+ *
+ * Pixels are used in place from the read only mapping (see `read_bmp_mem()`),
+ * which is released with the last image sharing them. Shared memory is
+ * handed over the same way, e.g. memfd of another process opened by its
+ * `/proc/<pid>/fd/<fd>` path. Files which cannot be mapped are read.
+ * The file must not be truncated while the image uses it.
+ *
+ * @arg path path of BMP file
+ * @return the image or NULL, if the file cannot be loaded
+ */
+struct bmp_image* map_bmp_file(const char* path);
+
+
+/**
+ * Write image into file.
+ *
+ * Whole file leaves the stdio buffer in one write.
+ *
+ * @arg path path of the file
+ * @arg image the image
+ * @return true if the file was written
+ */
+bool write_bmp_file(const char* path, const struct bmp_image* image);
+
+
+/**
+ * Check output file name pattern.
+ *
+ * Pattern is a printf format with exactly one integer conversion (`%d`,
+ * `%i` or `%u` with optional flags and width), which is replaced
+ * by the index of the output, e.g. `tile_%03d.bmp`.
+ *
+ * @arg pattern the pattern
+ * @return true if the pattern is valid
+ */
+bool output_pattern_valid(const char* pattern);
+
+
+/**
+ * Format output file name.
+ *
+ * @arg path receives the file name
+ * @arg size size of path buffer
+ * @arg pattern valid output file name pattern
+ * @arg index index of the output
+ * @return true if the file name fits the buffer
+ */
+bool format_output_path(char* path, size_t size, const char* pattern, size_t index);
+
+
+/**
+ * Check whether outputs replace input files.
+ *
+ * Files are compared by device and inode, so links and other spellings of an
+ * input path are found too. Outputs which do not exist yet replace nothing.
+ *
+ * @arg paths paths of input files
+ * @arg count number of files, which is also the number of outputs
+ * @arg pattern valid output file name pattern
+ * @return true if an output names an input file or memory allocation fails
+ */
+bool outputs_replace_inputs(char* const* paths, size_t count, const char* pattern);
+
+
+/**
+ * Check manifest format.
+ *
+ * @arg path path of the manifest
+ * @return true if the path has `.csv` extension, JSON is written otherwise
+ */
+bool manifest_csv(const char* path);
+
+
+/**
+ * Write string as JSON string literal.
+ *
+ * @arg stream opened output stream
+ * @arg text the string
+ */
+void write_json_string(FILE* stream, const char* text);
+
+#endif
@@ -4,6 +4,7 @@
 #include <string.h>
 #include <math.h>
 #include <stdint.h>
+#include <stdatomic.h>
 
 #include "bmp.h"
 
@@ -92,6 +93,8 @@ enum BMP_META
     IMPORANT_CLR = 0                    // important colors (0)
 };
 
+#define IO_CHUNK (1 << 20) // rows are read and written in chunks of this size
+
 /* properties of bmp image format */
 enum BMP_FORMAT
 {
@@ -100,19 +103,61 @@ enum BMP_FORMAT
     PADDING = '\0' // pixel row padding
 };
 
+/* pixels shared by copies and views of an image */
+struct bmp_buffer
+{
+    _Atomic uint32_t refs;        // images sharing the pixels
+    struct pixel *pixels;         // start of the allocation, NULL for memory of the caller
+    void (*release)(void *owner); // called with owner once memory of the caller is not used
+    void *owner;
+};
+
 // HELPER DECLARATION
 // ================================================================================
 
 /**
- * Copy BMP image
+ * Load BMP file from memory without copying pixels
  *
- * Performs a deep copy of image and data it points to. If the original
- * image is not provided, returns `NULL`
+ * Image uses rows of the file in place, they are never written. Memory
+ * must outlive all images sharing the pixels, then release is called.
  *
- * @param image the image to copy
- * @return reference to the `bmp_image` structure of the copied image or `NULL` if `image` is `NULL`
+ * @param data the file in memory
+ * @param size size of the file in bytes
+ * @param release called with owner once pixels are not used, may be `NULL`
+ * @param owner the owner of memory
+ * @return the image or `NULL` if data are not a complete 24-bit BMP file
+ */
+struct bmp_image *read_bmp_external(const void *data, size_t size, void (*release)(void *owner), void *owner);
+
+/**
+ * Read pixels following the header
+ *
+ * @param stream opened stream positioned after the header
+ * @param header the BMP header structure
+ * @param data receives `width` * `height` contiguous pixels
+ * @return `true` if all pixels were read
  */
-struct bmp_image *copy_bmp(const struct bmp_image *image);
+bool read_pixels(FILE *stream, const struct bmp_header *header, struct pixel *data);
+
+/**
+ * Skip bytes of stream by reading them
+ *
+ * Works on pipes and sockets, which cannot seek.
+ *
+ * @param stream opened stream
+ * @param count number of bytes to skip
+ * @return `true` if all bytes were read
+ */
+bool skip_bytes(FILE *stream, size_t count);
+
+/**
+ * Number of padded rows fitting one I/O chunk
+ *
+ * @param row_bytes size of one padded row
+ * @param height number of rows
+ * @return rows per chunk, at least 1
+ */
+uint32_t chunk_rows(size_t row_bytes, uint32_t height);
 
 /**
  * Create new BMP image
@@ -126,6 +171,64 @@ struct bmp_image *copy_bmp(const struct bmp_image *image);
  */
 struct bmp_image *create_bmp(const struct bmp_header *header, uint32_t width, uint32_t height);
 
+/**
+ * Create view into BMP image
+ *
+ * Creates image sharing pixels of a rectangular area of the original image.
+ * Header is copied with new dimensions, pixels are not copied, so view
+ * is created in constant time. View holds a reference to the pixels, so
+ * the original image may be freed before the view.
+ *
+ * @param image the viewed image
+ * @param row index of the bottom row of the area
+ * @param col index of the left column of the area
+ * @param width the width of the area
+ * @param height the height of the area
+ * @return reference to the `bmp_image` structure or `NULL` if area is not valid
+ */
+struct bmp_image *create_bmp_view(const struct bmp_image *image, uint32_t row, uint32_t col, uint32_t width, uint32_t height);
+
+/**
+ * Wrap pixel array into reference counted buffer
+ *
+ * Buffer takes ownership of the pixels, its only reference belongs
+ * to the caller.
+ *
+ * @param pixels the pixel array
+ * @return the buffer or `NULL` if pixels are `NULL` or memory allocation fails
+ */
+struct bmp_buffer *alloc_buffer(struct pixel *pixels);
+
+/**
+ * Create buffer referencing memory of the caller
+ *
+ * @param release called with owner once pixels are not used, may be `NULL`
+ * @param owner the owner of memory
+ * @return the buffer with one reference or `NULL` if allocation failed
+ */
+struct bmp_buffer *alloc_external_buffer(void (*release)(void *owner), void *owner);
+
+/**
+ * Drop reference to the buffer
+ *
+ * Frees the buffer with its pixels, when the last reference is dropped.
+ *
+ * @param buffer the buffer
+ */
+void release_buffer(struct bmp_buffer *buffer);
+
+/**
+ * Create BMP header with new dimensions
+ *
+ * Performs a deep copy of a header and updates its dimensions and sizes.
+ *
+ * @param header the BMP header structure
+ * @param width the new width
+ * @param height the new height
+ * @return `bmp_header` structure or `NULL` if header is `NULL` or new header is invalid
+ */
+struct bmp_header *resize_bmp_header(const struct bmp_header *header, uint32_t width, uint32_t height);
+
 /**
  * Copy BMP header
  *
@@ -142,13 +245,14 @@ struct bmp_header *copy_bmp_header(const struct bmp_header *header);
  *
  * Performs a deep copy of pixels. If the reference to the original
  * pixels is not provied,  returns `NULL`. If the header is not provided
- * also returns `NULL`.
+ * also returns `NULL`. Rows of a view are gathered into contiguous array.
  *
  * @param header the BMP header structure
  * @param data reference to the original pixel data to copy
+ * @param stride bytes between starts of consecutive original rows
  * @return the pixels of the image or `NULL` if pixels or header are broken
  */
-struct pixel *copy_data(const struct bmp_header *header, const struct pixel *data);
+struct pixel *copy_data(const struct bmp_header *header, const struct pixel *data, uint32_t stride);
 
 /**
  * Allocate memory for a `bmp_image` structure.
@@ -296,7 +400,153 @@ struct bmp_image *read_bmp(FILE *stream)
         return NULL;
     }
     img->data = read_data(stream, img->header);
-    if (img->data == NULL)
+    img->buffer = alloc_buffer(img->data);
+    if (img->buffer == NULL)
+    {
+        fprintf(stderr, "Error: Corrupted BMP file.\n");
+        free_bmp_image(img);
+        return NULL;
+    }
+    img->stride = img->header->width * (uint32_t)sizeof(struct pixel);
+
+    return img;
+}
+
+struct bmp_image *read_bmp_reuse(FILE *stream, struct bmp_image *image)
+{
+    if (image == NULL)
+    {
+        return read_bmp(stream);
+    }
+
+    struct bmp_header *header = read_bmp_header(stream);
+    if (header == NULL)
+    {
+        fprintf(stderr, "Error: This is not a BMP file.\n");
+        free_bmp_image(image);
+        return NULL;
+    }
+
+    // pixels owned by the image alone are overwritten by the next image of the same size
+    bool reusable = image->buffer != NULL && image->buffer->pixels == image->data &&
+                    atomic_load(&image->buffer->refs) == 1 && bmp_contiguous(image) &&
+                    image->header->width == header->width && image->header->height == header->height;
+    if (!reusable)
+    {
+        free_bmp_image(image);
+        image = create_bmp(header, header->width, header->height);
+    }
+    if (image != NULL)
+    {
+        memcpy(image->header, header, sizeof(struct bmp_header));
+    }
+    free(header);
+
+    if (image == NULL || !read_pixels(stream, image->header, image->data))
+    {
+        fprintf(stderr, "Error: Corrupted BMP file.\n");
+        free_bmp_image(image);
+        return NULL;
+    }
+    return image;
+}
+
+struct bmp_image *read_bmp_mem(const void *data, size_t size)
+{
+    return read_bmp_external(data, size, NULL, NULL);
+}
+
+struct bmp_image *read_bmp_scaled(FILE *stream, float factor)
+{
+    CHECK_NULL(stream);
+    if (factor <= 0 || factor > 1)
+    {
+        return NULL;
+    }
+
+    struct bmp_header *header = read_bmp_header(stream);
+    if (header == NULL)
+    {
+        fprintf(stderr, "Error: This is not a BMP file.\n");
+        return NULL;
+    }
+
+    uint32_t w = header->width;
+    uint32_t h = header->height;
+    uint32_t new_w = (uint32_t)roundf((float)w * factor);
+    uint32_t new_h = (uint32_t)roundf((float)h * factor);
+
+    // only the downscaled image is allocated, header validation rejects 0x0
+    struct bmp_image *img = create_bmp(header, new_w, new_h);
+    size_t row_bytes = w * sizeof(struct pixel) + pixel_padding_size(header);
+    uint8_t *row = malloc(row_bytes);
+    uint64_t *sums = calloc((size_t)new_w * 3, sizeof(uint64_t));
+    uint32_t *col_map = malloc(w * sizeof(uint32_t));
+    uint32_t *col_count = calloc(new_w, sizeof(uint32_t));
+    free(header);
+
+    if (img == NULL || row == NULL || sums == NULL || col_map == NULL || col_count == NULL)
+    {
+        free_bmp_image(img);
+        free(row);
+        free(sums);
+        free(col_map);
+        free(col_count);
+        return NULL;
+    }
+
+    // box filter footprint of every output column
+    for (uint32_t col = 0; col < w; col++)
+    {
+        col_map[col] = (uint32_t)((uint64_t)col * new_w / w);
+        col_count[col_map[col]]++;
+    }
+
+    bool success = skip_bytes(stream, img->header->offset - sizeof(struct bmp_header)); // skip color pallette
+    uint32_t new_row = 0;
+    uint32_t row_count = 0;
+    for (uint32_t i = 0; success && i < h; i++) // accumulate source rows as they are streamed
+    {
+        if (fread(row, row_bytes, 1, stream) != 1)
+        {
+            success = false;
+            break;
+        }
+
+        const struct pixel *px = (const struct pixel *)row;
+        for (uint32_t col = 0; col < w; col++)
+        {
+            uint64_t *sum = &sums[col_map[col] * 3];
+            sum[0] += px[col].blue;
+            sum[1] += px[col].green;
+            sum[2] += px[col].red;
+        }
+        row_count++;
+
+        // emit output row once the last source row of its footprint was read
+        if (i + 1 == h || (uint64_t)(i + 1) * new_h / h != new_row)
+        {
+            struct pixel *out = &img->data[new_row * new_w];
+            for (uint32_t new_col = 0; new_col < new_w; new_col++)
+            {
+                uint64_t n = (uint64_t)col_count[new_col] * row_count;
+                uint64_t *sum = &sums[new_col * 3];
+                out[new_col].blue = (uint8_t)((sum[0] + n / 2) / n);
+                out[new_col].green = (uint8_t)((sum[1] + n / 2) / n);
+                out[new_col].red = (uint8_t)((sum[2] + n / 2) / n);
+            }
+            memset(sums, 0, (size_t)new_w * 3 * sizeof(uint64_t));
+            row_count = 0;
+            new_row++;
+        }
+    }
+
+    free(row);
+    free(sums);
+    free(col_map);
+    free(col_count);
+
+    if (!success)
     {
         fprintf(stderr, "Error: Corrupted BMP file.\n");
         free_bmp_image(img);
@@ -311,24 +561,84 @@ bool write_bmp(FILE *stream, const struct bmp_image *image)
     CHECK_NULL(stream);
     CHECK_NULL(image);
 
-    fseek(stream, 0, SEEK_SET);
-    fwrite(image->header, sizeof(struct bmp_header), 1, stream);
-
-    uint32_t offset = image->header->offset;
     uint32_t width = image->header->width;
     uint32_t height = image->header->height;
+    size_t row_bytes = width * sizeof(struct pixel);
     uint8_t pad_bytes = pixel_padding_size(image->header);
 
-    uint8_t padding[pad_bytes];
-    memset(padding, PADDING, pad_bytes);
+    struct bmp_header header = *image->header;
+    swap_endianness(&header); // swap back to default endian
 
-    swap_endianness(image->header); // swap back to default endian
+    // strictly sequential, the stream may be a pipe or a socket
+    bool success = fwrite(&header, sizeof(struct bmp_header), 1, stream) == 1;
+    for (size_t gap = image->header->offset - sizeof(struct bmp_header); success && gap > 0; gap--)
+    {
+        success = fputc(PADDING, stream) != EOF;
+    }
+
+    // contiguous rows without padding are the pixel array itself
+    if (pad_bytes == 0 && bmp_contiguous(image))
+    {
+        return success && fwrite(image->data, row_bytes, height, stream) == height;
+    }
+
+    // padded rows are assembled into chunks, so every chunk leaves in one write
+    uint32_t rows = chunk_rows(row_bytes + pad_bytes, height);
+    uint8_t *chunk = malloc((row_bytes + pad_bytes) * rows);
+    if (chunk == NULL)
+    {
+        return false;
+    }
 
-    fseek(stream, offset, SEEK_SET);      // skip header & color pallette
+    for (uint32_t i = 0; success && i < height; i += rows)
+    {
+        uint32_t count = height - i < rows ? height - i : rows;
+        uint8_t *out = chunk;
+        for (uint32_t row = i; row < i + count; row++)
+        {
+            memcpy(out, bmp_row(image, row), row_bytes);
+            memset(out + row_bytes, PADDING, pad_bytes);
+            out += row_bytes + pad_bytes;
+        }
+        success = fwrite(chunk, (size_t)(out - chunk), 1, stream) == 1;
+    }
+
+    free(chunk);
+    return success;
+}
+
+size_t bmp_encoded_size(const struct bmp_image *image)
+{
+    if (image == NULL)
+    {
+        return 0;
+    }
+    return bmp_file_size(image->header);
+}
+
+bool write_bmp_mem(void *buffer, size_t size, const struct bmp_image *image)
+{
+    if (buffer == NULL || image == NULL || size < bmp_encoded_size(image))
+    {
+        return false;
+    }
+
+    uint32_t width = image->header->width;
+    uint32_t height = image->header->height;
+    size_t row_bytes = width * sizeof(struct pixel);
+    uint8_t pad_bytes = pixel_padding_size(image->header);
+
+    struct bmp_header header = *image->header;
+    swap_endianness(&header); // swap back to default endian
+
+    uint8_t *out = buffer;
+    memcpy(out, &header, sizeof(struct bmp_header));
+    out += image->header->offset;
     for (uint32_t i = 0; i < height; i++) // write padded pixel rows
     {
-        fwrite(image->data + i * width, sizeof(struct pixel), width, stream);
-        fwrite(&padding, sizeof(padding), 1, stream);
+        memcpy(out, bmp_row(image, i), row_bytes);
+        memset(out + row_bytes, PADDING, pad_bytes);
+        out += row_bytes + pad_bytes;
     }
     return true;
 }
@@ -340,8 +650,12 @@ struct bmp_header *read_bmp_header(FILE *stream)
     struct bmp_header *header = alloc_bmp_header();
     CHECK_NULL(header);
 
-    fseek(stream, 0, SEEK_SET);
-    fread(header, sizeof(struct bmp_header), 1, stream);
+    // header is read from the current position, streams need not seek
+    if (fread(header, sizeof(struct bmp_header), 1, stream) != 1)
+    {
+        free(header);
+        return NULL;
+    }
 
     swap_endianness(header); // swap to system's endianness
 
@@ -358,16 +672,10 @@ struct pixel *read_data(FILE *stream, const struct bmp_header *header)
     struct pixel *data = alloc_data(header->width, header->height);
     CHECK_NULL(data);
 
-    uint32_t offset = header->offset;
-    uint32_t width = header->width;
-    uint32_t height = header->height;
-    uint8_t pad_bytes = pixel_padding_size(header);
-
-    fseek(stream, offset, SEEK_SET);      // skip header & color pallette
-    for (uint32_t i = 0; i < height; i++) // load pixel rows without padding
+    if (!read_pixels(stream, header, data))
     {
-        fread(data + i * width, sizeof(struct pixel), width, stream);
-        fseek(stream, pad_bytes, SEEK_CUR);
+        free(data);
+        return NULL;
     }
     return data;
 }
@@ -382,15 +690,20 @@ void free_bmp_image(struct bmp_image *image)
     free(image->header);
     image->header = NULL;
 
-    free(image->data);
+    if (image->buffer != NULL)
+    {
+        release_buffer(image->buffer);
+    }
+    else
+    {
+        free(image->data);
+    }
     image->data = NULL;
+    image->buffer = NULL;
 
     free(image);
 }
 
-// HELPER IMPLEMENTATION
-// ================================================================================
-
 struct bmp_image *copy_bmp(const struct bmp_image *image)
 {
     CHECK_NULL(image);
@@ -401,12 +714,153 @@ struct bmp_image *copy_bmp(const struct bmp_image *image)
     copy->header = copy_bmp_header(image->header);
     CHECK_NULL_AND_FREE(copy->header, copy, copy);
 
-    copy->data = copy_data(image->header, image->data);
-    CHECK_NULL_AND_FREE(copy->data, copy->header, copy);
+    // pixels without buffer are owned by the image alone, they are copied eagerly
+    if (image->buffer == NULL)
+    {
+        copy->data = copy_data(image->header, image->data, image->stride);
+        copy->buffer = alloc_buffer(copy->data);
+        if (copy->buffer == NULL)
+        {
+            free_bmp_image(copy);
+            return NULL;
+        }
+        copy->stride = image->header->width * (uint32_t)sizeof(struct pixel);
+        return copy;
+    }
+
+    atomic_fetch_add(&image->buffer->refs, 1);
+    copy->buffer = image->buffer;
+    copy->data = image->data;
+    copy->stride = image->stride;
 
     return copy;
 }
 
+bool bmp_make_writable(struct bmp_image *image)
+{
+    if (image == NULL)
+    {
+        return false;
+    }
+    // memory of the caller is never written
+    if (image->buffer == NULL || (atomic_load(&image->buffer->refs) == 1 && image->buffer->pixels != NULL))
+    {
+        return true;
+    }
+
+    struct pixel *data = copy_data(image->header, image->data, image->stride);
+    struct bmp_buffer *buffer = alloc_buffer(data);
+    if (buffer == NULL)
+    {
+        free(data);
+        return false;
+    }
+
+    release_buffer(image->buffer);
+    image->buffer = buffer;
+    image->data = data;
+    image->stride = image->header->width * (uint32_t)sizeof(struct pixel);
+
+    return true;
+}
+
+// HELPER IMPLEMENTATION
+// ================================================================================
+
+bool read_pixels(FILE *stream, const struct bmp_header *header, struct pixel *data)
+{
+    uint32_t width = header->width;
+    uint32_t height = header->height;
+    size_t row_bytes = width * sizeof(struct pixel);
+    uint8_t pad_bytes = pixel_padding_size(header);
+
+    bool success = skip_bytes(stream, header->offset - sizeof(struct bmp_header)); // skip color pallette
+
+    // rows without padding are the pixel array itself
+    if (success && pad_bytes == 0)
+    {
+        success = fread(data, row_bytes, height, stream) == height;
+    }
+
+    // padded rows are read in chunks and the padding is dropped in memory
+    uint32_t rows = chunk_rows(row_bytes + pad_bytes, height);
+    uint8_t *chunk = success && pad_bytes != 0 ? malloc((row_bytes + pad_bytes) * rows) : NULL;
+    success = success && (pad_bytes == 0 || chunk != NULL);
+    for (uint32_t i = 0; success && pad_bytes != 0 && i < height; i += rows)
+    {
+        uint32_t count = height - i < rows ? height - i : rows;
+        success = fread(chunk, row_bytes + pad_bytes, count, stream) == count;
+        for (uint32_t row = 0; success && row < count; row++)
+        {
+            memcpy(data + (size_t)(i + row) * width, chunk + row * (row_bytes + pad_bytes), row_bytes);
+        }
+    }
+    free(chunk);
+
+    return success;
+}
+
+bool skip_bytes(FILE *stream, size_t count)
+{
+    for (; count > 0; count--)
+    {
+        if (fgetc(stream) == EOF)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+uint32_t chunk_rows(size_t row_bytes, uint32_t height)
+{
+    size_t rows = IO_CHUNK / row_bytes;
+    if (rows == 0)
+    {
+        return 1;
+    }
+    return rows < height ? (uint32_t)rows : height;
+}
+
+struct bmp_image *read_bmp_external(const void *data, size_t size, void (*release)(void *owner), void *owner)
+{
+    CHECK_NULL(data);
+
+    struct bmp_image *img = alloc_bmp_image();
+    CHECK_NULL(img);
+
+    img->header = alloc_bmp_header();
+    CHECK_NULL_AND_FREE(img->header, img, img);
+
+    if (size >= sizeof(struct bmp_header))
+    {
+        memcpy(img->header, data, sizeof(struct bmp_header));
+        swap_endianness(img->header); // swap to system's endianness
+    }
+    if (size < sizeof(struct bmp_header) || !bmp_header_valid(img->header) || img->header->bpp != BPP24)
+    {
+        fprintf(stderr, "Error: This is not a BMP file.\n");
+        free_bmp_image(img);
+        return NULL;
+    }
+
+    // padded rows are used in place, the stride skips the padding
+    uint64_t stride = (uint64_t)img->header->width * sizeof(struct pixel) + pixel_padding_size(img->header);
+    if (stride > UINT32_MAX || size < img->header->offset + stride * img->header->height)
+    {
+        fprintf(stderr, "Error: Corrupted BMP file.\n");
+        free_bmp_image(img);
+        return NULL;
+    }
+
+    img->buffer = alloc_external_buffer(release, owner);
+    CHECK_NULL_AND_FREE(img->buffer, img->header, img);
+    img->data = (struct pixel *)((const uint8_t *)data + img->header->offset);
+    img->stride = (uint32_t)stride;
+
+    return img;
+}
+
 struct bmp_image *create_bmp(const struct bmp_header *header, uint32_t width, uint32_t height)
 {
     CHECK_NULL(header);
@@ -415,23 +869,116 @@ struct bmp_image *create_bmp(const struct bmp_header *header, uint32_t width, ui
     struct bmp_image *copy = alloc_bmp_image();
     CHECK_NULL(copy);
 
-    copy->header = copy_bmp_header(header);
+    copy->header = resize_bmp_header(header, width, height);
     CHECK_NULL_AND_FREE(copy->header, copy, copy);
 
-    // update metadata & size
-    copy->header->width = width;
-    copy->header->height = height;
-    copy->header->size = bmp_file_size(copy->header);
-    copy->header->image_size = pixel_array_size(copy->header);
-    CHECK_VALID_BMP_AND_FREE(copy->header, copy, copy);
-
     // allocate memory for pixel array, but do not copy any data
     copy->data = alloc_data(width, height);
-    CHECK_NULL_AND_FREE(copy->data, copy->header, copy);
+    copy->buffer = alloc_buffer(copy->data);
+    if (copy->buffer == NULL)
+    {
+        free_bmp_image(copy);
+        return NULL;
+    }
+    copy->stride = width * (uint32_t)sizeof(struct pixel);
 
     return copy;
 }
 
+struct bmp_image *create_bmp_view(const struct bmp_image *image, uint32_t row, uint32_t col, uint32_t width, uint32_t height)
+{
+    CHECK_NULL(image);
+    if (col + width > image->header->width || row + height > image->header->height)
+    {
+        return NULL;
+    }
+
+    struct bmp_image *view = alloc_bmp_image();
+    CHECK_NULL(view);
+
+    view->header = resize_bmp_header(image->header, width, height);
+    CHECK_NULL_AND_FREE(view->header, view, view);
+
+    // pixels without buffer cannot be shared, the area is copied instead
+    if (image->buffer == NULL)
+    {
+        view->data = copy_data(view->header, bmp_row(image, row) + col, image->stride);
+        view->buffer = alloc_buffer(view->data);
+        if (view->buffer == NULL)
+        {
+            free_bmp_image(view);
+            return NULL;
+        }
+        view->stride = width * (uint32_t)sizeof(struct pixel);
+        return view;
+    }
+
+    atomic_fetch_add(&image->buffer->refs, 1);
+    view->buffer = image->buffer;
+    view->data = bmp_row(image, row) + col;
+    view->stride = image->stride;
+
+    return view;
+}
+
+struct bmp_buffer *alloc_buffer(struct pixel *pixels)
+{
+    CHECK_NULL(pixels);
+
+    struct bmp_buffer *buffer = malloc(sizeof(struct bmp_buffer));
+    CHECK_NULL(buffer);
+
+    atomic_init(&buffer->refs, 1);
+    buffer->pixels = pixels;
+    buffer->release = NULL;
+    buffer->owner = NULL;
+
+    return buffer;
+}
+
+struct bmp_buffer *alloc_external_buffer(void (*release)(void *owner), void *owner)
+{
+    struct bmp_buffer *buffer = malloc(sizeof(struct bmp_buffer));
+    CHECK_NULL(buffer);
+
+    atomic_init(&buffer->refs, 1);
+    buffer->pixels = NULL;
+    buffer->release = release;
+    buffer->owner = owner;
+
+    return buffer;
+}
+
+void release_buffer(struct bmp_buffer *buffer)
+{
+    if (atomic_fetch_sub(&buffer->refs, 1) == 1)
+    {
+        free(buffer->pixels);
+        if (buffer->release != NULL)
+        {
+            buffer->release(buffer->owner);
+        }
+        free(buffer);
+    }
+}
+
+struct bmp_header *resize_bmp_header(const struct bmp_header *header, uint32_t width, uint32_t height)
+{
+    CHECK_NULL(header);
+
+    struct bmp_header *header_copy = copy_bmp_header(header);
+    CHECK_NULL(header_copy);
+
+    // update metadata & size
+    header_copy->width = width;
+    header_copy->height = height;
+    header_copy->size = bmp_file_size(header_copy);
+    header_copy->image_size = pixel_array_size(header_copy);
+    CHECK_VALID_BMP_AND_FREE(header_copy, header_copy, header_copy);
+
+    return header_copy;
+}
+
 struct bmp_header *copy_bmp_header(const struct bmp_header *header)
 {
     CHECK_NULL(header);
@@ -444,7 +991,7 @@ struct bmp_header *copy_bmp_header(const struct bmp_header *header)
     return header_copy;
 }
 
-struct pixel *copy_data(const struct bmp_header *header, const struct pixel *data)
+struct pixel *copy_data(const struct bmp_header *header, const struct pixel *data, uint32_t stride)
 {
     CHECK_NULL(header);
     CHECK_NULL(data);
@@ -452,7 +999,17 @@ struct pixel *copy_data(const struct bmp_header *header, const struct pixel *dat
     struct pixel *data_copy = alloc_data(header->width, header->height);
     CHECK_NULL(data_copy);
 
-    memcpy(data_copy, data, header->width * header->height * sizeof(struct pixel));
+    size_t row_bytes = header->width * sizeof(struct pixel);
+    if (stride == row_bytes)
+    {
+        memcpy(data_copy, data, row_bytes * header->height);
+        return data_copy;
+    }
+
+    for (uint32_t i = 0; i < header->height; i++)
+    {
+        memcpy(data_copy + (size_t)i * header->width, (const uint8_t *)data + (size_t)i * stride, row_bytes);
+    }
 
     return data_copy;
 }
@@ -467,6 +1024,8 @@ struct bmp_image *alloc_bmp_image(void)
 
     img->header = NULL;
     img->data = NULL;
+    img->stride = 0;
+    img->buffer = NULL;
 
     return img;
 }
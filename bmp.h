@@ -2,12 +2,15 @@
 #define _BMP_H
 
 #include <stdint.h>
+#include <stddef.h>
 #include <stdio.h>
 #include <stdbool.h>
 
 
 #define PADDING_CHAR "\0"
 
+struct bmp_buffer;
+
 /**
  * Structure contains information about the type, size, layout, dimensions
  * and color format of a BMP file. Size of structure is 54 bytes.
@@ -48,13 +51,47 @@ struct pixel {
  * Structure describes the BMP file format, which consists from two parts:
  * 1. the header (metadata)
  * 2. the data (pixels)
+ *
+ * Rows are `stride` bytes apart. Pixels live in a reference counted buffer,
+ * which may be shared by several images: copies (see `copy_bmp()`) and views
+ * (see `crop()`), whose rows are generally not contiguous. Shared pixels are
+ * read only, `bmp_make_writable()` must be called before writing them.
  */
 struct bmp_image {
     struct bmp_header* header;
-    struct pixel* data;         // nr. of pixels is `width` * `height`
+    struct pixel* data;         // first pixel of the bottom row
+    uint32_t stride;            // bytes between starts of consecutive rows
+    struct bmp_buffer* buffer;  // reference counted pixel storage
 };
 
 
+/**
+ * Access row of pixels
+ *
+ * Rows are stored bottom up, row 0 is the bottom row of the image.
+ *
+ * @param image the image
+ * @param row the row index in the range <0, height)
+ * @return the first pixel of the row
+ */
+static inline struct pixel* bmp_row(const struct bmp_image* image, uint32_t row)
+{
+    return (struct pixel*)((uint8_t*)image->data + (size_t)row * image->stride);
+}
+
+
+/**
+ * Check whether pixel rows follow each other without gaps
+ *
+ * @param image the image
+ * @return `true` if all `width` * `height` pixels are contiguous
+ */
+static inline bool bmp_contiguous(const struct bmp_image* image)
+{
+    return image->stride == image->header->width * sizeof(struct pixel) || image->header->height == 1;
+}
+
+
 /**
  * Loads a BMP file from an input stream
  *
@@ -68,11 +105,56 @@ struct bmp_image {
 struct bmp_image* read_bmp(FILE* stream);
 
 
+/**
+ * Loads next BMP file from an input stream into image
+ *
+ * Meant for streams of images following each other. If image owns its
+ * contiguous pixels alone and has the same dimensions as the next image,
+ * its pixels are overwritten and no memory is allocated. Otherwise image is
+ * freed and a new one is loaded as by `read_bmp()`.
+ *
+ * @param stream opened stream, where the image data are located
+ * @param image the image to reuse or `NULL`, it must not be used afterwards
+ * @return reference to the `bmp_image` structure of the loaded image or `NULL` if `stream` is `NULL` or corrupted
+ */
+struct bmp_image* read_bmp_reuse(FILE* stream, struct bmp_image* image);
+
+
+/**
+ * Loads a BMP file from memory
+ *
+ * Parses the file in place: pixel rows of the file become rows of the image
+ * (the stride skips their padding), nothing is copied. Pixels are never
+ * written, `bmp_make_writable()` copies them. Memory must outlive the image
+ * and all copies and views sharing its pixels.
+ *
+ * @param data the BMP file in memory
+ * @param size size of the file in bytes
+ * @return reference to the `bmp_image` structure of the image or `NULL` if `data` is `NULL`, not a 24-bit BMP file or truncated
+ */
+struct bmp_image* read_bmp_mem(const void* data, size_t size);
+
+
+/**
+ * Loads a BMP file from an input stream downscaled by factor
+ *
+ * Decimates the image while it is being decoded: source rows are streamed
+ * one at a time and box-filtered into the output, so the full resolution
+ * pixel array is never allocated. Output dimensions match `scale()`.
+ *
+ * @param stream opened stream, where the image data are located
+ * @param factor the downscale ratio, 0 < factor <= 1
+ * @return reference to the `bmp_image` structure of the downscaled image or `NULL` if `stream` is `NULL`, corrupted or factor is not valid
+ */
+struct bmp_image* read_bmp_scaled(FILE* stream, float factor);
+
+
 /**
  * Writes a BMP file to an output stream
  *
- * Function writes BMP image to opened stream. If stream is not open
- * (is `NULL`) or image is `NULL`, function returns `false`.
+ * Function writes BMP image to opened stream at its current position,
+ * padded rows are written in large chunks without seeking. If stream is
+ * not open (is `NULL`) or image is `NULL`, function returns `false`.
  *
  * @param stream opened stream, where the image will be written
  * @param image the image to write
@@ -81,11 +163,35 @@ struct bmp_image* read_bmp(FILE* stream);
 bool write_bmp(FILE* stream, const struct bmp_image* image);
 
 
+/**
+ * Size of the BMP file of image
+ *
+ * @param image the image
+ * @return number of bytes written by `write_bmp()` or `write_bmp_mem()`, 0 if `image` is `NULL`
+ */
+size_t bmp_encoded_size(const struct bmp_image* image);
+
+
+/**
+ * Writes a BMP file to memory
+ *
+ * Encodes image into buffer provided by the caller, which must hold at
+ * least `bmp_encoded_size()` bytes.
+ *
+ * @param buffer the destination
+ * @param size size of buffer in bytes
+ * @param image the image to write
+ * @return `true`, if BMP image was encoded, `false` if buffer or image is `NULL` or buffer is too small
+ */
+bool write_bmp_mem(void* buffer, size_t size, const struct bmp_image* image);
+
+
 /**
  * Reads BMP header from input stream
  *
- * Reads and returns BMP header from opened input stream. The header is located
- * at it's beginning. If the stream is not opened or it is corrupted, function
+ * Reads and returns BMP header from opened input stream. The header is read
+ * from the current position, the stream is never seeked, so pipes and
+ * sockets work. If the stream is not opened or it is corrupted, function
  * returns `NULL`.
  *
  * @param stream opened stream, where the image data are located
@@ -97,8 +203,10 @@ struct bmp_header* read_bmp_header(FILE* stream);
 /**
  * Read the pixels
  *
- * Reads the data (pixels) from stream representing the image. If the stream
- * is not open or header is not provided, returns `NULL`.
+ * Reads the data (pixels) from stream representing the image, which follow
+ * the header read by `read_bmp_header()`. Row padding is read and dropped.
+ * If the stream is not open, header is not provided or the stream ends
+ * early, returns `NULL`.
  *
  * @param stream opened stream, where the image data are located
  * @param header the BMP header structure
@@ -107,10 +215,38 @@ struct bmp_header* read_bmp_header(FILE* stream);
 struct pixel* read_data(FILE* stream, const struct bmp_header* header);
 
 
+/**
+ * Copy BMP image
+ *
+ * Copies the header, pixels are shared with the original image in constant
+ * time and copied on write (see `bmp_make_writable()`). If the original
+ * image is not provided, returns `NULL`.
+ *
+ * @param image the image to copy
+ * @return reference to the `bmp_image` structure of the copied image or `NULL` if `image` is `NULL`
+ */
+struct bmp_image* copy_bmp(const struct bmp_image* image);
+
+
+/**
+ * Prepare pixels of the image for writing
+ *
+ * If the image is the only owner of its pixels, nothing is done and pixels
+ * may be modified in place, even if the image is a view. Otherwise pixels
+ * are copied into new contiguous buffer owned by the image only and other
+ * images sharing the original pixels are left untouched.
+ *
+ * @param image the image
+ * @return `true` if pixels may be written, `false` if image is `NULL` or copy failed
+ */
+bool bmp_make_writable(struct bmp_image* image);
+
+
 /**
  * Free the BMP image from the memory
  *
- * Function frees the allocated memory for the BMP image.
+ * Function frees the allocated memory for the BMP image. Pixels are freed
+ * once the last image sharing them is freed.
  *
  * @param image the BMP image object
  */
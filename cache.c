@@ -0,0 +1,344 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include <errno.h>
+#include <time.h>
+#include <dirent.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#ifdef __linux__
+#include <sys/ioctl.h>
+#include <linux/fs.h>
+#endif
+
+#include "cache.h"
+#include "hash.h"
+
+// HELPER MACROS
+// ================================================================================
+
+#define CACHE_VERSION 1                     // bump when the output of a chain changes
+#define KEY_LENGTH 32                       // hex digits of two 64-bit hashes
+#define TEMP_PREFIX ".tmp-"
+#define TEMP_MAX_AGE 3600                   // seconds after which temporary files are abandoned
+#define READ_CHUNK (1 << 20)
+#define COPY_CHUNK (1 << 20)
+
+/* file of the cache directory */
+struct cache_file
+{
+    char name[KEY_LENGTH + 1];
+    struct timespec used;
+    uint64_t size;
+};
+
+// HELPER DECLARATION
+// ================================================================================
+
+/**
+ * Read stream to the end.
+ *
+ * @param stream the stream
+ * @param size receives number of bytes read
+ * @return the bytes or NULL, if reading failed
+ */
+unsigned char *read_stream(FILE *stream, size_t *size);
+
+/**
+ * Check cache entry file name.
+ *
+ * @param name the file name
+ * @return true if the name is a key
+ */
+bool is_entry_name(const char *name);
+
+/**
+ * Order files from the least recently used.
+ *
+ * @param a the first `cache_file`
+ * @param b the second `cache_file`
+ * @return negative if the first goes first
+ */
+int compare_cache_files(const void *a, const void *b);
+
+// PUBLIC IMPLEMENTATION
+// ================================================================================
+
+bool cache_open(struct bmp_cache *cache, const char *dir, uint64_t max_size, FILE *input, const char *chain)
+{
+    if (cache == NULL || dir == NULL || input == NULL || chain == NULL)
+    {
+        return false;
+    }
+
+    *cache = (struct bmp_cache){dir, max_size, NULL, 0, ""};
+    if (mkdir(dir, 0777) != 0 && errno != EEXIST)
+    {
+        return false;
+    }
+
+    cache->input = read_stream(input, &cache->input_size);
+    if (cache->input == NULL)
+    {
+        return false;
+    }
+
+    // input and chain are hashed independently, entry name holds both
+    uint64_t input_hash = hash_bytes(cache->input, cache->input_size, 0);
+    uint64_t chain_hash = hash_bytes(chain, strlen(chain), CACHE_VERSION);
+    int length = snprintf(cache->path, sizeof(cache->path), "%s/%016" PRIx64 "%016" PRIx64, dir, input_hash, chain_hash);
+    return length > 0 && (size_t)length < sizeof(cache->path);
+}
+
+FILE *cache_lookup(struct bmp_cache *cache)
+{
+    if (cache == NULL || cache->input == NULL)
+    {
+        return NULL;
+    }
+
+    FILE *entry = fopen(cache->path, "rb");
+    if (entry != NULL)
+    {
+        // modification time orders entries for eviction
+        utimensat(AT_FDCWD, cache->path, NULL, 0);
+    }
+    return entry;
+}
+
+FILE *cache_input(struct bmp_cache *cache)
+{
+    if (cache == NULL || cache->input == NULL || cache->input_size == 0)
+    {
+        return NULL;
+    }
+    return fmemopen(cache->input, cache->input_size, "rb");
+}
+
+FILE *cache_create(struct bmp_cache *cache, char *temp_path)
+{
+    if (cache == NULL || temp_path == NULL)
+    {
+        return NULL;
+    }
+
+    int length = snprintf(temp_path, FILENAME_MAX, "%s/" TEMP_PREFIX "XXXXXX", cache->dir);
+    if (length <= 0 || length >= FILENAME_MAX)
+    {
+        return NULL;
+    }
+
+    int fd = mkstemp(temp_path);
+    if (fd < 0)
+    {
+        return NULL;
+    }
+
+    FILE *temp = fdopen(fd, "w+b");
+    if (temp == NULL)
+    {
+        close(fd);
+        unlink(temp_path);
+    }
+    return temp;
+}
+
+FILE *cache_commit(struct bmp_cache *cache, FILE *temp, const char *temp_path)
+{
+    if (cache == NULL || temp == NULL || temp_path == NULL)
+    {
+        return NULL;
+    }
+
+    // entry appears complete or not at all
+    fchmod(fileno(temp), 0644);
+    if (fflush(temp) != 0 || ferror(temp) || rename(temp_path, cache->path) != 0)
+    {
+        fclose(temp);
+        unlink(temp_path);
+        return NULL;
+    }
+
+    cache_evict(cache->dir, cache->max_size);
+
+    // the open file stays readable even if it was evicted
+    rewind(temp);
+    return temp;
+}
+
+bool cache_deliver(FILE *entry, FILE *output)
+{
+    if (entry == NULL || output == NULL)
+    {
+        return false;
+    }
+
+#ifdef FICLONE
+    if (fflush(output) == 0 && ioctl(fileno(output), FICLONE, fileno(entry)) == 0)
+    {
+        fclose(entry);
+        return true;
+    }
+#endif
+
+    char *buffer = malloc(COPY_CHUNK);
+    if (buffer == NULL)
+    {
+        fclose(entry);
+        return false;
+    }
+
+    size_t size;
+    bool success = true;
+    while (success && (size = fread(buffer, 1, COPY_CHUNK, entry)) > 0)
+    {
+        success = fwrite(buffer, 1, size, output) == size;
+    }
+    success = success && !ferror(entry);
+
+    free(buffer);
+    fclose(entry);
+    return success;
+}
+
+void cache_close(struct bmp_cache *cache)
+{
+    if (cache == NULL)
+    {
+        return;
+    }
+
+    free(cache->input);
+    cache->input = NULL;
+    cache->input_size = 0;
+}
+
+size_t cache_evict(const char *dir, uint64_t max_size)
+{
+    DIR *stream = dir != NULL ? opendir(dir) : NULL;
+    if (stream == NULL)
+    {
+        return 0;
+    }
+
+    size_t count = 0, capacity = 64;
+    struct cache_file *files = malloc(capacity * sizeof(struct cache_file));
+    uint64_t total = 0;
+    time_t now = time(NULL);
+
+    struct dirent *item;
+    while (files != NULL && (item = readdir(stream)) != NULL)
+    {
+        struct stat info;
+        if (fstatat(dirfd(stream), item->d_name, &info, 0) != 0 || !S_ISREG(info.st_mode))
+        {
+            continue;
+        }
+
+        if (strncmp(item->d_name, TEMP_PREFIX, strlen(TEMP_PREFIX)) == 0)
+        {
+            if (now - info.st_mtime > TEMP_MAX_AGE)
+            {
+                unlinkat(dirfd(stream), item->d_name, 0);
+            }
+            continue;
+        }
+        if (!is_entry_name(item->d_name))
+        {
+            continue;
+        }
+
+        if (count == capacity)
+        {
+            capacity *= 2;
+            struct cache_file *grown = realloc(files, capacity * sizeof(struct cache_file));
+            if (grown == NULL)
+            {
+                break;
+            }
+            files = grown;
+        }
+
+        strcpy(files[count].name, item->d_name);
+        files[count].used = info.st_mtim;
+        files[count].size = (uint64_t)info.st_size;
+        total += files[count].size;
+        count++;
+    }
+
+    // other processes may remove the same files, missing ones are skipped
+    size_t removed = 0;
+    if (files != NULL && total > max_size)
+    {
+        qsort(files, count, sizeof(struct cache_file), compare_cache_files);
+        for (size_t i = 0; i < count && total > max_size; i++)
+        {
+            total -= files[i].size;
+            removed += unlinkat(dirfd(stream), files[i].name, 0) == 0;
+        }
+    }
+
+    free(files);
+    closedir(stream);
+    return removed;
+}
+
+// HELPER IMPLEMENTATION
+// ================================================================================
+
+unsigned char *read_stream(FILE *stream, size_t *size)
+{
+    size_t capacity = READ_CHUNK;
+    unsigned char *bytes = malloc(capacity);
+    *size = 0;
+
+    while (bytes != NULL)
+    {
+        *size += fread(bytes + *size, 1, capacity - *size, stream);
+        if (*size < capacity)
+        {
+            break;
+        }
+
+        capacity *= 2;
+        unsigned char *grown = realloc(bytes, capacity);
+        if (grown == NULL)
+        {
+            free(bytes);
+            return NULL;
+        }
+        bytes = grown;
+    }
+
+    if (bytes != NULL && ferror(stream))
+    {
+        free(bytes);
+        return NULL;
+    }
+    return bytes;
+}
+
+bool is_entry_name(const char *name)
+{
+    size_t length = strspn(name, "0123456789abcdef");
+    return length == KEY_LENGTH && name[length] == '\0';
+}
+
+int compare_cache_files(const void *a, const void *b)
+{
+    const struct cache_file *first = a;
+    const struct cache_file *second = b;
+
+    if (first->used.tv_sec != second->used.tv_sec)
+    {
+        return first->used.tv_sec < second->used.tv_sec ? -1 : 1;
+    }
+    if (first->used.tv_nsec != second->used.tv_nsec)
+    {
+        return first->used.tv_nsec < second->used.tv_nsec ? -1 : 1;
+    }
+    return 0;
+}
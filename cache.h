@@ -0,0 +1,116 @@
+#ifndef _CACHE_H
+#define _CACHE_H
+
+#include <stdio.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+
+/**
+ * Result cache of one invocation.
+ *
+ * Entries are files named by the hash of the input bytes and of the
+ * transformation chain. They are written into temporary files and renamed
+ * into place, so concurrent processes may share one directory.
+ */
+struct bmp_cache {
+    const char* dir;                // directory of the entries
+    uint64_t max_size;              // least recently used entries are evicted above this size in bytes
+    unsigned char* input;           // whole input stream
+    size_t input_size;              // size of input in bytes
+    char path[FILENAME_MAX];        // path of the entry
+};
+
+
+/**
+ * Read input and compute key of its result.
+ *
+ * Directory is created if it does not exist.
+ *
+ * @arg cache the cache to initialize, must be closed with `cache_close()`
+ * @arg dir the cache directory
+ * @arg max_size size limit of the directory in bytes
+ * @arg input input stream, read to the end
+ * @arg chain normalized description of everything that affects the result
+ * @return true if the input was read
+ */
+bool cache_open(struct bmp_cache* cache, const char* dir, uint64_t max_size, FILE* input, const char* chain);
+
+
+/**
+ * Find stored result.
+ *
+ * Hit marks the entry as recently used.
+ *
+ * @arg cache the cache
+ * @return opened entry or NULL, if the result is not stored
+ */
+FILE* cache_lookup(struct bmp_cache* cache);
+
+
+/**
+ * Stream over the input read by `cache_open()`.
+ *
+ * @arg cache the cache
+ * @return the stream or NULL, if it cannot be opened
+ */
+FILE* cache_input(struct bmp_cache* cache);
+
+
+/**
+ * Create temporary file receiving the result.
+ *
+ * @arg cache the cache
+ * @arg temp_path receives path of the temporary file, at least `FILENAME_MAX` bytes
+ * @return opened temporary file or NULL, if it cannot be created
+ */
+FILE* cache_create(struct bmp_cache* cache, char* temp_path);
+
+
+/**
+ * Store result written into temporary file.
+ *
+ * The file is renamed into place and the cache is trimmed to its size limit.
+ *
+ * @arg cache the cache
+ * @arg temp the temporary file of `cache_create()`
+ * @arg temp_path path of the temporary file
+ * @return the stored entry opened from the beginning or NULL, if it cannot be stored
+ */
+FILE* cache_commit(struct bmp_cache* cache, FILE* temp, const char* temp_path);
+
+
+/**
+ * Copy entry into output.
+ *
+ * Regular output files share the blocks of the entry, if the file system
+ * supports reflinks. Entry is closed.
+ *
+ * @arg entry the entry of `cache_lookup()` or `cache_commit()`
+ * @arg output opened output stream
+ * @return true if the entry was copied
+ */
+bool cache_deliver(FILE* entry, FILE* output);
+
+
+/**
+ * Release input read by `cache_open()`.
+ *
+ * @arg cache the cache
+ */
+void cache_close(struct bmp_cache* cache);
+
+
+/**
+ * Remove least recently used entries.
+ *
+ * Stale temporary files of interrupted writers are removed too.
+ *
+ * @arg dir the cache directory
+ * @arg max_size size limit of the directory in bytes
+ * @return number of removed entries
+ */
+size_t cache_evict(const char* dir, uint64_t max_size);
+
+#endif
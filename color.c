@@ -0,0 +1,408 @@
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+
+#include "color.h"
+#include "parallel.h"
+#include "bmp.h"
+
+// HELPER MACROS
+// ================================================================================
+
+#define CHECK_NULL(ptr)    \
+    {                      \
+        if ((ptr) == NULL) \
+        {                  \
+            return NULL;   \
+        }                  \
+    }
+
+#define CHUNK_PIXELS 256    // pixels split into planes at once on the stack
+#define VECTOR_PIXELS 16    // pixels mixed into luma at once
+
+/* BT.601 luma weights in 8-bit fixed point, they sum to 256 */
+enum LUMA
+{
+    LUMA_BLUE = 29,
+    LUMA_GREEN = 150,
+    LUMA_RED = 77
+};
+
+/* chain application shared by all bands */
+struct color_pass
+{
+    const struct bmp_image *src;
+    struct bmp_image *dst;
+    const struct color_ops *ops;
+    bool pre_identity;  // lookups of `pre` are skipped
+    bool post_identity; // lookups of `post` are skipped
+};
+
+// HELPER DECLARATION
+// ================================================================================
+
+extern struct bmp_image *create_bmp(const struct bmp_header *header, uint32_t width, uint32_t height);
+extern void deinterleave_row(const struct pixel *src, uint8_t *const planes[3], uint32_t width);
+extern void interleave_row(const uint8_t *const planes[3], struct pixel *dst, uint32_t width);
+
+/**
+ * Table currently receiving per-channel operations.
+ *
+ * @param ops the chain
+ * @return `post` after grayscale, `pre` otherwise
+ */
+struct color_lut *active_lut(struct color_ops *ops);
+
+/**
+ * Compose the same per-value map into all channels of the active table.
+ *
+ * @param ops the chain
+ * @param map new value of every channel value
+ */
+void compose_map(struct color_ops *ops, const uint8_t map[256]);
+
+/**
+ * Check whether tables map every value to itself.
+ *
+ * @param lut the tables
+ * @return true if every channel is left unchanged
+ */
+bool lut_identity(const struct color_lut *lut);
+
+/**
+ * Apply the chain over band of rows.
+ *
+ * @param ctx the `color_pass` structure
+ * @param start first row of the band
+ * @param end one past the last row of the band
+ */
+void color_rows(void *ctx, uint32_t start, uint32_t end);
+
+/**
+ * Mix planes of channels into luma.
+ *
+ * @param in row of blue, green and red plane
+ * @param out row of luma
+ * @param width number of pixels
+ */
+void luma_row(const uint8_t *const in[3], uint8_t *out, uint32_t width);
+
+/**
+ * Mix channels into luma.
+ *
+ * @param blue the blue channel
+ * @param green the green channel
+ * @param red the red channel
+ * @return the luma
+ */
+static inline uint8_t luma(uint8_t blue, uint8_t green, uint8_t red)
+{
+    return (uint8_t)((LUMA_BLUE * (uint32_t)blue + LUMA_GREEN * (uint32_t)green + LUMA_RED * (uint32_t)red + 128) >> 8);
+}
+
+/**
+ * Clamp value to channel range.
+ *
+ * @param value the value
+ * @return value clamped to 0..255
+ */
+static inline uint8_t clamp_channel(long value)
+{
+    return (uint8_t)(value < 0 ? 0 : value > UINT8_MAX ? UINT8_MAX : value);
+}
+
+// PUBLIC IMPLEMENTATION
+// ================================================================================
+
+void color_ops_init(struct color_ops *ops)
+{
+    for (int v = 0; v < 256; v++)
+    {
+        ops->pre.blue[v] = ops->pre.green[v] = ops->pre.red[v] = (uint8_t)v;
+    }
+    ops->post = ops->pre;
+    ops->grayscale = false;
+}
+
+void color_ops_brightness(struct color_ops *ops, int delta)
+{
+    uint8_t map[256];
+    for (int v = 0; v < 256; v++)
+    {
+        map[v] = clamp_channel(v + delta);
+    }
+    compose_map(ops, map);
+}
+
+void color_ops_contrast(struct color_ops *ops, float factor)
+{
+    uint8_t map[256];
+    for (int v = 0; v < 256; v++)
+    {
+        map[v] = clamp_channel(lroundf((float)(v - 128) * factor + 128.0f));
+    }
+    compose_map(ops, map);
+}
+
+bool color_ops_gamma(struct color_ops *ops, float gamma)
+{
+    if (!(gamma > 0))
+    {
+        return false;
+    }
+
+    uint8_t map[256];
+    for (int v = 0; v < 256; v++)
+    {
+        map[v] = clamp_channel(lround(255.0 * pow(v / 255.0, 1.0 / gamma)));
+    }
+    compose_map(ops, map);
+    return true;
+}
+
+void color_ops_invert(struct color_ops *ops)
+{
+    uint8_t map[256];
+    for (int v = 0; v < 256; v++)
+    {
+        map[v] = (uint8_t)(UINT8_MAX - v);
+    }
+    compose_map(ops, map);
+}
+
+bool color_ops_levels(struct color_ops *ops, uint8_t low, uint8_t high)
+{
+    if (low >= high)
+    {
+        return false;
+    }
+
+    uint8_t map[256];
+    for (int v = 0; v < 256; v++)
+    {
+        map[v] = clamp_channel(((v - low) * UINT8_MAX + (high - low) / 2) / (high - low));
+    }
+    compose_map(ops, map);
+    return true;
+}
+
+bool color_ops_extract(struct color_ops *ops, const char *colors_to_keep)
+{
+    if (colors_to_keep == NULL)
+    {
+        return false;
+    }
+
+    struct color_lut mask;
+    memset(&mask, 0, sizeof(mask));
+    for (int c, i = 0; (c = colors_to_keep[i]) != '\0'; i++)
+    {
+        for (int v = 0; v < 256; v++)
+        {
+            switch (c)
+            {
+            case 'b':
+                mask.blue[v] = (uint8_t)v;
+                break;
+            case 'g':
+                mask.green[v] = (uint8_t)v;
+                break;
+            case 'r':
+                mask.red[v] = (uint8_t)v;
+                break;
+            default:
+                return false;
+            }
+        }
+    }
+
+    color_ops_lut(ops, &mask);
+    return true;
+}
+
+void color_ops_grayscale(struct color_ops *ops)
+{
+    if (!ops->grayscale)
+    {
+        ops->grayscale = true;
+        return;
+    }
+
+    // luma of post table is function of luma only, fold second conversion into post
+    for (int v = 0; v < 256; v++)
+    {
+        uint8_t y = luma(ops->post.blue[v], ops->post.green[v], ops->post.red[v]);
+        ops->post.blue[v] = ops->post.green[v] = ops->post.red[v] = y;
+    }
+}
+
+void color_ops_lut(struct color_ops *ops, const struct color_lut *lut)
+{
+    struct color_lut *active = active_lut(ops);
+    for (int v = 0; v < 256; v++)
+    {
+        active->blue[v] = lut->blue[active->blue[v]];
+        active->green[v] = lut->green[active->green[v]];
+        active->red[v] = lut->red[active->red[v]];
+    }
+}
+
+struct bmp_image *apply_color_ops(const struct bmp_image *image, const struct color_ops *ops)
+{
+    CHECK_NULL(image);
+    CHECK_NULL(ops);
+
+    struct bmp_image *copy = create_bmp(image->header, image->header->width, image->header->height);
+    CHECK_NULL(copy);
+    *copy->header = *image->header; // point operations keep metadata untouched
+
+    struct color_pass pass = {image, copy, ops, lut_identity(&ops->pre), lut_identity(&ops->post)};
+    parallel_rows(image->header->height, color_rows, &pass);
+
+    return copy;
+}
+
+bool apply_color_ops_inplace(struct bmp_image *image, const struct color_ops *ops)
+{
+    if (ops == NULL || !bmp_make_writable(image))
+    {
+        return false;
+    }
+
+    // every pixel is read before it is overwritten
+    struct color_pass pass = {image, image, ops, lut_identity(&ops->pre), lut_identity(&ops->post)};
+    parallel_rows(image->header->height, color_rows, &pass);
+
+    return true;
+}
+
+// HELPER IMPLEMENTATION
+// ================================================================================
+
+struct color_lut *active_lut(struct color_ops *ops)
+{
+    return ops->grayscale ? &ops->post : &ops->pre;
+}
+
+void compose_map(struct color_ops *ops, const uint8_t map[256])
+{
+    struct color_lut lut;
+    memcpy(lut.blue, map, 256);
+    memcpy(lut.green, map, 256);
+    memcpy(lut.red, map, 256);
+    color_ops_lut(ops, &lut);
+}
+
+bool lut_identity(const struct color_lut *lut)
+{
+    for (int v = 0; v < 256; v++)
+    {
+        if (lut->blue[v] != v || lut->green[v] != v || lut->red[v] != v)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+void color_rows(void *ctx, uint32_t start, uint32_t end)
+{
+    const struct color_pass *pass = ctx;
+    const struct color_lut *pre = &pass->ops->pre;
+    const struct color_lut *post = &pass->ops->post;
+    uint32_t width = pass->src->header->width;
+    uint8_t buffer[4][CHUNK_PIXELS];
+    uint8_t *const planes[3] = {buffer[0], buffer[1], buffer[2]};
+    uint8_t *gray = buffer[3];
+    const uint8_t *const grays[3] = {gray, gray, gray};
+
+    for (uint32_t row = start; row < end; row++)
+    {
+        const struct pixel *src = bmp_row(pass->src, row);
+        struct pixel *dst = bmp_row(pass->dst, row);
+
+        if (!pass->ops->grayscale)
+        {
+            for (uint32_t i = 0; i < width; i++)
+            {
+                dst[i].blue = pre->blue[src[i].blue];
+                dst[i].green = pre->green[src[i].green];
+                dst[i].red = pre->red[src[i].red];
+            }
+            continue;
+        }
+
+        // channels are split in chunks small enough to stay in L1 cache and mixed over planes,
+        // every chunk is read before it is overwritten
+        for (uint32_t col = 0; col < width; col += CHUNK_PIXELS)
+        {
+            uint32_t count = width - col < CHUNK_PIXELS ? width - col : CHUNK_PIXELS;
+            if (pass->pre_identity)
+            {
+                deinterleave_row(src + col, planes, count);
+            }
+            else
+            {
+                for (uint32_t i = 0; i < count; i++)
+                {
+                    planes[0][i] = pre->blue[src[col + i].blue];
+                    planes[1][i] = pre->green[src[col + i].green];
+                    planes[2][i] = pre->red[src[col + i].red];
+                }
+            }
+
+            luma_row((const uint8_t *const *)planes, gray, count);
+
+            if (pass->post_identity)
+            {
+                interleave_row(grays, dst + col, count);
+                continue;
+            }
+            for (uint32_t i = 0; i < count; i++)
+            {
+                dst[col + i].blue = post->blue[gray[i]];
+                dst[col + i].green = post->green[gray[i]];
+                dst[col + i].red = post->red[gray[i]];
+            }
+        }
+    }
+}
+
+void luma_row(const uint8_t *const in[3], uint8_t *out, uint32_t width)
+{
+    uint32_t col = 0;
+
+#ifdef __AVX2__
+    // blue and green pairs, then red with zero, are multiplied and summed into 32 bits by madd
+    __m256i zero = _mm256_setzero_si256();
+    __m256i blue_green = _mm256_set1_epi32(LUMA_BLUE | LUMA_GREEN << 16);
+    __m256i red = _mm256_set1_epi32(LUMA_RED);
+    __m256i half = _mm256_set1_epi32(128);
+
+    for (; col + VECTOR_PIXELS <= width; col += VECTOR_PIXELS)
+    {
+        __m256i b = _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i *)(in[0] + col)));
+        __m256i g = _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i *)(in[1] + col)));
+        __m256i r = _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i *)(in[2] + col)));
+        __m256i lo = _mm256_add_epi32(_mm256_add_epi32(_mm256_madd_epi16(_mm256_unpacklo_epi16(b, g), blue_green),
+                                                       _mm256_madd_epi16(_mm256_unpacklo_epi16(r, zero), red)),
+                                      half);
+        __m256i hi = _mm256_add_epi32(_mm256_add_epi32(_mm256_madd_epi16(_mm256_unpackhi_epi16(b, g), blue_green),
+                                                       _mm256_madd_epi16(_mm256_unpackhi_epi16(r, zero), red)),
+                                      half);
+
+        // unpack and pack both stay within 128-bit lanes, so pixels come back in order
+        __m256i words = _mm256_packs_epi32(_mm256_srli_epi32(lo, 8), _mm256_srli_epi32(hi, 8));
+        __m256i bytes = _mm256_permute4x64_epi64(_mm256_packus_epi16(words, words), 0x08);
+        _mm_storeu_si128((__m128i *)(out + col), _mm256_castsi256_si128(bytes));
+    }
+#endif
+
+    for (; col < width; col++)
+    {
+        out[col] = luma(in[0][col], in[1][col], in[2][col]);
+    }
+}
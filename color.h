@@ -0,0 +1,146 @@
+#ifndef _COLOR_H
+#define _COLOR_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "bmp.h"
+
+
+/**
+ * Lookup tables mapping every channel value to a new one.
+ */
+struct color_lut {
+    uint8_t blue[256];
+    uint8_t green[256];
+    uint8_t red[256];
+};
+
+
+/**
+ * Chain of point operations compiled into lookup tables.
+ *
+ * Every per-channel operation added to the chain is composed into one table,
+ * so any sequence of operations costs a single pass over the pixels.
+ * Grayscale mixes channels, operations before it compose into `pre`,
+ * operations after it into `post`.
+ */
+struct color_ops {
+    struct color_lut pre;       // applied to source channels
+    bool grayscale;             // channels of `pre` are mixed into luma
+    struct color_lut post;      // applied to luma, identity without grayscale
+};
+
+
+/**
+ * Initialize empty chain of point operations.
+ *
+ * @arg ops the chain
+ */
+void color_ops_init(struct color_ops* ops);
+
+
+/**
+ * Add brightness change to the chain.
+ *
+ * @arg ops the chain
+ * @arg delta value added to every channel, result is clamped
+ */
+void color_ops_brightness(struct color_ops* ops, int delta);
+
+
+/**
+ * Add contrast change to the chain.
+ *
+ * @arg ops the chain
+ * @arg factor scale of the distance from mid gray, 1.0 keeps the image
+ */
+void color_ops_contrast(struct color_ops* ops, float factor);
+
+
+/**
+ * Add gamma correction to the chain.
+ *
+ * @arg ops the chain
+ * @arg gamma the gamma, values above 1.0 brighten the image
+ * @return `true` on success, `false` if gamma is not positive
+ */
+bool color_ops_gamma(struct color_ops* ops, float gamma);
+
+
+/**
+ * Add inversion to the chain.
+ *
+ * @arg ops the chain
+ */
+void color_ops_invert(struct color_ops* ops);
+
+
+/**
+ * Add levels adjustment to the chain.
+ *
+ * Values in range <low, high> are stretched to <0, 255>, values outside are clamped.
+ *
+ * @arg ops the chain
+ * @arg low input black point
+ * @arg high input white point
+ * @return `true` on success, `false` if low is not smaller than high
+ */
+bool color_ops_levels(struct color_ops* ops, uint8_t low, uint8_t high);
+
+
+/**
+ * Add channel extraction to the chain.
+ *
+ * Same as `extract()`, channels which are not kept are set to 0.
+ *
+ * @arg ops the chain
+ * @arg colors_to_keep [bgr],b-blue, g-green, r-red
+ * @return `true` on success, `false` if color definition is not valid
+ */
+bool color_ops_extract(struct color_ops* ops, const char* colors_to_keep);
+
+
+/**
+ * Add grayscale conversion to the chain.
+ *
+ * Channels are mixed with integer BT.601 luma weights.
+ *
+ * @arg ops the chain
+ */
+void color_ops_grayscale(struct color_ops* ops);
+
+
+/**
+ * Add arbitrary lookup tables to the chain.
+ *
+ * @arg ops the chain
+ * @arg lut tables applied to the current result of the chain
+ */
+void color_ops_lut(struct color_ops* ops, const struct color_lut* lut);
+
+
+/**
+ * Apply chain of point operations.
+ *
+ * Creates copy of image with all operations of the chain applied in one pass.
+ *
+ * @arg image the image
+ * @arg ops the chain
+ * @return the copy of image with operations applied or null, if there is no image or chain (NULL given)
+ */
+struct bmp_image* apply_color_ops(const struct bmp_image* image, const struct color_ops* ops);
+
+
+/**
+ * Apply chain of point operations in place.
+ *
+ * Pixels are copied first only if they are shared with another image.
+ *
+ * @arg image the image
+ * @arg ops the chain
+ * @return true on success, false if there is no image or chain (NULL given) or memory allocation failed
+ */
+bool apply_color_ops_inplace(struct bmp_image* image, const struct color_ops* ops);
+
+#endif
@@ -0,0 +1,418 @@
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+
+#include "colorspace.h"
+#include "parallel.h"
+#include "bmp.h"
+
+// HELPER MACROS
+// ================================================================================
+
+#define CHECK_NULL(ptr)    \
+    {                      \
+        if ((ptr) == NULL) \
+        {                  \
+            return NULL;   \
+        }                  \
+    }
+
+#define MIX_BITS 13         // fixed point weights, 1.0 == 1 << 13, inverse weights stay below 4.0
+#define CHUNK_PIXELS 256    // pixels deinterleaved at once on the stack
+#define VECTOR_PIXELS 16    // pixels mixed at once
+
+/* affine map of channels, rows and columns in blue, green, red order */
+struct mix
+{
+    int16_t weights[3][3];
+    int32_t bias[3];        // includes rounding
+};
+
+/* conversion shared by all bands */
+struct conversion
+{
+    const struct bmp_image *src;
+    struct bmp_image *dst;
+    const struct mix *mix;
+};
+
+// HELPER DECLARATION
+// ================================================================================
+
+/**
+ * Build map of conversion into color space.
+ *
+ * @param space YCbCr or luma space
+ * @param forward true to convert from RGB, false to RGB
+ * @param mix receives the map
+ */
+void build_mix(const struct color_space *space, bool forward, struct mix *mix);
+
+/**
+ * Mix one row of planes.
+ *
+ * @param mix the map
+ * @param in blue, green and red input planes
+ * @param out blue, green and red output planes
+ * @param width number of pixels
+ */
+void mix_row(const struct mix *mix, const uint8_t *const in[3], uint8_t *const out[3], uint32_t width);
+
+/**
+ * Mix band of rows.
+ *
+ * @param ctx the `conversion` structure
+ * @param start first row of the band
+ * @param end one past the last row of the band
+ */
+void mix_band(void *ctx, uint32_t start, uint32_t end);
+
+/**
+ * Convert band of rows into HSV.
+ *
+ * @param ctx the `conversion` structure
+ * @param start first row of the band
+ * @param end one past the last row of the band
+ */
+void to_hsv_band(void *ctx, uint32_t start, uint32_t end);
+
+/**
+ * Convert band of rows from HSV.
+ *
+ * @param ctx the `conversion` structure
+ * @param start first row of the band
+ * @param end one past the last row of the band
+ */
+void from_hsv_band(void *ctx, uint32_t start, uint32_t end);
+
+/**
+ * Convert image by band worker.
+ *
+ * @param image the image
+ * @param mix the map or NULL, if the worker does not use it
+ * @param worker the band worker
+ * @return the converted copy or NULL, if allocation failed
+ */
+struct bmp_image *convert(const struct bmp_image *image, const struct mix *mix, band_worker worker);
+
+/**
+ * Clamp value to channel range.
+ *
+ * @param value the value
+ * @return value clamped to 0..255
+ */
+static inline uint8_t clamp_channel(int32_t value)
+{
+    return (uint8_t)(value < 0 ? 0 : value > UINT8_MAX ? UINT8_MAX : value);
+}
+
+// PUBLIC IMPLEMENTATION
+// ================================================================================
+
+extern struct bmp_image *create_bmp(const struct bmp_header *header, uint32_t width, uint32_t height);
+extern void deinterleave_row(const struct pixel *src, uint8_t *const planes[3], uint32_t width);
+extern void interleave_row(const uint8_t *const planes[3], struct pixel *dst, uint32_t width);
+
+bool parse_color_space(const char *name, struct color_space *space)
+{
+    if (name == NULL || space == NULL)
+    {
+        return false;
+    }
+
+    if (strcmp(name, "hsv") == 0)
+    {
+        *space = (struct color_space){MODEL_HSV, MATRIX_BT601, false};
+        return true;
+    }
+
+    struct color_space parsed = {MODEL_YCBCR, MATRIX_BT601, false};
+    if (strncmp(name, "ycbcr", 5) == 0)
+    {
+        name += 5;
+    }
+    else if (strncmp(name, "luma", 4) == 0)
+    {
+        parsed.model = MODEL_LUMA;
+        name += 4;
+    }
+    else
+    {
+        return false;
+    }
+
+    if (strncmp(name, "601", 3) == 0 || strncmp(name, "709", 3) == 0)
+    {
+        parsed.matrix = name[0] == '7' ? MATRIX_BT709 : MATRIX_BT601;
+        name += 3;
+    }
+    if (strcmp(name, "-limited") == 0)
+    {
+        parsed.limited = true;
+        name += strlen(name);
+    }
+    if (*name != '\0')
+    {
+        return false;
+    }
+
+    *space = parsed;
+    return true;
+}
+
+int color_space_components(const struct color_space *space)
+{
+    return space != NULL && space->model == MODEL_LUMA ? 1 : 3;
+}
+
+struct bmp_image *to_color_space(const struct bmp_image *image, const struct color_space *space)
+{
+    CHECK_NULL(image);
+    CHECK_NULL(space);
+
+    if (space->model == MODEL_HSV)
+    {
+        return convert(image, NULL, to_hsv_band);
+    }
+
+    struct mix mix;
+    build_mix(space, true, &mix);
+    return convert(image, &mix, mix_band);
+}
+
+struct bmp_image *from_color_space(const struct bmp_image *image, const struct color_space *space)
+{
+    CHECK_NULL(image);
+    CHECK_NULL(space);
+
+    if (space->model == MODEL_HSV)
+    {
+        return convert(image, NULL, from_hsv_band);
+    }
+
+    struct mix mix;
+    build_mix(space, false, &mix);
+    return convert(image, &mix, mix_band);
+}
+
+// HELPER IMPLEMENTATION
+// ================================================================================
+
+void build_mix(const struct color_space *space, bool forward, struct mix *mix)
+{
+    double kr = space->matrix == MATRIX_BT709 ? 0.2126 : 0.299;
+    double kb = space->matrix == MATRIX_BT709 ? 0.0722 : 0.114;
+    double luma_scale = space->limited ? 219.0 / 255.0 : 1.0;
+    double chroma_scale = space->limited ? 224.0 / 255.0 : 1.0;
+    double luma_offset = space->limited ? 16.0 : 0.0;
+
+    // components of the space are stored red first, so blue row holds Cr and red row holds Y
+    double y[3] = {kb * luma_scale, (1.0 - kr - kb) * luma_scale, kr * luma_scale};
+    double m[3][3], offset[3];
+    for (int c = 0; c < 3; c++)
+    {
+        double blue = c == 0 ? 1.0 : 0.0;
+        double red = c == 2 ? 1.0 : 0.0;
+        m[0][c] = (red - y[c] / luma_scale) / (2.0 * (1.0 - kr)) * chroma_scale;
+        m[1][c] = (blue - y[c] / luma_scale) / (2.0 * (1.0 - kb)) * chroma_scale;
+        m[2][c] = y[c];
+    }
+    offset[0] = offset[1] = 128.0;
+    offset[2] = luma_offset;
+
+    if (space->model == MODEL_LUMA)
+    {
+        // luma fills all channels, it is read back from red
+        for (int r = 0; r < 3; r++)
+        {
+            for (int c = 0; c < 3; c++)
+            {
+                m[r][c] = forward ? y[c] : c == 2 ? 1.0 / luma_scale : 0.0;
+            }
+            offset[r] = forward ? luma_offset : -luma_offset / luma_scale;
+        }
+    }
+    else if (!forward)
+    {
+        // inverse of the affine map
+        double det = m[0][0] * (m[1][1] * m[2][2] - m[1][2] * m[2][1]) -
+                     m[0][1] * (m[1][0] * m[2][2] - m[1][2] * m[2][0]) +
+                     m[0][2] * (m[1][0] * m[2][1] - m[1][1] * m[2][0]);
+        double inverse[3][3];
+        for (int r = 0; r < 3; r++)
+        {
+            for (int c = 0; c < 3; c++)
+            {
+                int r1 = (c + 1) % 3, r2 = (c + 2) % 3;
+                int c1 = (r + 1) % 3, c2 = (r + 2) % 3;
+                inverse[r][c] = (m[r1][c1] * m[r2][c2] - m[r1][c2] * m[r2][c1]) / det;
+            }
+        }
+        double inverse_offset[3];
+        for (int r = 0; r < 3; r++)
+        {
+            inverse_offset[r] = -(inverse[r][0] * offset[0] + inverse[r][1] * offset[1] + inverse[r][2] * offset[2]);
+        }
+        memcpy(m, inverse, sizeof(m));
+        memcpy(offset, inverse_offset, sizeof(offset));
+    }
+
+    for (int r = 0; r < 3; r++)
+    {
+        for (int c = 0; c < 3; c++)
+        {
+            mix->weights[r][c] = (int16_t)lround(m[r][c] * (1 << MIX_BITS));
+        }
+        mix->bias[r] = (int32_t)lround(offset[r] * (1 << MIX_BITS)) + (1 << (MIX_BITS - 1));
+    }
+}
+
+void mix_row(const struct mix *mix, const uint8_t *const in[3], uint8_t *const out[3], uint32_t width)
+{
+    uint32_t col = 0;
+
+#ifdef __AVX2__
+    // pairs of 16-bit channels are multiplied and summed into 32 bits by one madd
+    __m256i zero = _mm256_setzero_si256();
+    __m256i blue_green[3], red[3], bias[3];
+    for (int r = 0; r < 3; r++)
+    {
+        blue_green[r] = _mm256_set1_epi32((int32_t)((uint32_t)(uint16_t)mix->weights[r][0] |
+                                                    (uint32_t)(uint16_t)mix->weights[r][1] << 16));
+        red[r] = _mm256_set1_epi32((int32_t)(uint16_t)mix->weights[r][2]);
+        bias[r] = _mm256_set1_epi32(mix->bias[r]);
+    }
+
+    for (; col + VECTOR_PIXELS <= width; col += VECTOR_PIXELS)
+    {
+        __m256i b = _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i *)(in[0] + col)));
+        __m256i g = _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i *)(in[1] + col)));
+        __m256i r = _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i *)(in[2] + col)));
+        __m256i bg_lo = _mm256_unpacklo_epi16(b, g), bg_hi = _mm256_unpackhi_epi16(b, g);
+        __m256i r_lo = _mm256_unpacklo_epi16(r, zero), r_hi = _mm256_unpackhi_epi16(r, zero);
+
+        for (int k = 0; k < 3; k++)
+        {
+            __m256i lo = _mm256_add_epi32(_mm256_add_epi32(_mm256_madd_epi16(bg_lo, blue_green[k]),
+                                                           _mm256_madd_epi16(r_lo, red[k])),
+                                          bias[k]);
+            __m256i hi = _mm256_add_epi32(_mm256_add_epi32(_mm256_madd_epi16(bg_hi, blue_green[k]),
+                                                           _mm256_madd_epi16(r_hi, red[k])),
+                                          bias[k]);
+
+            // unpack and pack both stay within 128-bit lanes, so pixels come back in order
+            __m256i words = _mm256_packs_epi32(_mm256_srai_epi32(lo, MIX_BITS), _mm256_srai_epi32(hi, MIX_BITS));
+            __m256i bytes = _mm256_permute4x64_epi64(_mm256_packus_epi16(words, words), 0x08);
+            _mm_storeu_si128((__m128i *)(out[k] + col), _mm256_castsi256_si128(bytes));
+        }
+    }
+#endif
+
+    for (; col < width; col++)
+    {
+        int32_t b = in[0][col], g = in[1][col], r = in[2][col];
+        for (int k = 0; k < 3; k++)
+        {
+            int32_t acc = mix->weights[k][0] * b + mix->weights[k][1] * g + mix->weights[k][2] * r + mix->bias[k];
+            out[k][col] = clamp_channel(acc >> MIX_BITS);
+        }
+    }
+}
+
+void mix_band(void *ctx, uint32_t start, uint32_t end)
+{
+    const struct conversion *conversion = ctx;
+    uint32_t width = conversion->src->header->width;
+    uint8_t buffer[6][CHUNK_PIXELS];
+    uint8_t *const in[3] = {buffer[0], buffer[1], buffer[2]};
+    uint8_t *const out[3] = {buffer[3], buffer[4], buffer[5]};
+
+    // channels are split in chunks small enough to stay in L1 cache
+    for (uint32_t row = start; row < end; row++)
+    {
+        const struct pixel *src = bmp_row(conversion->src, row);
+        struct pixel *dst = bmp_row(conversion->dst, row);
+        for (uint32_t col = 0; col < width; col += CHUNK_PIXELS)
+        {
+            uint32_t count = width - col < CHUNK_PIXELS ? width - col : CHUNK_PIXELS;
+            deinterleave_row(src + col, in, count);
+            mix_row(conversion->mix, (const uint8_t *const *)in, out, count);
+            interleave_row((const uint8_t *const *)out, dst + col, count);
+        }
+    }
+}
+
+void to_hsv_band(void *ctx, uint32_t start, uint32_t end)
+{
+    const struct conversion *conversion = ctx;
+    uint32_t width = conversion->src->header->width;
+
+    for (uint32_t row = start; row < end; row++)
+    {
+        const struct pixel *src = bmp_row(conversion->src, row);
+        struct pixel *dst = bmp_row(conversion->dst, row);
+        for (uint32_t col = 0; col < width; col++)
+        {
+            int32_t b = src[col].blue, g = src[col].green, r = src[col].red;
+            int32_t max = r > g ? (r > b ? r : b) : (g > b ? g : b);
+            int32_t min = r < g ? (r < b ? r : b) : (g < b ? g : b);
+            int32_t delta = max - min;
+
+            // hue in 1/256 of a turn, sector of the largest channel plus signed offset
+            int32_t hue = 0;
+            if (delta != 0)
+            {
+                int32_t sector = max == r ? 0 : max == g ? 1 : 2;
+                int32_t diff = max == r ? g - b : max == g ? b - r : r - g;
+                int32_t den = 6 * delta;
+                hue = ((256 * (2 * sector * delta + diff + den) + den / 2) / den) & 0xFF;
+            }
+
+            dst[col].red = (uint8_t)hue;
+            dst[col].green = (uint8_t)(max == 0 ? 0 : (255 * delta + max / 2) / max);
+            dst[col].blue = (uint8_t)max;
+        }
+    }
+}
+
+void from_hsv_band(void *ctx, uint32_t start, uint32_t end)
+{
+    const struct conversion *conversion = ctx;
+    uint32_t width = conversion->src->header->width;
+
+    for (uint32_t row = start; row < end; row++)
+    {
+        const struct pixel *src = bmp_row(conversion->src, row);
+        struct pixel *dst = bmp_row(conversion->dst, row);
+        for (uint32_t col = 0; col < width; col++)
+        {
+            int32_t h = src[col].red, s = src[col].green, v = src[col].blue;
+            int32_t sector = h * 6 / 256;
+            int32_t f = h * 6 % 256;
+
+            uint8_t p = (uint8_t)((v * (255 - s) + 127) / 255);
+            uint8_t q = (uint8_t)((v * (255 * 256 - s * f) + 255 * 128) / (255 * 256));
+            uint8_t t = (uint8_t)((v * (255 * 256 - s * (256 - f)) + 255 * 128) / (255 * 256));
+            uint8_t value = (uint8_t)v;
+
+            static const int order[6][3] = {{0, 2, 1}, {3, 0, 1}, {1, 0, 2}, {1, 3, 0}, {2, 1, 0}, {0, 1, 3}};
+            const uint8_t parts[4] = {value, p, t, q};
+            dst[col].red = parts[order[sector][0]];
+            dst[col].green = parts[order[sector][1]];
+            dst[col].blue = parts[order[sector][2]];
+        }
+    }
+}
+
+struct bmp_image *convert(const struct bmp_image *image, const struct mix *mix, band_worker worker)
+{
+    struct bmp_image *copy = create_bmp(image->header, image->header->width, image->header->height);
+    CHECK_NULL(copy);
+
+    struct conversion conversion = {image, copy, mix};
+    parallel_rows(image->header->height, worker, &conversion);
+    return copy;
+}
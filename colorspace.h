@@ -0,0 +1,89 @@
+#ifndef _COLORSPACE_H
+#define _COLORSPACE_H
+
+#include <stdbool.h>
+
+#include "bmp.h"
+
+
+/**
+ * Kinds of color spaces.
+ */
+enum color_model {
+    MODEL_YCBCR,                    // luma and two color differences
+    MODEL_HSV,                      // hue, saturation and value, hue 0-255 is one full turn
+    MODEL_LUMA                      // luma only
+};
+
+
+/**
+ * Luma weights of YCbCr and luma spaces.
+ */
+enum ycbcr_matrix {
+    MATRIX_BT601,
+    MATRIX_BT709
+};
+
+
+/**
+ * Color space of converted pixels.
+ *
+ * Converted images keep the BMP container, components are stored in the
+ * channels in reading order: the first one in red, the second one in green
+ * and the third one in blue. Luma is stored in all three channels.
+ */
+struct color_space {
+    enum color_model model;
+    enum ycbcr_matrix matrix;       // ignored by HSV
+    bool limited;                   // luma 16-235 and differences 16-240 instead of 0-255, ignored by HSV
+};
+
+
+/**
+ * Parse name of color space.
+ *
+ * Names are `hsv`, `ycbcr` and `luma`, the last two optionally followed by
+ * `601` (default) or `709` and by `-limited`, e.g. `ycbcr709-limited`.
+ *
+ * @arg name the name
+ * @arg space receives the space
+ * @return true if the name is known
+ */
+bool parse_color_space(const char* name, struct color_space* space);
+
+
+/**
+ * Number of components of color space.
+ *
+ * @arg space the space
+ * @return 1 for luma, 3 otherwise
+ */
+int color_space_components(const struct color_space* space);
+
+
+/**
+ * Convert image into color space.
+ *
+ * YCbCr and luma are fixed point matrix products computed on 16 pixels at
+ * once with AVX2 where available, HSV is computed per pixel. Bands of rows
+ * are converted in parallel.
+ *
+ * @arg image the image
+ * @arg space the target space
+ * @return the converted copy of image or NULL, if there is no image or space (NULL given) or memory allocation fails
+ */
+struct bmp_image* to_color_space(const struct bmp_image* image, const struct color_space* space);
+
+
+/**
+ * Convert image from color space back to RGB.
+ *
+ * Rounding makes the round trip exact only up to one or two levels per channel.
+ *
+ * @arg image the image holding components of the space
+ * @arg space the source space
+ * @return the converted copy of image or NULL, if there is no image or space (NULL given) or memory allocation fails
+ */
+struct bmp_image* from_color_space(const struct bmp_image* image, const struct color_space* space);
+
+#endif
@@ -0,0 +1,289 @@
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+
+#include "dedupe.h"
+#include "transformations.h"
+#include "parallel.h"
+#include "batch.h"
+#include "hash.h"
+#include "bmp.h"
+
+// HELPER MACROS
+// ================================================================================
+
+#define CHECK_NULL(ptr)    \
+    {                      \
+        if ((ptr) == NULL) \
+        {                  \
+            return NULL;   \
+        }                  \
+    }
+
+/* hashing shared by all bands */
+struct dedupe_pass
+{
+    struct bmp_image *const *images;
+    struct dedupe_entry *entries;
+    bool canonical;
+};
+
+/* image ordered by hash */
+struct hash_index
+{
+    uint64_t hash;
+    size_t index;
+};
+
+static const char *ORIENTATION_NAMES[ORIENTATIONS] = {
+    "identity", "flip-horizontal", "flip-vertical", "rotate-180",
+    "rotate-right", "rotate-left", "transpose", "transverse"};
+
+// HELPER DECLARATION
+// ================================================================================
+
+/**
+ * Hash band of images.
+ *
+ * @param ctx the `dedupe_pass` structure
+ * @param start index of the first image of the band
+ * @param end one past the index of the last image of the band
+ */
+void hash_images(void *ctx, uint32_t start, uint32_t end);
+
+/**
+ * Order by hash, then by index.
+ *
+ * @param a the first `hash_index`
+ * @param b the second `hash_index`
+ * @return negative if the first goes first
+ */
+int compare_hash_index(const void *a, const void *b);
+
+/**
+ * Compare pixels of two images in their canonical orientations.
+ *
+ * @param a the first image
+ * @param a_orientation canonical orientation of the first image
+ * @param b the second image
+ * @param b_orientation canonical orientation of the second image
+ * @return true if dimensions and all pixels are equal
+ */
+bool same_pixels(const struct bmp_image *a, enum orientation a_orientation, const struct bmp_image *b, enum orientation b_orientation);
+
+// PUBLIC IMPLEMENTATION
+// ================================================================================
+
+struct bmp_image *orient_image(const struct bmp_image *image, enum orientation orientation)
+{
+    CHECK_NULL(image);
+
+    switch (orientation)
+    {
+    case ORIENT_IDENTITY:
+        return copy_bmp(image);
+    case ORIENT_FLIP_HORIZONTAL:
+        return flip_horizontally(image);
+    case ORIENT_FLIP_VERTICAL:
+        return flip_vertically(image);
+    case ORIENT_ROTATE_180:
+        return rotate_180(image);
+    case ORIENT_ROTATE_RIGHT:
+        return rotate_right(image);
+    case ORIENT_ROTATE_LEFT:
+        return rotate_left(image);
+    case ORIENT_TRANSPOSE:
+        return transpose(image);
+    case ORIENT_TRANSVERSE:
+        return transverse(image);
+    default:
+        return NULL;
+    }
+}
+
+const char *orientation_name(enum orientation orientation)
+{
+    return orientation < ORIENTATIONS ? ORIENTATION_NAMES[orientation] : "unknown";
+}
+
+size_t dedupe_images(struct bmp_image *const *images, size_t count, bool canonical, struct dedupe_entry *entries)
+{
+    if (images == NULL || entries == NULL || count == 0 || count > UINT32_MAX)
+    {
+        return 0;
+    }
+
+    struct hash_index *order = malloc(count * sizeof(struct hash_index));
+    if (order == NULL)
+    {
+        return 0;
+    }
+
+    struct dedupe_pass pass = {images, entries, canonical};
+    parallel_rows((uint32_t)count, hash_images, &pass);
+
+    for (size_t i = 0; i < count; i++)
+    {
+        order[i] = (struct hash_index){entries[i].hash, i};
+    }
+    qsort(order, count, sizeof(struct hash_index), compare_hash_index);
+
+    // only images of equal hash are compared, each joins the first equal one
+    size_t groups = 0;
+    for (size_t run = 0, end; run < count; run = end)
+    {
+        for (end = run; end < count && order[end].hash == order[run].hash; end++)
+        {
+            size_t i = order[end].index;
+            entries[i].group = i;
+            for (size_t k = run; k < end; k++)
+            {
+                size_t j = order[k].index;
+                if (entries[j].group == j &&
+                    same_pixels(images[j], entries[j].orientation, images[i], entries[i].orientation))
+                {
+                    entries[i].group = j;
+                    break;
+                }
+            }
+            groups += entries[i].group == i;
+        }
+    }
+
+    free(order);
+    return groups;
+}
+
+bool write_dedupe_manifest(FILE *stream, char *const *names, const struct dedupe_entry *entries, size_t count, bool csv)
+{
+    if (stream == NULL || names == NULL || entries == NULL)
+    {
+        return false;
+    }
+
+    if (csv)
+    {
+        fprintf(stream, "name,duplicate_of,hash,orientation\n");
+        for (size_t i = 0; i < count; i++)
+        {
+            size_t group = entries[i].group;
+            fprintf(stream, "%s,%s,%016" PRIx64 ",%s\n", names[i], group == i ? "" : names[group],
+                    entries[i].hash, orientation_name(entries[i].orientation));
+        }
+        return !ferror(stream);
+    }
+
+    // members of every group are linked in the order of images
+    size_t *next = malloc(count * sizeof(size_t));
+    size_t *tail = malloc(count * sizeof(size_t));
+    if (next == NULL || tail == NULL)
+    {
+        free(next);
+        free(tail);
+        return false;
+    }
+
+    size_t groups = 0;
+    for (size_t i = 0; i < count; i++)
+    {
+        size_t group = entries[i].group;
+        next[i] = count;
+        if (group == i)
+        {
+            groups++;
+        }
+        else
+        {
+            next[tail[group]] = i;
+        }
+        tail[group] = i;
+    }
+
+    fprintf(stream, "{\n  \"images\": %zu,\n  \"groups\": %zu,\n  \"duplicates\": [", count, groups);
+    bool first = true;
+    for (size_t i = 0; i < count; i++)
+    {
+        if (entries[i].group != i || next[i] == count)
+        {
+            continue;
+        }
+
+        fprintf(stream, "%s\n    {\"hash\": \"%016" PRIx64 "\", \"images\": [", first ? "" : ",", entries[i].hash);
+        for (size_t j = i; j != count; j = next[j])
+        {
+            fprintf(stream, "%s{\"name\": ", j == i ? "" : ", ");
+            write_json_string(stream, names[j]);
+            fprintf(stream, ", \"orientation\": \"%s\"}", orientation_name(entries[j].orientation));
+        }
+        fprintf(stream, "]}");
+        first = false;
+    }
+    fprintf(stream, "\n  ]\n}\n");
+
+    free(next);
+    free(tail);
+    return !ferror(stream);
+}
+
+// HELPER IMPLEMENTATION
+// ================================================================================
+
+void hash_images(void *ctx, uint32_t start, uint32_t end)
+{
+    const struct dedupe_pass *pass = ctx;
+
+    for (uint32_t i = start; i < end; i++)
+    {
+        struct dedupe_entry *entry = &pass->entries[i];
+        entry->hash = hash_pixels(pass->images[i]);
+        entry->orientation = ORIENT_IDENTITY;
+
+        // symmetric images keep the first orientation of the lowest hash
+        for (int orientation = ORIENT_IDENTITY + 1; pass->canonical && orientation < ORIENTATIONS; orientation++)
+        {
+            struct bmp_image *oriented = orient_image(pass->images[i], (enum orientation)orientation);
+            uint64_t hash = hash_pixels(oriented);
+            if (oriented != NULL && hash < entry->hash)
+            {
+                entry->hash = hash;
+                entry->orientation = (enum orientation)orientation;
+            }
+            free_bmp_image(oriented);
+        }
+    }
+}
+
+int compare_hash_index(const void *a, const void *b)
+{
+    const struct hash_index *first = a;
+    const struct hash_index *second = b;
+
+    if (first->hash != second->hash)
+    {
+        return first->hash < second->hash ? -1 : 1;
+    }
+    if (first->index != second->index)
+    {
+        return first->index < second->index ? -1 : 1;
+    }
+    return 0;
+}
+
+bool same_pixels(const struct bmp_image *a, enum orientation a_orientation, const struct bmp_image *b, enum orientation b_orientation)
+{
+    struct bmp_image *first = orient_image(a, a_orientation);
+    struct bmp_image *second = orient_image(b, b_orientation);
+    bool same = first != NULL && second != NULL &&
+                first->header->width == second->header->width &&
+                first->header->height == second->header->height;
+
+    size_t row_bytes = same ? first->header->width * sizeof(struct pixel) : 0;
+    for (uint32_t row = 0; same && row < first->header->height; row++)
+    {
+        same = memcmp(bmp_row(first, row), bmp_row(second, row), row_bytes) == 0;
+    }
+
+    free_bmp_image(first);
+    free_bmp_image(second);
+    return same;
+}
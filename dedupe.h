@@ -0,0 +1,89 @@
+#ifndef _DEDUPE_H
+#define _DEDUPE_H
+
+#include <stdio.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "bmp.h"
+
+
+/**
+ * The eight orientations of an image, rotations and reflections.
+ */
+enum orientation {
+    ORIENT_IDENTITY,
+    ORIENT_FLIP_HORIZONTAL,
+    ORIENT_FLIP_VERTICAL,
+    ORIENT_ROTATE_180,
+    ORIENT_ROTATE_RIGHT,
+    ORIENT_ROTATE_LEFT,
+    ORIENT_TRANSPOSE,           // reflection along the top-left to bottom-right diagonal
+    ORIENT_TRANSVERSE,          // reflection along the bottom-left to top-right diagonal
+    ORIENTATIONS
+};
+
+
+/**
+ * Duplicate detection result of one image.
+ */
+struct dedupe_entry {
+    uint64_t hash;                  // hash of pixels in canonical orientation
+    enum orientation orientation;   // transforms the image into canonical orientation
+    size_t group;                   // index of the first image with the same pixels
+};
+
+
+/**
+ * Reorient image.
+ *
+ * @arg image the image
+ * @arg orientation the orientation
+ * @return the copy of image in orientation or NULL, if there is no image (NULL given) or orientation is not valid
+ */
+struct bmp_image* orient_image(const struct bmp_image* image, enum orientation orientation);
+
+
+/**
+ * Name of orientation used in manifests.
+ *
+ * @arg orientation the orientation
+ * @return the name, e.g. `rotate-right`
+ */
+const char* orientation_name(enum orientation orientation);
+
+
+/**
+ * Group images with equal pixels.
+ *
+ * Header fields other than dimensions are ignored. Images are hashed in
+ * parallel, images with equal hash are compared pixel by pixel. With
+ * `canonical`, every image is hashed in the orientation with the lowest
+ * hash, so rotated and reflected duplicates are grouped too.
+ *
+ * @arg images the images
+ * @arg count number of images
+ * @arg canonical group images in any orientation
+ * @arg entries receives result of every image
+ * @return number of groups or 0, if there are no images (NULL given) or memory allocation failed
+ */
+size_t dedupe_images(struct bmp_image* const* images, size_t count, bool canonical, struct dedupe_entry* entries);
+
+
+/**
+ * Write groups of duplicates.
+ *
+ * JSON object listing groups with more than one image, or CSV with header
+ * `name,duplicate_of,hash,orientation` listing every image.
+ *
+ * @arg stream opened output stream
+ * @arg names names of the images
+ * @arg entries the results of `dedupe_images()`
+ * @arg count number of images
+ * @arg csv write CSV instead of JSON
+ * @return true if the manifest was written
+ */
+bool write_dedupe_manifest(FILE* stream, char* const* names, const struct dedupe_entry* entries, size_t count, bool csv);
+
+#endif
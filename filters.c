@@ -0,0 +1,580 @@
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <stdatomic.h>
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+
+#include "filters.h"
+#include "parallel.h"
+#include "bmp.h"
+
+// HELPER MACROS
+// ================================================================================
+
+#define CHECK_NULL(ptr)    \
+    {                      \
+        if ((ptr) == NULL) \
+        {                  \
+            return NULL;   \
+        }                  \
+    }
+
+#define PRECISION_BITS 14 // fixed point kernel weights, 1.0 == 1 << 14, fewer bits for heavier kernels
+#define GAUSS_PASSES 3    // box blurs approximating gaussian
+#define VECTOR_BYTES 16   // channels convolved at once
+
+/* one separable pass over bands of rows */
+struct filter_pass
+{
+    const uint8_t *src;
+    uint8_t *dst;
+    size_t src_stride; // bytes per source row, destination rows are contiguous
+    uint32_t width;
+    uint32_t height;
+    enum border_mode border;
+    const int16_t *kernel; // 2 * radius + 1 fixed point weights, NULL for box
+    uint32_t shift;        // fraction bits of the weights
+    uint32_t radius;
+    _Atomic bool failed; // set by band which could not allocate its memory
+};
+
+/* unsharp mask shared by all bands */
+struct unsharp
+{
+    const uint8_t *src;
+    const uint8_t *blurred;
+    uint8_t *dst;
+    size_t src_stride;     // bytes per source row
+    size_t blurred_stride; // bytes per blurred and destination row
+    size_t row_bytes;      // bytes of pixels in a row
+    int32_t amount; // 8.8 fixed point
+    int32_t threshold;
+};
+
+// HELPER DECLARATION
+// ================================================================================
+
+extern struct bmp_image *create_bmp(const struct bmp_header *header, uint32_t width, uint32_t height);
+
+/**
+ * Run horizontal and vertical pass of separable filter.
+ *
+ * @param image the source image
+ * @param pass filter parameters, source and destination are filled in
+ * @param horizontal worker of the horizontal pass
+ * @param vertical worker of the vertical pass
+ * @return the filtered copy of image or `NULL` if memory allocation fails
+ */
+struct bmp_image *separable(const struct bmp_image *image, struct filter_pass pass, band_worker horizontal, band_worker vertical);
+
+/**
+ * Copy row into buffer extended by radius border pixels on both sides.
+ *
+ * @param ext buffer of (width + 2 * radius) pixels
+ * @param row the source row
+ * @param width pixels in row
+ * @param radius number of border pixels on each side
+ * @param border handling of pixels outside of the image
+ */
+void extend_row(uint8_t *ext, const uint8_t *row, uint32_t width, uint32_t radius, enum border_mode border);
+
+/**
+ * Convolve one row from taps of the kernel.
+ *
+ * With AVX2 bytes of two taps are interleaved into 16-bit pairs summed by
+ * one madd, the remaining bytes are accumulated tap by tap.
+ *
+ * @param taps first byte of every tap, 2 * radius + 1 pointers
+ * @param kernel fixed point weights of the taps
+ * @param size number of taps
+ * @param shift fraction bits of the weights
+ * @param acc accumulator of `bytes` values
+ * @param dst destination row
+ * @param bytes bytes of the row
+ */
+void convolve_taps(const uint8_t *const *taps, const int16_t *kernel, uint32_t size, uint32_t shift, int32_t *acc, uint8_t *dst, size_t bytes);
+
+/**
+ * Horizontal convolution over band of rows.
+ *
+ * Sets `failed` of the pass, if memory allocation fails.
+ */
+void convolve_rows(void *ctx, uint32_t start, uint32_t end);
+
+/**
+ * Vertical convolution over band of rows.
+ *
+ * Sets `failed` of the pass, if memory allocation fails.
+ */
+void convolve_cols(void *ctx, uint32_t start, uint32_t end);
+
+/**
+ * Horizontal running sum box blur over band of rows.
+ *
+ * Sets `failed` of the pass, if memory allocation fails.
+ */
+void box_rows(void *ctx, uint32_t start, uint32_t end);
+
+/**
+ * Vertical running sum box blur over band of rows.
+ *
+ * Sets `failed` of the pass, if memory allocation fails.
+ */
+void box_cols(void *ctx, uint32_t start, uint32_t end);
+
+/**
+ * Unsharp mask over band of rows.
+ */
+void unsharp_rows(void *ctx, uint32_t start, uint32_t end);
+
+/**
+ * Map coordinate outside of the image into it.
+ *
+ * @param i the coordinate
+ * @param n size of the axis
+ * @param border handling of pixels outside of the image
+ * @return coordinate in the range <0, n)
+ */
+static inline uint32_t border_index(int64_t i, uint32_t n, enum border_mode border)
+{
+    if (i >= 0 && i < n)
+    {
+        return (uint32_t)i;
+    }
+    if (border == BORDER_CLAMP || n == 1)
+    {
+        return i < 0 ? 0 : n - 1;
+    }
+
+    int64_t period = 2 * ((int64_t)n - 1);
+    i %= period;
+    i = i < 0 ? i + period : i;
+    return (uint32_t)(i < n ? i : period - i);
+}
+
+/**
+ * Convert fixed point accumulator to channel value.
+ *
+ * @param acc accumulated weighted sum
+ * @param shift fraction bits of the sum
+ * @return the value clamped to 0..255
+ */
+static inline uint8_t clamp_channel(int32_t acc, uint32_t shift)
+{
+    acc >>= shift;
+    return (uint8_t)(acc < 0 ? 0 : acc > UINT8_MAX ? UINT8_MAX : acc);
+}
+
+// PUBLIC IMPLEMENTATION
+// ================================================================================
+
+bool parse_border_mode(const char *name, enum border_mode *border)
+{
+    if (strcmp(name, "clamp") == 0)
+    {
+        *border = BORDER_CLAMP;
+        return true;
+    }
+    if (strcmp(name, "mirror") == 0)
+    {
+        *border = BORDER_MIRROR;
+        return true;
+    }
+    return false;
+}
+
+struct bmp_image *convolve_separable(const struct bmp_image *image, const float *kernel, uint32_t radius, enum border_mode border)
+{
+    CHECK_NULL(image);
+    CHECK_NULL(kernel);
+
+    // heavier kernels give up fraction bits, so every weight fits 16 bits and every sum of channels times weights 32 bits
+    double largest = 0, total = 0;
+    for (uint32_t k = 0; k < 2 * radius + 1; k++)
+    {
+        largest = fmax(largest, fabs(kernel[k]));
+        total += fabs(kernel[k]);
+    }
+    uint32_t shift = PRECISION_BITS + 1;
+    bool fits = false;
+    while (!fits && shift > 0)
+    {
+        shift--;
+        fits = ldexp(largest, (int)shift) < INT16_MAX && ldexp(total, (int)shift) * UINT8_MAX < INT32_MAX / 2;
+    }
+    if (!fits)
+    {
+        return NULL;
+    }
+
+    int16_t *fixed = malloc((2 * (size_t)radius + 1) * sizeof(int16_t));
+    CHECK_NULL(fixed);
+    for (uint32_t k = 0; k < 2 * radius + 1; k++)
+    {
+        fixed[k] = (int16_t)lround(ldexp(kernel[k], (int)shift));
+    }
+
+    struct filter_pass pass = {.border = border, .kernel = fixed, .shift = shift, .radius = radius};
+    struct bmp_image *copy = separable(image, pass, convolve_rows, convolve_cols);
+
+    free(fixed);
+    return copy;
+}
+
+struct bmp_image *box_blur(const struct bmp_image *image, uint32_t radius, enum border_mode border)
+{
+    CHECK_NULL(image);
+    if (radius == 0)
+    {
+        return copy_bmp(image);
+    }
+
+    struct filter_pass pass = {.border = border, .kernel = NULL, .radius = radius};
+    return separable(image, pass, box_rows, box_cols);
+}
+
+struct bmp_image *gaussian_blur(const struct bmp_image *image, float sigma, enum border_mode border)
+{
+    CHECK_NULL(image);
+    if (!(sigma >= 0))
+    {
+        return NULL;
+    }
+
+    // box widths whose successive application has variance sigma^2
+    double variance = 12.0 * sigma * sigma;
+    double lower = floor(sqrt(variance / GAUSS_PASSES + 1));
+    lower -= fmod(lower, 2) == 0 ? 1 : 0;
+    double upper = lower + 2;
+    double lower_passes = (variance - GAUSS_PASSES * lower * lower - 4.0 * GAUSS_PASSES * lower - 3.0 * GAUSS_PASSES) / (-4.0 * lower - 4.0);
+
+    struct bmp_image *blurred = copy_bmp(image);
+    for (int i = 0; i < GAUSS_PASSES && blurred != NULL; i++)
+    {
+        uint32_t radius = (uint32_t)(((i < lround(lower_passes) ? lower : upper) - 1) / 2);
+        if (radius == 0)
+        {
+            continue;
+        }
+        struct bmp_image *next = box_blur(blurred, radius, border);
+        free_bmp_image(blurred);
+        blurred = next;
+    }
+    return blurred;
+}
+
+struct bmp_image *unsharp_mask(const struct bmp_image *image, float sigma, float amount, uint8_t threshold, enum border_mode border)
+{
+    CHECK_NULL(image);
+    if (!(amount >= 0))
+    {
+        return NULL;
+    }
+
+    struct bmp_image *blurred = gaussian_blur(image, sigma, border);
+    CHECK_NULL(blurred);
+
+    // zero sigma gives a copy sharing pixels of the image, they may be a strided view or read-only mapping
+    if (!bmp_make_writable(blurred))
+    {
+        free_bmp_image(blurred);
+        return NULL;
+    }
+
+    // sharpen in place of the blurred copy, every band reads its rows before writing them
+    size_t row_bytes = image->header->width * sizeof(struct pixel);
+    struct unsharp unsharp = {
+        .src = (const uint8_t *)image->data,
+        .blurred = (const uint8_t *)blurred->data,
+        .dst = (uint8_t *)blurred->data,
+        .src_stride = image->stride,
+        .blurred_stride = blurred->stride,
+        .row_bytes = row_bytes,
+        .amount = (int32_t)lroundf(amount * 256),
+        .threshold = threshold,
+    };
+    parallel_rows(image->header->height, unsharp_rows, &unsharp);
+
+    return blurred;
+}
+
+// HELPER IMPLEMENTATION
+// ================================================================================
+
+struct bmp_image *separable(const struct bmp_image *image, struct filter_pass pass, band_worker horizontal, band_worker vertical)
+{
+    pass.width = image->header->width;
+    pass.height = image->header->height;
+
+    struct bmp_image *copy = create_bmp(image->header, pass.width, pass.height);
+    CHECK_NULL(copy);
+
+    uint8_t *tmp = malloc((size_t)pass.width * pass.height * sizeof(struct pixel));
+    if (tmp == NULL)
+    {
+        free_bmp_image(copy);
+        return NULL;
+    }
+
+    pass.src = (const uint8_t *)image->data;
+    pass.src_stride = image->stride;
+    pass.dst = tmp;
+    pass.failed = false;
+    parallel_rows(pass.height, horizontal, &pass);
+
+    if (!pass.failed)
+    {
+        pass.src = tmp;
+        pass.src_stride = (size_t)pass.width * sizeof(struct pixel);
+        pass.dst = (uint8_t *)copy->data;
+        parallel_rows(pass.height, vertical, &pass);
+    }
+
+    free(tmp);
+    if (pass.failed)
+    {
+        free_bmp_image(copy);
+        return NULL;
+    }
+    return copy;
+}
+
+void extend_row(uint8_t *ext, const uint8_t *row, uint32_t width, uint32_t radius, enum border_mode border)
+{
+    memcpy(ext + radius * sizeof(struct pixel), row, width * sizeof(struct pixel));
+    for (uint32_t i = 0; i < radius; i++)
+    {
+        uint32_t left = border_index(-(int64_t)radius + i, width, border);
+        uint32_t right = border_index((int64_t)width + i, width, border);
+        memcpy(ext + i * sizeof(struct pixel), row + left * sizeof(struct pixel), sizeof(struct pixel));
+        memcpy(ext + (radius + width + i) * sizeof(struct pixel), row + right * sizeof(struct pixel), sizeof(struct pixel));
+    }
+}
+
+void convolve_taps(const uint8_t *const *taps, const int16_t *kernel, uint32_t size, uint32_t shift, int32_t *acc, uint8_t *dst, size_t bytes)
+{
+    size_t done = 0;
+    int32_t half = shift > 0 ? 1 << (shift - 1) : 0;
+
+#ifdef __AVX2__
+    const __m256i zero = _mm256_setzero_si256();
+    const __m128i count = _mm_cvtsi32_si128((int)shift);
+    for (; done + VECTOR_BYTES <= bytes; done += VECTOR_BYTES)
+    {
+        __m256i lo = _mm256_set1_epi32(half);
+        __m256i hi = lo;
+        uint32_t k = 0;
+        for (; k + 2 <= size; k += 2)
+        {
+            __m256i weight = _mm256_set1_epi32((int32_t)((uint32_t)(uint16_t)kernel[k] | (uint32_t)(uint16_t)kernel[k + 1] << 16));
+            __m256i a = _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i *)(taps[k] + done)));
+            __m256i b = _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i *)(taps[k + 1] + done)));
+            lo = _mm256_add_epi32(lo, _mm256_madd_epi16(_mm256_unpacklo_epi16(a, b), weight));
+            hi = _mm256_add_epi32(hi, _mm256_madd_epi16(_mm256_unpackhi_epi16(a, b), weight));
+        }
+        if (k < size)
+        {
+            __m256i weight = _mm256_set1_epi32((int32_t)(uint16_t)kernel[k]);
+            __m256i a = _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i *)(taps[k] + done)));
+            lo = _mm256_add_epi32(lo, _mm256_madd_epi16(_mm256_unpacklo_epi16(a, zero), weight));
+            hi = _mm256_add_epi32(hi, _mm256_madd_epi16(_mm256_unpackhi_epi16(a, zero), weight));
+        }
+
+        // unpack and pack both stay within 128-bit lanes, so bytes come back in order
+        __m256i words = _mm256_packs_epi32(_mm256_sra_epi32(lo, count), _mm256_sra_epi32(hi, count));
+        __m256i packed = _mm256_permute4x64_epi64(_mm256_packus_epi16(words, words), 0x08);
+        _mm_storeu_si128((__m128i *)(dst + done), _mm256_castsi256_si128(packed));
+    }
+#endif
+
+    // tap by tap over contiguous bytes, the inner loop vectorizes
+    for (size_t i = done; i < bytes; i++)
+    {
+        acc[i] = half;
+    }
+    for (uint32_t k = 0; k < size; k++)
+    {
+        int32_t weight = kernel[k];
+        const uint8_t *src = taps[k];
+        for (size_t i = done; i < bytes; i++)
+        {
+            acc[i] += weight * src[i];
+        }
+    }
+    for (size_t i = done; i < bytes; i++)
+    {
+        dst[i] = clamp_channel(acc[i], shift);
+    }
+}
+
+void convolve_rows(void *ctx, uint32_t start, uint32_t end)
+{
+    struct filter_pass *pass = ctx;
+    size_t bytes = pass->width * sizeof(struct pixel);
+    uint32_t size = 2 * pass->radius + 1;
+    uint8_t *ext = malloc(bytes + 2 * pass->radius * sizeof(struct pixel));
+    int32_t *acc = malloc(bytes * sizeof(int32_t));
+    const uint8_t **taps = malloc(size * sizeof(*taps));
+    if (ext == NULL || acc == NULL || taps == NULL)
+    {
+        free(ext);
+        free(acc);
+        free(taps);
+        pass->failed = true;
+        return;
+    }
+
+    // taps are the extended row shifted by whole pixels
+    for (uint32_t k = 0; k < size; k++)
+    {
+        taps[k] = ext + k * sizeof(struct pixel);
+    }
+
+    for (uint32_t row = start; row < end; row++)
+    {
+        extend_row(ext, pass->src + row * pass->src_stride, pass->width, pass->radius, pass->border);
+        convolve_taps(taps, pass->kernel, size, pass->shift, acc, pass->dst + row * bytes, bytes);
+    }
+
+    free(ext);
+    free(acc);
+    free(taps);
+}
+
+void convolve_cols(void *ctx, uint32_t start, uint32_t end)
+{
+    struct filter_pass *pass = ctx;
+    size_t bytes = pass->width * sizeof(struct pixel);
+    uint32_t size = 2 * pass->radius + 1;
+    int32_t *acc = malloc(bytes * sizeof(int32_t));
+    const uint8_t **taps = malloc(size * sizeof(*taps));
+    if (acc == NULL || taps == NULL)
+    {
+        free(acc);
+        free(taps);
+        pass->failed = true;
+        return;
+    }
+
+    for (uint32_t row = start; row < end; row++)
+    {
+        for (uint32_t k = 0; k < size; k++)
+        {
+            taps[k] = pass->src + border_index((int64_t)row + k - pass->radius, pass->height, pass->border) * pass->src_stride;
+        }
+        convolve_taps(taps, pass->kernel, size, pass->shift, acc, pass->dst + row * bytes, bytes);
+    }
+
+    free(acc);
+    free(taps);
+}
+
+void box_rows(void *ctx, uint32_t start, uint32_t end)
+{
+    struct filter_pass *pass = ctx;
+    size_t bytes = pass->width * sizeof(struct pixel);
+    uint32_t size = 2 * pass->radius + 1;
+    uint8_t *ext = malloc(bytes + 2 * pass->radius * sizeof(struct pixel));
+    if (ext == NULL)
+    {
+        pass->failed = true;
+        return;
+    }
+
+    for (uint32_t row = start; row < end; row++)
+    {
+        extend_row(ext, pass->src + row * pass->src_stride, pass->width, pass->radius, pass->border);
+
+        uint32_t sums[3] = {0, 0, 0};
+        for (uint32_t k = 0; k < size; k++)
+        {
+            sums[0] += ext[k * 3];
+            sums[1] += ext[k * 3 + 1];
+            sums[2] += ext[k * 3 + 2];
+        }
+
+        // slide the window, one pixel enters and one leaves
+        uint8_t *dst = pass->dst + row * bytes;
+        for (uint32_t col = 0; col < pass->width; col++)
+        {
+            const uint8_t *leave = ext + col * 3;
+            const uint8_t *enter = leave + size * 3;
+            for (uint32_t c = 0; c < 3; c++)
+            {
+                dst[col * 3 + c] = (uint8_t)((sums[c] + size / 2) / size);
+                if (col + 1 < pass->width)
+                {
+                    sums[c] += (uint32_t)enter[c] - leave[c];
+                }
+            }
+        }
+    }
+
+    free(ext);
+}
+
+void box_cols(void *ctx, uint32_t start, uint32_t end)
+{
+    struct filter_pass *pass = ctx;
+    size_t bytes = pass->width * sizeof(struct pixel);
+    uint32_t size = 2 * pass->radius + 1;
+    uint32_t *sums = calloc(bytes, sizeof(uint32_t));
+    if (sums == NULL)
+    {
+        pass->failed = true;
+        return;
+    }
+
+    // every band primes its own window
+    for (uint32_t k = 0; k < size; k++)
+    {
+        const uint8_t *src = pass->src + border_index((int64_t)start + k - pass->radius, pass->height, pass->border) * pass->src_stride;
+        for (size_t i = 0; i < bytes; i++)
+        {
+            sums[i] += src[i];
+        }
+    }
+
+    for (uint32_t row = start; row < end; row++)
+    {
+        uint8_t *dst = pass->dst + row * bytes;
+        for (size_t i = 0; i < bytes; i++)
+        {
+            dst[i] = (uint8_t)((sums[i] + size / 2) / size);
+        }
+
+        const uint8_t *leave = pass->src + border_index((int64_t)row - pass->radius, pass->height, pass->border) * pass->src_stride;
+        const uint8_t *enter = pass->src + border_index((int64_t)row + pass->radius + 1, pass->height, pass->border) * pass->src_stride;
+        for (size_t i = 0; i < bytes; i++)
+        {
+            sums[i] += (uint32_t)enter[i] - leave[i];
+        }
+    }
+
+    free(sums);
+}
+
+void unsharp_rows(void *ctx, uint32_t start, uint32_t end)
+{
+    const struct unsharp *unsharp = ctx;
+
+    for (uint32_t row = start; row < end; row++)
+    {
+        const uint8_t *src = unsharp->src + row * unsharp->src_stride;
+        const uint8_t *blurred = unsharp->blurred + row * unsharp->blurred_stride;
+        uint8_t *dst = unsharp->dst + row * unsharp->blurred_stride;
+
+        for (size_t i = 0; i < unsharp->row_bytes; i++)
+        {
+            int32_t diff = (int32_t)src[i] - blurred[i];
+            int32_t value = src[i];
+            if (abs(diff) >= unsharp->threshold)
+            {
+                value += (diff * unsharp->amount + 128) >> 8;
+            }
+            dst[i] = (uint8_t)(value < 0 ? 0 : value > UINT8_MAX ? UINT8_MAX : value);
+        }
+    }
+}
@@ -0,0 +1,90 @@
+#ifndef _FILTERS_H
+#define _FILTERS_H
+
+#include <stdint.h>
+
+#include "bmp.h"
+
+
+/**
+ * Handling of pixels outside of the image.
+ */
+enum border_mode {
+    BORDER_CLAMP,       // repeat the edge pixel (aaa|abcd|ddd)
+    BORDER_MIRROR       // reflect around the edge pixel (cb|abcd|cb)
+};
+
+
+/**
+ * Parse border mode name.
+ *
+ * Accepted names are "clamp" and "mirror".
+ *
+ * @arg name the border mode name
+ * @arg border where the parsed border mode is stored
+ * @return `true` if the name is known, `false` otherwise
+ */
+bool parse_border_mode(const char* name, enum border_mode* border);
+
+
+/**
+ * Convolve image with separable kernel.
+ *
+ * Creates copy of image convolved with kernel horizontally and then
+ * vertically. Kernel weights are quantized to 16-bit fixed point with 14
+ * fraction bits, kernels whose weights or sum of absolute weights do not fit
+ * get fewer of them. Rows are processed in parallel.
+ *
+ * @arg image the image
+ * @arg kernel 2 * radius + 1 weights, kernel[radius] is the center
+ * @arg radius the kernel radius
+ * @arg border handling of pixels outside of the image
+ * @return the convolved copy of image or null, if there is no image or kernel (NULL given), a weight is not finite or does not fit even without fraction bits
+ */
+struct bmp_image* convolve_separable(const struct bmp_image* image, const float* kernel, uint32_t radius, enum border_mode border);
+
+
+/**
+ * Blur image with box filter.
+ *
+ * Creates copy of image where every pixel is the mean of (2 * radius + 1)^2
+ * neighbourhood. Running sums are used, so cost does not depend on radius.
+ *
+ * @arg image the image
+ * @arg radius the box radius, 0 copies the image
+ * @arg border handling of pixels outside of the image
+ * @return the blurred copy of image or null, if there is no image (NULL given)
+ */
+struct bmp_image* box_blur(const struct bmp_image* image, uint32_t radius, enum border_mode border);
+
+
+/**
+ * Blur image with gaussian filter.
+ *
+ * Gaussian is approximated by three successive box blurs with radii derived
+ * from sigma, so cost does not depend on sigma.
+ *
+ * @arg image the image
+ * @arg sigma the standard deviation in pixels
+ * @arg border handling of pixels outside of the image
+ * @return the blurred copy of image or null, if there is no image (NULL given) or sigma is negative
+ */
+struct bmp_image* gaussian_blur(const struct bmp_image* image, float sigma, enum border_mode border);
+
+
+/**
+ * Sharpen image with unsharp mask.
+ *
+ * Creates copy of image with difference between image and its gaussian blur
+ * amplified by amount. Differences smaller than threshold are left untouched.
+ *
+ * @arg image the image
+ * @arg sigma the standard deviation of the blur in pixels
+ * @arg amount strength of sharpening, 1.0 doubles the local contrast
+ * @arg threshold minimal channel difference which is sharpened
+ * @arg border handling of pixels outside of the image
+ * @return the sharpened copy of image or null, if there is no image (NULL given) or parameters are not valid
+ */
+struct bmp_image* unsharp_mask(const struct bmp_image* image, float sigma, float amount, uint8_t threshold, enum border_mode border);
+
+#endif
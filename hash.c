@@ -0,0 +1,341 @@
+#include <string.h>
+#ifdef __AVX2__
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include "hash.h"
+#include "bmp.h"
+
+// HELPER MACROS
+// ================================================================================
+
+/* XXH64 primes */
+#define PRIME64_1 0x9E3779B185EBCA87ULL
+#define PRIME64_2 0xC2B2AE3D27D4EB4FULL
+#define PRIME64_3 0x165667B19E3779F9ULL
+#define PRIME64_4 0x85EBCA77C2B2AE63ULL
+#define PRIME64_5 0x27D4EB2F165667C5ULL
+
+/* XXH32 primes */
+#define PRIME32_1 0x9E3779B1U
+#define PRIME32_2 0x85EBCA77U
+#define PRIME32_3 0xC2B2AE3DU
+
+#define LONG_INPUT 256  // shortest input hashed by stripes
+#define STRIPE_WORDS 8  // 64-bit words of a stripe, one per accumulator
+#define KEY_WORDS 24    // key words, successive stripes use them shifted by one word
+#define BLOCK_STRIPES (KEY_WORDS - STRIPE_WORDS) // stripes between scrambles of accumulators
+
+/* key words of stripes, splitmix64 sequence */
+static const uint64_t KEYS[KEY_WORDS] = {
+    0x8C9FF21EB4943E94ULL, 0x529BCFD80991254CULL, 0x12B8EB6D931B5E6EULL,
+    0xCEC50C5D0C1FCC21ULL, 0x31F5796E26EF1CA1ULL, 0x6FAD0E5AD91DFF82ULL,
+    0x061C22C6F5405433ULL, 0xACEBED3BE37886A1ULL, 0x0D81E8485A2713A6ULL,
+    0xA3E600F8F1FD238CULL, 0xEF1382C779E55F8EULL, 0xFE2C41FF60885D40ULL,
+    0x94CBB826DAC34BB2ULL, 0xB502428724A731F6ULL, 0xD0BEC29520B72715ULL,
+    0x81335F7CACFEBD80ULL, 0xE34BE0AABABD1D08ULL, 0x25C86B4D7EF8431AULL,
+    0x889C2B2A461FFB7EULL, 0x6A810FE6190B977EULL, 0xA24C7BA4F2058340ULL,
+    0xBA5C108702350F86ULL, 0x73B2EFD68E1C6856ULL, 0xC539D9C263EE450AULL,
+};
+
+// HELPER DECLARATION
+// ================================================================================
+
+/**
+ * Rotate bits left.
+ *
+ * @param x the word
+ * @param r number of bits, 0 < r < 64
+ * @return the rotated word
+ */
+static inline uint64_t rotl64(uint64_t x, int r)
+{
+    return (x << r) | (x >> (64 - r));
+}
+
+/**
+ * Read unaligned little endian 64-bit word.
+ *
+ * @param p the bytes
+ * @return the word
+ */
+static inline uint64_t read64(const uint8_t *p)
+{
+    uint64_t x;
+    memcpy(&x, p, sizeof(x));
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    x = __builtin_bswap64(x);
+#endif
+    return x;
+}
+
+/**
+ * Read unaligned little endian 32-bit word.
+ *
+ * @param p the bytes
+ * @return the word
+ */
+static inline uint32_t read32(const uint8_t *p)
+{
+    uint32_t x;
+    memcpy(&x, p, sizeof(x));
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    x = __builtin_bswap32(x);
+#endif
+    return x;
+}
+
+/**
+ * Consume one word into lane.
+ *
+ * @param acc the lane
+ * @param input the word
+ * @return the updated lane
+ */
+static inline uint64_t lane_round(uint64_t acc, uint64_t input)
+{
+    acc += input * PRIME64_2;
+    acc = rotl64(acc, 31);
+    return acc * PRIME64_1;
+}
+
+/**
+ * Fold lane into the hash.
+ *
+ * @param acc the hash
+ * @param lane the lane
+ * @return the updated hash
+ */
+static inline uint64_t merge_round(uint64_t acc, uint64_t lane)
+{
+    acc ^= lane_round(0, lane);
+    return acc * PRIME64_1 + PRIME64_4;
+}
+
+/**
+ * Mix all bits of the hash into each other.
+ *
+ * @param hash the hash
+ * @return the final hash
+ */
+static inline uint64_t avalanche(uint64_t hash)
+{
+    hash ^= hash >> 33;
+    hash *= PRIME64_2;
+    hash ^= hash >> 29;
+    hash *= PRIME64_3;
+    hash ^= hash >> 32;
+    return hash;
+}
+
+/**
+ * Hash long input by 64-byte stripes (XXH3-style).
+ *
+ * Every accumulator takes the product of 32-bit halves of its word mixed
+ * with the key and the plain word of its neighbour, so a stripe is one
+ * 32x32 to 64-bit multiplication per word, which SSE2 does 2 and AVX2 4 at a time.
+ *
+ * @param p the bytes
+ * @param size number of bytes, at least `LONG_INPUT`
+ * @param seed the seed
+ * @return the hash before avalanche
+ */
+uint64_t hash_stripes(const uint8_t *p, size_t size, uint64_t seed);
+
+/**
+ * Consume one stripe into accumulators.
+ *
+ * @param acc the accumulators
+ * @param stripe 64 bytes
+ * @param key `STRIPE_WORDS` key words
+ */
+static inline void accumulate(uint64_t acc[STRIPE_WORDS], const uint8_t *stripe, const uint64_t *key)
+{
+#ifdef __AVX2__
+    for (int half = 0; half < 2; half++)
+    {
+        __m256i lanes = _mm256_loadu_si256((const __m256i *)acc + half);
+        __m256i data = _mm256_loadu_si256((const __m256i *)stripe + half);
+        __m256i mixed = _mm256_xor_si256(data, _mm256_loadu_si256((const __m256i *)key + half));
+        __m256i product = _mm256_mul_epu32(mixed, _mm256_shuffle_epi32(mixed, _MM_SHUFFLE(0, 3, 0, 1)));
+        __m256i neighbour = _mm256_shuffle_epi32(data, _MM_SHUFFLE(1, 0, 3, 2));
+        _mm256_storeu_si256((__m256i *)acc + half, _mm256_add_epi64(lanes, _mm256_add_epi64(product, neighbour)));
+    }
+#elif defined(__SSE2__)
+    for (int quarter = 0; quarter < 4; quarter++)
+    {
+        __m128i lanes = _mm_loadu_si128((const __m128i *)acc + quarter);
+        __m128i data = _mm_loadu_si128((const __m128i *)stripe + quarter);
+        __m128i mixed = _mm_xor_si128(data, _mm_loadu_si128((const __m128i *)key + quarter));
+        __m128i product = _mm_mul_epu32(mixed, _mm_shuffle_epi32(mixed, _MM_SHUFFLE(0, 3, 0, 1)));
+        __m128i neighbour = _mm_shuffle_epi32(data, _MM_SHUFFLE(1, 0, 3, 2));
+        _mm_storeu_si128((__m128i *)acc + quarter, _mm_add_epi64(lanes, _mm_add_epi64(product, neighbour)));
+    }
+#else
+    for (int i = 0; i < STRIPE_WORDS; i++)
+    {
+        uint64_t data = read64(stripe + 8 * i);
+        uint64_t mixed = data ^ key[i];
+        acc[i ^ 1] += data;
+        acc[i] += (mixed & 0xFFFFFFFF) * (mixed >> 32);
+    }
+#endif
+}
+
+/**
+ * Scramble accumulators at the end of block.
+ *
+ * @param acc the accumulators
+ * @param key `STRIPE_WORDS` key words
+ */
+static inline void scramble(uint64_t acc[STRIPE_WORDS], const uint64_t *key)
+{
+#ifdef __AVX2__
+    const __m256i prime = _mm256_set1_epi64x(PRIME32_1);
+    for (int half = 0; half < 2; half++)
+    {
+        __m256i lanes = _mm256_loadu_si256((const __m256i *)acc + half);
+        lanes = _mm256_xor_si256(lanes, _mm256_srli_epi64(lanes, 47));
+        lanes = _mm256_xor_si256(lanes, _mm256_loadu_si256((const __m256i *)key + half));
+        // 64-bit product with 32-bit prime from two 32x32 products
+        __m256i low = _mm256_mul_epu32(lanes, prime);
+        __m256i high = _mm256_mul_epu32(_mm256_srli_epi64(lanes, 32), prime);
+        _mm256_storeu_si256((__m256i *)acc + half, _mm256_add_epi64(low, _mm256_slli_epi64(high, 32)));
+    }
+#elif defined(__SSE2__)
+    const __m128i prime = _mm_set1_epi64x(PRIME32_1);
+    for (int quarter = 0; quarter < 4; quarter++)
+    {
+        __m128i lanes = _mm_loadu_si128((const __m128i *)acc + quarter);
+        lanes = _mm_xor_si128(lanes, _mm_srli_epi64(lanes, 47));
+        lanes = _mm_xor_si128(lanes, _mm_loadu_si128((const __m128i *)key + quarter));
+        __m128i low = _mm_mul_epu32(lanes, prime);
+        __m128i high = _mm_mul_epu32(_mm_srli_epi64(lanes, 32), prime);
+        _mm_storeu_si128((__m128i *)acc + quarter, _mm_add_epi64(low, _mm_slli_epi64(high, 32)));
+    }
+#else
+    for (int i = 0; i < STRIPE_WORDS; i++)
+    {
+        acc[i] ^= acc[i] >> 47;
+        acc[i] ^= key[i];
+        acc[i] *= PRIME32_1;
+    }
+#endif
+}
+
+// PUBLIC IMPLEMENTATION
+// ================================================================================
+
+uint64_t hash_bytes(const void *data, size_t size, uint64_t seed)
+{
+    const uint8_t *p = data;
+    const uint8_t *end = p + size;
+    uint64_t hash;
+
+    if (size >= LONG_INPUT)
+    {
+        return avalanche(hash_stripes(p, size, seed));
+    }
+
+    if (size >= 32)
+    {
+        uint64_t v1 = seed + PRIME64_1 + PRIME64_2;
+        uint64_t v2 = seed + PRIME64_2;
+        uint64_t v3 = seed;
+        uint64_t v4 = seed - PRIME64_1;
+
+        // lanes are independent, so their multiplications overlap
+        for (; p + 32 <= end; p += 32)
+        {
+            v1 = lane_round(v1, read64(p));
+            v2 = lane_round(v2, read64(p + 8));
+            v3 = lane_round(v3, read64(p + 16));
+            v4 = lane_round(v4, read64(p + 24));
+        }
+
+        hash = rotl64(v1, 1) + rotl64(v2, 7) + rotl64(v3, 12) + rotl64(v4, 18);
+        hash = merge_round(hash, v1);
+        hash = merge_round(hash, v2);
+        hash = merge_round(hash, v3);
+        hash = merge_round(hash, v4);
+    }
+    else
+    {
+        hash = seed + PRIME64_5;
+    }
+
+    hash += size;
+
+    for (; p + 8 <= end; p += 8)
+    {
+        hash ^= lane_round(0, read64(p));
+        hash = rotl64(hash, 27) * PRIME64_1 + PRIME64_4;
+    }
+    if (p + 4 <= end)
+    {
+        hash ^= read32(p) * PRIME64_1;
+        hash = rotl64(hash, 23) * PRIME64_2 + PRIME64_3;
+        p += 4;
+    }
+    for (; p < end; p++)
+    {
+        hash ^= *p * PRIME64_5;
+        hash = rotl64(hash, 11) * PRIME64_1;
+    }
+
+    return avalanche(hash);
+}
+
+uint64_t hash_pixels(const struct bmp_image *image)
+{
+    if (image == NULL)
+    {
+        return 0;
+    }
+
+    uint32_t width = image->header->width;
+    uint32_t height = image->header->height;
+    uint64_t hash = (uint64_t)width << 32 | height;
+
+    // rows are chained, so views hash like their contiguous copies
+    for (uint32_t row = 0; row < height; row++)
+    {
+        hash = hash_bytes(bmp_row(image, row), (size_t)width * sizeof(struct pixel), hash);
+    }
+    return hash;
+}
+
+// HELPER IMPLEMENTATION
+// ================================================================================
+
+uint64_t hash_stripes(const uint8_t *p, size_t size, uint64_t seed)
+{
+    uint64_t key[KEY_WORDS];
+    uint64_t acc[STRIPE_WORDS] = {PRIME32_3, PRIME64_1, PRIME64_2, PRIME64_3, PRIME64_4, PRIME32_2, PRIME64_5, PRIME32_1};
+
+    for (int i = 0; i < KEY_WORDS; i++)
+    {
+        key[i] = i % 2 == 0 ? KEYS[i] + seed : KEYS[i] - seed;
+    }
+
+    // the last stripe ends with the input and may overlap the previous one
+    size_t stripes = (size - 1) / (STRIPE_WORDS * 8);
+    for (size_t s = 0; s < stripes; s++)
+    {
+        accumulate(acc, p + s * STRIPE_WORDS * 8, key + s % BLOCK_STRIPES);
+        if (s % BLOCK_STRIPES == BLOCK_STRIPES - 1)
+        {
+            scramble(acc, key + BLOCK_STRIPES);
+        }
+    }
+    accumulate(acc, p + size - STRIPE_WORDS * 8, key + BLOCK_STRIPES - 1);
+
+    uint64_t hash = size * PRIME64_1;
+    for (int i = 0; i < STRIPE_WORDS; i++)
+    {
+        hash = merge_round(hash, acc[i]);
+    }
+    return hash;
+}
@@ -0,0 +1,37 @@
+#ifndef _HASH_H
+#define _HASH_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "bmp.h"
+
+
+/**
+ * Hash bytes.
+ *
+ * 64-bit hash. Inputs shorter than 256 bytes are hashed by XXH64, whose four
+ * independent lanes consume 32 bytes per step. Longer inputs are consumed by
+ * 64-byte stripes into eight accumulators (XXH3-style), with SSE2 or AVX2
+ * when the build supports them; every build gives the same hash.
+ *
+ * @arg data the bytes
+ * @arg size number of bytes
+ * @arg seed the seed, chains hashes of consecutive blocks
+ * @return the hash
+ */
+uint64_t hash_bytes(const void* data, size_t size, uint64_t seed);
+
+
+/**
+ * Hash pixels of image.
+ *
+ * Only dimensions and pixels are hashed, so images differing in other
+ * header fields or in row stride (views) hash equally.
+ *
+ * @arg image the image
+ * @return the hash or 0, if there is no image (NULL given)
+ */
+uint64_t hash_pixels(const struct bmp_image* image);
+
+#endif
@@ -0,0 +1,266 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "integral.h"
+#include "parallel.h"
+#include "bmp.h"
+
+// HELPER MACROS
+// ================================================================================
+
+#define CHECK_NULL(ptr)    \
+    {                      \
+        if ((ptr) == NULL) \
+        {                  \
+            return NULL;   \
+        }                  \
+    }
+
+/* construction or use of tables shared by all bands */
+struct integral_pass
+{
+    const struct bmp_image *image;
+    struct bmp_image *dst;
+    struct bmp_integral *integral;
+    uint32_t radius;
+};
+
+// HELPER DECLARATION
+// ================================================================================
+
+/**
+ * Sum band of image rows into rows of tables.
+ *
+ * @param ctx the `integral_pass` structure
+ * @param start first row of the band
+ * @param end one past the last row of the band
+ */
+void sum_rows(void *ctx, uint32_t start, uint32_t end);
+
+/**
+ * Accumulate band of table columns from the top down.
+ *
+ * @param ctx the `integral_pass` structure
+ * @param start first column of the band
+ * @param end one past the last column of the band
+ */
+void sum_cols(void *ctx, uint32_t start, uint32_t end);
+
+/**
+ * Blur band of rows.
+ *
+ * @param ctx the `integral_pass` structure
+ * @param start first row of the band
+ * @param end one past the last row of the band
+ */
+void blur_rows(void *ctx, uint32_t start, uint32_t end);
+
+/**
+ * Sum table over rectangle given by corners.
+ *
+ * @param table the table
+ * @param width number of image columns
+ * @param top first row
+ * @param left first column
+ * @param bottom one past the last row
+ * @param right one past the last column
+ * @param sums receives sum of every channel
+ */
+static inline void corner_sum(const uint64_t *table, size_t width, uint32_t top, uint32_t left,
+                              uint32_t bottom, uint32_t right, uint64_t sums[CHANNELS])
+{
+    const uint64_t *upper = table + (size_t)top * (width + 1) * CHANNELS;
+    const uint64_t *lower = table + (size_t)bottom * (width + 1) * CHANNELS;
+    for (size_t c = 0; c < CHANNELS; c++)
+    {
+        // wrapping subtraction is exact, the result fits
+        sums[c] = lower[right * CHANNELS + c] - lower[left * CHANNELS + c] -
+                  upper[right * CHANNELS + c] + upper[left * CHANNELS + c];
+    }
+}
+
+// PUBLIC IMPLEMENTATION
+// ================================================================================
+
+extern struct bmp_image *create_bmp(const struct bmp_header *header, uint32_t width, uint32_t height);
+
+struct bmp_integral *build_integral(const struct bmp_image *image)
+{
+    CHECK_NULL(image);
+
+    struct bmp_integral *integral = calloc(1, sizeof(struct bmp_integral));
+    CHECK_NULL(integral);
+    integral->header = *image->header;
+
+    size_t entries = ((size_t)image->header->width + 1) * ((size_t)image->header->height + 1) * CHANNELS;
+    integral->sums = malloc(entries * sizeof(uint64_t));
+    integral->squares = malloc(entries * sizeof(uint64_t));
+    if (integral->sums == NULL || integral->squares == NULL)
+    {
+        free_integral(integral);
+        return NULL;
+    }
+
+    // first row is zero, other rows are independent prefix sums, then every column is a prefix sum of them
+    size_t row_size = ((size_t)image->header->width + 1) * CHANNELS * sizeof(uint64_t);
+    memset(integral->sums, 0, row_size);
+    memset(integral->squares, 0, row_size);
+
+    struct integral_pass pass = {image, NULL, integral, 0};
+    parallel_rows(image->header->height, sum_rows, &pass);
+    parallel_rows(image->header->width + 1, sum_cols, &pass);
+    return integral;
+}
+
+bool region_sum(const struct bmp_integral *integral, const struct slice_rect *rect, uint64_t sums[CHANNELS], uint64_t squares[CHANNELS])
+{
+    if (integral == NULL || rect == NULL || sums == NULL)
+    {
+        return false;
+    }
+
+    uint64_t bottom = (uint64_t)rect->start_y + rect->height;
+    uint64_t right = (uint64_t)rect->start_x + rect->width;
+    if (rect->height == 0 || rect->width == 0 || bottom > integral->header.height || right > integral->header.width)
+    {
+        return false;
+    }
+
+    size_t width = integral->header.width;
+    corner_sum(integral->sums, width, rect->start_y, rect->start_x, (uint32_t)bottom, (uint32_t)right, sums);
+    if (squares != NULL)
+    {
+        corner_sum(integral->squares, width, rect->start_y, rect->start_x, (uint32_t)bottom, (uint32_t)right, squares);
+    }
+    return true;
+}
+
+bool region_mean(const struct bmp_integral *integral, const struct slice_rect *rect, double mean[CHANNELS], double variance[CHANNELS])
+{
+    uint64_t sums[CHANNELS], squares[CHANNELS];
+    if (mean == NULL || !region_sum(integral, rect, sums, squares))
+    {
+        return false;
+    }
+
+    double pixels = (double)rect->width * rect->height;
+    for (int c = 0; c < CHANNELS; c++)
+    {
+        mean[c] = (double)sums[c] / pixels;
+        if (variance != NULL)
+        {
+            // rounding may push variance of flat area slightly below zero
+            double value = (double)squares[c] / pixels - mean[c] * mean[c];
+            variance[c] = value > 0 ? value : 0;
+        }
+    }
+    return true;
+}
+
+struct bmp_image *integral_box_blur(const struct bmp_integral *integral, uint32_t radius)
+{
+    CHECK_NULL(integral);
+
+    struct bmp_image *blurred = create_bmp(&integral->header, integral->header.width, integral->header.height);
+    CHECK_NULL(blurred);
+
+    struct integral_pass pass = {NULL, blurred, (struct bmp_integral *)integral, radius};
+    parallel_rows(integral->header.height, blur_rows, &pass);
+    return blurred;
+}
+
+void free_integral(struct bmp_integral *integral)
+{
+    if (integral == NULL)
+    {
+        return;
+    }
+
+    free(integral->sums);
+    free(integral->squares);
+    free(integral);
+}
+
+// HELPER IMPLEMENTATION
+// ================================================================================
+
+void sum_rows(void *ctx, uint32_t start, uint32_t end)
+{
+    const struct integral_pass *pass = ctx;
+    uint32_t width = pass->image->header->width;
+    uint32_t height = pass->image->header->height;
+    size_t row_entries = ((size_t)width + 1) * CHANNELS;
+
+    for (uint32_t y = start; y < end; y++)
+    {
+        const struct pixel *src = bmp_row(pass->image, height - 1 - y);
+        uint64_t *sums = pass->integral->sums + (y + 1) * row_entries;
+        uint64_t *squares = pass->integral->squares + (y + 1) * row_entries;
+        uint64_t sum[CHANNELS] = {0}, square[CHANNELS] = {0};
+
+        for (int c = 0; c < CHANNELS; c++)
+        {
+            sums[c] = 0;
+            squares[c] = 0;
+        }
+        for (uint32_t x = 0; x < width; x++)
+        {
+            const uint8_t values[CHANNELS] = {src[x].blue, src[x].green, src[x].red};
+            for (size_t c = 0; c < CHANNELS; c++)
+            {
+                sum[c] += values[c];
+                square[c] += (uint32_t)values[c] * values[c];
+                sums[(x + 1) * CHANNELS + c] = sum[c];
+                squares[(x + 1) * CHANNELS + c] = square[c];
+            }
+        }
+    }
+}
+
+void sum_cols(void *ctx, uint32_t start, uint32_t end)
+{
+    const struct integral_pass *pass = ctx;
+    uint32_t height = pass->image->header->height;
+    size_t row_entries = ((size_t)pass->image->header->width + 1) * CHANNELS;
+
+    // every row of the band adds the one above it, rows are walked in order
+    for (uint32_t y = 2; y <= height; y++)
+    {
+        uint64_t *sums = pass->integral->sums + y * row_entries;
+        uint64_t *squares = pass->integral->squares + y * row_entries;
+        for (size_t i = (size_t)start * CHANNELS; i < (size_t)end * CHANNELS; i++)
+        {
+            sums[i] += sums[i - row_entries];
+            squares[i] += squares[i - row_entries];
+        }
+    }
+}
+
+void blur_rows(void *ctx, uint32_t start, uint32_t end)
+{
+    const struct integral_pass *pass = ctx;
+    const struct bmp_integral *integral = pass->integral;
+    uint32_t width = integral->header.width;
+    uint32_t height = integral->header.height;
+    uint32_t radius = pass->radius;
+
+    for (uint32_t y = start; y < end; y++)
+    {
+        struct pixel *dst = bmp_row(pass->dst, height - 1 - y);
+        uint32_t top = y > radius ? y - radius : 0;
+        uint32_t bottom = height - y > radius ? y + radius + 1 : height;
+
+        for (uint32_t x = 0; x < width; x++)
+        {
+            uint32_t left = x > radius ? x - radius : 0;
+            uint32_t right = width - x > radius ? x + radius + 1 : width;
+            uint64_t pixels = (uint64_t)(bottom - top) * (right - left);
+            uint64_t sums[CHANNELS];
+            corner_sum(integral->sums, width, top, left, bottom, right, sums);
+
+            dst[x].blue = (uint8_t)((sums[CHANNEL_BLUE] + pixels / 2) / pixels);
+            dst[x].green = (uint8_t)((sums[CHANNEL_GREEN] + pixels / 2) / pixels);
+            dst[x].red = (uint8_t)((sums[CHANNEL_RED] + pixels / 2) / pixels);
+        }
+    }
+}
@@ -0,0 +1,85 @@
+#ifndef _INTEGRAL_H
+#define _INTEGRAL_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "bmp.h"
+#include "stats.h"
+#include "slice.h"
+
+
+/**
+ * Summed-area tables of an image.
+ *
+ * Entry [y][x] holds per-channel sums of all pixels above and left of it,
+ * so the sum over any rectangle is read from its four corners. Tables have
+ * one more row and column than the image, the first ones are zero. Rows go
+ * from the top of the image down, like `struct slice_rect` counts them.
+ * Both tables together take 48 bytes per pixel.
+ */
+struct bmp_integral {
+    struct bmp_header header;       // header of the image, its size gives size of tables
+    uint64_t* sums;                 // (height + 1) * (width + 1) entries of CHANNELS sums
+    uint64_t* squares;              // the same for squared channel values
+};
+
+
+/**
+ * Build summed-area tables of image.
+ *
+ * Rows are summed in parallel bands, then columns are accumulated in
+ * parallel bands of columns.
+ *
+ * @arg image the image
+ * @return the tables, which must be freed with `free_integral()`, or NULL if there is no image (NULL given) or memory allocation fails
+ */
+struct bmp_integral* build_integral(const struct bmp_image* image);
+
+
+/**
+ * Sum channels over area in constant time.
+ *
+ * @arg integral the tables
+ * @arg rect the area, it must be non-empty and lie inside the image
+ * @arg sums receives sum of every channel, indexed by `enum channel`
+ * @arg squares receives sum of squares of every channel or NULL, if not needed
+ * @return true on success, false if there are no tables or area (NULL given) or area is not valid
+ */
+bool region_sum(const struct bmp_integral* integral, const struct slice_rect* rect, uint64_t sums[CHANNELS], uint64_t squares[CHANNELS]);
+
+
+/**
+ * Compute mean and population variance of channels over area in constant time.
+ *
+ * @arg integral the tables
+ * @arg rect the area, it must be non-empty and lie inside the image
+ * @arg mean receives mean of every channel, indexed by `enum channel`
+ * @arg variance receives variance of every channel or NULL, if not needed
+ * @return true on success, false if there are no tables or area (NULL given) or area is not valid
+ */
+bool region_mean(const struct bmp_integral* integral, const struct slice_rect* rect, double mean[CHANNELS], double variance[CHANNELS]);
+
+
+/**
+ * Blur image with box filter read from summed-area tables.
+ *
+ * Every pixel is the rounded mean of (2 * radius + 1)^2 neighbourhood cut
+ * by the image edges, so cost depends neither on radius nor on the border.
+ * Rows are processed in parallel.
+ *
+ * @arg integral the tables
+ * @arg radius the box radius, 0 copies the image
+ * @return the blurred image or NULL, if there are no tables (NULL given) or memory allocation fails
+ */
+struct bmp_image* integral_box_blur(const struct bmp_integral* integral, uint32_t radius);
+
+
+/**
+ * Free summed-area tables.
+ *
+ * @arg integral the tables
+ */
+void free_integral(struct bmp_integral* integral);
+
+#endif
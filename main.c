@@ -1,27 +1,231 @@
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <getopt.h>
+#include <inttypes.h>
+#include <time.h>
 
 #include "bmp.h"
 #include "transformations.h"
+#include "resample.h"
+#include "filters.h"
+#include "color.h"
+#include "stats.h"
+#include "slice.h"
+#include "atlas.h"
+#include "batch.h"
+#include "dedupe.h"
+#include "cache.h"
+#include "server.h"
+#include "pipeline.h"
+#include "colorspace.h"
+#include "planar.h"
+#include "overlay.h"
+#include "quantize.h"
+#include "hash.h"
+
+/* transformation given on the command line */
+struct step
+{
+    int opt;
+    char *arg;
+    void *data;                     // argument loaded once for every image, or NULL
+};
+
+/* overlay of --overlay, decoded once for every image of the run */
+struct overlay_step
+{
+    struct bmp_overlay *overlay;
+    int64_t x;
+    int64_t y;
+    uint8_t opacity;
+};
+
+/* FILE operands flowing through the pipeline */
+struct batch_run
+{
+    char *const *paths;
+    size_t count;
+    struct bmp_image **images;      // images loaded up front, or NULL to map files one by one
+    const struct dedupe_entry *entries;
+    size_t *last_use;               // index of the last image using the result of each group
+    struct bmp_image **results;     // results kept for later duplicates
+    const struct step *steps;
+    size_t step_count;
+    const char *output_pattern;
+    bool loaded;                    // every file was loaded
+};
+
+/* frames of --stream */
+struct stream_run
+{
+    FILE *input;
+    FILE *output;
+    const struct step *steps;
+    size_t step_count;
+    double *latencies;              // milliseconds from the first byte read to the last byte written
+    size_t frames;
+    size_t capacity;
+    bool complete;                  // input ended between frames
+};
+
+struct bmp_image *apply_steps(struct bmp_image *img, const struct step *steps, size_t count, bool *wrong_args);
+bool prepare_steps(struct step *steps, size_t count);
+struct overlay_step *load_overlay_step(const char *arg);
+void free_steps(struct step *steps, size_t count);
+bool run_batch(char *const *paths, size_t count, const struct step *steps, size_t step_count,
+               const char *output_pattern, const char *dedupe_manifest, bool canonical);
+struct bmp_image *read_batch_image(void *ctx, size_t index, struct bmp_image *spare, struct timespec *started);
+struct bmp_image *transform_batch_image(void *ctx, size_t index, struct bmp_image *image);
+bool write_batch_image(void *ctx, size_t index, const struct bmp_image *image, const struct timespec *started);
+struct bmp_image *replace_image(struct bmp_image *image, struct bmp_image *result);
+struct bmp_image *update_image(struct bmp_image *image, bool success);
+struct bmp_image *read_atlas(char *const *paths, size_t count, const char *manifest_path);
+char *describe_steps(const struct step *steps, size_t count, bool histogram_mode, bool stats_mode);
+bool run_stream(FILE *input, FILE *output, const struct step *steps, size_t step_count);
+struct bmp_image *read_frame(void *ctx, size_t index, struct bmp_image *spare, struct timespec *started);
+struct bmp_image *transform_frame(void *ctx, size_t index, struct bmp_image *image);
+bool write_frame(void *ctx, size_t index, const struct bmp_image *image, const struct timespec *started);
+void print_latency(FILE *stream, double *latencies, size_t count);
+int compare_doubles(const void *a, const void *b);
+bool handle_request(void *ctx, char **args, size_t count, char *error, size_t size);
+bool parse_request(char **args, size_t count, struct step *steps, size_t *step_count, const char **input_path, const char **output_path);
 
 void print_wrong_args(FILE *stream);
+bool is_color_option(int opt);
+bool is_transform_option(int opt);
+bool is_step_option(int opt);
 
 void print_desc(FILE *stream);
 void print_usage(FILE *stream);
 void print_help(FILE *stream);
 
-#define OPTIONS "hrlxyc:s:e:o:i:"
+#define OPTIONS "hrlxya:c:s:e:f:o:i:"
+#define CACHE_SIZE_MIB 256 // default size limit of --cache
+#define PIPELINE_DEPTH 2   // images waiting between stages of batch and stream modes
+
+/* options without short form */
+enum long_option
+{
+    OPT_BLUR = 256,
+    OPT_GAUSSIAN,
+    OPT_SHARPEN,
+    OPT_BORDER,
+    OPT_GRAYSCALE,
+    OPT_BRIGHTNESS,
+    OPT_CONTRAST,
+    OPT_GAMMA,
+    OPT_INVERT,
+    OPT_LEVELS,
+    OPT_AUTO_LEVELS,
+    OPT_EQUALIZE,
+    OPT_HISTOGRAM,
+    OPT_STATS,
+    OPT_SLICE,
+    OPT_SLICE_LIST,
+    OPT_ATLAS,
+    OPT_EPX,
+    OPT_DEDUPE,
+    OPT_CANONICAL,
+    OPT_CACHE,
+    OPT_CACHE_SIZE,
+    OPT_SERVE,
+    OPT_STREAM,
+    OPT_ROTATE_180,
+    OPT_TRANSPOSE,
+    OPT_TRANSVERSE,
+    OPT_TO_SPACE,
+    OPT_FROM_SPACE,
+    OPT_RAW_PLANES,
+    OPT_TRIM,
+    OPT_OVERLAY,
+    OPT_QUANTIZE
+};
+
+static const struct option LONG_OPTIONS[] = {
+    {"blur", required_argument, NULL, OPT_BLUR},
+    {"gaussian", required_argument, NULL, OPT_GAUSSIAN},
+    {"sharpen", required_argument, NULL, OPT_SHARPEN},
+    {"border", required_argument, NULL, OPT_BORDER},
+    {"grayscale", no_argument, NULL, OPT_GRAYSCALE},
+    {"brightness", required_argument, NULL, OPT_BRIGHTNESS},
+    {"contrast", required_argument, NULL, OPT_CONTRAST},
+    {"gamma", required_argument, NULL, OPT_GAMMA},
+    {"invert", no_argument, NULL, OPT_INVERT},
+    {"levels", required_argument, NULL, OPT_LEVELS},
+    {"auto-levels", optional_argument, NULL, OPT_AUTO_LEVELS},
+    {"equalize", no_argument, NULL, OPT_EQUALIZE},
+    {"histogram", no_argument, NULL, OPT_HISTOGRAM},
+    {"stats-pixels", no_argument, NULL, OPT_STATS},
+    {"slice", required_argument, NULL, OPT_SLICE},
+    {"slice-list", required_argument, NULL, OPT_SLICE_LIST},
+    {"atlas", required_argument, NULL, OPT_ATLAS},
+    {"epx", required_argument, NULL, OPT_EPX},
+    {"dedupe", required_argument, NULL, OPT_DEDUPE},
+    {"canonical", no_argument, NULL, OPT_CANONICAL},
+    {"cache", required_argument, NULL, OPT_CACHE},
+    {"cache-size", required_argument, NULL, OPT_CACHE_SIZE},
+    {"serve", optional_argument, NULL, OPT_SERVE},
+    {"stream", no_argument, NULL, OPT_STREAM},
+    {"rotate-180", no_argument, NULL, OPT_ROTATE_180},
+    {"transpose", no_argument, NULL, OPT_TRANSPOSE},
+    {"transverse", no_argument, NULL, OPT_TRANSVERSE},
+    {"to-space", required_argument, NULL, OPT_TO_SPACE},
+    {"from-space", required_argument, NULL, OPT_FROM_SPACE},
+    {"raw-planes", no_argument, NULL, OPT_RAW_PLANES},
+    {"trim", optional_argument, NULL, OPT_TRIM},
+    {"overlay", required_argument, NULL, OPT_OVERLAY},
+    {"quantize", required_argument, NULL, OPT_QUANTIZE},
+    {NULL, 0, NULL, 0}};
 
 int main(int arc, char **argv)
 {
     FILE *input_stream = stdin;
     FILE *output_stream = stdout;
+    int first_transform = 0;
+    char *first_transform_arg = NULL;
+    enum resample_filter filter = FILTER_NEAREST;
+    bool histogram_mode = false;
+    bool stats_mode = false;
+    const char *output_path = NULL;
+    struct slice_rect *slices = NULL;
+    size_t slice_count = 0;
+    uint32_t tile_width = 0, tile_height = 0;
+    const char *atlas_manifest = NULL;
+    const char *dedupe_manifest = NULL;
+    bool canonical = false;
+    const char *cache_dir = NULL;
+    uint64_t cache_size = (uint64_t)CACHE_SIZE_MIB << 20;
+    bool serve_mode = false;
+    bool stream_mode = false;
+    bool raw_mode = false;
+    int raw_components = 3;
+    uint32_t palette_colors = 0;
+    enum dither dither = DITHER_NONE;
+    const char *socket_path = NULL;
+    struct step *steps = malloc((size_t)arc * sizeof(struct step));
+    size_t step_count = 0;
+    size_t first_step = 0;
+    if (steps == NULL)
+    {
+        exit(EXIT_FAILURE);
+    }
 
-    // scan streams
+    // scan streams, transformations are applied once the input is loaded
     int opt;
-    while ((opt = getopt(arc, argv, OPTIONS)) != -1)
+    while ((opt = getopt_long(arc, argv, OPTIONS, LONG_OPTIONS, NULL)) != -1)
     {
+        if (first_transform == 0 && is_transform_option(opt))
+        {
+            first_transform = opt;
+            first_transform_arg = optarg;
+            first_step = step_count;
+        }
+        if (is_step_option(opt))
+        {
+            steps[step_count++] = (struct step){opt, optarg, NULL};
+        }
+
         switch (opt)
         {
         case 'i':
@@ -29,7 +233,109 @@ int main(int arc, char **argv)
             break;
 
         case 'o':
-            output_stream = fopen(optarg, "wb");
+            output_path = optarg;
+            break;
+
+        case OPT_SLICE:
+            if ((sscanf(optarg, "%ux%u", &tile_width, &tile_height)) != 2 || tile_width == 0 || tile_height == 0)
+            {
+                print_wrong_args(stderr);
+                print_usage(stderr);
+                exit(EXIT_FAILURE);
+            }
+            break;
+
+        case OPT_SLICE_LIST:;
+            FILE *list_stream = fopen(optarg, "r");
+            free(slices);
+            slice_count = read_slice_list(list_stream, &slices);
+            if (list_stream != NULL)
+            {
+                fclose(list_stream);
+            }
+            if (slice_count == 0)
+            {
+                print_wrong_args(stderr);
+                print_usage(stderr);
+                exit(EXIT_FAILURE);
+            }
+            break;
+
+        case OPT_ATLAS:
+            atlas_manifest = optarg;
+            break;
+
+        case OPT_DEDUPE:
+            dedupe_manifest = optarg;
+            break;
+
+        case OPT_CANONICAL:
+            canonical = true;
+            break;
+
+        case OPT_CACHE:
+            cache_dir = optarg;
+            break;
+
+        case OPT_CACHE_SIZE:;
+            uint64_t cache_mib;
+            if ((sscanf(optarg, "%" SCNu64, &cache_mib)) != 1 || cache_mib > UINT64_MAX >> 20)
+            {
+                print_wrong_args(stderr);
+                print_usage(stderr);
+                exit(EXIT_FAILURE);
+            }
+            cache_size = cache_mib << 20;
+            break;
+
+        case OPT_HISTOGRAM:
+            histogram_mode = true;
+            break;
+
+        case OPT_STATS:
+            stats_mode = true;
+            break;
+
+        case OPT_SERVE:
+            serve_mode = true;
+            socket_path = optarg;
+            break;
+
+        case OPT_STREAM:
+            stream_mode = true;
+            break;
+
+        case OPT_RAW_PLANES:
+            raw_mode = true;
+            break;
+
+        case OPT_TO_SPACE:;
+            struct color_space space;
+            raw_components = parse_color_space(optarg, &space) ? color_space_components(&space) : 3;
+            break;
+
+        case OPT_FROM_SPACE:
+            raw_components = 3;
+            break;
+
+        case OPT_QUANTIZE:;
+            char dither_name[16] = "none";
+            int quantize_fields = sscanf(optarg, "%" SCNu32 ",%15s", &palette_colors, dither_name);
+            if (quantize_fields < 1 || palette_colors < 2 || palette_colors > PALETTE_SIZE || !parse_dither(dither_name, &dither))
+            {
+                print_wrong_args(stderr);
+                print_usage(stderr);
+                exit(EXIT_FAILURE);
+            }
+            break;
+
+        case 'f':
+            if (first_transform == 0 && !parse_resample_filter(optarg, &filter))
+            {
+                print_wrong_args(stderr);
+                print_usage(stderr);
+                exit(EXIT_FAILURE);
+            }
             break;
 
         case 'h':
@@ -38,79 +344,1141 @@ int main(int arc, char **argv)
             print_help(stdout);
             exit(EXIT_SUCCESS);
             break;
+
+        case '?':
+            print_usage(stderr);
+            print_help(stderr);
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    // files named by the chain are loaded once, not for every image
+    if (!prepare_steps(steps, step_count))
+    {
+        print_wrong_args(stderr);
+        print_usage(stderr);
+        exit(EXIT_FAILURE);
+    }
+
+    // every request names its own input, output and transformations
+    if (serve_mode)
+    {
+        if (step_count != 0 || optind != arc || raw_mode || palette_colors != 0)
+        {
+            print_wrong_args(stderr);
+            print_usage(stderr);
+            exit(EXIT_FAILURE);
+        }
+
+        free_steps(steps, step_count);
+        bool served = socket_path != NULL ? serve_socket(socket_path, handle_request, NULL)
+                                          : serve_stream(stdin, stdout, handle_request, NULL);
+        if (!served)
+        {
+            fprintf(stderr, "Error: Unable to serve %s.\n", socket_path != NULL ? socket_path : "standard input");
+        }
+        exit(served ? EXIT_SUCCESS : EXIT_FAILURE);
+    }
+
+    // file operands are transformed one by one, unless they are packed into atlas
+    char *const *input_paths = &argv[optind];
+    size_t input_count = (size_t)(arc - optind);
+    if (input_count != 0 && atlas_manifest == NULL)
+    {
+        bool output_valid = output_path == NULL ? dedupe_manifest != NULL : output_pattern_valid(output_path);
+        if (!output_valid || histogram_mode || stats_mode || tile_width != 0 || slice_count != 0 || cache_dir != NULL || stream_mode || raw_mode || palette_colors != 0)
+        {
+            print_wrong_args(stderr);
+            print_usage(stderr);
+            exit(EXIT_FAILURE);
+        }
+
+        bool success = run_batch(input_paths, input_count, steps, step_count, output_path, dedupe_manifest, canonical);
+        free_steps(steps, step_count);
+        exit(success ? EXIT_SUCCESS : EXIT_FAILURE);
+    }
+    if (dedupe_manifest != NULL)
+    {
+        print_wrong_args(stderr);
+        print_usage(stderr);
+        exit(EXIT_FAILURE);
+    }
+
+    // frames following each other on the input are transformed and written one by one
+    if (stream_mode)
+    {
+        if (histogram_mode || stats_mode || tile_width != 0 || slice_count != 0 || atlas_manifest != NULL || cache_dir != NULL || raw_mode || palette_colors != 0)
+        {
+            print_wrong_args(stderr);
+            print_usage(stderr);
+            exit(EXIT_FAILURE);
+        }
+
+        if (output_path != NULL)
+        {
+            output_stream = fopen(output_path, "wb");
+        }
+        bool success = run_stream(input_stream, output_stream, steps, step_count);
+        free_steps(steps, step_count);
+        if (input_stream != NULL)
+        {
+            fclose(input_stream);
+        }
+        if (output_stream != NULL)
+        {
+            success = fclose(output_stream) == 0 && success;
+        }
+        exit(success ? EXIT_SUCCESS : EXIT_FAILURE);
+    }
+
+    // slicing writes every area into its own file named by the output pattern
+    bool slice_mode = tile_width != 0 || slice_count != 0;
+    if (slice_mode && ((tile_width != 0 && slice_count != 0) || !output_pattern_valid(output_path) || cache_dir != NULL || raw_mode || palette_colors != 0))
+    {
+        print_wrong_args(stderr);
+        print_usage(stderr);
+        exit(EXIT_FAILURE);
+    }
+    if (!slice_mode && output_path != NULL)
+    {
+        output_stream = fopen(output_path, "wb");
+    }
+
+    // planes or indexed pixels are written instead of the image, reports and cache know only images
+    if ((raw_mode || palette_colors != 0) && (histogram_mode || stats_mode || cache_dir != NULL || (raw_mode && palette_colors != 0)))
+    {
+        print_wrong_args(stderr);
+        print_usage(stderr);
+        exit(EXIT_FAILURE);
+    }
+
+    // atlas of the file operands replaces the input image
+    if (atlas_manifest != NULL && (input_count == 0 || cache_dir != NULL))
+    {
+        print_wrong_args(stderr);
+        print_usage(stderr);
+        exit(EXIT_FAILURE);
+    }
+
+    // stored result of the same input and chain is copied without decoding
+    struct bmp_cache cache = {0};
+    if (cache_dir != NULL)
+    {
+        char *chain = describe_steps(steps, step_count, histogram_mode, stats_mode);
+        bool opened = chain != NULL && cache_open(&cache, cache_dir, cache_size, input_stream, chain);
+        free(chain);
+        if (!opened)
+        {
+            fprintf(stderr, "Error: Unable to use cache %s.\n", cache_dir);
+            exit(EXIT_FAILURE);
+        }
+
+        FILE *entry = cache_lookup(&cache);
+        if (entry != NULL)
+        {
+            bool delivered = cache_deliver(entry, output_stream);
+            cache_close(&cache);
+            free_steps(steps, step_count);
+            fclose(input_stream);
+            delivered = fclose(output_stream) == 0 && delivered;
+            exit(delivered ? EXIT_SUCCESS : EXIT_FAILURE);
+        }
+
+        fclose(input_stream);
+        input_stream = cache_input(&cache);
+    }
+
+    // leading downscale is done by the loader, full resolution is never decoded
+    // the loader box filters, so it is used unless a different filter was requested
+    struct bmp_image *img = NULL;
+    float decode_factor;
+    bool decode_scaled = atlas_manifest == NULL && first_transform == 's' &&
+                         (filter == FILTER_NEAREST || filter == FILTER_BOX) &&
+                         sscanf(first_transform_arg, "%f", &decode_factor) == 1 &&
+                         decode_factor > 0 && decode_factor < 1;
+    if (atlas_manifest != NULL)
+    {
+        img = read_atlas(input_paths, input_count, atlas_manifest);
+    }
+    else if (decode_scaled)
+    {
+        img = read_bmp_scaled(input_stream, decode_factor);
+    }
+    else if (cache_dir != NULL)
+    {
+        // input read for the cache key is parsed in place
+        img = read_bmp_mem(cache.input, cache.input_size);
+    }
+    else
+    {
+        img = read_bmp(input_stream);
+    }
+
+    // downscale applied by the loader is dropped from the chain
+    if (decode_scaled)
+    {
+        memmove(&steps[first_step], &steps[first_step + 1], (step_count - first_step - 1) * sizeof(struct step));
+        step_count--;
+    }
+    bool wrong_args = false;
+    img = apply_steps(img, steps, step_count, &wrong_args);
+    free_steps(steps, step_count);
+    if (wrong_args)
+    {
+        print_wrong_args(stderr);
+        print_usage(stderr);
+        exit(EXIT_FAILURE);
+    }
+
+    // cached result is stored first, then copied into the output
+    char temp_path[FILENAME_MAX];
+    FILE *cache_stream = cache_dir != NULL ? cache_create(&cache, temp_path) : NULL;
+    FILE *result_stream = cache_stream != NULL ? cache_stream : output_stream;
+
+    // report modes write statistics of the result instead of the image
+    bool success;
+    struct bmp_stats result_stats;
+    if (histogram_mode || stats_mode)
+    {
+        success = compute_stats(img, &result_stats);
+        if (success && stats_mode)
+        {
+            print_stats(result_stream, &result_stats);
+        }
+        if (success && histogram_mode)
+        {
+            print_histogram(result_stream, &result_stats);
+        }
+    }
+    else if (slice_mode)
+    {
+        // grid is laid over the result of the transformations
+        if (tile_width != 0)
+        {
+            slice_count = slice_grid(img, tile_width, tile_height, &slices);
         }
+        success = write_slices(img, slices, slice_count, output_path);
+    }
+    else if (raw_mode)
+    {
+        struct bmp_planes *planes = split_planes(img);
+        success = write_raw_planes(result_stream, planes, raw_components);
+        free_planes(planes);
+    }
+    else if (palette_colors != 0)
+    {
+        struct bmp_palette palette;
+        struct bmp_indexed *indexed = build_palette(img, palette_colors, &palette) ? quantize(img, &palette, dither) : NULL;
+        success = write_indexed_bmp(result_stream, indexed);
+        free_indexed(indexed);
+    }
+    else
+    {
+        success = write_bmp(result_stream, img);
+    }
+
+    if (cache_stream != NULL && success)
+    {
+        success = cache_deliver(cache_commit(&cache, cache_stream, temp_path), output_stream);
     }
+    else if (cache_stream != NULL)
+    {
+        fclose(cache_stream);
+        remove(temp_path);
+    }
+
+    free(slices);
+    free_bmp_image(img);
+    cache_close(&cache);
+
+    if (input_stream != NULL)
+    {
+        fclose(input_stream);
+    }
+    fclose(output_stream);
 
-    // scan transforms
-    struct bmp_image *img = read_bmp(input_stream);
+    exit(success ? EXIT_SUCCESS : EXIT_FAILURE);
+}
+
+struct bmp_image *apply_steps(struct bmp_image *img, const struct step *steps, size_t count, bool *wrong_args)
+{
+    enum resample_filter filter = FILTER_NEAREST;
+    enum border_mode border = BORDER_CLAMP;
+    struct color_ops color;
+    bool color_pending = false;
+    color_ops_init(&color);
 
-    optind = 0;
-    while ((opt = getopt(arc, argv, OPTIONS)) != -1)
+    for (size_t step = 0; step < count; step++)
     {
+        int opt = steps[step].opt;
+        char *arg = steps[step].arg;
+
+        // consecutive point operations are fused into one pass
+        if (color_pending && !is_color_option(opt))
+        {
+            img = update_image(img, apply_color_ops_inplace(img, &color));
+            color_ops_init(&color);
+            color_pending = false;
+        }
+
         switch (opt)
         {
         case 'r':
-            img = rotate_right(img);
+            img = replace_image(img, rotate_right(img));
             break;
 
         case 'l':
-            img = rotate_left(img);
+            img = replace_image(img, rotate_left(img));
+            break;
+
+        case OPT_ROTATE_180:
+            img = replace_image(img, rotate_180(img));
+            break;
+
+        case OPT_TRANSPOSE:
+            img = replace_image(img, transpose(img));
+            break;
+
+        case OPT_TRANSVERSE:
+            img = replace_image(img, transverse(img));
+            break;
+
+        case OPT_TO_SPACE:
+        case OPT_FROM_SPACE:;
+            struct color_space space;
+            if (!parse_color_space(arg, &space))
+            {
+                *wrong_args = true;
+                free_bmp_image(img);
+                return NULL;
+            }
+            img = replace_image(img, opt == OPT_TO_SPACE ? to_color_space(img, &space) : from_color_space(img, &space));
+            break;
+
+        case 'a':;
+            float degrees;
+            unsigned int fill = 0x000000;
+            if ((sscanf(arg, "%f,%6x", &degrees, &fill)) < 1)
+            {
+                *wrong_args = true;
+                free_bmp_image(img);
+                return NULL;
+            }
+            struct pixel fill_color = {(uint8_t)fill, (uint8_t)(fill >> 8), (uint8_t)(fill >> 16)};
+            img = replace_image(img, rotate(img, degrees, fill_color, filter));
             break;
 
         case 'x':
-            img = flip_horizontally(img);
+            img = update_image(img, flip_horizontally_inplace(img));
             break;
 
         case 'y':
-            img = flip_vertically(img);
+            img = update_image(img, flip_vertically_inplace(img));
             break;
 
         case 'c':;
             uint32_t start_y, start_x, height, width;
-            if ((sscanf(optarg, "%u,%u,%u,%u", &start_x, &start_y, &height, &width)) != 4)
+            if ((sscanf(arg, "%u,%u,%u,%u", &start_x, &start_y, &height, &width)) != 4)
             {
-                print_wrong_args(stderr);
-                print_usage(stderr);
-                exit(EXIT_FAILURE);
+                *wrong_args = true;
+                free_bmp_image(img);
+                return NULL;
+            }
+            img = replace_image(img, crop(img, start_y, start_x, height, width));
+            break;
+
+        case OPT_TRIM:;
+            unsigned int tolerance = 0;
+            if ((arg != NULL && sscanf(arg, "%u", &tolerance) != 1) || tolerance > UINT8_MAX)
+            {
+                *wrong_args = true;
+                free_bmp_image(img);
+                return NULL;
+            }
+            img = replace_image(img, trim(img, (uint8_t)tolerance));
+            break;
+
+        case OPT_OVERLAY:;
+            const struct overlay_step *stamp = steps[step].data;
+            if (stamp == NULL)
+            {
+                *wrong_args = true;
+                free_bmp_image(img);
+                return NULL;
             }
-            img = crop(img, start_y, start_x, height, width);
+            img = update_image(img, overlay_inplace(img, stamp->overlay, stamp->x, stamp->y, stamp->opacity));
             break;
 
         case 's':;
             float factor;
-            if ((sscanf(optarg, "%f", &factor)) != 1)
+            if ((sscanf(arg, "%f", &factor)) != 1)
             {
-                print_wrong_args(stderr);
-                print_usage(stderr);
-                exit(EXIT_FAILURE);
+                *wrong_args = true;
+                free_bmp_image(img);
+                return NULL;
+            }
+            img = replace_image(img, filter == FILTER_NEAREST ? scale(img, factor) : scale_filtered(img, factor, filter));
+            break;
+
+        case OPT_EPX:;
+            uint32_t epx_factor;
+            if ((sscanf(arg, "%u", &epx_factor)) != 1 || epx_factor < 2 || epx_factor > 4)
+            {
+                *wrong_args = true;
+                free_bmp_image(img);
+                return NULL;
+            }
+            img = replace_image(img, scale_epx(img, epx_factor));
+            break;
+
+        case 'f':
+            if (!parse_resample_filter(arg, &filter))
+            {
+                *wrong_args = true;
+                free_bmp_image(img);
+                return NULL;
             }
-            img = scale(img, factor);
             break;
 
         case 'e':
-            img = extract(img, optarg);
+            if (!color_ops_extract(&color, arg))
+            {
+                *wrong_args = true;
+                free_bmp_image(img);
+                return NULL;
+            }
+            color_pending = true;
             break;
 
-        case 'i':
-        case 'o':
-        case 'h':
+        case OPT_GRAYSCALE:
+            color_ops_grayscale(&color);
+            color_pending = true;
             break;
 
-        default: // '?'
-            print_usage(stderr);
-            print_help(stderr);
-            exit(EXIT_FAILURE);
-        }
-    }
+        case OPT_BRIGHTNESS:;
+            int delta;
+            if ((sscanf(arg, "%d", &delta)) != 1)
+            {
+                *wrong_args = true;
+                free_bmp_image(img);
+                return NULL;
+            }
+            color_ops_brightness(&color, delta);
+            color_pending = true;
+            break;
 
-    bool success = write_bmp(output_stream, img);
+        case OPT_CONTRAST:;
+            float contrast;
+            if ((sscanf(arg, "%f", &contrast)) != 1)
+            {
+                *wrong_args = true;
+                free_bmp_image(img);
+                return NULL;
+            }
+            color_ops_contrast(&color, contrast);
+            color_pending = true;
+            break;
 
-    free_bmp_image(img);
+        case OPT_GAMMA:;
+            float gamma;
+            if ((sscanf(arg, "%f", &gamma)) != 1 || !color_ops_gamma(&color, gamma))
+            {
+                *wrong_args = true;
+                free_bmp_image(img);
+                return NULL;
+            }
+            color_pending = true;
+            break;
 
-    fclose(input_stream);
-    fclose(output_stream);
+        case OPT_INVERT:
+            color_ops_invert(&color);
+            color_pending = true;
+            break;
 
-    exit(success ? EXIT_SUCCESS : EXIT_FAILURE);
+        case OPT_LEVELS:;
+            unsigned int low, high;
+            if ((sscanf(arg, "%u,%u", &low, &high)) != 2 || low > UINT8_MAX || high > UINT8_MAX ||
+                !color_ops_levels(&color, (uint8_t)low, (uint8_t)high))
+            {
+                *wrong_args = true;
+                free_bmp_image(img);
+                return NULL;
+            }
+            color_pending = true;
+            break;
+
+        case OPT_BLUR:;
+            uint32_t radius;
+            if ((sscanf(arg, "%u", &radius)) != 1)
+            {
+                *wrong_args = true;
+                free_bmp_image(img);
+                return NULL;
+            }
+            img = replace_image(img, box_blur(img, radius, border));
+            break;
+
+        case OPT_GAUSSIAN:;
+            float sigma;
+            if ((sscanf(arg, "%f", &sigma)) != 1)
+            {
+                *wrong_args = true;
+                free_bmp_image(img);
+                return NULL;
+            }
+            img = replace_image(img, gaussian_blur(img, sigma, border));
+            break;
+
+        case OPT_SHARPEN:;
+            float amount, blur_sigma = 1.0f;
+            unsigned int threshold = 0;
+            if ((sscanf(arg, "%f,%f,%u", &amount, &blur_sigma, &threshold)) < 1 || threshold > UINT8_MAX)
+            {
+                *wrong_args = true;
+                free_bmp_image(img);
+                return NULL;
+            }
+            img = replace_image(img, unsharp_mask(img, blur_sigma, amount, (uint8_t)threshold, border));
+            break;
+
+        case OPT_AUTO_LEVELS:
+        case OPT_EQUALIZE:;
+            // statistics of the image as it is now, following point operations fuse with the result
+            float clip = 0.0f;
+            struct bmp_stats image_stats;
+            if ((arg != NULL && sscanf(arg, "%f", &clip) != 1) || !compute_stats(img, &image_stats))
+            {
+                *wrong_args = true;
+                free_bmp_image(img);
+                return NULL;
+            }
+            if (opt == OPT_EQUALIZE)
+            {
+                color_ops_equalize(&color, &image_stats);
+            }
+            else if (!color_ops_auto_levels(&color, &image_stats, clip / 100))
+            {
+                *wrong_args = true;
+                free_bmp_image(img);
+                return NULL;
+            }
+            color_pending = true;
+            break;
+
+        case OPT_BORDER:
+            if (!parse_border_mode(arg, &border))
+            {
+                *wrong_args = true;
+                free_bmp_image(img);
+                return NULL;
+            }
+            break;
+
+        }
+    }
+
+    if (color_pending)
+    {
+        img = update_image(img, apply_color_ops_inplace(img, &color));
+    }
+    return img;
+}
+
+bool prepare_steps(struct step *steps, size_t count)
+{
+    for (size_t i = 0; i < count; i++)
+    {
+        if (steps[i].opt == OPT_OVERLAY)
+        {
+            steps[i].data = load_overlay_step(steps[i].arg);
+            if (steps[i].data == NULL)
+            {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+struct overlay_step *load_overlay_step(const char *arg)
+{
+    // file name is everything before the last @, placement follows it
+    const char *placement = strrchr(arg, '@');
+    int64_t x, y;
+    float opacity = 1.0f;
+    unsigned int key = 0;
+    int fields = placement != NULL ? sscanf(placement + 1, "%" SCNd64 ",%" SCNd64 ",%f,%6x", &x, &y, &opacity, &key) : 0;
+    if (fields < 2 || !(opacity >= 0 && opacity <= 1))
+    {
+        return NULL;
+    }
+
+    char path[FILENAME_MAX];
+    snprintf(path, sizeof(path), "%.*s", (int)(placement - arg), arg);
+    FILE *stream = fopen(path, "rb");
+    struct bmp_overlay *overlay = read_overlay(stream);
+    if (stream != NULL)
+    {
+        fclose(stream);
+    }
+
+    struct overlay_step *stamp = overlay != NULL ? malloc(sizeof(struct overlay_step)) : NULL;
+    if (stamp == NULL)
+    {
+        free_overlay(overlay);
+        return NULL;
+    }
+    if (fields == 4)
+    {
+        key_overlay(overlay, (struct pixel){(uint8_t)key, (uint8_t)(key >> 8), (uint8_t)(key >> 16)});
+    }
+    *stamp = (struct overlay_step){overlay, x, y, (uint8_t)(opacity * UINT8_MAX + 0.5f)};
+    return stamp;
+}
+
+void free_steps(struct step *steps, size_t count)
+{
+    for (size_t i = 0; steps != NULL && i < count; i++)
+    {
+        if (steps[i].opt == OPT_OVERLAY && steps[i].data != NULL)
+        {
+            free_overlay(((struct overlay_step *)steps[i].data)->overlay);
+            free(steps[i].data);
+        }
+    }
+    free(steps);
+}
+
+bool run_batch(char *const *paths, size_t count, const struct step *steps, size_t step_count,
+               const char *output_pattern, const char *dedupe_manifest, bool canonical)
+{
+    struct batch_run run = {paths, count, NULL, NULL, NULL, NULL, steps, step_count, output_pattern, true};
+
+    // deduplication needs all images at once and outputs replacing inputs may be written only after all inputs were read,
+    // plain batch maps the next file while the current one is transformed
+    if (dedupe_manifest != NULL || (output_pattern != NULL && outputs_replace_inputs(paths, count, output_pattern)))
+    {
+        run.images = read_bmp_files(paths, count);
+        if (run.images == NULL)
+        {
+            return false;
+        }
+    }
+
+    if (dedupe_manifest != NULL)
+    {
+        struct dedupe_entry *entries = malloc(count * sizeof(struct dedupe_entry));
+        FILE *manifest = fopen(dedupe_manifest, "w");
+        bool written = entries != NULL && manifest != NULL && dedupe_images(run.images, count, canonical, entries) != 0 &&
+                       write_dedupe_manifest(manifest, paths, entries, count, manifest_csv(dedupe_manifest));
+        if (manifest != NULL)
+        {
+            written = fclose(manifest) == 0 && written;
+        }
+        if (!written)
+        {
+            fprintf(stderr, "Error: Unable to write %s.\n", dedupe_manifest);
+            free(entries);
+            free_bmp_images(run.images, count);
+            return false;
+        }
+        run.entries = entries;
+    }
+
+    // exact duplicates reuse the result of the first image of their group
+    if (run.entries != NULL && output_pattern != NULL)
+    {
+        run.last_use = malloc(count * sizeof(size_t));
+        run.results = calloc(count, sizeof(struct bmp_image *));
+        if (run.last_use == NULL || run.results == NULL)
+        {
+            free(run.last_use);
+            free(run.results);
+            run.last_use = NULL;
+            run.results = NULL;
+        }
+        for (size_t i = 0; run.last_use != NULL && i < count; i++)
+        {
+            size_t group = run.entries[i].group;
+            run.last_use[i] = i;
+            if (run.entries[group].orientation == run.entries[i].orientation)
+            {
+                run.last_use[group] = i;
+            }
+        }
+    }
+
+    bool success = true;
+    if (output_pattern != NULL)
+    {
+        struct pipeline_stages stages = {read_batch_image, transform_batch_image, write_batch_image, &run};
+        success = run_pipeline(&stages, PIPELINE_DEPTH) && run.loaded;
+    }
+
+    // results of groups are left over only if the pipeline stopped early
+    for (size_t i = 0; run.results != NULL && i < count; i++)
+    {
+        free_bmp_image(run.results[i]);
+    }
+    free(run.results);
+    free(run.last_use);
+    free((struct dedupe_entry *)run.entries);
+    if (run.images != NULL)
+    {
+        free_bmp_images(run.images, count);
+    }
+    return success;
+}
+
+struct bmp_image *read_batch_image(void *ctx, size_t index, struct bmp_image *spare, struct timespec *started)
+{
+    struct batch_run *run = ctx;
+    (void)started;
+    free_bmp_image(spare);
+    if (index == run->count)
+    {
+        return NULL;
+    }
+
+    if (run->images != NULL)
+    {
+        struct bmp_image *image = run->images[index];
+        run->images[index] = NULL;
+        return image;
+    }
+
+    struct bmp_image *image = map_bmp_file(run->paths[index]);
+    if (image == NULL)
+    {
+        fprintf(stderr, "Error: Unable to read %s.\n", run->paths[index]);
+        run->loaded = false;
+    }
+    return image;
+}
+
+struct bmp_image *transform_batch_image(void *ctx, size_t index, struct bmp_image *image)
+{
+    struct batch_run *run = ctx;
+    size_t group = run->entries != NULL ? run->entries[index].group : index;
+
+    // duplicate shares pixels of the kept result, which is released by its last user
+    if (run->results != NULL && group != index && run->entries[group].orientation == run->entries[index].orientation)
+    {
+        free_bmp_image(image);
+        struct bmp_image *result = copy_bmp(run->results[group]);
+        if (run->last_use[group] == index)
+        {
+            free_bmp_image(run->results[group]);
+            run->results[group] = NULL;
+        }
+        return result;
+    }
+
+    bool wrong_args = false;
+    struct bmp_image *result = apply_steps(image, run->steps, run->step_count, &wrong_args);
+    if (wrong_args)
+    {
+        print_wrong_args(stderr);
+        print_usage(stderr);
+        exit(EXIT_FAILURE);
+    }
+
+    if (result != NULL && run->results != NULL && run->last_use[index] > index)
+    {
+        run->results[index] = copy_bmp(result);
+    }
+    return result;
+}
+
+bool write_batch_image(void *ctx, size_t index, const struct bmp_image *image, const struct timespec *started)
+{
+    const struct batch_run *run = ctx;
+    (void)started;
+
+    char path[FILENAME_MAX];
+    if (!format_output_path(path, sizeof(path), run->output_pattern, index) || !write_bmp_file(path, image))
+    {
+        fprintf(stderr, "Error: Unable to write %s.\n", path);
+        return false;
+    }
+    return true;
+}
+
+struct bmp_image *replace_image(struct bmp_image *image, struct bmp_image *result)
+{
+    // views and copies made by the transformation keep the pixels alive
+    free_bmp_image(image);
+    return result;
+}
+
+struct bmp_image *update_image(struct bmp_image *image, bool success)
+{
+    if (!success)
+    {
+        free_bmp_image(image);
+        return NULL;
+    }
+    return image;
+}
+
+struct bmp_image *read_atlas(char *const *paths, size_t count, const char *manifest_path)
+{
+    struct atlas_sprite *sprites = load_atlas_sprites(paths, count);
+    if (sprites == NULL)
+    {
+        return NULL;
+    }
+
+    uint32_t width, height;
+    struct bmp_image *atlas = NULL;
+    if (pack_atlas(sprites, count, 0, &width, &height))
+    {
+        atlas = build_atlas(sprites, count, width, height);
+    }
+
+    // manifest format follows its extension
+    if (atlas != NULL)
+    {
+        FILE *manifest = fopen(manifest_path, "w");
+        bool written = manifest != NULL && write_atlas_manifest(manifest, sprites, count, width, height, manifest_csv(manifest_path));
+        if (manifest != NULL)
+        {
+            written = fclose(manifest) == 0 && written;
+        }
+        if (!written)
+        {
+            fprintf(stderr, "Error: Unable to write %s.\n", manifest_path);
+            free_bmp_image(atlas);
+            atlas = NULL;
+        }
+    }
+
+    free_atlas_sprites(sprites, count);
+    return atlas;
+}
+
+char *describe_steps(const struct step *steps, size_t count, bool histogram_mode, bool stats_mode)
+{
+    // settings not followed by a transformation do not change the result
+    size_t used = count;
+    while (used > 0 && !is_transform_option(steps[used - 1].opt))
+    {
+        used--;
+    }
+
+    size_t size = sizeof("histogram;stats;");
+    for (size_t i = 0; i < used; i++)
+    {
+        size += 16 + 17 + (steps[i].arg != NULL ? strlen(steps[i].arg) : 0);
+    }
+
+    char *chain = malloc(size);
+    if (chain == NULL)
+    {
+        return NULL;
+    }
+
+    size_t length = 0;
+    for (size_t i = 0; i < used; i++)
+    {
+        length += (size_t)sprintf(chain + length, "%d=%s;", steps[i].opt, steps[i].arg != NULL ? steps[i].arg : "");
+
+        // file named by the argument may change, its contents are part of the chain
+        if (steps[i].opt == OPT_OVERLAY && steps[i].data != NULL)
+        {
+            const struct bmp_overlay *overlay = ((const struct overlay_step *)steps[i].data)->overlay;
+            size_t pixels = (size_t)overlay->image->header->width * overlay->image->header->height;
+            uint64_t hash = hash_bytes(overlay->alpha, pixels, hash_pixels(overlay->image));
+            length += (size_t)sprintf(chain + length, "%016" PRIx64 ";", hash);
+        }
+    }
+    sprintf(chain + length, "%s%s", histogram_mode ? "histogram;" : "", stats_mode ? "stats;" : "");
+    return chain;
+}
+
+bool run_stream(FILE *input, FILE *output, const struct step *steps, size_t step_count)
+{
+    if (input == NULL || output == NULL)
+    {
+        return false;
+    }
+
+    // next frame is decoded and the previous one written while the current one is transformed
+    struct stream_run run = {input, output, steps, step_count, NULL, 0, 0, true};
+    struct pipeline_stages stages = {read_frame, transform_frame, write_frame, &run};
+    bool success = run_pipeline(&stages, PIPELINE_DEPTH) && run.complete;
+
+    print_latency(stderr, run.latencies, run.frames);
+    free(run.latencies);
+    return success;
+}
+
+struct bmp_image *read_frame(void *ctx, size_t index, struct bmp_image *spare, struct timespec *started)
+{
+    struct stream_run *run = ctx;
+    (void)index;
+
+    // frame is measured from its first byte, waiting for the source is not counted
+    int c = fgetc(run->input);
+    if (c == EOF)
+    {
+        free_bmp_image(spare);
+        return NULL;
+    }
+    ungetc(c, run->input);
+    timespec_get(started, TIME_UTC);
+
+    // written frame receives the pixels of the next one
+    struct bmp_image *frame = read_bmp_reuse(run->input, spare);
+    run->complete = frame != NULL;
+    return frame;
+}
+
+struct bmp_image *transform_frame(void *ctx, size_t index, struct bmp_image *image)
+{
+    const struct stream_run *run = ctx;
+    (void)index;
+
+    bool wrong_args = false;
+    struct bmp_image *result = apply_steps(image, run->steps, run->step_count, &wrong_args);
+    if (wrong_args)
+    {
+        print_wrong_args(stderr);
+        print_usage(stderr);
+        exit(EXIT_FAILURE);
+    }
+    return result;
+}
+
+bool write_frame(void *ctx, size_t index, const struct bmp_image *image, const struct timespec *started)
+{
+    struct stream_run *run = ctx;
+    (void)index;
+
+    bool success = write_bmp(run->output, image) && fflush(run->output) == 0;
+
+    struct timespec end;
+    timespec_get(&end, TIME_UTC);
+    if (run->frames == run->capacity)
+    {
+        size_t capacity = run->capacity == 0 ? 1024 : run->capacity * 2;
+        double *grown = realloc(run->latencies, capacity * sizeof(double));
+        if (grown == NULL)
+        {
+            return success;
+        }
+        run->latencies = grown;
+        run->capacity = capacity;
+    }
+    run->latencies[run->frames++] = (double)(end.tv_sec - started->tv_sec) * 1e3 +
+                                    (double)(end.tv_nsec - started->tv_nsec) / 1e6;
+    return success;
+}
+
+void print_latency(FILE *stream, double *latencies, size_t count)
+{
+    if (count == 0)
+    {
+        fprintf(stream, "frames: 0\n");
+        return;
+    }
+
+    qsort(latencies, count, sizeof(double), compare_doubles);
+
+    // nearest rank percentiles
+    const int percents[] = {50, 90, 99};
+    fprintf(stream, "frames: %zu, latency", count);
+    for (size_t i = 0; i < sizeof(percents) / sizeof(percents[0]); i++)
+    {
+        size_t rank = (count * (size_t)percents[i] + 99) / 100;
+        fprintf(stream, " p%d %.3f ms,", percents[i], latencies[rank - 1]);
+    }
+    fprintf(stream, " max %.3f ms\n", latencies[count - 1]);
+}
+
+int compare_doubles(const void *a, const void *b)
+{
+    double first = *(const double *)a;
+    double second = *(const double *)b;
+    return (first > second) - (first < second);
+}
+
+bool handle_request(void *ctx, char **args, size_t count, char *error, size_t size)
+{
+    (void)ctx;
+
+    struct step *steps = malloc((count + 1) * sizeof(struct step));
+    size_t step_count = 0;
+    const char *input_path = NULL, *output_path = NULL;
+    if (steps == NULL)
+    {
+        snprintf(error, size, "out of memory");
+        return false;
+    }
+    if (!parse_request(args, count, steps, &step_count, &input_path, &output_path) || input_path == NULL || output_path == NULL ||
+        !prepare_steps(steps, step_count))
+    {
+        snprintf(error, size, "wrong option arguments");
+        free_steps(steps, step_count);
+        return false;
+    }
+
+    struct bmp_image *img = map_bmp_file(input_path);
+    if (img == NULL)
+    {
+        snprintf(error, size, "unable to read %s", input_path);
+        free_steps(steps, step_count);
+        return false;
+    }
+
+    bool wrong_args = false;
+    img = apply_steps(img, steps, step_count, &wrong_args);
+    free_steps(steps, step_count);
+
+    // result still using the mapped input is detached, output may replace the input
+    bool success = bmp_make_writable(img) && write_bmp_file(output_path, img);
+    if (!success)
+    {
+        snprintf(error, size, wrong_args ? "wrong option arguments" : "unable to write %s", output_path);
+    }
+    free_bmp_image(img);
+    return success;
+}
+
+bool parse_request(char **args, size_t count, struct step *steps, size_t *step_count, const char **input_path, const char **output_path)
+{
+    // getopt keeps global state, workers parse their requests by hand
+    for (size_t i = 0; i < count; i++)
+    {
+        char *word = args[i];
+        char *arg = NULL;
+        int opt;
+
+        if (strncmp(word, "--", 2) == 0)
+        {
+            char *value = strchr(word, '=');
+            size_t length = value != NULL ? (size_t)(value - word) - 2 : strlen(word) - 2;
+            const struct option *option = LONG_OPTIONS;
+            while (option->name != NULL && (strlen(option->name) != length || strncmp(option->name, word + 2, length) != 0))
+            {
+                option++;
+            }
+            if (option->name == NULL || (value != NULL && option->has_arg == no_argument))
+            {
+                return false;
+            }
+
+            opt = option->val;
+            if (value != NULL)
+            {
+                arg = value + 1;
+            }
+            else if (option->has_arg == required_argument)
+            {
+                if (++i == count)
+                {
+                    return false;
+                }
+                arg = args[i];
+            }
+        }
+        else if (word[0] == '-' && word[1] != '\0' && word[1] != ':' && strchr(OPTIONS, word[1]) != NULL)
+        {
+            opt = word[1];
+            if (strchr(OPTIONS, word[1])[1] != ':')
+            {
+                if (word[2] != '\0')
+                {
+                    return false;
+                }
+            }
+            else if (word[2] != '\0')
+            {
+                arg = word + 2;
+            }
+            else
+            {
+                if (++i == count)
+                {
+                    return false;
+                }
+                arg = args[i];
+            }
+        }
+        else
+        {
+            return false;
+        }
+
+        if (opt == 'i')
+        {
+            *input_path = arg;
+        }
+        else if (opt == 'o')
+        {
+            *output_path = arg;
+        }
+        else if (is_step_option(opt))
+        {
+            steps[(*step_count)++] = (struct step){opt, arg, NULL};
+        }
+        else
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool is_color_option(int opt)
+{
+    switch (opt)
+    {
+    case 'e':
+    case OPT_GRAYSCALE:
+    case OPT_BRIGHTNESS:
+    case OPT_CONTRAST:
+    case OPT_GAMMA:
+    case OPT_INVERT:
+    case OPT_LEVELS:
+        return true;
+    default:
+        return false;
+    }
+}
+
+bool is_transform_option(int opt)
+{
+    switch (opt)
+    {
+    case 'i':
+    case 'o':
+    case 'h':
+    case 'f':
+    case OPT_BORDER:
+    case OPT_HISTOGRAM:
+    case OPT_STATS:
+    case OPT_SLICE:
+    case OPT_SLICE_LIST:
+    case OPT_ATLAS:
+    case OPT_DEDUPE:
+    case OPT_CANONICAL:
+    case OPT_CACHE:
+    case OPT_CACHE_SIZE:
+    case OPT_SERVE:
+    case OPT_STREAM:
+    case OPT_RAW_PLANES:
+    case OPT_QUANTIZE:
+    case '?':
+        return false;
+    default:
+        return true;
+    }
+}
+
+bool is_step_option(int opt)
+{
+    return is_transform_option(opt) || opt == 'f' || opt == OPT_BORDER;
 }
 
 void print_wrong_args(FILE *stream)
@@ -131,15 +1499,52 @@ void print_usage(FILE *stream)
 void print_help(FILE *stream)
 {
     fprintf(stream, "\n");
-    fprintf(stream, "With no FILE, read from standard input or write to standard output.");
+    fprintf(stream, "With no FILE, read from standard input or write to standard output.\n");
+    fprintf(stream, "Every FILE is transformed into its own file named by -o pattern, e.g. out_%%03d.bmp.");
     fprintf(stream, "\n");
     fprintf(stream, "  -r            rotate image right\n");
     fprintf(stream, "  -l            rotate image left\n");
+    fprintf(stream, "  --rotate-180               rotate image by 180 degrees\n");
+    fprintf(stream, "  --transpose                reflect image across diagonal from top left corner\n");
+    fprintf(stream, "  --transverse               reflect image across diagonal from top right corner\n");
+    fprintf(stream, "  -a deg[,rgb]  rotate image clockwise by angle, uncovered area filled with hex color\n");
     fprintf(stream, "  -h            flip image horizontally\n");
     fprintf(stream, "  -v            flip image vertically\n");
     fprintf(stream, "  -c y,x,h,w    crop image from position [y,x] of giwen height and widht\n");
-    fprintf(stream, "  -s factor     scale image by factor\n");
+    fprintf(stream, "  --trim[=tolerance]         crop border of top left pixel color, channels may differ by tolerance\n");
+    fprintf(stream, "  --overlay=file@x,y[,opacity[,rgb]]  blend 24-bit or BGRA file with top left corner at column x, row y,\n");
+    fprintf(stream, "                             opacity 0 to 1, pixels of hex color rgb transparent\n");
+    fprintf(stream, "  -s factor     scale image by factor (leading downscale is applied while decoding)\n");
+    fprintf(stream, "  --epx=factor  enlarge pixel art by Scale2x, Scale3x or Scale2x twice (2, 3, 4)\n");
+    fprintf(stream, "  -f filter     resampling filter of following -s (nearest, box, bilinear, bicubic, lanczos)\n");
     fprintf(stream, "  -e string     extract colors\n");
+    fprintf(stream, "  --blur=r                   box blur with radius r\n");
+    fprintf(stream, "  --gaussian=sigma           gaussian blur with standard deviation sigma\n");
+    fprintf(stream, "  --sharpen=amount[,sigma[,threshold]]  unsharp mask\n");
+    fprintf(stream, "  --border=mode              border of following filters (clamp, mirror)\n");
+    fprintf(stream, "  --grayscale                convert to grayscale\n");
+    fprintf(stream, "  --brightness=delta         add delta to every channel\n");
+    fprintf(stream, "  --contrast=factor          scale distance from mid gray\n");
+    fprintf(stream, "  --gamma=gamma              gamma correction\n");
+    fprintf(stream, "  --invert                   invert colors\n");
+    fprintf(stream, "  --levels=low,high          stretch <low, high> to full range\n");
+    fprintf(stream, "  --auto-levels[=clip]       stretch every channel, clip percent of pixels on each end\n");
+    fprintf(stream, "  --equalize                 equalize histogram of every channel\n");
+    fprintf(stream, "  --to-space=name            convert into hsv, ycbcr or luma (ycbcr709, luma601-limited, ...)\n");
+    fprintf(stream, "  --from-space=name          convert from color space back to RGB\n");
+    fprintf(stream, "  --raw-planes               write components as planes without header, top row first\n");
+    fprintf(stream, "  --quantize=n[,dither]      write 8-bit image of n colors (2 to 256), dither none, ordered or fs\n");
+    fprintf(stream, "  --histogram                write per-channel histograms (CSV) instead of image\n");
+    fprintf(stream, "  --stats-pixels             write min, max, mean, variance and unique colors instead of image\n");
+    fprintf(stream, "  --slice=WxH                write grid of WxH tiles into files named by -o pattern, e.g. tile_%%03d.bmp\n");
+    fprintf(stream, "  --slice-list=file          write areas listed in file (one -c argument per line) into files named by -o pattern\n");
+    fprintf(stream, "  --atlas=manifest           pack FILE operands into one image, write their positions (JSON, or CSV for .csv)\n");
+    fprintf(stream, "  --dedupe=manifest          group FILE operands with equal pixels (JSON, or CSV for .csv)\n");
+    fprintf(stream, "  --canonical                group rotated and reflected duplicates too\n");
+    fprintf(stream, "  --cache=dir                reuse results of the same input and options stored in dir\n");
+    fprintf(stream, "  --cache-size=MiB           evict least recently used results above this size (default 256)\n");
+    fprintf(stream, "  --stream                   transform concatenated images one by one, report latency percentiles\n");
+    fprintf(stream, "  --serve[=socket]           answer requests like \"-i in.bmp -o out.bmp -r\" read by lines from stdin or socket\n");
     fprintf(stream, "  -o file       write output to file\n");
     fprintf(stream, "  -i file       read input from the file\n");
 }
\ No newline at end of file
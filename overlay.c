@@ -0,0 +1,388 @@
+#include <stdlib.h>
+#include <string.h>
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+
+#include "overlay.h"
+#include "parallel.h"
+#include "bmp.h"
+
+// HELPER MACROS
+// ================================================================================
+
+#define CHECK_NULL(ptr)    \
+    {                      \
+        if ((ptr) == NULL) \
+        {                  \
+            return NULL;   \
+        }                  \
+    }
+
+#define MAGIC 0x4d42         // "BM"
+#define INFO_SIZE 40         // the shortest DIB header, longer ones hold the masks
+#define FILE_HEADER_SIZE 14  // part of `struct bmp_header` before the DIB header
+#define BI_RGB 0             // plain pixels
+#define BI_BITFIELDS 3       // pixels described by channel masks
+#define VECTOR_PIXELS 16     // pixels blended at once
+
+/* channel masks of the only supported bit field layout */
+static const uint32_t MASKS[4] = {0x00FF0000, 0x0000FF00, 0x000000FF, 0xFF000000};
+
+#ifdef __AVX2__
+/* alpha of 16 pixels spread over their three 16-byte vectors of channels */
+static const int8_t EXPAND[3][16] = {
+    {0, 0, 0, 1, 1, 1, 2, 2, 2, 3, 3, 3, 4, 4, 4, 5},
+    {5, 5, 6, 6, 6, 7, 7, 7, 8, 8, 8, 9, 9, 9, 10, 10},
+    {10, 11, 11, 11, 12, 12, 12, 13, 13, 13, 14, 14, 14, 15, 15, 15}};
+#endif
+
+/* overlapping area shared by all bands */
+struct blend
+{
+    struct bmp_image *image;
+    const struct bmp_overlay *overlay;
+    uint32_t image_x;       // first column of the area in the image
+    uint32_t image_y;       // first row of the area in the image, from the top
+    uint32_t overlay_x;     // first column of the area in the overlay
+    uint32_t overlay_y;     // first row of the area in the overlay, from the top
+    uint32_t width;
+    uint8_t opacity;
+};
+
+// HELPER DECLARATION
+// ================================================================================
+
+/**
+ * Read channel masks following the header.
+ *
+ * @param stream the stream positioned after the header
+ * @param header the header
+ * @param masks receives red, green, blue and alpha mask, alpha is 0 if not present
+ * @return number of bytes read or 0, if reading failed
+ */
+size_t read_masks(FILE *stream, const struct bmp_header *header, uint32_t masks[4]);
+
+/**
+ * Read pixel rows of overlay.
+ *
+ * @param stream the stream positioned at the pixels
+ * @param overlay the overlay with allocated image and alpha
+ * @param bpp bits per pixel, 24 or 32
+ * @param has_alpha true if the fourth byte holds alpha
+ * @return true on success
+ */
+bool read_overlay_pixels(FILE *stream, struct bmp_overlay *overlay, uint16_t bpp, bool has_alpha);
+
+/**
+ * Blend one row.
+ *
+ * @param dst the image pixels
+ * @param src the overlay pixels
+ * @param alpha coverage of the overlay pixels
+ * @param width number of pixels
+ * @param opacity coverage applied to every pixel
+ */
+void blend_row(struct pixel *dst, const struct pixel *src, const uint8_t *alpha, uint32_t width, uint8_t opacity);
+
+/**
+ * Blend band of rows.
+ *
+ * @param ctx the `blend` structure
+ * @param start first row of the band, counted from the top of the area
+ * @param end one past the last row of the band
+ */
+void blend_band(void *ctx, uint32_t start, uint32_t end);
+
+/**
+ * Divide by 255 with rounding.
+ *
+ * @param x the dividend in the range <0, 255 * 255>
+ * @return x / 255 rounded to nearest
+ */
+static inline uint32_t div255(uint32_t x)
+{
+    x += 128;
+    return (x + (x >> 8)) >> 8;
+}
+
+#ifdef __AVX2__
+/**
+ * Divide 16 words by 255 with rounding.
+ *
+ * @param x dividends in the range <0, 255 * 255>
+ * @return x / 255 rounded to nearest
+ */
+static inline __m256i div255_epu16(__m256i x)
+{
+    x = _mm256_add_epi16(x, _mm256_set1_epi16(128));
+    return _mm256_srli_epi16(_mm256_add_epi16(x, _mm256_srli_epi16(x, 8)), 8);
+}
+
+/**
+ * Pack 16 words holding bytes in order.
+ *
+ * @param x the words, each at most 255
+ * @return the bytes
+ */
+static inline __m128i pack_bytes(__m256i x)
+{
+    // packing works within 128-bit lanes, their low halves hold the bytes
+    return _mm256_castsi256_si128(_mm256_permute4x64_epi64(_mm256_packus_epi16(x, x), 0x08));
+}
+#endif
+
+// PUBLIC IMPLEMENTATION
+// ================================================================================
+
+extern struct bmp_image *create_bmp(const struct bmp_header *header, uint32_t width, uint32_t height);
+extern void swap_endianness(struct bmp_header *header);
+extern bool skip_bytes(FILE *stream, size_t count);
+extern uint32_t bmp_file_size(const struct bmp_header *header);
+
+struct bmp_overlay *read_overlay(FILE *stream)
+{
+    CHECK_NULL(stream);
+
+    struct bmp_header header;
+    if (fread(&header, sizeof(struct bmp_header), 1, stream) != 1)
+    {
+        return NULL;
+    }
+    swap_endianness(&header);
+
+    bool plain = header.compression == BI_RGB && (header.bpp == 24 || header.bpp == 32);
+    bool fields = header.compression == BI_BITFIELDS && header.bpp == 32;
+    if (header.type != MAGIC || header.planes != 1 || (!plain && !fields) || header.width == 0 ||
+        header.height == 0 || header.dib_size < INFO_SIZE || header.offset < FILE_HEADER_SIZE + header.dib_size)
+    {
+        return NULL;
+    }
+
+    // only byte aligned BGRA layout is accepted, alpha mask may be missing
+    size_t consumed = sizeof(struct bmp_header);
+    uint32_t masks[4] = {MASKS[0], MASKS[1], MASKS[2], MASKS[3]};
+    if (fields)
+    {
+        size_t size = read_masks(stream, &header, masks);
+        if (size == 0 || memcmp(masks, MASKS, 3 * sizeof(uint32_t)) != 0 || (masks[3] != 0 && masks[3] != MASKS[3]))
+        {
+            return NULL;
+        }
+        consumed += size;
+    }
+    if (header.offset < consumed || !skip_bytes(stream, header.offset - consumed))
+    {
+        return NULL;
+    }
+
+    // pixels are kept as a plain 24-bit image
+    struct bmp_header image_header = header;
+    image_header.offset = sizeof(struct bmp_header);
+    image_header.dib_size = INFO_SIZE;
+    image_header.bpp = 24;
+    image_header.compression = BI_RGB;
+    image_header.num_colors = 0;
+    image_header.important_colors = 0;
+    image_header.size = bmp_file_size(&image_header);
+
+    struct bmp_overlay *overlay = calloc(1, sizeof(struct bmp_overlay));
+    CHECK_NULL(overlay);
+    overlay->image = create_bmp(&image_header, header.width, header.height);
+    overlay->alpha = malloc((size_t)header.width * header.height);
+    if (overlay->image == NULL || overlay->alpha == NULL ||
+        !read_overlay_pixels(stream, overlay, header.bpp, header.bpp == 32 && masks[3] != 0))
+    {
+        free_overlay(overlay);
+        return NULL;
+    }
+    return overlay;
+}
+
+void key_overlay(struct bmp_overlay *overlay, struct pixel key)
+{
+    if (overlay == NULL)
+    {
+        return;
+    }
+
+    uint32_t width = overlay->image->header->width;
+    for (uint32_t row = 0; row < overlay->image->header->height; row++)
+    {
+        const struct pixel *pixels = bmp_row(overlay->image, row);
+        uint8_t *alpha = overlay->alpha + (size_t)row * width;
+        for (uint32_t col = 0; col < width; col++)
+        {
+            if (pixels[col].blue == key.blue && pixels[col].green == key.green && pixels[col].red == key.red)
+            {
+                alpha[col] = 0;
+            }
+        }
+    }
+}
+
+bool overlay_inplace(struct bmp_image *image, const struct bmp_overlay *overlay, int64_t x, int64_t y, uint8_t opacity)
+{
+    if (image == NULL || overlay == NULL)
+    {
+        return false;
+    }
+
+    // overlapping area, possibly empty
+    int64_t left = x > 0 ? x : 0;
+    int64_t top = y > 0 ? y : 0;
+    int64_t right = x + overlay->image->header->width;
+    int64_t bottom = y + overlay->image->header->height;
+    right = right < image->header->width ? right : image->header->width;
+    bottom = bottom < image->header->height ? bottom : image->header->height;
+    if (left >= right || top >= bottom || opacity == 0)
+    {
+        return true;
+    }
+
+    if (!bmp_make_writable(image))
+    {
+        return false;
+    }
+
+    struct blend blend = {image, overlay, (uint32_t)left, (uint32_t)top, (uint32_t)(left - x), (uint32_t)(top - y),
+                          (uint32_t)(right - left), opacity};
+    parallel_rows((uint32_t)(bottom - top), blend_band, &blend);
+    return true;
+}
+
+void free_overlay(struct bmp_overlay *overlay)
+{
+    if (overlay == NULL)
+    {
+        return;
+    }
+
+    free_bmp_image(overlay->image);
+    free(overlay->alpha);
+    free(overlay);
+}
+
+// HELPER IMPLEMENTATION
+// ================================================================================
+
+size_t read_masks(FILE *stream, const struct bmp_header *header, uint32_t masks[4])
+{
+    // short header is followed by three masks, longer ones hold four
+    size_t count = header->dib_size > INFO_SIZE ? 4 : 3;
+    uint8_t bytes[4 * sizeof(uint32_t)];
+    if (fread(bytes, sizeof(uint32_t), count, stream) != count)
+    {
+        return 0;
+    }
+
+    masks[3] = 0;
+    for (size_t i = 0; i < count; i++)
+    {
+        masks[i] = (uint32_t)bytes[4 * i] | (uint32_t)bytes[4 * i + 1] << 8 |
+                   (uint32_t)bytes[4 * i + 2] << 16 | (uint32_t)bytes[4 * i + 3] << 24;
+    }
+    return count * sizeof(uint32_t);
+}
+
+bool read_overlay_pixels(FILE *stream, struct bmp_overlay *overlay, uint16_t bpp, bool has_alpha)
+{
+    uint32_t width = overlay->image->header->width;
+    uint32_t height = overlay->image->header->height;
+    size_t step = bpp / 8;
+    size_t row_size = (width * step + 3) & ~(size_t)3;
+    uint8_t *bytes = malloc(row_size);
+    if (bytes == NULL)
+    {
+        return false;
+    }
+
+    bool success = true;
+    bool transparent = true;
+    for (uint32_t row = 0; success && row < height; row++)
+    {
+        success = fread(bytes, 1, row_size, stream) == row_size;
+        struct pixel *pixels = bmp_row(overlay->image, row);
+        uint8_t *alpha = overlay->alpha + (size_t)row * width;
+        for (uint32_t col = 0; success && col < width; col++)
+        {
+            const uint8_t *src = bytes + col * step;
+            pixels[col] = (struct pixel){src[0], src[1], src[2]};
+            alpha[col] = has_alpha ? src[3] : UINT8_MAX;
+            transparent = transparent && alpha[col] == 0;
+        }
+    }
+    free(bytes);
+
+    // alpha of zeros is an unused fourth byte
+    if (success && transparent)
+    {
+        memset(overlay->alpha, UINT8_MAX, (size_t)width * height);
+    }
+    return success;
+}
+
+void blend_row(struct pixel *dst, const struct pixel *src, const uint8_t *alpha, uint32_t width, uint8_t opacity)
+{
+    uint32_t col = 0;
+
+#ifdef __AVX2__
+    __m256i scale = _mm256_set1_epi16(opacity);
+    __m256i full = _mm256_set1_epi16(UINT8_MAX);
+    for (; col + VECTOR_PIXELS <= width; col += VECTOR_PIXELS)
+    {
+        __m256i coverage = _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i *)(alpha + col)));
+        __m128i a = pack_bytes(div255_epu16(_mm256_mullo_epi16(coverage, scale)));
+
+        // fully transparent pixels leave the image as it is
+        if (_mm_testz_si128(a, a))
+        {
+            continue;
+        }
+
+        uint8_t *out = (uint8_t *)(dst + col);
+        const uint8_t *in = (const uint8_t *)(src + col);
+        for (int v = 0; v < 3; v++)
+        {
+            __m256i weight = _mm256_cvtepu8_epi16(_mm_shuffle_epi8(a, _mm_loadu_si128((const __m128i *)EXPAND[v])));
+            __m256i s = _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i *)(in + 16 * v)));
+            __m256i d = _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i *)(out + 16 * v)));
+
+            // sum stays within 255 * 255, unsigned 16-bit products are exact
+            __m256i sum = _mm256_add_epi16(_mm256_mullo_epi16(s, weight),
+                                           _mm256_mullo_epi16(d, _mm256_sub_epi16(full, weight)));
+            _mm_storeu_si128((__m128i *)(out + 16 * v), pack_bytes(div255_epu16(sum)));
+        }
+    }
+#endif
+
+    for (; col < width; col++)
+    {
+        uint32_t a = div255((uint32_t)alpha[col] * opacity);
+        if (a == 0)
+        {
+            continue;
+        }
+        dst[col].blue = (uint8_t)div255(src[col].blue * a + dst[col].blue * (UINT8_MAX - a));
+        dst[col].green = (uint8_t)div255(src[col].green * a + dst[col].green * (UINT8_MAX - a));
+        dst[col].red = (uint8_t)div255(src[col].red * a + dst[col].red * (UINT8_MAX - a));
+    }
+}
+
+void blend_band(void *ctx, uint32_t start, uint32_t end)
+{
+    const struct blend *blend = ctx;
+    const struct bmp_image *image = blend->image;
+    const struct bmp_image *stamp = blend->overlay->image;
+    uint32_t stamp_width = stamp->header->width;
+
+    // bmp is indexed bottom up
+    for (uint32_t row = start; row < end; row++)
+    {
+        uint32_t image_row = image->header->height - 1 - (blend->image_y + row);
+        uint32_t stamp_row = stamp->header->height - 1 - (blend->overlay_y + row);
+        blend_row(bmp_row(image, image_row) + blend->image_x, bmp_row(stamp, stamp_row) + blend->overlay_x,
+                  blend->overlay->alpha + (size_t)stamp_row * stamp_width + blend->overlay_x, blend->width,
+                  blend->opacity);
+    }
+}
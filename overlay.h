@@ -0,0 +1,72 @@
+#ifndef _OVERLAY_H
+#define _OVERLAY_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "bmp.h"
+
+
+/**
+ * Image blended over another one, such as a watermark.
+ *
+ * Pixels keep their color, coverage of every pixel is kept in a separate
+ * plane laid out like the pixels: `width * height` values, rows bottom up.
+ */
+struct bmp_overlay {
+    struct bmp_image* image;        // colors of the overlay
+    uint8_t* alpha;                 // coverage of every pixel, 0 transparent to 255 opaque
+};
+
+
+/**
+ * Load overlay from BMP stream.
+ *
+ * Accepts 24-bit images, which are opaque, and 32-bit BGRA images with plain
+ * or bit field encoding, including the longer V4 and V5 headers. 32-bit
+ * image whose alpha bytes are all zero is treated as opaque, as most
+ * writers leave the fourth byte unused.
+ *
+ * @arg stream opened stream positioned at the start of the file
+ * @return the overlay, which must be freed with `free_overlay()`, or NULL if there is no stream (NULL given), the file is not supported or memory allocation fails
+ */
+struct bmp_overlay* read_overlay(FILE* stream);
+
+
+/**
+ * Make pixels of key color transparent.
+ *
+ * @arg overlay the overlay
+ * @arg key the color to drop
+ */
+void key_overlay(struct bmp_overlay* overlay, struct pixel key);
+
+
+/**
+ * Blend overlay into image.
+ *
+ * Only the area covered by the overlay is touched, so cost depends on size
+ * of the overlay, not of the image. Every channel becomes
+ * `(overlay * a + image * (255 - a)) / 255` with `a = alpha * opacity / 255`,
+ * divisions by 255 are rounded exactly. 16 pixels are blended at once with
+ * AVX2 where available, bands of rows are blended in parallel.
+ *
+ * @arg image the image, its pixels are made writable first
+ * @arg overlay the overlay
+ * @arg x column of the image where the left column of the overlay lands, it may be negative
+ * @arg y row of the image counted from the top where the top row of the overlay lands, it may be negative
+ * @arg opacity coverage applied to the whole overlay, 255 keeps its alpha
+ * @return true on success, false if there is no image or overlay (NULL given) or memory allocation fails
+ */
+bool overlay_inplace(struct bmp_image* image, const struct bmp_overlay* overlay, int64_t x, int64_t y, uint8_t opacity);
+
+
+/**
+ * Free overlay.
+ *
+ * @arg overlay the overlay
+ */
+void free_overlay(struct bmp_overlay* overlay);
+
+#endif
@@ -0,0 +1,130 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdlib.h>
+#include <stdbool.h>
+#include <pthread.h>
+#include <unistd.h>
+
+#include "parallel.h"
+
+// HELPER MACROS
+// ================================================================================
+
+#define MAX_THREADS 64
+#define MIN_BAND_ROWS 16 // bands smaller than this are not worth a thread
+
+struct band
+{
+    band_worker worker;
+    void *ctx;
+    uint32_t start;
+    uint32_t end;
+};
+
+/* thread runs a band or serves a pool, its calls must not spawn more threads */
+static _Thread_local bool in_band = false;
+
+/* number of worker threads, set once by init_threads() */
+static unsigned thread_count = 1;
+static pthread_once_t threads_once = PTHREAD_ONCE_INIT;
+
+// HELPER DECLARATION
+// ================================================================================
+
+/**
+ * Read number of threads from environment or processor count.
+ */
+void init_threads(void);
+
+/**
+ * Thread entry point running one band.
+ *
+ * @param arg the `band` structure
+ * @return always `NULL`
+ */
+void *run_band(void *arg);
+
+// PUBLIC IMPLEMENTATION
+// ================================================================================
+
+unsigned parallel_threads(void)
+{
+    pthread_once(&threads_once, init_threads);
+    return thread_count;
+}
+
+void parallel_serial(void)
+{
+    in_band = true;
+}
+
+void parallel_rows(uint32_t rows, band_worker worker, void *ctx)
+{
+    uint32_t n = in_band ? 1 : parallel_threads();
+    if (n > rows / MIN_BAND_ROWS)
+    {
+        n = rows / MIN_BAND_ROWS;
+    }
+    if (n <= 1)
+    {
+        worker(ctx, 0, rows);
+        return;
+    }
+
+    pthread_t threads[MAX_THREADS];
+    struct band bands[MAX_THREADS];
+    bool spawned[MAX_THREADS];
+
+    for (uint32_t i = 0; i < n; i++)
+    {
+        bands[i] = (struct band){worker, ctx, (uint32_t)((uint64_t)rows * i / n), (uint32_t)((uint64_t)rows * (i + 1) / n)};
+    }
+
+    // calling thread takes the first band itself
+    for (uint32_t i = 1; i < n; i++)
+    {
+        spawned[i] = pthread_create(&threads[i], NULL, run_band, &bands[i]) == 0;
+        if (!spawned[i])
+        {
+            run_band(&bands[i]);
+        }
+    }
+    run_band(&bands[0]);
+
+    for (uint32_t i = 1; i < n; i++)
+    {
+        if (spawned[i])
+        {
+            pthread_join(threads[i], NULL);
+        }
+    }
+}
+
+// HELPER IMPLEMENTATION
+// ================================================================================
+
+void init_threads(void)
+{
+    long n = 0;
+    const char *env = getenv("BMP_THREADS");
+    if (env != NULL)
+    {
+        n = strtol(env, NULL, 10);
+    }
+    if (n <= 0)
+    {
+        n = sysconf(_SC_NPROCESSORS_ONLN);
+    }
+
+    thread_count = n <= 0 ? 1 : n > MAX_THREADS ? MAX_THREADS : (unsigned)n;
+}
+
+void *run_band(void *arg)
+{
+    struct band *band = arg;
+    bool nested = in_band;
+    in_band = true;
+    band->worker(band->ctx, band->start, band->end);
+    in_band = nested;
+    return NULL;
+}
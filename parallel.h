@@ -0,0 +1,52 @@
+#ifndef _PARALLEL_H
+#define _PARALLEL_H
+
+#include <stdint.h>
+
+
+/**
+ * Worker processing one band of rows.
+ *
+ * @param ctx user data shared by all bands
+ * @param start first row of the band
+ * @param end one past the last row of the band
+ */
+typedef void (*band_worker)(void* ctx, uint32_t start, uint32_t end);
+
+
+/**
+ * Number of worker threads.
+ *
+ * Uses the `BMP_THREADS` environment variable if set, otherwise number of
+ * online processors.
+ *
+ * @return number of threads used by `parallel_rows()`, at least 1
+ */
+unsigned parallel_threads(void);
+
+
+/**
+ * Process rows in parallel.
+ *
+ * Splits rows [0, rows) into contiguous bands and runs worker on each band
+ * in its own thread. Bands never overlap, so workers may write their rows
+ * without synchronization. Small workloads, calls from inside a band
+ * worker and calls from threads marked by `parallel_serial()` run on the
+ * calling thread.
+ *
+ * @arg rows number of rows to process
+ * @arg worker the band worker
+ * @arg ctx user data passed to every worker call
+ */
+void parallel_rows(uint32_t rows, band_worker worker, void* ctx);
+
+
+/**
+ * Run all following `parallel_rows()` calls of the calling thread on it.
+ *
+ * Meant for threads of a pool which already keeps every processor busy, so
+ * that each of them does not spawn `parallel_threads()` threads of its own.
+ */
+void parallel_serial(void);
+
+#endif
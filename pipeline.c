@@ -0,0 +1,333 @@
+#include <stdlib.h>
+#include <pthread.h>
+
+#include "pipeline.h"
+
+// HELPER MACROS
+// ================================================================================
+
+/* image travelling through the stages */
+struct item
+{
+    struct bmp_image *image;
+    size_t index;
+    struct timespec started;
+};
+
+/* bounded queue between two stages */
+struct queue
+{
+    pthread_mutex_t lock;
+    pthread_cond_t filled;
+    pthread_cond_t drained;
+    struct item *items;
+    size_t capacity;
+    size_t head;            // index of the oldest item
+    size_t count;
+    bool closed;            // producer finished, consumer drains the rest
+    bool cancelled;         // consumer stopped, producer discards its items
+};
+
+/* state shared by the stage threads */
+struct pipeline
+{
+    const struct pipeline_stages *stages;
+    struct queue read;      // reader to transformation
+    struct queue write;     // transformation to writer
+    struct queue spare;     // writer back to reader
+    bool written;           // every image passed to the writer was written
+};
+
+// HELPER DECLARATION
+// ================================================================================
+
+/**
+ * Initialize queue.
+ *
+ * @param queue the queue
+ * @param capacity maximum number of items
+ * @return true if the queue was allocated
+ */
+bool init_queue(struct queue *queue, size_t capacity);
+
+/**
+ * Free queue together with images left in it.
+ *
+ * @param queue the queue
+ */
+void destroy_queue(struct queue *queue);
+
+/**
+ * Append item, waiting while the queue is full.
+ *
+ * @param queue the queue
+ * @param item the item
+ * @param wait false to give up instead of waiting
+ * @return true if the item was appended, false if the queue was cancelled or is full
+ */
+bool push_item(struct queue *queue, const struct item *item, bool wait);
+
+/**
+ * Remove the oldest item, waiting while the queue is empty.
+ *
+ * @param queue the queue
+ * @param item receives the item
+ * @param wait false to give up instead of waiting
+ * @return true if an item was removed, false if the queue is closed and empty, cancelled or empty
+ */
+bool pop_item(struct queue *queue, struct item *item, bool wait);
+
+/**
+ * Mark queue closed or cancelled and wake all its waiters.
+ *
+ * @param queue the queue
+ * @param cancel true to cancel, false to close
+ */
+void end_queue(struct queue *queue, bool cancel);
+
+/**
+ * Reader thread entry point.
+ *
+ * @param arg the `pipeline` structure
+ * @return always `NULL`
+ */
+void *run_reader(void *arg);
+
+/**
+ * Writer thread entry point.
+ *
+ * @param arg the `pipeline` structure
+ * @return always `NULL`
+ */
+void *run_writer(void *arg);
+
+/**
+ * Run all stages one after another on the calling thread.
+ *
+ * @param stages the stages
+ * @return true if every image read was transformed and written
+ */
+bool run_stages(const struct pipeline_stages *stages);
+
+// PUBLIC IMPLEMENTATION
+// ================================================================================
+
+bool run_pipeline(const struct pipeline_stages *stages, size_t depth)
+{
+    if (stages == NULL || stages->read == NULL || stages->transform == NULL || stages->write == NULL)
+    {
+        return false;
+    }
+
+    struct pipeline pipeline = {.stages = stages, .written = true};
+    bool queues = init_queue(&pipeline.read, depth) &&
+                  init_queue(&pipeline.write, depth) &&
+                  init_queue(&pipeline.spare, 1);
+
+    // writer starts first, so no input is consumed if the reader cannot start
+    pthread_t reader, writer;
+    bool threads = queues && pthread_create(&writer, NULL, run_writer, &pipeline) == 0;
+    if (threads && pthread_create(&reader, NULL, run_reader, &pipeline) != 0)
+    {
+        end_queue(&pipeline.write, false);
+        pthread_join(writer, NULL);
+        threads = false;
+    }
+
+    // queues cannot be allocated or threads started, stages take turns
+    if (!threads)
+    {
+        destroy_queue(&pipeline.read);
+        destroy_queue(&pipeline.write);
+        destroy_queue(&pipeline.spare);
+        return run_stages(stages);
+    }
+
+    bool success = true;
+    struct item item;
+    while (pop_item(&pipeline.read, &item, true))
+    {
+        item.image = stages->transform(stages->ctx, item.index, item.image);
+        if (item.image == NULL)
+        {
+            success = false;
+            end_queue(&pipeline.read, true);
+            break;
+        }
+        push_item(&pipeline.write, &item, true);
+    }
+    end_queue(&pipeline.write, false);
+
+    pthread_join(reader, NULL);
+    pthread_join(writer, NULL);
+
+    destroy_queue(&pipeline.read);
+    destroy_queue(&pipeline.write);
+    destroy_queue(&pipeline.spare);
+    return success && pipeline.written;
+}
+
+// HELPER IMPLEMENTATION
+// ================================================================================
+
+bool init_queue(struct queue *queue, size_t capacity)
+{
+    *queue = (struct queue){.capacity = capacity};
+    queue->items = capacity != 0 ? malloc(capacity * sizeof(struct item)) : NULL;
+    if (queue->items == NULL)
+    {
+        return false;
+    }
+
+    pthread_mutex_init(&queue->lock, NULL);
+    pthread_cond_init(&queue->filled, NULL);
+    pthread_cond_init(&queue->drained, NULL);
+    return true;
+}
+
+void destroy_queue(struct queue *queue)
+{
+    if (queue->items == NULL)
+    {
+        return;
+    }
+
+    for (size_t i = 0; i < queue->count; i++)
+    {
+        free_bmp_image(queue->items[(queue->head + i) % queue->capacity].image);
+    }
+    free(queue->items);
+    queue->items = NULL;
+
+    pthread_mutex_destroy(&queue->lock);
+    pthread_cond_destroy(&queue->filled);
+    pthread_cond_destroy(&queue->drained);
+}
+
+bool push_item(struct queue *queue, const struct item *item, bool wait)
+{
+    pthread_mutex_lock(&queue->lock);
+    while (wait && queue->count == queue->capacity && !queue->cancelled)
+    {
+        pthread_cond_wait(&queue->drained, &queue->lock);
+    }
+
+    bool pushed = queue->count < queue->capacity && !queue->cancelled;
+    if (pushed)
+    {
+        queue->items[(queue->head + queue->count) % queue->capacity] = *item;
+        queue->count++;
+        pthread_cond_signal(&queue->filled);
+    }
+    pthread_mutex_unlock(&queue->lock);
+    return pushed;
+}
+
+bool pop_item(struct queue *queue, struct item *item, bool wait)
+{
+    pthread_mutex_lock(&queue->lock);
+    while (wait && queue->count == 0 && !queue->closed && !queue->cancelled)
+    {
+        pthread_cond_wait(&queue->filled, &queue->lock);
+    }
+
+    bool popped = queue->count != 0 && !queue->cancelled;
+    if (popped)
+    {
+        *item = queue->items[queue->head];
+        queue->head = (queue->head + 1) % queue->capacity;
+        queue->count--;
+        pthread_cond_signal(&queue->drained);
+    }
+    pthread_mutex_unlock(&queue->lock);
+    return popped;
+}
+
+void end_queue(struct queue *queue, bool cancel)
+{
+    pthread_mutex_lock(&queue->lock);
+    if (cancel)
+    {
+        queue->cancelled = true;
+    }
+    else
+    {
+        queue->closed = true;
+    }
+    pthread_cond_broadcast(&queue->filled);
+    pthread_cond_broadcast(&queue->drained);
+    pthread_mutex_unlock(&queue->lock);
+}
+
+void *run_reader(void *arg)
+{
+    struct pipeline *pipeline = arg;
+    const struct pipeline_stages *stages = pipeline->stages;
+
+    for (size_t index = 0;; index++)
+    {
+        struct item item = {NULL, index, {0, 0}};
+        struct item spare = {NULL, 0, {0, 0}};
+        pop_item(&pipeline->spare, &spare, false);
+
+        timespec_get(&item.started, TIME_UTC);
+        item.image = stages->read(stages->ctx, index, spare.image, &item.started);
+
+        // cancelled queue means the transformation gave up
+        if (item.image == NULL || !push_item(&pipeline->read, &item, true))
+        {
+            free_bmp_image(item.image);
+            break;
+        }
+    }
+
+    end_queue(&pipeline->read, false);
+    return NULL;
+}
+
+void *run_writer(void *arg)
+{
+    struct pipeline *pipeline = arg;
+    const struct pipeline_stages *stages = pipeline->stages;
+
+    struct item item;
+    while (pop_item(&pipeline->write, &item, true))
+    {
+        if (!stages->write(stages->ctx, item.index, item.image, &item.started))
+        {
+            pipeline->written = false;
+        }
+
+        // reader takes the image if it has not taken the previous one yet
+        if (!push_item(&pipeline->spare, &item, false))
+        {
+            free_bmp_image(item.image);
+        }
+    }
+    return NULL;
+}
+
+bool run_stages(const struct pipeline_stages *stages)
+{
+    bool success = true;
+    struct bmp_image *spare = NULL;
+
+    for (size_t index = 0;; index++)
+    {
+        struct timespec started;
+        timespec_get(&started, TIME_UTC);
+
+        struct bmp_image *image = stages->read(stages->ctx, index, spare, &started);
+        if (image == NULL)
+        {
+            return success;
+        }
+
+        spare = stages->transform(stages->ctx, index, image);
+        if (spare == NULL)
+        {
+            return false;
+        }
+        success = stages->write(stages->ctx, index, spare, &started) && success;
+    }
+}
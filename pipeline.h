@@ -0,0 +1,75 @@
+#ifndef _PIPELINE_H
+#define _PIPELINE_H
+
+#include <stddef.h>
+#include <stdbool.h>
+#include <time.h>
+
+#include "bmp.h"
+
+
+/**
+ * Stages of one pipeline.
+ *
+ * Images are read on the reader thread, transformed on the calling thread
+ * and written on the writer thread, so reading of the next image and writing
+ * of the previous one overlap the transformation of the current one.
+ * Ownership of every image passes along the stages.
+ */
+struct pipeline_stages {
+    /**
+     * Read image.
+     *
+     * Spare is a written image handed back for reuse (see `read_bmp_reuse()`),
+     * or NULL. It belongs to the callback, which must reuse or free it.
+     * Start time is taken before the call, callbacks waiting for their
+     * source may take it again once the image starts arriving.
+     *
+     * @param ctx user data of the stages
+     * @param index index of the image
+     * @param spare the spare image or NULL
+     * @param started start time of the image passed to the write stage
+     * @return the image or NULL, which ends the input
+     */
+    struct bmp_image* (*read)(void* ctx, size_t index, struct bmp_image* spare, struct timespec* started);
+
+    /**
+     * Transform image.
+     *
+     * @param ctx user data of the stages
+     * @param index index of the image
+     * @param image the image
+     * @return the result or NULL, which stops the pipeline
+     */
+    struct bmp_image* (*transform)(void* ctx, size_t index, struct bmp_image* image);
+
+    /**
+     * Write image.
+     *
+     * Image stays owned by the pipeline.
+     *
+     * @param ctx user data of the stages
+     * @param index index of the image
+     * @param image the image
+     * @param started start time of the image set by the read stage
+     * @return true if the image was written, failures do not stop the pipeline
+     */
+    bool (*write)(void* ctx, size_t index, const struct bmp_image* image, const struct timespec* started);
+
+    void* ctx;                      // user data passed to every callback
+};
+
+
+/**
+ * Run images through read, transform and write stages.
+ *
+ * Stages hand images over through queues holding at most depth images,
+ * full queues block the stage feeding them.
+ *
+ * @arg stages the stages
+ * @arg depth capacity of every queue, at least 1
+ * @return true if every image read was transformed and written
+ */
+bool run_pipeline(const struct pipeline_stages* stages, size_t depth);
+
+#endif
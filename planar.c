@@ -0,0 +1,347 @@
+#include <stdlib.h>
+#include <string.h>
+#ifdef __SSSE3__
+#include <tmmintrin.h>
+#endif
+
+#include "planar.h"
+#include "parallel.h"
+#include "bmp.h"
+
+// HELPER MACROS
+// ================================================================================
+
+#define CHECK_NULL(ptr)    \
+    {                      \
+        if ((ptr) == NULL) \
+        {                  \
+            return NULL;   \
+        }                  \
+    }
+
+#define VECTOR_PIXELS 16 // pixels shuffled at once, 48 interleaved bytes
+
+/* conversion between image and planes shared by all bands */
+struct plane_pass
+{
+    const struct bmp_image *src;
+    struct bmp_image *dst;
+    struct bmp_planes *planes;
+    const uint8_t *zeros; // row read in place of dropped planes
+};
+
+#ifdef __SSSE3__
+/* byte of every channel of 16 pixels taken from each of their three 16-byte vectors, -1 is zero */
+static const int8_t DEINTERLEAVE[3][3][16] = {
+    {{0, 3, 6, 9, 12, 15, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
+     {-1, -1, -1, -1, -1, -1, 2, 5, 8, 11, 14, -1, -1, -1, -1, -1},
+     {-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 1, 4, 7, 10, 13}},
+    {{1, 4, 7, 10, 13, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
+     {-1, -1, -1, -1, -1, 0, 3, 6, 9, 12, 15, -1, -1, -1, -1, -1},
+     {-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 2, 5, 8, 11, 14}},
+    {{2, 5, 8, 11, 14, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
+     {-1, -1, -1, -1, -1, 1, 4, 7, 10, 13, -1, -1, -1, -1, -1, -1},
+     {-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 0, 3, 6, 9, 12, 15}}};
+
+/* byte of every 16-byte vector of interleaved pixels taken from each channel, -1 is zero */
+static const int8_t INTERLEAVE[3][3][16] = {
+    {{0, -1, -1, 1, -1, -1, 2, -1, -1, 3, -1, -1, 4, -1, -1, 5},
+     {-1, 0, -1, -1, 1, -1, -1, 2, -1, -1, 3, -1, -1, 4, -1, -1},
+     {-1, -1, 0, -1, -1, 1, -1, -1, 2, -1, -1, 3, -1, -1, 4, -1}},
+    {{-1, -1, 6, -1, -1, 7, -1, -1, 8, -1, -1, 9, -1, -1, 10, -1},
+     {5, -1, -1, 6, -1, -1, 7, -1, -1, 8, -1, -1, 9, -1, -1, 10},
+     {-1, 5, -1, -1, 6, -1, -1, 7, -1, -1, 8, -1, -1, 9, -1, -1}},
+    {{-1, 11, -1, -1, 12, -1, -1, 13, -1, -1, 14, -1, -1, 15, -1, -1},
+     {-1, -1, 11, -1, -1, 12, -1, -1, 13, -1, -1, 14, -1, -1, 15, -1},
+     {10, -1, -1, 11, -1, -1, 12, -1, -1, 13, -1, -1, 14, -1, -1, 15}}};
+#endif
+
+// HELPER DECLARATION
+// ================================================================================
+
+/**
+ * Split one row of pixels into channels.
+ *
+ * @param src the pixels
+ * @param planes row of blue, green and red plane
+ * @param width number of pixels
+ */
+void deinterleave_row(const struct pixel *src, uint8_t *const planes[3], uint32_t width);
+
+/**
+ * Join one row of channels into pixels.
+ *
+ * @param planes row of blue, green and red plane
+ * @param dst the pixels
+ * @param width number of pixels
+ */
+void interleave_row(const uint8_t *const planes[3], struct pixel *dst, uint32_t width);
+
+/**
+ * Split band of rows.
+ *
+ * @param ctx the `plane_pass` structure
+ * @param start first row of the band
+ * @param end one past the last row of the band
+ */
+void split_band(void *ctx, uint32_t start, uint32_t end);
+
+/**
+ * Merge band of rows.
+ *
+ * @param ctx the `plane_pass` structure
+ * @param start first row of the band
+ * @param end one past the last row of the band
+ */
+void merge_band(void *ctx, uint32_t start, uint32_t end);
+
+// PUBLIC IMPLEMENTATION
+// ================================================================================
+
+extern struct bmp_image *create_bmp(const struct bmp_header *header, uint32_t width, uint32_t height);
+
+struct bmp_planes *split_planes(const struct bmp_image *image)
+{
+    CHECK_NULL(image);
+
+    struct bmp_planes *planes = calloc(1, sizeof(struct bmp_planes));
+    CHECK_NULL(planes);
+    planes->header = *image->header;
+
+    // empty image still gets planes, NULL would mean dropped channels
+    size_t size = (size_t)image->header->width * image->header->height;
+    planes->blue = malloc(size + 1);
+    planes->green = malloc(size + 1);
+    planes->red = malloc(size + 1);
+    if (planes->blue == NULL || planes->green == NULL || planes->red == NULL)
+    {
+        free_planes(planes);
+        return NULL;
+    }
+
+    struct plane_pass pass = {image, NULL, planes, NULL};
+    parallel_rows(image->header->height, split_band, &pass);
+    return planes;
+}
+
+struct bmp_image *merge_planes(const struct bmp_planes *planes)
+{
+    CHECK_NULL(planes);
+
+    struct bmp_image *image = create_bmp(&planes->header, planes->header.width, planes->header.height);
+    CHECK_NULL(image);
+
+    // dropped channels read from one row of zeros
+    uint8_t *zeros = NULL;
+    if (planes->blue == NULL || planes->green == NULL || planes->red == NULL)
+    {
+        zeros = calloc((size_t)planes->header.width + 1, 1);
+        if (zeros == NULL)
+        {
+            free_bmp_image(image);
+            return NULL;
+        }
+    }
+
+    struct plane_pass pass = {NULL, image, (struct bmp_planes *)planes, zeros};
+    parallel_rows(planes->header.height, merge_band, &pass);
+    free(zeros);
+    return image;
+}
+
+bool drop_planes(struct bmp_planes *planes, const char *colors_to_keep)
+{
+    if (planes == NULL || colors_to_keep == NULL)
+    {
+        return false;
+    }
+
+    bool blue = false, green = false, red = false;
+    for (const char *c = colors_to_keep; *c != '\0'; c++)
+    {
+        switch (*c)
+        {
+        case 'b':
+            blue = true;
+            break;
+        case 'g':
+            green = true;
+            break;
+        case 'r':
+            red = true;
+            break;
+        default:
+            return false;
+        }
+    }
+
+    // nothing is touched but the dropped planes
+    if (!blue)
+    {
+        free(planes->blue);
+        planes->blue = NULL;
+    }
+    if (!green)
+    {
+        free(planes->green);
+        planes->green = NULL;
+    }
+    if (!red)
+    {
+        free(planes->red);
+        planes->red = NULL;
+    }
+    return true;
+}
+
+void apply_planes_lut(struct bmp_planes *planes, const struct color_lut *lut)
+{
+    if (planes == NULL || lut == NULL)
+    {
+        return;
+    }
+
+    size_t size = (size_t)planes->header.width * planes->header.height;
+    uint8_t *channels[3] = {planes->blue, planes->green, planes->red};
+    const uint8_t *tables[3] = {lut->blue, lut->green, lut->red};
+    for (int c = 0; c < 3; c++)
+    {
+        for (size_t i = 0; channels[c] != NULL && i < size; i++)
+        {
+            channels[c][i] = tables[c][channels[c][i]];
+        }
+    }
+}
+
+bool write_raw_planes(FILE *stream, const struct bmp_planes *planes, int count)
+{
+    if (stream == NULL || planes == NULL || count < 1 || count > 3)
+    {
+        return false;
+    }
+
+    size_t width = planes->header.width;
+    uint8_t *zeros = calloc(width + 1, 1);
+    if (zeros == NULL)
+    {
+        return false;
+    }
+
+    const uint8_t *channels[3] = {planes->red, planes->green, planes->blue};
+    bool success = true;
+    for (int c = 0; c < count && success; c++)
+    {
+        for (uint32_t row = planes->header.height; row > 0 && success; row--)
+        {
+            const uint8_t *values = channels[c] != NULL ? channels[c] + (row - 1) * width : zeros;
+            success = fwrite(values, 1, width, stream) == width;
+        }
+    }
+    free(zeros);
+    return success;
+}
+
+void free_planes(struct bmp_planes *planes)
+{
+    if (planes == NULL)
+    {
+        return;
+    }
+
+    free(planes->blue);
+    free(planes->green);
+    free(planes->red);
+    free(planes);
+}
+
+// HELPER IMPLEMENTATION
+// ================================================================================
+
+void deinterleave_row(const struct pixel *src, uint8_t *const planes[3], uint32_t width)
+{
+    uint32_t col = 0;
+    const uint8_t *bytes = (const uint8_t *)src;
+
+#ifdef __SSSE3__
+    for (; col + VECTOR_PIXELS <= width; col += VECTOR_PIXELS, bytes += 3 * VECTOR_PIXELS)
+    {
+        __m128i v[3] = {_mm_loadu_si128((const __m128i *)bytes),
+                        _mm_loadu_si128((const __m128i *)(bytes + 16)),
+                        _mm_loadu_si128((const __m128i *)(bytes + 32))};
+        for (int c = 0; c < 3; c++)
+        {
+            __m128i channel = _mm_or_si128(
+                _mm_or_si128(_mm_shuffle_epi8(v[0], _mm_loadu_si128((const __m128i *)DEINTERLEAVE[c][0])),
+                             _mm_shuffle_epi8(v[1], _mm_loadu_si128((const __m128i *)DEINTERLEAVE[c][1]))),
+                _mm_shuffle_epi8(v[2], _mm_loadu_si128((const __m128i *)DEINTERLEAVE[c][2])));
+            _mm_storeu_si128((__m128i *)(planes[c] + col), channel);
+        }
+    }
+#endif
+
+    for (; col < width; col++, bytes += 3)
+    {
+        planes[0][col] = bytes[0];
+        planes[1][col] = bytes[1];
+        planes[2][col] = bytes[2];
+    }
+}
+
+void interleave_row(const uint8_t *const planes[3], struct pixel *dst, uint32_t width)
+{
+    uint32_t col = 0;
+    uint8_t *bytes = (uint8_t *)dst;
+
+#ifdef __SSSE3__
+    for (; col + VECTOR_PIXELS <= width; col += VECTOR_PIXELS, bytes += 3 * VECTOR_PIXELS)
+    {
+        __m128i channels[3] = {_mm_loadu_si128((const __m128i *)(planes[0] + col)),
+                               _mm_loadu_si128((const __m128i *)(planes[1] + col)),
+                               _mm_loadu_si128((const __m128i *)(planes[2] + col))};
+        for (int v = 0; v < 3; v++)
+        {
+            __m128i out = _mm_or_si128(
+                _mm_or_si128(_mm_shuffle_epi8(channels[0], _mm_loadu_si128((const __m128i *)INTERLEAVE[v][0])),
+                             _mm_shuffle_epi8(channels[1], _mm_loadu_si128((const __m128i *)INTERLEAVE[v][1]))),
+                _mm_shuffle_epi8(channels[2], _mm_loadu_si128((const __m128i *)INTERLEAVE[v][2])));
+            _mm_storeu_si128((__m128i *)(bytes + 16 * v), out);
+        }
+    }
+#endif
+
+    for (; col < width; col++, bytes += 3)
+    {
+        bytes[0] = planes[0][col];
+        bytes[1] = planes[1][col];
+        bytes[2] = planes[2][col];
+    }
+}
+
+void split_band(void *ctx, uint32_t start, uint32_t end)
+{
+    const struct plane_pass *pass = ctx;
+    size_t width = pass->src->header->width;
+
+    for (uint32_t row = start; row < end; row++)
+    {
+        uint8_t *const planes[3] = {pass->planes->blue + row * width, pass->planes->green + row * width,
+                                    pass->planes->red + row * width};
+        deinterleave_row(bmp_row(pass->src, row), planes, (uint32_t)width);
+    }
+}
+
+void merge_band(void *ctx, uint32_t start, uint32_t end)
+{
+    const struct plane_pass *pass = ctx;
+    const struct bmp_planes *planes = pass->planes;
+    const uint8_t *zeros = pass->zeros;
+    size_t width = planes->header.width;
+
+    for (uint32_t row = start; row < end; row++)
+    {
+        const uint8_t *const channels[3] = {planes->blue != NULL ? planes->blue + row * width : zeros,
+                                            planes->green != NULL ? planes->green + row * width : zeros,
+                                            planes->red != NULL ? planes->red + row * width : zeros};
+        interleave_row(channels, bmp_row(pass->dst, row), (uint32_t)width);
+    }
+}
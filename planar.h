@@ -0,0 +1,89 @@
+#ifndef _PLANAR_H
+#define _PLANAR_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+
+#include "bmp.h"
+#include "color.h"
+
+
+/**
+ * Image split into one contiguous plane per channel.
+ *
+ * Planes hold `width * height` values without padding, rows bottom up like
+ * the pixels they were split from. Channel-wise work runs over whole planes
+ * on full width vectors. Dropped channel has no plane and reads as zero.
+ */
+struct bmp_planes {
+    struct bmp_header header;       // header of the image, its size gives size of planes
+    uint8_t* blue;                  // blue plane or NULL, if the channel was dropped
+    uint8_t* green;                 // green plane or NULL, if the channel was dropped
+    uint8_t* red;                   // red plane or NULL, if the channel was dropped
+};
+
+
+/**
+ * Split image into planes.
+ *
+ * Pixels are deinterleaved 16 at a time with byte shuffles where SSSE3 is
+ * available, bands of rows are processed in parallel.
+ *
+ * @arg image the image
+ * @return the planes, which must be freed with `free_planes()`, or NULL if there is no image (NULL given) or memory allocation fails
+ */
+struct bmp_planes* split_planes(const struct bmp_image* image);
+
+
+/**
+ * Interleave planes into new image.
+ *
+ * @arg planes the planes
+ * @return the image or NULL, if there are no planes (NULL given) or memory allocation fails
+ */
+struct bmp_image* merge_planes(const struct bmp_planes* planes);
+
+
+/**
+ * Drop planes of channels not listed.
+ *
+ * @arg planes the planes
+ * @arg colors_to_keep channels to keep as in `extract()`, any of `b`, `g` and `r`
+ * @return true on success, false if there are no planes (NULL given) or colors contain other letter
+ */
+bool drop_planes(struct bmp_planes* planes, const char* colors_to_keep);
+
+
+/**
+ * Map every value of every plane through lookup table of its channel.
+ *
+ * @arg planes the planes
+ * @arg lut the lookup tables
+ */
+void apply_planes_lut(struct bmp_planes* planes, const struct color_lut* lut);
+
+
+/**
+ * Write planes without any header.
+ *
+ * Planes follow each other in the order of components of `struct color_space`:
+ * red, green, then blue. Rows of every plane go from the top one down and
+ * dropped planes are written as zeros.
+ *
+ * @arg stream the output stream
+ * @arg planes the planes
+ * @arg count number of planes to write, 1 writes only red
+ * @return true on success, false if there are no planes (NULL given), count is not 1 to 3 or writing fails
+ */
+bool write_raw_planes(FILE* stream, const struct bmp_planes* planes, int count);
+
+
+/**
+ * Free planes.
+ *
+ * @arg planes the planes
+ */
+void free_planes(struct bmp_planes* planes);
+
+#endif
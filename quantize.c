@@ -0,0 +1,704 @@
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <stdatomic.h>
+#include <pthread.h>
+
+#include "quantize.h"
+#include "stats.h"
+#include "parallel.h"
+#include "bmp.h"
+
+// HELPER MACROS
+// ================================================================================
+
+#define CHECK_NULL(ptr)    \
+    {                      \
+        if ((ptr) == NULL) \
+        {                  \
+            return NULL;   \
+        }                  \
+    }
+
+#define CELL_BITS 5                                  // histogram and lookup grid keep 5 bits of every channel
+#define CELL_SIDE (1u << CELL_BITS)
+#define CELLS (CELL_SIDE * CELL_SIDE * CELL_SIDE)
+#define CELL_SHIFT (8 - CELL_BITS)
+#define INDEXED_BPP 8
+#define ENTRY_SIZE 4                                 // palette entry is blue, green, red and a reserved byte
+#define BAYER_SIZE 8
+
+/* red, green and blue coordinates of the cell from the most significant bits, channel c is at 5 * c */
+#define CELL(px) ((uint32_t)((px).red >> CELL_SHIFT) << (2 * CELL_BITS) | \
+                  (uint32_t)((px).green >> CELL_SHIFT) << CELL_BITS | (uint32_t)((px).blue >> CELL_SHIFT))
+#define CELL_COORD(cell, c) (((cell) >> (CELL_BITS * (c))) & (CELL_SIDE - 1))
+
+static const uint8_t BAYER[BAYER_SIZE][BAYER_SIZE] = {
+    {0, 32, 8, 40, 2, 34, 10, 42},
+    {48, 16, 56, 24, 50, 18, 58, 26},
+    {12, 44, 4, 36, 14, 46, 6, 38},
+    {60, 28, 52, 20, 62, 30, 54, 22},
+    {3, 35, 11, 43, 1, 33, 9, 41},
+    {51, 19, 59, 27, 49, 17, 57, 25},
+    {15, 47, 7, 39, 13, 45, 5, 37},
+    {63, 31, 55, 23, 61, 29, 53, 21}};
+
+/* pixel count and channel sums of every cell */
+struct histogram
+{
+    uint64_t counts[CELLS];
+    uint64_t sums[CELLS][CHANNELS];
+};
+
+/* box of histogram cells, its cells are a range of the sorted cell list */
+struct box
+{
+    uint32_t begin;
+    uint32_t end;
+    uint64_t count;
+    uint32_t min[CHANNELS];
+    uint32_t max[CHANNELS];
+};
+
+/* palette entries split into channels, distances to all of them are computed at once */
+struct palette_table
+{
+    uint32_t count;
+    int32_t values[CHANNELS][PALETTE_SIZE];
+};
+
+/* counting or mapping shared by all bands */
+struct quantize_pass
+{
+    const struct bmp_image *image;
+    const struct bmp_palette *palette;
+    struct palette_table table;
+    struct histogram *histogram;
+    uint8_t *grid;               // nearest palette entry of every cell
+    uint8_t *indices;
+    enum dither dither;
+    int16_t thresholds[BAYER_SIZE][BAYER_SIZE]; // offsets of ordered dithering
+    pthread_mutex_t lock;        // guards merging into histogram
+    _Atomic bool failed;         // set by band which could not allocate its memory
+};
+
+// HELPER DECLARATION
+// ================================================================================
+
+/**
+ * Count band of rows into private histogram and merge it.
+ *
+ * Sets `failed` of the pass, if memory allocation fails.
+ *
+ * @param ctx the `quantize_pass` structure
+ * @param start first row of the band
+ * @param end one past the last row of the band
+ */
+void count_rows(void *ctx, uint32_t start, uint32_t end);
+
+/**
+ * Look up nearest palette entry of band of grid lines.
+ *
+ * Line is a pair of red and green coordinates, it holds every blue one.
+ *
+ * @param ctx the `quantize_pass` structure
+ * @param start first line of the band
+ * @param end one past the last line of the band
+ */
+void fill_grid(void *ctx, uint32_t start, uint32_t end);
+
+/**
+ * Map band of rows to palette, thresholds of ordered dithering are added first.
+ *
+ * @param ctx the `quantize_pass` structure
+ * @param start first row of the band
+ * @param end one past the last row of the band
+ */
+void map_rows(void *ctx, uint32_t start, uint32_t end);
+
+/**
+ * Map image to palette with Floyd-Steinberg error diffusion.
+ *
+ * @param pass the pass with filled grid
+ * @return true on success, false if memory allocation fails
+ */
+bool diffuse_image(const struct quantize_pass *pass);
+
+/**
+ * Shrink box to bounds of its cells.
+ *
+ * @param box the box
+ * @param cells the sorted cell list
+ * @param histogram the histogram
+ */
+void shrink_box(struct box *box, const uint16_t *cells, const struct histogram *histogram);
+
+/**
+ * Split box at median of its longest side.
+ *
+ * @param box the box, it keeps the lower part
+ * @param upper receives the upper part
+ * @param cells the sorted cell list, range of the box is reordered
+ * @param sorted scratch list of the same size
+ * @param histogram the histogram
+ */
+void split_box(struct box *box, struct box *upper, uint16_t *cells, uint16_t *sorted, const struct histogram *histogram);
+
+/**
+ * Split palette entries into channels.
+ *
+ * @param palette the palette
+ * @param table receives the entries
+ */
+void fill_table(const struct bmp_palette *palette, struct palette_table *table);
+
+/**
+ * Find palette entry nearest to color.
+ *
+ * @param table the palette entries
+ * @param color channels of the color, indexed by `enum channel`
+ * @return index of the first entry of the smallest distance
+ */
+uint8_t nearest_entry(const struct palette_table *table, const int32_t color[CHANNELS]);
+
+/**
+ * Clamp value to channel range.
+ *
+ * @param value the value
+ * @return the clamped value
+ */
+static inline uint8_t clamp_channel(int32_t value)
+{
+    return (uint8_t)(value < 0 ? 0 : value > UINT8_MAX ? UINT8_MAX : value);
+}
+
+// PUBLIC IMPLEMENTATION
+// ================================================================================
+
+extern void swap_endianness(struct bmp_header *header);
+extern uint32_t chunk_rows(size_t row_bytes, uint32_t height);
+
+bool parse_dither(const char *name, enum dither *dither)
+{
+    static const char *names[] = {"none", "ordered", "fs"};
+
+    for (size_t i = 0; i < sizeof(names) / sizeof(names[0]); i++)
+    {
+        if (strcmp(name, names[i]) == 0)
+        {
+            *dither = (enum dither)i;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool build_palette(const struct bmp_image *image, uint32_t colors, struct bmp_palette *palette)
+{
+    if (image == NULL || palette == NULL || colors == 0 || colors > PALETTE_SIZE)
+    {
+        return false;
+    }
+
+    struct quantize_pass pass = {image, NULL, {0}, NULL, NULL, NULL, DITHER_NONE, {{0}}, PTHREAD_MUTEX_INITIALIZER, false};
+    pass.histogram = calloc(1, sizeof(struct histogram));
+    uint16_t *cells = malloc(CELLS * sizeof(uint16_t));
+    uint16_t *sorted = malloc(CELLS * sizeof(uint16_t));
+    if (pass.histogram == NULL || cells == NULL || sorted == NULL)
+    {
+        free(pass.histogram);
+        free(cells);
+        free(sorted);
+        return false;
+    }
+    parallel_rows(image->header->height, count_rows, &pass);
+    pthread_mutex_destroy(&pass.lock);
+    if (pass.failed)
+    {
+        free(pass.histogram);
+        free(cells);
+        free(sorted);
+        return false;
+    }
+    const struct histogram *histogram = pass.histogram;
+
+    // the first box holds every used cell, the most populous box with some extent is split next
+    struct box boxes[PALETTE_SIZE];
+    uint32_t used = 0;
+    for (uint32_t cell = 0; cell < CELLS; cell++)
+    {
+        if (histogram->counts[cell] != 0)
+        {
+            cells[used++] = (uint16_t)cell;
+        }
+    }
+    boxes[0] = (struct box){0, used, 0, {0}, {0}};
+    shrink_box(&boxes[0], cells, histogram);
+
+    uint32_t count = 1;
+    while (count < colors)
+    {
+        uint64_t best_score = 0;
+        uint32_t best = count;
+        for (uint32_t i = 0; i < count; i++)
+        {
+            uint32_t extent = 0;
+            for (int c = 0; c < CHANNELS; c++)
+            {
+                extent = boxes[i].max[c] - boxes[i].min[c] > extent ? boxes[i].max[c] - boxes[i].min[c] : extent;
+            }
+            if (extent != 0 && boxes[i].count * extent > best_score)
+            {
+                best_score = boxes[i].count * extent;
+                best = i;
+            }
+        }
+        if (best == count)
+        {
+            break;
+        }
+        split_box(&boxes[best], &boxes[count++], cells, sorted, histogram);
+    }
+
+    // entries start at the means of boxes
+    palette->count = count;
+    for (uint32_t i = 0; i < count; i++)
+    {
+        uint64_t sums[CHANNELS] = {0};
+        for (uint32_t j = boxes[i].begin; j < boxes[i].end; j++)
+        {
+            for (int c = 0; c < CHANNELS; c++)
+            {
+                sums[c] += histogram->sums[cells[j]][c];
+            }
+        }
+        uint64_t n = boxes[i].count;
+        palette->colors[i] = (struct pixel){(uint8_t)((sums[CHANNEL_BLUE] + n / 2) / n),
+                                            (uint8_t)((sums[CHANNEL_GREEN] + n / 2) / n),
+                                            (uint8_t)((sums[CHANNEL_RED] + n / 2) / n)};
+    }
+
+    // one k-means pass moves every entry to the mean of cells nearest to it
+    fill_table(palette, &pass.table);
+    uint64_t (*sums)[CHANNELS] = calloc(count, sizeof(*sums));
+    uint64_t *counts = calloc(count, sizeof(uint64_t));
+    for (uint32_t j = 0; sums != NULL && counts != NULL && j < used; j++)
+    {
+        uint64_t n = histogram->counts[cells[j]];
+        const uint64_t *cell_sums = histogram->sums[cells[j]];
+        int32_t mean[CHANNELS];
+        for (int c = 0; c < CHANNELS; c++)
+        {
+            mean[c] = (int32_t)((cell_sums[c] + n / 2) / n);
+        }
+        uint8_t entry = nearest_entry(&pass.table, mean);
+        counts[entry] += n;
+        for (int c = 0; c < CHANNELS; c++)
+        {
+            sums[entry][c] += cell_sums[c];
+        }
+    }
+    for (uint32_t i = 0; sums != NULL && counts != NULL && i < count; i++)
+    {
+        uint64_t n = counts[i];
+        if (n != 0)
+        {
+            palette->colors[i] = (struct pixel){(uint8_t)((sums[i][CHANNEL_BLUE] + n / 2) / n),
+                                                (uint8_t)((sums[i][CHANNEL_GREEN] + n / 2) / n),
+                                                (uint8_t)((sums[i][CHANNEL_RED] + n / 2) / n)};
+        }
+    }
+    bool success = sums != NULL && counts != NULL;
+
+    free(sums);
+    free(counts);
+    free(pass.histogram);
+    free(cells);
+    free(sorted);
+    return success;
+}
+
+struct bmp_indexed *quantize(const struct bmp_image *image, const struct bmp_palette *palette, enum dither dither)
+{
+    if (image == NULL || palette == NULL || palette->count == 0 || palette->count > PALETTE_SIZE)
+    {
+        return NULL;
+    }
+
+    struct bmp_indexed *indexed = calloc(1, sizeof(struct bmp_indexed));
+    CHECK_NULL(indexed);
+    indexed->header = *image->header;
+    indexed->palette = *palette;
+
+    uint32_t width = image->header->width;
+    uint32_t height = image->header->height;
+    struct quantize_pass pass = {image, palette, {0}, NULL, NULL, NULL, dither, {{0}}, PTHREAD_MUTEX_INITIALIZER, false};
+    indexed->indices = malloc((size_t)width * height);
+    pass.indices = indexed->indices;
+    pass.grid = malloc(CELLS);
+    if (indexed->indices == NULL || pass.grid == NULL)
+    {
+        free(pass.grid);
+        free_indexed(indexed);
+        return NULL;
+    }
+    fill_table(palette, &pass.table);
+    parallel_rows(CELL_SIDE * CELL_SIDE, fill_grid, &pass);
+
+    // threshold spans the distance between entries spread evenly over the color cube
+    if (dither == DITHER_ORDERED)
+    {
+        double spread = 256.0 / cbrt(palette->count);
+        for (int y = 0; y < BAYER_SIZE; y++)
+        {
+            for (int x = 0; x < BAYER_SIZE; x++)
+            {
+                double level = (BAYER[y][x] + 0.5) / (BAYER_SIZE * BAYER_SIZE) - 0.5;
+                pass.thresholds[y][x] = (int16_t)lround(level * spread);
+            }
+        }
+    }
+
+    bool success = true;
+    if (dither == DITHER_FLOYD_STEINBERG)
+    {
+        success = diffuse_image(&pass);
+    }
+    else
+    {
+        parallel_rows(height, map_rows, &pass);
+    }
+
+    pthread_mutex_destroy(&pass.lock);
+    free(pass.grid);
+    if (!success)
+    {
+        free_indexed(indexed);
+        return NULL;
+    }
+    return indexed;
+}
+
+bool write_indexed_bmp(FILE *stream, const struct bmp_indexed *indexed)
+{
+    if (stream == NULL || indexed == NULL)
+    {
+        return false;
+    }
+
+    uint32_t width = indexed->header.width;
+    uint32_t height = indexed->header.height;
+    size_t row_bytes = width;
+    size_t pad_bytes = (4 - row_bytes % 4) % 4;
+    uint32_t palette_bytes = indexed->palette.count * ENTRY_SIZE;
+
+    struct bmp_header header = indexed->header;
+    header.offset = (uint32_t)sizeof(struct bmp_header) + palette_bytes;
+    header.bpp = INDEXED_BPP;
+    header.compression = 0;
+    header.image_size = (uint32_t)((row_bytes + pad_bytes) * height);
+    header.size = header.offset + header.image_size;
+    header.num_colors = indexed->palette.count;
+    header.important_colors = 0;
+    swap_endianness(&header); // swap back to default endian
+
+    uint8_t entries[PALETTE_SIZE * ENTRY_SIZE] = {0};
+    for (uint32_t i = 0; i < indexed->palette.count; i++)
+    {
+        entries[i * ENTRY_SIZE] = indexed->palette.colors[i].blue;
+        entries[i * ENTRY_SIZE + 1] = indexed->palette.colors[i].green;
+        entries[i * ENTRY_SIZE + 2] = indexed->palette.colors[i].red;
+    }
+
+    // strictly sequential, the stream may be a pipe
+    bool success = fwrite(&header, sizeof(struct bmp_header), 1, stream) == 1 &&
+                   fwrite(entries, 1, palette_bytes, stream) == palette_bytes;
+
+    // padded rows are assembled into chunks, so every chunk leaves in one write
+    uint32_t rows = chunk_rows(row_bytes + pad_bytes, height);
+    uint8_t *chunk = calloc(row_bytes + pad_bytes, rows);
+    if (chunk == NULL)
+    {
+        return false;
+    }
+
+    for (uint32_t i = 0; success && i < height; i += rows)
+    {
+        uint32_t count = height - i < rows ? height - i : rows;
+        for (uint32_t row = 0; row < count; row++)
+        {
+            memcpy(chunk + row * (row_bytes + pad_bytes), indexed->indices + (size_t)(i + row) * width, row_bytes);
+        }
+        success = fwrite(chunk, row_bytes + pad_bytes, count, stream) == count;
+    }
+
+    free(chunk);
+    return success;
+}
+
+void free_indexed(struct bmp_indexed *indexed)
+{
+    if (indexed == NULL)
+    {
+        return;
+    }
+
+    free(indexed->indices);
+    free(indexed);
+}
+
+// HELPER IMPLEMENTATION
+// ================================================================================
+
+void count_rows(void *ctx, uint32_t start, uint32_t end)
+{
+    struct quantize_pass *pass = ctx;
+    struct histogram *counts = calloc(1, sizeof(struct histogram));
+    if (counts == NULL)
+    {
+        pass->failed = true;
+        return;
+    }
+
+    uint32_t width = pass->image->header->width;
+    for (uint32_t row = start; row < end; row++)
+    {
+        const struct pixel *px = bmp_row(pass->image, row);
+        for (uint32_t i = 0; i < width; i++)
+        {
+            uint32_t cell = CELL(px[i]);
+            counts->counts[cell]++;
+            counts->sums[cell][CHANNEL_BLUE] += px[i].blue;
+            counts->sums[cell][CHANNEL_GREEN] += px[i].green;
+            counts->sums[cell][CHANNEL_RED] += px[i].red;
+        }
+    }
+
+    pthread_mutex_lock(&pass->lock);
+    for (uint32_t cell = 0; cell < CELLS; cell++)
+    {
+        pass->histogram->counts[cell] += counts->counts[cell];
+        for (int c = 0; c < CHANNELS; c++)
+        {
+            pass->histogram->sums[cell][c] += counts->sums[cell][c];
+        }
+    }
+    pthread_mutex_unlock(&pass->lock);
+
+    free(counts);
+}
+
+void fill_grid(void *ctx, uint32_t start, uint32_t end)
+{
+    struct quantize_pass *pass = ctx;
+
+    // every cell is represented by its center
+    for (uint32_t line = start; line < end; line++)
+    {
+        for (uint32_t blue = 0; blue < CELL_SIDE; blue++)
+        {
+            uint32_t cell = line << CELL_BITS | blue;
+            int32_t center[CHANNELS];
+            for (int c = 0; c < CHANNELS; c++)
+            {
+                center[c] = (int32_t)(CELL_COORD(cell, c) << CELL_SHIFT | 1u << (CELL_SHIFT - 1));
+            }
+            pass->grid[cell] = nearest_entry(&pass->table, center);
+        }
+    }
+}
+
+void map_rows(void *ctx, uint32_t start, uint32_t end)
+{
+    struct quantize_pass *pass = ctx;
+    uint32_t width = pass->image->header->width;
+
+    for (uint32_t row = start; row < end; row++)
+    {
+        const struct pixel *px = bmp_row(pass->image, row);
+        uint8_t *indices = pass->indices + (size_t)row * width;
+        if (pass->dither == DITHER_NONE)
+        {
+            for (uint32_t i = 0; i < width; i++)
+            {
+                indices[i] = pass->grid[CELL(px[i])];
+            }
+            continue;
+        }
+
+        const int16_t *thresholds = pass->thresholds[row % BAYER_SIZE];
+        for (uint32_t i = 0; i < width; i++)
+        {
+            int32_t t = thresholds[i % BAYER_SIZE];
+            struct pixel value = {clamp_channel(px[i].blue + t), clamp_channel(px[i].green + t), clamp_channel(px[i].red + t)};
+            indices[i] = pass->grid[CELL(value)];
+        }
+    }
+}
+
+bool diffuse_image(const struct quantize_pass *pass)
+{
+    uint32_t width = pass->image->header->width;
+    uint32_t height = pass->image->header->height;
+
+    // errors reaching the current and the next row, scaled by 16
+    size_t entries = (size_t)width * CHANNELS;
+    int32_t *current = calloc(entries, sizeof(int32_t));
+    int32_t *next = calloc(entries, sizeof(int32_t));
+    if (current == NULL || next == NULL)
+    {
+        free(current);
+        free(next);
+        return false;
+    }
+
+    for (uint32_t y = 0; y < height; y++)
+    {
+        uint32_t row = height - 1 - y;
+        const struct pixel *px = bmp_row(pass->image, row);
+        uint8_t *indices = pass->indices + (size_t)row * width;
+
+        // error of the right neighbour and of the two pending pixels below is carried in registers,
+        // every entry of the next row is written once
+        int32_t right[CHANNELS] = {0}, left_below[CHANNELS] = {0}, below[CHANNELS] = {0};
+        for (uint32_t x = 0; x < width; x++)
+        {
+            const int32_t *error = current + (size_t)x * CHANNELS;
+            struct pixel wanted = {clamp_channel(px[x].blue + (error[CHANNEL_BLUE] + right[CHANNEL_BLUE]) / 16),
+                                   clamp_channel(px[x].green + (error[CHANNEL_GREEN] + right[CHANNEL_GREEN]) / 16),
+                                   clamp_channel(px[x].red + (error[CHANNEL_RED] + right[CHANNEL_RED]) / 16)};
+            uint8_t entry = pass->grid[CELL(wanted)];
+            const struct pixel *color = &pass->palette->colors[entry];
+            const int32_t diff[CHANNELS] = {wanted.blue - color->blue, wanted.green - color->green, wanted.red - color->red};
+            indices[x] = entry;
+
+            int32_t *spread = next + (size_t)x * CHANNELS;
+            for (int c = 0; c < CHANNELS; c++)
+            {
+                right[c] = diff[c] * 7;
+                if (x > 0)
+                {
+                    spread[c - CHANNELS] = left_below[c] + diff[c] * 3;
+                }
+                left_below[c] = below[c] + diff[c] * 5;
+                below[c] = diff[c];
+            }
+        }
+        for (int c = 0; c < CHANNELS; c++)
+        {
+            next[entries - CHANNELS + (size_t)c] = left_below[c];
+        }
+
+        int32_t *swap = current;
+        current = next;
+        next = swap;
+    }
+
+    free(current);
+    free(next);
+    return true;
+}
+
+void shrink_box(struct box *box, const uint16_t *cells, const struct histogram *histogram)
+{
+    box->count = 0;
+    for (int c = 0; c < CHANNELS; c++)
+    {
+        box->min[c] = CELL_SIDE - 1;
+        box->max[c] = 0;
+    }
+    for (uint32_t j = box->begin; j < box->end; j++)
+    {
+        box->count += histogram->counts[cells[j]];
+        for (int c = 0; c < CHANNELS; c++)
+        {
+            uint32_t coord = CELL_COORD(cells[j], c);
+            box->min[c] = coord < box->min[c] ? coord : box->min[c];
+            box->max[c] = coord > box->max[c] ? coord : box->max[c];
+        }
+    }
+}
+
+void split_box(struct box *box, struct box *upper, uint16_t *cells, uint16_t *sorted, const struct histogram *histogram)
+{
+    int axis = 0;
+    for (int c = 1; c < CHANNELS; c++)
+    {
+        axis = box->max[c] - box->min[c] > box->max[axis] - box->min[axis] ? c : axis;
+    }
+
+    // counting sort of cells by coordinate along the axis
+    uint32_t offsets[CELL_SIDE + 1] = {0};
+    uint64_t weights[CELL_SIDE] = {0};
+    for (uint32_t j = box->begin; j < box->end; j++)
+    {
+        uint32_t coord = CELL_COORD(cells[j], axis);
+        offsets[coord + 1]++;
+        weights[coord] += histogram->counts[cells[j]];
+    }
+    for (uint32_t v = 0; v < CELL_SIDE; v++)
+    {
+        offsets[v + 1] += offsets[v];
+    }
+    for (uint32_t j = box->begin; j < box->end; j++)
+    {
+        sorted[box->begin + offsets[CELL_COORD(cells[j], axis)]++] = cells[j];
+    }
+    memcpy(cells + box->begin, sorted + box->begin, (box->end - box->begin) * sizeof(uint16_t));
+
+    // lower part takes coordinates up to the median, upper part keeps at least the largest one
+    uint64_t taken = 0;
+    uint32_t split = box->min[axis];
+    uint32_t middle = box->begin;
+    for (uint32_t v = box->min[axis]; v < box->max[axis]; v++)
+    {
+        taken += weights[v];
+        split = v;
+        if (taken * 2 >= box->count)
+        {
+            break;
+        }
+    }
+    while (middle < box->end && CELL_COORD(cells[middle], axis) <= split)
+    {
+        middle++;
+    }
+
+    *upper = (struct box){middle, box->end, 0, {0}, {0}};
+    box->end = middle;
+    shrink_box(box, cells, histogram);
+    shrink_box(upper, cells, histogram);
+}
+
+void fill_table(const struct bmp_palette *palette, struct palette_table *table)
+{
+    table->count = palette->count;
+    for (uint32_t i = 0; i < palette->count; i++)
+    {
+        table->values[CHANNEL_BLUE][i] = palette->colors[i].blue;
+        table->values[CHANNEL_GREEN][i] = palette->colors[i].green;
+        table->values[CHANNEL_RED][i] = palette->colors[i].red;
+    }
+}
+
+uint8_t nearest_entry(const struct palette_table *table, const int32_t color[CHANNELS])
+{
+    // independent distances and minimum vectorize, the index is searched only once
+    int32_t distances[PALETTE_SIZE];
+    int32_t least = INT32_MAX;
+    for (uint32_t i = 0; i < table->count; i++)
+    {
+        int32_t db = color[CHANNEL_BLUE] - table->values[CHANNEL_BLUE][i];
+        int32_t dg = color[CHANNEL_GREEN] - table->values[CHANNEL_GREEN][i];
+        int32_t dr = color[CHANNEL_RED] - table->values[CHANNEL_RED][i];
+        distances[i] = db * db + dg * dg + dr * dr;
+        least = distances[i] < least ? distances[i] : least;
+    }
+
+    uint32_t best = 0;
+    while (distances[best] != least)
+    {
+        best++;
+    }
+    return (uint8_t)best;
+}
@@ -0,0 +1,107 @@
+#ifndef _QUANTIZE_H
+#define _QUANTIZE_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "bmp.h"
+
+#define PALETTE_SIZE 256
+
+
+/**
+ * Dithering used when pixels are mapped to palette.
+ */
+enum dither {
+    DITHER_NONE,                // nearest palette color
+    DITHER_ORDERED,             // 8x8 Bayer threshold matrix
+    DITHER_FLOYD_STEINBERG      // error diffusion
+};
+
+
+/**
+ * Colors of an indexed image.
+ */
+struct bmp_palette {
+    uint32_t count;                         // number of used entries
+    struct pixel colors[PALETTE_SIZE];
+};
+
+
+/**
+ * Image of palette indices.
+ *
+ * Indices hold `width * height` values without padding, rows bottom up like
+ * the pixels they were mapped from.
+ */
+struct bmp_indexed {
+    struct bmp_header header;       // header of the image, its size gives size of indices
+    struct bmp_palette palette;
+    uint8_t* indices;               // palette entry of every pixel
+};
+
+
+/**
+ * Parse dithering name.
+ *
+ * Accepted names are "none", "ordered" and "fs" (Floyd-Steinberg).
+ *
+ * @arg name the dithering name
+ * @arg dither where the parsed dithering is stored
+ * @return `true` if the name is known, `false` otherwise
+ */
+bool parse_dither(const char* name, enum dither* dither);
+
+
+/**
+ * Build palette of image by median cut.
+ *
+ * Colors are counted in parallel bands into a histogram of 5 bits per
+ * channel. Boxes of histogram cells are split at the median of their
+ * longest side until there are enough of them, then one k-means pass moves
+ * every entry to the mean of the cells nearest to it. Image with fewer
+ * distinct cells gets one entry per cell.
+ *
+ * @arg image the image
+ * @arg colors the largest number of entries, from 1 to `PALETTE_SIZE`
+ * @arg palette receives the palette
+ * @return true on success, false if there is no image or palette (NULL given), number of colors is not valid or memory allocation fails
+ */
+bool build_palette(const struct bmp_image* image, uint32_t colors, struct bmp_palette* palette);
+
+
+/**
+ * Map pixels to palette.
+ *
+ * Nearest entry of every histogram cell is looked up once into a grid
+ * shared by all pixels. Without dithering and with ordered dithering bands
+ * of rows are mapped in parallel, error diffusion runs over rows from the
+ * top down.
+ *
+ * @arg image the image
+ * @arg palette the palette, it must not be empty
+ * @arg dither the dithering
+ * @return the indexed image, which must be freed with `free_indexed()`, or NULL if there is no image or palette (NULL given), palette is empty or memory allocation fails
+ */
+struct bmp_indexed* quantize(const struct bmp_image* image, const struct bmp_palette* palette, enum dither dither);
+
+
+/**
+ * Write indexed image as 8-bit BMP file.
+ *
+ * @arg stream opened stream
+ * @arg indexed the indexed image
+ * @return true on success, false if there is no stream or image (NULL given) or write fails
+ */
+bool write_indexed_bmp(FILE* stream, const struct bmp_indexed* indexed);
+
+
+/**
+ * Free indexed image.
+ *
+ * @arg indexed the indexed image
+ */
+void free_indexed(struct bmp_indexed* indexed);
+
+#endif
@@ -0,0 +1,477 @@
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <stdatomic.h>
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+
+#include "resample.h"
+#include "parallel.h"
+#include "bmp.h"
+
+// HELPER MACROS
+// ================================================================================
+
+#define CHECK_NULL(ptr)    \
+    {                      \
+        if ((ptr) == NULL) \
+        {                  \
+            return NULL;   \
+        }                  \
+    }
+
+#define PRECISION_BITS 14 // fixed point coefficients, 1.0 == 1 << 14
+#define ONE (1 << PRECISION_BITS)
+#define HALF (1 << (PRECISION_BITS - 1))
+#define VECTOR_BYTES 16   // channels of a row filtered at once by the vertical pass
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+/* filter coefficients for every output column (or row) */
+struct coeffs
+{
+    uint32_t taps;     // maximal number of source pixels per output pixel
+    uint32_t *start;   // first source pixel of each output pixel
+    uint32_t *count;   // number of source pixels of each output pixel
+    int16_t *weights;  // `taps` weights for each output pixel
+};
+
+/* one separable pass over bands of rows */
+struct pass
+{
+    const uint8_t *src;
+    uint8_t *dst;
+    size_t src_stride; // bytes per source row
+    size_t dst_stride; // bytes per destination row
+    uint32_t width;    // output pixels per row
+    const struct coeffs *coeffs;
+    _Atomic bool failed; // set by band which could not allocate its memory
+};
+
+// HELPER DECLARATION
+// ================================================================================
+
+extern struct bmp_image *create_bmp(const struct bmp_header *header, uint32_t width, uint32_t height);
+
+/**
+ * Filter support radius in source pixels (for scale 1).
+ *
+ * @param filter the reconstruction filter
+ * @return the support radius
+ */
+double filter_support(enum resample_filter filter);
+
+/**
+ * Evaluate filter kernel.
+ *
+ * @param filter the reconstruction filter
+ * @param x distance from kernel center
+ * @return kernel weight at x
+ */
+double filter_eval(enum resample_filter filter, double x);
+
+/**
+ * Precompute fixed point coefficients of one axis.
+ *
+ * @param coeffs where the coefficient table is stored
+ * @param in_size source size of the axis
+ * @param out_size destination size of the axis
+ * @param filter the reconstruction filter
+ * @return `true` on success, `false` if memory allocation fails
+ */
+bool build_coeffs(struct coeffs *coeffs, uint32_t in_size, uint32_t out_size, enum resample_filter filter);
+
+/**
+ * Free coefficient table.
+ *
+ * @param coeffs the coefficient table
+ */
+void free_coeffs(struct coeffs *coeffs);
+
+/**
+ * Horizontal pass over band of rows.
+ *
+ * @param ctx the `pass` structure
+ * @param start first row of the band
+ * @param end one past the last row of the band
+ */
+void horizontal_band(void *ctx, uint32_t start, uint32_t end);
+
+/**
+ * Vertical pass over band of output rows.
+ *
+ * Sets `failed` of the pass, if memory allocation fails.
+ *
+ * @param ctx the `pass` structure
+ * @param start first output row of the band
+ * @param end one past the last output row of the band
+ */
+void vertical_band(void *ctx, uint32_t start, uint32_t end);
+
+/**
+ * Convert fixed point accumulator to channel value.
+ *
+ * @param acc accumulated weighted sum
+ * @return the value clamped to 0..255
+ */
+static inline uint8_t clamp_channel(int32_t acc)
+{
+    acc >>= PRECISION_BITS;
+    return (uint8_t)(acc < 0 ? 0 : acc > UINT8_MAX ? UINT8_MAX : acc);
+}
+
+// PUBLIC IMPLEMENTATION
+// ================================================================================
+
+bool parse_resample_filter(const char *name, enum resample_filter *filter)
+{
+    static const char *names[] = {"nearest", "box", "bilinear", "bicubic", "lanczos"};
+
+    for (size_t i = 0; i < sizeof(names) / sizeof(names[0]); i++)
+    {
+        if (strcmp(name, names[i]) == 0)
+        {
+            *filter = (enum resample_filter)i;
+            return true;
+        }
+    }
+    return false;
+}
+
+struct bmp_image *resample(const struct bmp_image *image, uint32_t width, uint32_t height, enum resample_filter filter)
+{
+    CHECK_NULL(image);
+
+    uint32_t w = image->header->width;
+    uint32_t h = image->header->height;
+
+    struct bmp_image *copy = create_bmp(image->header, width, height);
+    CHECK_NULL(copy);
+
+    struct coeffs horizontal = {0};
+    struct coeffs vertical = {0};
+    uint8_t *tmp = NULL;
+    bool success = build_coeffs(&horizontal, w, width, filter) && build_coeffs(&vertical, h, height, filter);
+
+    // horizontal pass first, intermediate image has output width and source height
+    const uint8_t *src = (const uint8_t *)image->data;
+    size_t src_stride = image->stride;
+    size_t dst_stride = width * sizeof(struct pixel);
+    if (success && width != w)
+    {
+        uint8_t *dst = (uint8_t *)copy->data;
+        if (height != h)
+        {
+            dst = tmp = malloc(dst_stride * h);
+            success = tmp != NULL;
+        }
+        if (success)
+        {
+            struct pass pass = {src, dst, src_stride, dst_stride, width, &horizontal, false};
+            parallel_rows(h, horizontal_band, &pass);
+            src = dst;
+            src_stride = dst_stride;
+        }
+    }
+    if (success && height != h)
+    {
+        struct pass pass = {src, (uint8_t *)copy->data, src_stride, dst_stride, width, &vertical, false};
+        parallel_rows(height, vertical_band, &pass);
+        success = !pass.failed;
+    }
+    else if (success && width == w)
+    {
+        for (uint32_t row = 0; row < height; row++)
+        {
+            memcpy(bmp_row(copy, row), bmp_row(image, row), dst_stride);
+        }
+    }
+
+    free(tmp);
+    free_coeffs(&horizontal);
+    free_coeffs(&vertical);
+    if (!success)
+    {
+        free_bmp_image(copy);
+        return NULL;
+    }
+    return copy;
+}
+
+struct bmp_image *scale_filtered(const struct bmp_image *image, float factor, enum resample_filter filter)
+{
+    CHECK_NULL(image);
+    if (factor <= 0)
+    {
+        return NULL;
+    }
+
+    uint32_t new_w = (uint32_t)roundf((float)image->header->width * factor);
+    uint32_t new_h = (uint32_t)roundf((float)image->header->height * factor);
+
+    return resample(image, new_w, new_h, filter);
+}
+
+// HELPER IMPLEMENTATION
+// ================================================================================
+
+double filter_support(enum resample_filter filter)
+{
+    switch (filter)
+    {
+    case FILTER_BOX:
+        return 0.5;
+    case FILTER_BILINEAR:
+        return 1.0;
+    case FILTER_BICUBIC:
+        return 2.0;
+    case FILTER_LANCZOS:
+        return 3.0;
+    default:
+        return 0.0;
+    }
+}
+
+double filter_eval(enum resample_filter filter, double x)
+{
+    const double a = -0.5; // bicubic sharpness
+    x = fabs(x);
+
+    switch (filter)
+    {
+    case FILTER_BOX:
+        return x < 0.5 ? 1.0 : 0.0;
+    case FILTER_BILINEAR:
+        return x < 1.0 ? 1.0 - x : 0.0;
+    case FILTER_BICUBIC:
+        if (x < 1.0)
+        {
+            return ((a + 2.0) * x - (a + 3.0)) * x * x + 1.0;
+        }
+        if (x < 2.0)
+        {
+            return (((x - 5.0) * x + 8.0) * x - 4.0) * a;
+        }
+        return 0.0;
+    case FILTER_LANCZOS:
+        if (x == 0.0)
+        {
+            return 1.0;
+        }
+        if (x < 3.0)
+        {
+            return 3.0 * sin(M_PI * x) * sin(M_PI * x / 3.0) / (M_PI * M_PI * x * x);
+        }
+        return 0.0;
+    default:
+        return 0.0;
+    }
+}
+
+bool build_coeffs(struct coeffs *coeffs, uint32_t in_size, uint32_t out_size, enum resample_filter filter)
+{
+    double scale = (double)in_size / out_size;
+    double filter_scale = scale < 1.0 ? 1.0 : scale; // widen support when downscaling
+    double support = filter_support(filter) * filter_scale;
+
+    coeffs->taps = filter == FILTER_NEAREST ? 1 : (uint32_t)ceil(support) * 2 + 1;
+    coeffs->start = malloc(out_size * sizeof(uint32_t));
+    coeffs->count = malloc(out_size * sizeof(uint32_t));
+    coeffs->weights = calloc((size_t)out_size * coeffs->taps, sizeof(int16_t));
+    double *weights = malloc(coeffs->taps * sizeof(double));
+    if (coeffs->start == NULL || coeffs->count == NULL || coeffs->weights == NULL || weights == NULL)
+    {
+        free(weights);
+        return false;
+    }
+
+    for (uint32_t i = 0; i < out_size; i++)
+    {
+        int16_t *fixed = &coeffs->weights[(size_t)i * coeffs->taps];
+
+        if (filter == FILTER_NEAREST)
+        {
+            coeffs->start[i] = (uint32_t)((uint64_t)i * in_size / out_size);
+            coeffs->count[i] = 1;
+            fixed[0] = ONE;
+            continue;
+        }
+
+        double center = (i + 0.5) * scale;
+        double lo = floor(center - support + 0.5);
+        double hi = floor(center + support + 0.5);
+        uint32_t first = lo < 0 ? 0 : (uint32_t)lo;
+        uint32_t last = hi > in_size ? in_size : (uint32_t)hi;
+        uint32_t count = last - first > coeffs->taps ? coeffs->taps : last - first;
+
+        double total = 0;
+        for (uint32_t k = 0; k < count; k++)
+        {
+            weights[k] = filter_eval(filter, (first + k - center + 0.5) / filter_scale);
+            total += weights[k];
+        }
+
+        // degenerate footprint, fall back to the nearest pixel
+        if (count == 0 || total == 0)
+        {
+            first = (uint32_t)center < in_size ? (uint32_t)center : in_size - 1;
+            count = 1;
+            weights[0] = total = 1.0;
+        }
+
+        // quantize, rounding error goes to the heaviest tap so weights sum to one
+        int32_t sum = 0;
+        uint32_t heaviest = 0;
+        for (uint32_t k = 0; k < count; k++)
+        {
+            fixed[k] = (int16_t)lround(weights[k] / total * ONE);
+            sum += fixed[k];
+            heaviest = fixed[k] > fixed[heaviest] ? k : heaviest;
+        }
+        fixed[heaviest] = (int16_t)(fixed[heaviest] + ONE - sum);
+
+        coeffs->start[i] = first;
+        coeffs->count[i] = count;
+    }
+
+    free(weights);
+    return true;
+}
+
+void free_coeffs(struct coeffs *coeffs)
+{
+    free(coeffs->start);
+    free(coeffs->count);
+    free(coeffs->weights);
+}
+
+void horizontal_band(void *ctx, uint32_t start, uint32_t end)
+{
+    const struct pass *pass = ctx;
+    const struct coeffs *coeffs = pass->coeffs;
+
+    for (uint32_t row = start; row < end; row++)
+    {
+        const uint8_t *src = pass->src + row * pass->src_stride;
+        uint8_t *dst = pass->dst + row * pass->dst_stride;
+
+        for (uint32_t col = 0; col < pass->width; col++, dst += sizeof(struct pixel))
+        {
+            const uint8_t *px = src + coeffs->start[col] * sizeof(struct pixel);
+            const int16_t *weights = &coeffs->weights[(size_t)col * coeffs->taps];
+            int32_t blue = HALF;
+            int32_t green = HALF;
+            int32_t red = HALF;
+            uint32_t k = 0;
+
+#ifdef __AVX2__
+            // four taps per step, each lane holds channels of a pair of taps as 16-bit pairs summed by madd
+            const __m256i spread = _mm256_setr_epi8(0, -1, 3, -1, 1, -1, 4, -1, 2, -1, 5, -1, -1, -1, -1, -1,
+                                                    6, -1, 9, -1, 7, -1, 10, -1, 8, -1, 11, -1, -1, -1, -1, -1);
+            const __m256i pairs = _mm256_setr_epi32(0, 0, 0, 0, 1, 1, 1, 1);
+            __m256i sum = _mm256_setzero_si256();
+            for (; k + 4 <= coeffs->count[col]; k += 4, px += 4 * sizeof(struct pixel))
+            {
+                // exactly the 12 bytes of the taps, the row may end right after them
+                int32_t last;
+                memcpy(&last, px + 8, sizeof(last));
+                __m128i raw = _mm_insert_epi32(_mm_loadl_epi64((const __m128i *)px), last, 2);
+                __m256i channels = _mm256_shuffle_epi8(_mm256_broadcastsi128_si256(raw), spread);
+                __m256i weight = _mm256_permutevar8x32_epi32(_mm256_castsi128_si256(_mm_loadl_epi64((const __m128i *)(weights + k))), pairs);
+                sum = _mm256_add_epi32(sum, _mm256_madd_epi16(channels, weight));
+            }
+            __m128i total = _mm_add_epi32(_mm256_castsi256_si128(sum), _mm256_extracti128_si256(sum, 1));
+            blue += _mm_cvtsi128_si32(total);
+            green += _mm_extract_epi32(total, 1);
+            red += _mm_extract_epi32(total, 2);
+#endif
+
+            for (; k < coeffs->count[col]; k++, px += sizeof(struct pixel))
+            {
+                blue += weights[k] * px[0];
+                green += weights[k] * px[1];
+                red += weights[k] * px[2];
+            }
+            dst[0] = clamp_channel(blue);
+            dst[1] = clamp_channel(green);
+            dst[2] = clamp_channel(red);
+        }
+    }
+}
+
+void vertical_band(void *ctx, uint32_t start, uint32_t end)
+{
+    struct pass *pass = ctx;
+    const struct coeffs *coeffs = pass->coeffs;
+    size_t bytes = (size_t)pass->width * sizeof(struct pixel);
+
+    int32_t *acc = malloc(bytes * sizeof(int32_t));
+    if (acc == NULL)
+    {
+        pass->failed = true;
+        return;
+    }
+
+    for (uint32_t row = start; row < end; row++)
+    {
+        const int16_t *weights = &coeffs->weights[(size_t)row * coeffs->taps];
+        const uint8_t *src = pass->src + coeffs->start[row] * pass->src_stride;
+        uint8_t *dst = pass->dst + row * pass->dst_stride;
+        size_t done = 0;
+
+#ifdef __AVX2__
+        // bytes of two source rows are interleaved into 16-bit pairs, madd sums both taps into 32 bits
+        const __m256i zero = _mm256_setzero_si256();
+        for (; done + VECTOR_BYTES <= bytes; done += VECTOR_BYTES)
+        {
+            const uint8_t *px = src + done;
+            __m256i lo = _mm256_set1_epi32(HALF);
+            __m256i hi = lo;
+            uint32_t k = 0;
+            for (; k + 2 <= coeffs->count[row]; k += 2, px += 2 * pass->src_stride)
+            {
+                __m256i weight = _mm256_set1_epi32((int32_t)((uint32_t)(uint16_t)weights[k] | (uint32_t)(uint16_t)weights[k + 1] << 16));
+                __m256i a = _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i *)px));
+                __m256i b = _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i *)(px + pass->src_stride)));
+                lo = _mm256_add_epi32(lo, _mm256_madd_epi16(_mm256_unpacklo_epi16(a, b), weight));
+                hi = _mm256_add_epi32(hi, _mm256_madd_epi16(_mm256_unpackhi_epi16(a, b), weight));
+            }
+            if (k < coeffs->count[row])
+            {
+                __m256i weight = _mm256_set1_epi32((int32_t)(uint16_t)weights[k]);
+                __m256i a = _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i *)px));
+                lo = _mm256_add_epi32(lo, _mm256_madd_epi16(_mm256_unpacklo_epi16(a, zero), weight));
+                hi = _mm256_add_epi32(hi, _mm256_madd_epi16(_mm256_unpackhi_epi16(a, zero), weight));
+            }
+
+            // unpack and pack both stay within 128-bit lanes, so bytes come back in order
+            __m256i words = _mm256_packs_epi32(_mm256_srai_epi32(lo, PRECISION_BITS), _mm256_srai_epi32(hi, PRECISION_BITS));
+            __m256i packed = _mm256_permute4x64_epi64(_mm256_packus_epi16(words, words), 0x08);
+            _mm_storeu_si128((__m128i *)(dst + done), _mm256_castsi256_si128(packed));
+        }
+#endif
+
+        // remaining bytes are accumulated as whole rows, the inner loop runs over contiguous bytes
+        for (size_t i = done; i < bytes; i++)
+        {
+            acc[i] = HALF;
+        }
+        for (uint32_t k = 0; k < coeffs->count[row]; k++, src += pass->src_stride)
+        {
+            int32_t weight = weights[k];
+            for (size_t i = done; i < bytes; i++)
+            {
+                acc[i] += weight * src[i];
+            }
+        }
+        for (size_t i = done; i < bytes; i++)
+        {
+            dst[i] = clamp_channel(acc[i]);
+        }
+    }
+
+    free(acc);
+}
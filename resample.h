@@ -0,0 +1,63 @@
+#ifndef _RESAMPLE_H
+#define _RESAMPLE_H
+
+#include <stdbool.h>
+
+#include "bmp.h"
+
+
+/**
+ * Reconstruction filters used for resampling.
+ */
+enum resample_filter {
+    FILTER_NEAREST,     // nearest neighbour, same sampling as `scale()`
+    FILTER_BOX,         // box / area average
+    FILTER_BILINEAR,    // triangle filter
+    FILTER_BICUBIC,     // cubic convolution (a = -0.5)
+    FILTER_LANCZOS      // lanczos windowed sinc (a = 3)
+};
+
+
+/**
+ * Parse resampling filter name.
+ *
+ * Accepted names are "nearest", "box", "bilinear", "bicubic" and "lanczos".
+ *
+ * @arg name the filter name
+ * @arg filter where the parsed filter is stored
+ * @return `true` if the name is known, `false` otherwise
+ */
+bool parse_resample_filter(const char* name, enum resample_filter* filter);
+
+
+/**
+ * Resample image to given dimensions.
+ *
+ * Creates copy of original file resampled with separable filter. Filter
+ * coefficients are precomputed for every output column and row, horizontal
+ * and vertical passes run in 16-bit fixed point over bands of rows in parallel.
+ * When downscaling, filter support is widened by the scale ratio, so every
+ * source pixel contributes (no aliasing).
+ *
+ * @arg image the image
+ * @arg width width of created image
+ * @arg height height of created image
+ * @arg filter the reconstruction filter
+ * @return the copy of image resampled to width x height or NULL, if there is no image (NULL given) or dimensions are not valid
+ */
+struct bmp_image* resample(const struct bmp_image* image, uint32_t width, uint32_t height, enum resample_filter filter);
+
+
+/**
+ * Resize image height and width by scale factor using filter.
+ *
+ * Same dimensions as `scale()`, but pixels are computed by `resample()`.
+ *
+ * @arg image the image
+ * @arg factor the ratio of corresponding sides of original and created image
+ * @arg filter the reconstruction filter
+ * @return the copy of image scaled by factor or NULL, if there is no image (NULL given) or factor value is not valid
+ */
+struct bmp_image* scale_filtered(const struct bmp_image* image, float factor, enum resample_filter filter);
+
+#endif
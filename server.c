@@ -0,0 +1,461 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <signal.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#include "server.h"
+#include "parallel.h"
+
+// HELPER MACROS
+// ================================================================================
+
+#define MAX_WORKERS 64
+#define MESSAGE_MAX 256
+#define BACKLOG 64
+
+/* requests of one connection, answered in order */
+struct session
+{
+    FILE *output;
+    pthread_mutex_t lock;
+    pthread_cond_t drained;
+    struct job *head; // oldest unanswered request
+    struct job *tail;
+};
+
+/* one request line */
+struct job
+{
+    struct session *session;
+    char *line;
+    char **args;
+    size_t count;
+    bool done;
+    bool success;
+    char message[MESSAGE_MAX];
+    struct job *next;       // next request of the session
+    struct job *next_queued; // next request waiting for a worker
+};
+
+/* workers shared by all sessions */
+struct pool
+{
+    request_handler handler;
+    void *ctx;
+    pthread_mutex_t lock;
+    pthread_cond_t ready;
+    struct job *head;
+    struct job *tail;
+    bool stopping;
+    pthread_t threads[MAX_WORKERS];
+    unsigned count;
+};
+
+/* accepted connection */
+struct connection
+{
+    struct pool *pool;
+    int fd;
+};
+
+// HELPER DECLARATION
+// ================================================================================
+
+/**
+ * Start workers.
+ *
+ * @param pool the pool to initialize
+ * @param handler the request handler
+ * @param ctx user data of the handler
+ * @return true if at least one worker runs
+ */
+bool start_pool(struct pool *pool, request_handler handler, void *ctx);
+
+/**
+ * Let workers finish queued requests and join them.
+ *
+ * @param pool the pool
+ */
+void stop_pool(struct pool *pool);
+
+/**
+ * Worker thread entry point.
+ *
+ * @param arg the `pool` structure
+ * @return always `NULL`
+ */
+void *run_worker(void *arg);
+
+/**
+ * Read requests of one session until the input ends and answer them.
+ *
+ * @param pool the pool running requests
+ * @param input the request stream
+ * @param output the response stream
+ */
+void run_session(struct pool *pool, FILE *input, FILE *output);
+
+/**
+ * Connection thread entry point.
+ *
+ * @param arg the `connection` structure, freed by the thread
+ * @return always `NULL`
+ */
+void *run_connection(void *arg);
+
+/**
+ * Split request line into words.
+ *
+ * @param job the job holding the line
+ * @return true if the words were allocated
+ */
+bool split_request(struct job *job);
+
+/**
+ * Mark job done and write answers of all finished leading requests.
+ *
+ * @param job the finished job
+ */
+void finish_job(struct job *job);
+
+/**
+ * Free job.
+ *
+ * @param job the job
+ */
+void free_job(struct job *job);
+
+// PUBLIC IMPLEMENTATION
+// ================================================================================
+
+bool serve_stream(FILE *input, FILE *output, request_handler handler, void *ctx)
+{
+    if (input == NULL || output == NULL || handler == NULL)
+    {
+        return false;
+    }
+
+    struct pool pool;
+    if (!start_pool(&pool, handler, ctx))
+    {
+        return false;
+    }
+
+    run_session(&pool, input, output);
+    stop_pool(&pool);
+    return true;
+}
+
+bool serve_socket(const char *path, request_handler handler, void *ctx)
+{
+    struct sockaddr_un address = {.sun_family = AF_UNIX};
+    if (path == NULL || handler == NULL || strlen(path) >= sizeof(address.sun_path))
+    {
+        return false;
+    }
+    strcpy(address.sun_path, path);
+
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0)
+    {
+        return false;
+    }
+
+    unlink(path);
+    if (bind(fd, (struct sockaddr *)&address, sizeof(address)) != 0 || listen(fd, BACKLOG) != 0)
+    {
+        close(fd);
+        return false;
+    }
+
+    struct pool pool;
+    if (!start_pool(&pool, handler, ctx))
+    {
+        close(fd);
+        return false;
+    }
+
+    // clients leaving early must not kill the server
+    signal(SIGPIPE, SIG_IGN);
+
+    for (;;)
+    {
+        int client = accept(fd, NULL, NULL);
+        if (client < 0)
+        {
+            continue;
+        }
+
+        struct connection *connection = malloc(sizeof(struct connection));
+        pthread_t thread;
+        if (connection == NULL)
+        {
+            close(client);
+            continue;
+        }
+
+        *connection = (struct connection){&pool, client};
+        if (pthread_create(&thread, NULL, run_connection, connection) != 0)
+        {
+            close(client);
+            free(connection);
+            continue;
+        }
+        pthread_detach(thread);
+    }
+}
+
+// HELPER IMPLEMENTATION
+// ================================================================================
+
+bool start_pool(struct pool *pool, request_handler handler, void *ctx)
+{
+    pool->handler = handler;
+    pool->ctx = ctx;
+    pool->head = pool->tail = NULL;
+    pool->stopping = false;
+    pool->count = 0;
+    pthread_mutex_init(&pool->lock, NULL);
+    pthread_cond_init(&pool->ready, NULL);
+
+    unsigned threads = parallel_threads() < MAX_WORKERS ? parallel_threads() : MAX_WORKERS;
+    for (unsigned i = 0; i < threads; i++)
+    {
+        if (pthread_create(&pool->threads[pool->count], NULL, run_worker, pool) == 0)
+        {
+            pool->count++;
+        }
+    }
+
+    if (pool->count == 0)
+    {
+        pthread_mutex_destroy(&pool->lock);
+        pthread_cond_destroy(&pool->ready);
+        return false;
+    }
+    return true;
+}
+
+void stop_pool(struct pool *pool)
+{
+    pthread_mutex_lock(&pool->lock);
+    pool->stopping = true;
+    pthread_cond_broadcast(&pool->ready);
+    pthread_mutex_unlock(&pool->lock);
+
+    for (unsigned i = 0; i < pool->count; i++)
+    {
+        pthread_join(pool->threads[i], NULL);
+    }
+
+    pthread_mutex_destroy(&pool->lock);
+    pthread_cond_destroy(&pool->ready);
+}
+
+void *run_worker(void *arg)
+{
+    struct pool *pool = arg;
+
+    // workers already run one per processor, so requests do not spawn threads of their own
+    parallel_serial();
+
+    for (;;)
+    {
+        pthread_mutex_lock(&pool->lock);
+        while (pool->head == NULL && !pool->stopping)
+        {
+            pthread_cond_wait(&pool->ready, &pool->lock);
+        }
+
+        struct job *job = pool->head;
+        if (job == NULL)
+        {
+            pthread_mutex_unlock(&pool->lock);
+            return NULL;
+        }
+        pool->head = job->next_queued;
+        if (pool->head == NULL)
+        {
+            pool->tail = NULL;
+        }
+        pthread_mutex_unlock(&pool->lock);
+
+        job->success = job->args != NULL &&
+                       pool->handler(pool->ctx, job->args, job->count, job->message, sizeof(job->message));
+        if (job->args == NULL)
+        {
+            strcpy(job->message, "out of memory");
+        }
+        finish_job(job);
+    }
+}
+
+void run_session(struct pool *pool, FILE *input, FILE *output)
+{
+    struct session session = {.output = output};
+    pthread_mutex_init(&session.lock, NULL);
+    pthread_cond_init(&session.drained, NULL);
+
+    char *line = NULL;
+    size_t capacity = 0;
+    while (getline(&line, &capacity, input) != -1)
+    {
+        if (strspn(line, " \t\r\n") == strlen(line))
+        {
+            continue;
+        }
+
+        struct job *job = malloc(sizeof(struct job));
+        if (job == NULL)
+        {
+            break;
+        }
+
+        // line buffer passes to the job, words point into it
+        *job = (struct job){.session = &session, .line = line};
+        line = NULL;
+        capacity = 0;
+        split_request(job);
+
+        pthread_mutex_lock(&session.lock);
+        if (session.tail != NULL)
+        {
+            session.tail->next = job;
+        }
+        else
+        {
+            session.head = job;
+        }
+        session.tail = job;
+        pthread_mutex_unlock(&session.lock);
+
+        pthread_mutex_lock(&pool->lock);
+        if (pool->tail != NULL)
+        {
+            pool->tail->next_queued = job;
+        }
+        else
+        {
+            pool->head = job;
+        }
+        pool->tail = job;
+        pthread_cond_signal(&pool->ready);
+        pthread_mutex_unlock(&pool->lock);
+    }
+    free(line);
+
+    pthread_mutex_lock(&session.lock);
+    while (session.head != NULL)
+    {
+        pthread_cond_wait(&session.drained, &session.lock);
+    }
+    pthread_mutex_unlock(&session.lock);
+
+    pthread_mutex_destroy(&session.lock);
+    pthread_cond_destroy(&session.drained);
+}
+
+void *run_connection(void *arg)
+{
+    struct connection *connection = arg;
+    int output_fd = dup(connection->fd);
+    FILE *input = fdopen(connection->fd, "r");
+    FILE *output = output_fd >= 0 ? fdopen(output_fd, "w") : NULL;
+
+    if (input != NULL && output != NULL)
+    {
+        run_session(connection->pool, input, output);
+    }
+
+    if (input != NULL)
+    {
+        fclose(input);
+    }
+    else
+    {
+        close(connection->fd);
+    }
+    if (output != NULL)
+    {
+        fclose(output);
+    }
+    else if (output_fd >= 0)
+    {
+        close(output_fd);
+    }
+
+    free(connection);
+    return NULL;
+}
+
+bool split_request(struct job *job)
+{
+    // every other character at most starts a word
+    size_t length = strlen(job->line);
+    job->args = malloc((length / 2 + 1) * sizeof(char *));
+    if (job->args == NULL)
+    {
+        return false;
+    }
+
+    char *save = NULL;
+    for (char *word = strtok_r(job->line, " \t\r\n", &save); word != NULL; word = strtok_r(NULL, " \t\r\n", &save))
+    {
+        job->args[job->count++] = word;
+    }
+    return true;
+}
+
+void finish_job(struct job *job)
+{
+    struct session *session = job->session;
+
+    pthread_mutex_lock(&session->lock);
+    job->done = true;
+
+    // later requests finishing first wait for the earlier ones
+    bool answered = false;
+    while (session->head != NULL && session->head->done)
+    {
+        struct job *head = session->head;
+        if (head->success)
+        {
+            fputs("ok\n", session->output);
+        }
+        else
+        {
+            fprintf(session->output, "error %s\n", head->message);
+        }
+        answered = true;
+
+        session->head = head->next;
+        if (session->head == NULL)
+        {
+            session->tail = NULL;
+        }
+        free_job(head);
+    }
+
+    if (answered)
+    {
+        fflush(session->output);
+    }
+    if (session->head == NULL)
+    {
+        pthread_cond_broadcast(&session->drained);
+    }
+    pthread_mutex_unlock(&session->lock);
+}
+
+void free_job(struct job *job)
+{
+    free(job->args);
+    free(job->line);
+    free(job);
+}
@@ -0,0 +1,55 @@
+#ifndef _SERVER_H
+#define _SERVER_H
+
+#include <stdio.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+
+/**
+ * Handler of one request.
+ *
+ * Called on worker threads, so handlers must not use global state.
+ *
+ * @param ctx user data passed to `serve_stream()` or `serve_socket()`
+ * @param args whitespace separated words of the request line
+ * @param count number of words
+ * @param error receives message of the failure
+ * @param size size of error buffer
+ * @return true if the request succeeded
+ */
+typedef bool (*request_handler)(void* ctx, char** args, size_t count, char* error, size_t size);
+
+
+/**
+ * Serve requests read line by line from stream.
+ *
+ * Requests run on a pool of `parallel_threads()` workers, each request
+ * serially on its worker, so no threads are created per request. Every
+ * request is answered by line `ok` or `error <message>`, in the order of
+ * requests.
+ * Returns once the input ends and all requests are answered.
+ *
+ * @arg input the request stream
+ * @arg output the response stream
+ * @arg handler the request handler
+ * @arg ctx user data passed to every handler call
+ * @return true if the pool was started
+ */
+bool serve_stream(FILE* input, FILE* output, request_handler handler, void* ctx);
+
+
+/**
+ * Serve requests of clients connecting to Unix domain socket.
+ *
+ * Every connection speaks the protocol of `serve_stream()`, all of them
+ * share one pool of workers. Existing socket file at path is replaced.
+ *
+ * @arg path path of the socket
+ * @arg handler the request handler
+ * @arg ctx user data passed to every handler call
+ * @return false if the socket or the pool cannot be created, does not return otherwise
+ */
+bool serve_socket(const char* path, request_handler handler, void* ctx);
+
+#endif
@@ -0,0 +1,190 @@
+#include <stdlib.h>
+#include <ctype.h>
+#include <stdatomic.h>
+
+#include "slice.h"
+#include "batch.h"
+#include "transformations.h"
+#include "parallel.h"
+#include "bmp.h"
+
+// HELPER MACROS
+// ================================================================================
+
+#define LINE_SIZE 256 // longest line of area list
+
+/* slicing shared by all bands */
+struct slice_pass
+{
+    const struct bmp_image *image;
+    const struct slice_rect *rects;
+    const char *pattern;
+    atomic_bool failed;
+};
+
+// HELPER DECLARATION
+// ================================================================================
+
+/**
+ * Write band of slices.
+ *
+ * @param ctx the `slice_pass` structure
+ * @param start index of the first slice of the band
+ * @param end one past the index of the last slice of the band
+ */
+void slice_files(void *ctx, uint32_t start, uint32_t end);
+
+/**
+ * Write one slice into file.
+ *
+ * @param image the image
+ * @param rect the area
+ * @param name the file name
+ * @return true if the file was written
+ */
+bool write_slice(const struct bmp_image *image, const struct slice_rect *rect, const char *name);
+
+// PUBLIC IMPLEMENTATION
+// ================================================================================
+
+size_t slice_grid(const struct bmp_image *image, uint32_t tile_width, uint32_t tile_height, struct slice_rect **rects)
+{
+    if (image == NULL || rects == NULL || tile_width == 0 || tile_height == 0)
+    {
+        return 0;
+    }
+
+    uint32_t width = image->header->width;
+    uint32_t height = image->header->height;
+    size_t cols = (width + (size_t)tile_width - 1) / tile_width;
+    size_t rows = (height + (size_t)tile_height - 1) / tile_height;
+
+    *rects = malloc(cols * rows * sizeof(struct slice_rect));
+    if (*rects == NULL)
+    {
+        return 0;
+    }
+
+    size_t count = 0;
+    for (size_t row = 0; row < rows; row++)
+    {
+        for (size_t col = 0; col < cols; col++)
+        {
+            struct slice_rect *rect = &(*rects)[count++];
+            rect->start_y = (uint32_t)(row * tile_height);
+            rect->start_x = (uint32_t)(col * tile_width);
+            rect->height = height - rect->start_y < tile_height ? height - rect->start_y : tile_height;
+            rect->width = width - rect->start_x < tile_width ? width - rect->start_x : tile_width;
+        }
+    }
+    return count;
+}
+
+size_t read_slice_list(FILE *stream, struct slice_rect **rects)
+{
+    if (stream == NULL || rects == NULL)
+    {
+        return 0;
+    }
+
+    size_t count = 0;
+    size_t capacity = 64;
+    *rects = malloc(capacity * sizeof(struct slice_rect));
+    if (*rects == NULL)
+    {
+        return 0;
+    }
+
+    char line[LINE_SIZE];
+    while (fgets(line, sizeof(line), stream) != NULL)
+    {
+        char *text = line;
+        while (isspace((unsigned char)*text))
+        {
+            text++;
+        }
+        if (*text == '\0' || *text == '#')
+        {
+            continue;
+        }
+
+        if (count == capacity)
+        {
+            capacity *= 2;
+            struct slice_rect *grown = realloc(*rects, capacity * sizeof(struct slice_rect));
+            if (grown == NULL)
+            {
+                break;
+            }
+            *rects = grown;
+        }
+
+        // same order as the -c option
+        struct slice_rect *rect = &(*rects)[count];
+        if (sscanf(text, "%u,%u,%u,%u", &rect->start_x, &rect->start_y, &rect->height, &rect->width) != 4)
+        {
+            break;
+        }
+        count++;
+    }
+
+    if (!feof(stream))
+    {
+        free(*rects);
+        *rects = NULL;
+        return 0;
+    }
+    return count;
+}
+
+bool write_slices(const struct bmp_image *image, const struct slice_rect *rects, size_t count, const char *pattern)
+{
+    if (image == NULL || rects == NULL || count == 0 || count > UINT32_MAX || !output_pattern_valid(pattern))
+    {
+        return false;
+    }
+
+    // reject whole list before any file is created
+    for (size_t i = 0; i < count; i++)
+    {
+        const struct slice_rect *rect = &rects[i];
+        if (rect->height == 0 || rect->width == 0 ||
+            (uint64_t)rect->start_y + rect->height > image->header->height ||
+            (uint64_t)rect->start_x + rect->width > image->header->width)
+        {
+            return false;
+        }
+    }
+
+    struct slice_pass pass = {image, rects, pattern, false};
+    parallel_rows((uint32_t)count, slice_files, &pass);
+
+    return !atomic_load(&pass.failed);
+}
+
+// HELPER IMPLEMENTATION
+// ================================================================================
+
+void slice_files(void *ctx, uint32_t start, uint32_t end)
+{
+    struct slice_pass *pass = ctx;
+    char name[FILENAME_MAX];
+
+    for (uint32_t i = start; i < end; i++)
+    {
+        if (!format_output_path(name, sizeof(name), pass->pattern, i) || !write_slice(pass->image, &pass->rects[i], name))
+        {
+            fprintf(stderr, "Error: Unable to write %s.\n", name);
+            atomic_store(&pass->failed, true);
+        }
+    }
+}
+
+bool write_slice(const struct bmp_image *image, const struct slice_rect *rect, const char *name)
+{
+    struct bmp_image *view = crop(image, rect->start_y, rect->start_x, rect->height, rect->width);
+    bool success = write_bmp_file(name, view);
+
+    free_bmp_image(view);
+    return success;
+}
@@ -0,0 +1,66 @@
+#ifndef _SLICE_H
+#define _SLICE_H
+
+#include <stdio.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "bmp.h"
+
+
+/**
+ * Rectangular area of an image, arguments of `crop()`.
+ */
+struct slice_rect {
+    uint32_t start_y;           // top row, counted from the top of the image
+    uint32_t start_x;           // left column
+    uint32_t height;
+    uint32_t width;
+};
+
+
+/**
+ * Split image into grid of tiles.
+ *
+ * Tiles are listed row by row from the top-left corner. Tiles at the right
+ * and bottom edge are smaller, if image dimensions are not multiples of tile
+ * dimensions.
+ *
+ * @arg image the image
+ * @arg tile_width width of tiles in pixels
+ * @arg tile_height height of tiles in pixels
+ * @arg rects receives array of tiles, which must be freed with free()
+ * @return number of tiles or 0, if there is no image (NULL given), tile dimensions are 0 or memory allocation failed
+ */
+size_t slice_grid(const struct bmp_image* image, uint32_t tile_width, uint32_t tile_height, struct slice_rect** rects);
+
+
+/**
+ * Read list of areas.
+ *
+ * Every line holds one area in the format of the `-c` option. Empty lines
+ * and lines starting with `#` are skipped.
+ *
+ * @arg stream opened stream with the list
+ * @arg rects receives array of areas, which must be freed with free()
+ * @return number of areas or 0, if there is no stream (NULL given), a line is not valid or memory allocation failed
+ */
+size_t read_slice_list(FILE* stream, struct slice_rect** rects);
+
+
+/**
+ * Write areas of image into separate files.
+ *
+ * Every area is a view into image, so no pixels are copied. Files are
+ * written in parallel, every file through one fully buffered write.
+ *
+ * @arg image the image
+ * @arg rects the areas
+ * @arg count number of areas
+ * @arg pattern output file name pattern (see `output_pattern_valid()`)
+ * @return true if all files were written, false if there is no image, an area is out of range, pattern is not valid or writing failed
+ */
+bool write_slices(const struct bmp_image* image, const struct slice_rect* rects, size_t count, const char* pattern);
+
+#endif
@@ -0,0 +1,245 @@
+#include <stdlib.h>
+#include <string.h>
+#include <stdatomic.h>
+#include <pthread.h>
+
+#include "stats.h"
+#include "parallel.h"
+#include "bmp.h"
+
+// HELPER MACROS
+// ================================================================================
+
+#define SUB_HISTOGRAMS 4       // independent counters hide store to load latency of repeated values,
+                               // 32-bit counters of a band overflow only beyond 2^34 pixels
+#define COLOR_BITS (1u << 24) // one bit per 24-bit color
+
+/* counting shared by all bands */
+struct stats_pass
+{
+    const struct bmp_image *image;
+    struct bmp_stats *stats;
+    _Atomic uint64_t *colors; // bitset of seen colors
+    pthread_mutex_t lock;     // guards merging into stats
+    _Atomic bool failed;      // set by band which could not allocate its memory
+};
+
+// HELPER DECLARATION
+// ================================================================================
+
+/**
+ * Count band of rows into private histograms and merge them.
+ *
+ * Sets `failed` of the pass, if memory allocation fails.
+ *
+ * @param ctx the `stats_pass` structure
+ * @param start first row of the band
+ * @param end one past the last row of the band
+ */
+void stats_rows(void *ctx, uint32_t start, uint32_t end);
+
+// PUBLIC IMPLEMENTATION
+// ================================================================================
+
+bool compute_stats(const struct bmp_image *image, struct bmp_stats *stats)
+{
+    if (image == NULL || stats == NULL)
+    {
+        return false;
+    }
+
+    memset(stats, 0, sizeof(struct bmp_stats));
+    stats->pixels = (uint64_t)image->header->width * image->header->height;
+
+    struct stats_pass pass = {image, stats, NULL, PTHREAD_MUTEX_INITIALIZER, false};
+    pass.colors = calloc(COLOR_BITS / 64, sizeof(uint64_t));
+    if (pass.colors == NULL)
+    {
+        return false;
+    }
+
+    parallel_rows(image->header->height, stats_rows, &pass);
+
+    for (uint32_t i = 0; i < COLOR_BITS / 64; i++)
+    {
+        stats->unique_colors += (uint32_t)__builtin_popcountll(atomic_load_explicit(&pass.colors[i], memory_order_relaxed));
+    }
+    free(pass.colors);
+    pthread_mutex_destroy(&pass.lock);
+    if (pass.failed)
+    {
+        return false;
+    }
+
+    for (int c = 0; c < CHANNELS; c++)
+    {
+        uint64_t sum = 0;
+        uint64_t sum_squares = 0;
+        bool seen = false;
+        for (uint32_t v = 0; v < 256; v++)
+        {
+            uint64_t n = stats->histogram[c][v];
+            if (n == 0)
+            {
+                continue;
+            }
+            stats->min[c] = seen ? stats->min[c] : (uint8_t)v;
+            stats->max[c] = (uint8_t)v;
+            seen = true;
+            sum += n * v;
+            sum_squares += n * v * v;
+        }
+        stats->mean[c] = (double)sum / (double)stats->pixels;
+        stats->variance[c] = (double)sum_squares / (double)stats->pixels - stats->mean[c] * stats->mean[c];
+    }
+
+    return true;
+}
+
+void print_histogram(FILE *stream, const struct bmp_stats *stats)
+{
+    fprintf(stream, "value,blue,green,red\n");
+    for (int v = 0; v < 256; v++)
+    {
+        fprintf(stream, "%d,%llu,%llu,%llu\n", v,
+                (unsigned long long)stats->histogram[CHANNEL_BLUE][v],
+                (unsigned long long)stats->histogram[CHANNEL_GREEN][v],
+                (unsigned long long)stats->histogram[CHANNEL_RED][v]);
+    }
+}
+
+void print_stats(FILE *stream, const struct bmp_stats *stats)
+{
+    static const char *names[CHANNELS] = {"blue", "green", "red"};
+
+    fprintf(stream, "pixels: %llu\n", (unsigned long long)stats->pixels);
+    fprintf(stream, "unique colors: %u\n", stats->unique_colors);
+    for (int c = 0; c < CHANNELS; c++)
+    {
+        fprintf(stream, "%s: min %u, max %u, mean %.3f, variance %.3f\n",
+                names[c], stats->min[c], stats->max[c], stats->mean[c], stats->variance[c]);
+    }
+}
+
+bool color_ops_auto_levels(struct color_ops *ops, const struct bmp_stats *stats, float clip)
+{
+    if (!(clip >= 0 && clip < 0.5f))
+    {
+        return false;
+    }
+
+    struct color_lut lut;
+    uint8_t *maps[CHANNELS] = {lut.blue, lut.green, lut.red};
+    uint64_t clipped = (uint64_t)((double)clip * (double)stats->pixels);
+
+    for (int c = 0; c < CHANNELS; c++)
+    {
+        // darkest and brightest value after clipping
+        uint32_t low = 0;
+        uint32_t high = UINT8_MAX;
+        for (uint64_t count = 0; low < UINT8_MAX && (count += stats->histogram[c][low]) <= clipped;)
+        {
+            low++;
+        }
+        for (uint64_t count = 0; high > 0 && (count += stats->histogram[c][high]) <= clipped;)
+        {
+            high--;
+        }
+
+        for (uint32_t v = 0; v < 256; v++)
+        {
+            if (high <= low)
+            {
+                maps[c][v] = (uint8_t)v; // flat channel is left untouched
+            }
+            else
+            {
+                int64_t value = ((int64_t)v - low) * UINT8_MAX / (high - low);
+                maps[c][v] = (uint8_t)(value < 0 ? 0 : value > UINT8_MAX ? UINT8_MAX : value);
+            }
+        }
+    }
+
+    color_ops_lut(ops, &lut);
+    return true;
+}
+
+void color_ops_equalize(struct color_ops *ops, const struct bmp_stats *stats)
+{
+    struct color_lut lut;
+    uint8_t *maps[CHANNELS] = {lut.blue, lut.green, lut.red};
+
+    for (int c = 0; c < CHANNELS; c++)
+    {
+        uint64_t first = 0; // pixels of the darkest value map to 0
+        for (uint32_t v = 0; v < 256 && first == 0; v++)
+        {
+            first = stats->histogram[c][v];
+        }
+
+        uint64_t cdf = 0;
+        for (uint32_t v = 0; v < 256; v++)
+        {
+            cdf += stats->histogram[c][v];
+            uint64_t range = stats->pixels - first;
+            maps[c][v] = range == 0 ? (uint8_t)v : (uint8_t)((cdf < first ? 0 : (cdf - first) * UINT8_MAX + range / 2) / range);
+        }
+    }
+
+    color_ops_lut(ops, &lut);
+}
+
+// HELPER IMPLEMENTATION
+// ================================================================================
+
+void stats_rows(void *ctx, uint32_t start, uint32_t end)
+{
+    struct stats_pass *pass = ctx;
+    uint32_t (*counts)[CHANNELS][256] = calloc(SUB_HISTOGRAMS, sizeof(*counts));
+    if (counts == NULL)
+    {
+        pass->failed = true;
+        return;
+    }
+
+    uint32_t width = pass->image->header->width;
+    uint32_t last = UINT32_MAX;
+    for (uint32_t row = start; row < end; row++)
+    {
+        const struct pixel *px = bmp_row(pass->image, row);
+        for (uint32_t i = 0; i < width; i++)
+        {
+            uint32_t (*sub)[256] = counts[i % SUB_HISTOGRAMS];
+            sub[CHANNEL_BLUE][px[i].blue]++;
+            sub[CHANNEL_GREEN][px[i].green]++;
+            sub[CHANNEL_RED][px[i].red]++;
+
+            // runs of the same color skip the shared bitset
+            uint32_t color = (uint32_t)px[i].red << 16 | (uint32_t)px[i].green << 8 | px[i].blue;
+            if (color != last)
+            {
+                uint64_t bit = (uint64_t)1 << (color % 64);
+                if ((atomic_load_explicit(&pass->colors[color / 64], memory_order_relaxed) & bit) == 0)
+                {
+                    atomic_fetch_or_explicit(&pass->colors[color / 64], bit, memory_order_relaxed);
+                }
+                last = color;
+            }
+        }
+    }
+
+    pthread_mutex_lock(&pass->lock);
+    for (int s = 0; s < SUB_HISTOGRAMS; s++)
+    {
+        for (int c = 0; c < CHANNELS; c++)
+        {
+            for (int v = 0; v < 256; v++)
+            {
+                pass->stats->histogram[c][v] += counts[s][c][v];
+            }
+        }
+    }
+    pthread_mutex_unlock(&pass->lock);
+
+    free(counts);
+}
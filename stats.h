@@ -0,0 +1,97 @@
+#ifndef _STATS_H
+#define _STATS_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "bmp.h"
+#include "color.h"
+
+
+/**
+ * Indices of channels in statistics arrays.
+ */
+enum channel {
+    CHANNEL_BLUE,
+    CHANNEL_GREEN,
+    CHANNEL_RED,
+    CHANNELS
+};
+
+
+/**
+ * Pixel statistics of an image.
+ */
+struct bmp_stats {
+    uint64_t pixels;                        // number of pixels
+    uint64_t histogram[CHANNELS][256];      // occurrences of every channel value
+    uint8_t min[CHANNELS];
+    uint8_t max[CHANNELS];
+    double mean[CHANNELS];
+    double variance[CHANNELS];              // population variance
+    uint32_t unique_colors;                 // number of distinct pixels
+};
+
+
+/**
+ * Compute pixel statistics in one pass.
+ *
+ * Bands of rows are counted in parallel into private histograms, which are
+ * merged at the end. Everything else is derived from the histograms.
+ *
+ * @arg image the image
+ * @arg stats where the statistics are stored
+ * @return `true` on success, `false` if there is no image (NULL given) or memory allocation fails
+ */
+bool compute_stats(const struct bmp_image* image, struct bmp_stats* stats);
+
+
+/**
+ * Print per-channel histograms.
+ *
+ * Writes CSV with header `value,blue,green,red` and one line per channel value.
+ *
+ * @arg stream opened output stream
+ * @arg stats the statistics
+ */
+void print_histogram(FILE* stream, const struct bmp_stats* stats);
+
+
+/**
+ * Print summary statistics.
+ *
+ * Writes min, max, mean and variance of every channel and number of unique colors.
+ *
+ * @arg stream opened output stream
+ * @arg stats the statistics
+ */
+void print_stats(FILE* stream, const struct bmp_stats* stats);
+
+
+/**
+ * Add auto levels to chain of point operations.
+ *
+ * Every channel is stretched to full range, clip fraction of the darkest
+ * and brightest pixels is saturated.
+ *
+ * @arg ops the chain
+ * @arg stats statistics of the image the chain is applied to
+ * @arg clip fraction of pixels clipped on each end, 0 <= clip < 0.5
+ * @return `true` on success, `false` if clip is not valid
+ */
+bool color_ops_auto_levels(struct color_ops* ops, const struct bmp_stats* stats, float clip);
+
+
+/**
+ * Add histogram equalization to chain of point operations.
+ *
+ * Every channel is mapped through its cumulative distribution, so channel
+ * values are spread evenly over full range.
+ *
+ * @arg ops the chain
+ * @arg stats statistics of the image the chain is applied to
+ */
+void color_ops_equalize(struct color_ops* ops, const struct bmp_stats* stats);
+
+#endif
@@ -0,0 +1,81 @@
+#include "../unity/src/unity.h"
+
+#include <string.h>
+
+#include "atlas.h"
+#include "bmp.h"
+
+void setUp(void);
+void tearDown(void);
+
+void test_load_atlas_sprites_missing_file(void);
+
+void test_pack_atlas_equal_squares(void);
+void test_build_atlas_sprite_pixels(void);
+
+int main(void)
+{
+    UNITY_BEGIN();
+
+    RUN_TEST(test_load_atlas_sprites_missing_file);
+
+    RUN_TEST(test_pack_atlas_equal_squares);
+    RUN_TEST(test_build_atlas_sprite_pixels);
+
+    return UNITY_END();
+}
+
+// TEST LOADING
+// ================================================================================
+
+void test_load_atlas_sprites_missing_file(void)
+{
+    char *paths[] = {"data/tests/test_load_atlas_sprites_missing_file.bmp"};
+
+    TEST_ASSERT_NULL(load_atlas_sprites(paths, 1));
+}
+
+// TEST PACKING
+// ================================================================================
+
+void test_pack_atlas_equal_squares(void)
+{
+    FILE *fp = fopen("data/tests/test_pack_atlas_equal_squares.bmp", "rb");
+    struct bmp_image *image = read_bmp(fp);
+    struct atlas_sprite sprites[4];
+    for (int i = 0; i < 4; i++)
+    {
+        sprites[i] = (struct atlas_sprite){"cherry", image, 0, 0};
+    }
+    uint32_t width, height;
+
+    fclose(fp);
+    TEST_ASSERT_TRUE(pack_atlas(sprites, 4, 0, &width, &height));
+    TEST_ASSERT_EQUAL(64, width);
+    TEST_ASSERT_EQUAL(64, height);
+    TEST_ASSERT_EQUAL(32, sprites[3].x);
+    TEST_ASSERT_EQUAL(32, sprites[3].y);
+}
+
+void test_build_atlas_sprite_pixels(void)
+{
+    FILE *fp = fopen("data/tests/test_build_atlas_sprite_pixels.bmp", "rb");
+    struct bmp_image *image = read_bmp(fp);
+    struct atlas_sprite sprites[] = {{"cherry", image, 8, 4}};
+    struct bmp_image *atlas = build_atlas(sprites, 1, 48, 40);
+
+    fclose(fp);
+    TEST_ASSERT_EQUAL(48, atlas->header->width);
+    // top-left sprite pixel lies 4 rows below the top of the atlas
+    TEST_ASSERT_EQUAL(0, memcmp(&bmp_row(atlas, 35)[8], &bmp_row(image, 31)[0], sizeof(struct pixel)));
+    TEST_ASSERT_EQUAL(0, bmp_row(atlas, 0)[0].red);
+    TEST_ASSERT_NULL(build_atlas(sprites, 1, 32, 32));
+}
+
+void setUp(void)
+{
+}
+
+void tearDown(void)
+{
+}
@@ -0,0 +1,67 @@
+#include "../unity/src/unity.h"
+
+#include <string.h>
+
+#include "batch.h"
+
+void test_outputs_replace_inputs(void)
+{
+    char *paths[] = {"data/tests/test_outputs_replace_inputs1.bmp", "data/tests/test_outputs_replace_inputs0.bmp"};
+
+    // written in place, in swapped order or through other spelling of the path
+    TEST_ASSERT_TRUE(outputs_replace_inputs(paths + 1, 1, "data/tests/test_outputs_replace_inputs%d.bmp"));
+    TEST_ASSERT_TRUE(outputs_replace_inputs(paths, 2, "data/tests/test_outputs_replace_inputs%d.bmp"));
+    TEST_ASSERT_TRUE(outputs_replace_inputs(paths + 1, 1, "data/../data/tests/test_outputs_replace_inputs%u.bmp"));
+
+    // existing file which is not an input and outputs which do not exist
+    TEST_ASSERT_FALSE(outputs_replace_inputs(paths, 1, "data/tests/test_outputs_replace_inputs%d.bmp"));
+    TEST_ASSERT_FALSE(outputs_replace_inputs(paths, 2, "data/tests/test_outputs_replace_inputs%d.out.bmp"));
+}
+
+void setUp(void);
+void tearDown(void);
+
+void test_output_pattern_valid(void);
+void test_format_output_path(void);
+void test_outputs_replace_inputs(void);
+
+int main(void)
+{
+    UNITY_BEGIN();
+
+    RUN_TEST(test_output_pattern_valid);
+    RUN_TEST(test_format_output_path);
+    RUN_TEST(test_outputs_replace_inputs);
+
+    return UNITY_END();
+}
+
+// TEST OUTPUT
+// ================================================================================
+
+void test_output_pattern_valid(void)
+{
+    TEST_ASSERT_TRUE(output_pattern_valid("tile_%03d.bmp"));
+    TEST_ASSERT_TRUE(output_pattern_valid("100%%_%u.bmp"));
+    TEST_ASSERT_FALSE(output_pattern_valid("tile.bmp"));
+    TEST_ASSERT_FALSE(output_pattern_valid("%d_%d.bmp"));
+    TEST_ASSERT_FALSE(output_pattern_valid("%s.bmp"));
+    TEST_ASSERT_FALSE(output_pattern_valid(NULL));
+}
+
+void test_format_output_path(void)
+{
+    char path[16];
+
+    TEST_ASSERT_TRUE(format_output_path(path, sizeof(path), "out_%03d.bmp", 7));
+    TEST_ASSERT_EQUAL(0, strcmp("out_007.bmp", path));
+    TEST_ASSERT_FALSE(format_output_path(path, sizeof(path), "long_output_%08d.bmp", 7));
+}
+
+void setUp(void)
+{
+}
+
+void tearDown(void)
+{
+}
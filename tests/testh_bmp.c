@@ -1,5 +1,8 @@
 #include "../unity/src/unity.h"
 
+#include <stdlib.h>
+#include <string.h>
+
 #include "bmp.h"
 
 void setUp(void);
@@ -15,6 +18,23 @@ void test_read_bmp_header_correct_height(void);
 
 void test_read_bmp_header_correct_filesize(void);
 
+void test_read_bmp_scaled_correct_size(void);
+void test_read_bmp_scaled_uneven_factor(void);
+void test_read_bmp_scaled_invalid_factor(void);
+
+void test_copy_bmp_copy_on_write(void);
+
+void test_read_bmp_mem_in_place(void);
+void test_read_bmp_mem_truncated(void);
+void test_write_bmp_mem_round_trip(void);
+
+void test_read_bmp_sequential(void);
+void test_read_bmp_reuse_same_size(void);
+
+void assert_box_filtered(const struct bmp_image *original, const struct bmp_image *scaled);
+
+unsigned char *read_file(const char *path, size_t *size);
+
 int main(void)
 {
     UNITY_BEGIN();
@@ -29,6 +49,19 @@ int main(void)
 
     RUN_TEST(test_read_bmp_header_correct_filesize);
 
+    RUN_TEST(test_read_bmp_scaled_correct_size);
+    RUN_TEST(test_read_bmp_scaled_uneven_factor);
+    RUN_TEST(test_read_bmp_scaled_invalid_factor);
+
+    RUN_TEST(test_copy_bmp_copy_on_write);
+
+    RUN_TEST(test_read_bmp_mem_in_place);
+    RUN_TEST(test_read_bmp_mem_truncated);
+    RUN_TEST(test_write_bmp_mem_round_trip);
+
+    RUN_TEST(test_read_bmp_sequential);
+    RUN_TEST(test_read_bmp_reuse_same_size);
+
     return UNITY_END();
 }
 
@@ -85,4 +118,218 @@ void setUp(void)
 
 void tearDown(void)
 {
-}
\ No newline at end of file
+}
+
+void test_read_bmp_scaled_correct_size(void)
+{
+    FILE *fp = fopen("data/tests/test_read_bmp_scaled_correct_size.bmp", "rb");
+    struct bmp_image *image = read_bmp_scaled(fp, 0.25f);
+
+    rewind(fp);
+    struct bmp_image *original = read_bmp(fp);
+    fclose(fp);
+    TEST_ASSERT_NOT_NULL(image);
+    TEST_ASSERT_EQUAL(64, image->header->width);
+    TEST_ASSERT_EQUAL(64, image->header->height);
+    TEST_ASSERT_EQUAL(12342, image->header->size);
+    assert_box_filtered(original, image);
+    free_bmp_image(original);
+    free_bmp_image(image);
+}
+
+void test_read_bmp_scaled_uneven_factor(void)
+{
+    FILE *fp = fopen("data/tests/test_read_bmp_scaled_uneven_factor.bmp", "rb");
+    struct bmp_image *image = read_bmp_scaled(fp, 0.3f);
+
+    rewind(fp);
+    struct bmp_image *original = read_bmp(fp);
+    fclose(fp);
+    // 256 pixels into 77 leaves footprints of 3 and 4 pixels in both directions
+    TEST_ASSERT_NOT_NULL(image);
+    TEST_ASSERT_EQUAL(77, image->header->width);
+    TEST_ASSERT_EQUAL(77, image->header->height);
+    TEST_ASSERT_EQUAL(54 + 232 * 77, image->header->size);
+    assert_box_filtered(original, image);
+    free_bmp_image(original);
+    free_bmp_image(image);
+}
+
+void test_read_bmp_scaled_invalid_factor(void)
+{
+    FILE *fp = fopen("data/tests/test_read_bmp_scaled_invalid_factor.bmp", "rb");
+    struct bmp_image *image = read_bmp_scaled(fp, 2.0f);
+
+    fclose(fp);
+    TEST_ASSERT_NULL(image);
+}
+
+void test_copy_bmp_copy_on_write(void)
+{
+    FILE *fp = fopen("data/tests/test_copy_bmp_copy_on_write.bmp", "rb");
+    struct bmp_image *image = read_bmp(fp);
+    struct bmp_image *copy = copy_bmp(image);
+
+    fclose(fp);
+    TEST_ASSERT_TRUE(copy->data == image->data);
+
+    struct pixel original = image->data[0];
+    TEST_ASSERT_TRUE(bmp_make_writable(copy));
+    copy->data[0].blue = (uint8_t)~original.blue;
+
+    TEST_ASSERT_TRUE(copy->data != image->data);
+    TEST_ASSERT_EQUAL(original.blue, image->data[0].blue);
+
+    // the only owner writes in place
+    struct pixel *data = copy->data;
+    TEST_ASSERT_TRUE(bmp_make_writable(copy));
+    TEST_ASSERT_TRUE(copy->data == data);
+}
+
+unsigned char *read_file(const char *path, size_t *size)
+{
+    FILE *fp = fopen(path, "rb");
+    unsigned char *bytes = malloc(1 << 20);
+
+    *size = fread(bytes, 1, 1 << 20, fp);
+    fclose(fp);
+    return bytes;
+}
+
+void test_read_bmp_mem_in_place(void)
+{
+    size_t size;
+    unsigned char *bytes = read_file("data/tests/test_read_bmp_mem_in_place.bmp", &size);
+    struct bmp_image *image = read_bmp_mem(bytes, size);
+
+    TEST_ASSERT_EQUAL(3, image->header->width);
+    // rows of the file are used in place, padding is skipped by the stride
+    TEST_ASSERT_TRUE((unsigned char *)image->data == bytes + 54);
+    TEST_ASSERT_EQUAL(12, image->stride);
+
+    // memory of the caller is never written
+    TEST_ASSERT_TRUE(bmp_make_writable(image));
+    TEST_ASSERT_FALSE((unsigned char *)image->data == bytes + 54);
+    TEST_ASSERT_EQUAL(9, image->stride);
+
+    free_bmp_image(image);
+    free(bytes);
+}
+
+void test_read_bmp_mem_truncated(void)
+{
+    size_t size;
+    unsigned char *bytes = read_file("data/tests/test_read_bmp_mem_truncated.bmp", &size);
+
+    TEST_ASSERT_NULL(read_bmp_mem(bytes, size - 1));
+    TEST_ASSERT_NULL(read_bmp_mem(bytes, 20));
+    TEST_ASSERT_NULL(read_bmp_mem(NULL, size));
+    free(bytes);
+}
+
+void test_write_bmp_mem_round_trip(void)
+{
+    size_t size;
+    unsigned char *bytes = read_file("data/tests/test_write_bmp_mem_round_trip.bmp", &size);
+    struct bmp_image *image = read_bmp_mem(bytes, size);
+    unsigned char *encoded = malloc(size);
+
+    TEST_ASSERT_EQUAL(size, bmp_encoded_size(image));
+    TEST_ASSERT_FALSE(write_bmp_mem(encoded, size - 1, image));
+    TEST_ASSERT_TRUE(write_bmp_mem(encoded, size, image));
+    TEST_ASSERT_EQUAL(0, memcmp(bytes, encoded, size));
+
+    free_bmp_image(image);
+    free(encoded);
+    free(bytes);
+}
+
+void test_read_bmp_sequential(void)
+{
+    FILE *fp = fopen("data/tests/test_read_bmp_sequential.bmp", "rb");
+    struct bmp_image *image = read_bmp(fp);
+    FILE *stream = tmpfile();
+
+    fclose(fp);
+    // images follow each other, each is read from the current position
+    TEST_ASSERT_TRUE(write_bmp(stream, image));
+    TEST_ASSERT_TRUE(write_bmp(stream, image));
+    rewind(stream);
+
+    struct bmp_image *first = read_bmp(stream);
+    struct bmp_image *second = read_bmp(stream);
+    TEST_ASSERT_NOT_NULL(first);
+    TEST_ASSERT_NOT_NULL(second);
+    TEST_ASSERT_EQUAL(0, memcmp(bmp_row(image, 1), bmp_row(second, 1), 3 * sizeof(struct pixel)));
+    TEST_ASSERT_NULL(read_bmp(stream));
+
+    fclose(stream);
+    free_bmp_image(image);
+    free_bmp_image(first);
+    free_bmp_image(second);
+}
+
+void test_read_bmp_reuse_same_size(void)
+{
+    FILE *fp = fopen("data/tests/test_read_bmp_reuse_same_size.bmp", "rb");
+    struct bmp_image *image = read_bmp(fp);
+    FILE *stream = tmpfile();
+
+    fclose(fp);
+    TEST_ASSERT_TRUE(write_bmp(stream, image));
+    TEST_ASSERT_TRUE(write_bmp(stream, image));
+    rewind(stream);
+
+    // the second frame lands in the pixels of the first one
+    struct bmp_image *frame = read_bmp_reuse(stream, NULL);
+    TEST_ASSERT_NOT_NULL(frame);
+    struct pixel *data = frame->data;
+    frame->data[0].red = (uint8_t)~image->data[0].red;
+
+    frame = read_bmp_reuse(stream, frame);
+    TEST_ASSERT_NOT_NULL(frame);
+    TEST_ASSERT_TRUE(frame->data == data);
+    TEST_ASSERT_EQUAL(0, memcmp(bmp_row(image, 0), bmp_row(frame, 0), 3 * sizeof(struct pixel)));
+    TEST_ASSERT_NULL(read_bmp_reuse(stream, frame));
+
+    fclose(stream);
+    free_bmp_image(image);
+}
+
+void assert_box_filtered(const struct bmp_image *original, const struct bmp_image *scaled)
+{
+    uint32_t w = original->header->width, h = original->header->height;
+    uint32_t new_w = scaled->header->width, new_h = scaled->header->height;
+    uint32_t *sums = calloc((size_t)new_w * new_h * 4, sizeof(uint32_t));
+
+    // every source pixel adds to the scaled pixel its row and column are mapped onto
+    TEST_ASSERT_NOT_NULL(sums);
+    for (uint32_t row = 0; row < h; row++)
+    {
+        for (uint32_t col = 0; col < w; col++)
+        {
+            const struct pixel *px = &bmp_row(original, row)[col];
+            uint32_t *sum = &sums[((size_t)(row * new_h / h) * new_w + col * new_w / w) * 4];
+            sum[0] += px->blue;
+            sum[1] += px->green;
+            sum[2] += px->red;
+            sum[3]++;
+        }
+    }
+
+    // and the scaled pixel is their rounded mean
+    for (uint32_t new_row = 0; new_row < new_h; new_row++)
+    {
+        for (uint32_t new_col = 0; new_col < new_w; new_col++)
+        {
+            const uint32_t *sum = &sums[((size_t)new_row * new_w + new_col) * 4];
+            const struct pixel *out = &bmp_row(scaled, new_row)[new_col];
+            uint32_t n = sum[3];
+            TEST_ASSERT_TRUE(n > 0);
+            TEST_ASSERT_EQUAL((sum[0] + n / 2) / n, out->blue);
+            TEST_ASSERT_EQUAL((sum[1] + n / 2) / n, out->green);
+            TEST_ASSERT_EQUAL((sum[2] + n / 2) / n, out->red);
+        }
+    }
+    free(sums);
+}
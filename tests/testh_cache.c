@@ -0,0 +1,106 @@
+#include "../unity/src/unity.h"
+
+#include <string.h>
+
+#include "cache.h"
+
+void setUp(void);
+void tearDown(void);
+
+void test_cache_store_and_lookup(void);
+void test_cache_key_depends_on_chain(void);
+
+void test_cache_evict_over_limit(void);
+
+int main(void)
+{
+    UNITY_BEGIN();
+
+    RUN_TEST(test_cache_store_and_lookup);
+    RUN_TEST(test_cache_key_depends_on_chain);
+
+    RUN_TEST(test_cache_evict_over_limit);
+
+    return UNITY_END();
+}
+
+// TEST LOOKUP
+// ================================================================================
+
+void test_cache_store_and_lookup(void)
+{
+    const char *dir = "build/results/out/test_cache_store_and_lookup";
+    FILE *fp = fopen("data/tests/test_cache_store_and_lookup.bmp", "rb");
+    struct bmp_cache cache;
+    char temp_path[FILENAME_MAX];
+    char result[8] = "";
+
+    TEST_ASSERT_TRUE(cache_open(&cache, dir, 1 << 20, fp, "114=;"));
+    fclose(fp);
+    cache_evict(dir, 0);
+    TEST_ASSERT_NULL(cache_lookup(&cache));
+
+    FILE *temp = cache_create(&cache, temp_path);
+    fputs("result", temp);
+    FILE *entry = cache_commit(&cache, temp, temp_path);
+    TEST_ASSERT_NOT_NULL(entry);
+    TEST_ASSERT_EQUAL(6, fread(result, 1, sizeof(result), entry));
+    TEST_ASSERT_EQUAL(0, strcmp("result", result));
+    fclose(entry);
+
+    entry = cache_lookup(&cache);
+    TEST_ASSERT_NOT_NULL(entry);
+    fclose(entry);
+    cache_close(&cache);
+}
+
+void test_cache_key_depends_on_chain(void)
+{
+    const char *dir = "build/results/out/test_cache_key_depends_on_chain";
+    FILE *fp = fopen("data/tests/test_cache_key_depends_on_chain.bmp", "rb");
+    struct bmp_cache first, second, third;
+
+    TEST_ASSERT_TRUE(cache_open(&first, dir, 1 << 20, fp, "114=;"));
+    rewind(fp);
+    TEST_ASSERT_TRUE(cache_open(&second, dir, 1 << 20, fp, "108=;"));
+    rewind(fp);
+    TEST_ASSERT_TRUE(cache_open(&third, dir, 1 << 20, fp, "114=;"));
+    fclose(fp);
+
+    TEST_ASSERT_FALSE(strcmp(first.path, second.path) == 0);
+    TEST_ASSERT_EQUAL(0, strcmp(first.path, third.path));
+    TEST_ASSERT_EQUAL(3126, first.input_size);
+    cache_close(&first);
+    cache_close(&second);
+    cache_close(&third);
+}
+
+// TEST EVICTION
+// ================================================================================
+
+void test_cache_evict_over_limit(void)
+{
+    const char *dir = "build/results/out/test_cache_evict_over_limit";
+    FILE *fp = fopen("data/tests/test_cache_evict_over_limit.bmp", "rb");
+    struct bmp_cache cache;
+    char temp_path[FILENAME_MAX];
+
+    TEST_ASSERT_TRUE(cache_open(&cache, dir, 1 << 20, fp, "114=;"));
+    fclose(fp);
+    FILE *temp = cache_create(&cache, temp_path);
+    fputs("result", temp);
+    fclose(cache_commit(&cache, temp, temp_path));
+
+    TEST_ASSERT_EQUAL(0, cache_evict(dir, 1 << 20));
+    TEST_ASSERT_EQUAL(1, cache_evict(dir, 0));
+    TEST_ASSERT_NULL(cache_lookup(&cache));
+    cache_close(&cache);
+}
+
+void setUp(void)
+{
+}
+
+void tearDown(void)
+{
+}
@@ -0,0 +1,97 @@
+#include "../unity/src/unity.h"
+
+#include <string.h>
+
+#include "color.h"
+#include "bmp.h"
+
+void setUp(void);
+void tearDown(void);
+
+void test_color_ops_extract_not_valid(void);
+void test_color_ops_levels_not_valid(void);
+
+void test_apply_color_ops_grayscale(void);
+void test_apply_color_ops_fused_chain(void);
+
+int main(void)
+{
+    UNITY_BEGIN();
+
+    RUN_TEST(test_color_ops_extract_not_valid);
+    RUN_TEST(test_color_ops_levels_not_valid);
+
+    RUN_TEST(test_apply_color_ops_grayscale);
+    RUN_TEST(test_apply_color_ops_fused_chain);
+
+    return UNITY_END();
+}
+
+// TEST COMPOSITION
+// ================================================================================
+
+void test_color_ops_extract_not_valid(void)
+{
+    struct color_ops ops;
+    color_ops_init(&ops);
+
+    TEST_ASSERT_FALSE(color_ops_extract(&ops, "rgx"));
+}
+
+void test_color_ops_levels_not_valid(void)
+{
+    struct color_ops ops;
+    color_ops_init(&ops);
+
+    TEST_ASSERT_FALSE(color_ops_levels(&ops, 200, 100));
+}
+
+// TEST APPLY
+// ================================================================================
+
+void test_apply_color_ops_grayscale(void)
+{
+    FILE *fp = fopen("data/tests/test_apply_color_ops_grayscale.bmp", "rb");
+    struct bmp_image *image = read_bmp(fp);
+    struct color_ops ops;
+    color_ops_init(&ops);
+    color_ops_grayscale(&ops);
+    struct bmp_image *gray_image = apply_color_ops(image, &ops);
+
+    fclose(fp);
+    for (uint32_t i = 0; i < image->header->width * image->header->height; i++)
+    {
+        TEST_ASSERT_EQUAL(gray_image->data[i].blue, gray_image->data[i].green);
+        TEST_ASSERT_EQUAL(gray_image->data[i].blue, gray_image->data[i].red);
+    }
+}
+
+void test_apply_color_ops_fused_chain(void)
+{
+    FILE *fp = fopen("data/tests/test_apply_color_ops_fused_chain.bmp", "rb");
+    struct bmp_image *image = read_bmp(fp);
+    struct color_ops invert, levels, fused;
+    color_ops_init(&invert);
+    color_ops_init(&levels);
+    color_ops_init(&fused);
+    color_ops_invert(&invert);
+    color_ops_levels(&levels, 16, 235);
+    color_ops_invert(&fused);
+    color_ops_levels(&fused, 16, 235);
+
+    struct bmp_image *inverted_image = apply_color_ops(image, &invert);
+    struct bmp_image *sequential_image = apply_color_ops(inverted_image, &levels);
+    struct bmp_image *fused_image = apply_color_ops(image, &fused);
+
+    fclose(fp);
+    size_t size = image->header->width * image->header->height * sizeof(struct pixel);
+    TEST_ASSERT_EQUAL(0, memcmp(sequential_image->data, fused_image->data, size));
+}
+
+void setUp(void)
+{
+}
+
+void tearDown(void)
+{
+}
@@ -0,0 +1,206 @@
+#include "../unity/src/unity.h"
+
+#include <stdlib.h>
+
+#include "colorspace.h"
+#include "transformations.h"
+#include "bmp.h"
+
+void setUp(void);
+void tearDown(void);
+
+void test_parse_color_space_names(void);
+void test_parse_color_space_invalid(void);
+
+void test_to_color_space_ycbcr(void);
+void test_to_color_space_limited(void);
+void test_to_color_space_hsv(void);
+void test_to_color_space_round_trip(void);
+
+void test_from_color_space_hsv(void);
+
+void fill_pixels(struct bmp_image *image);
+int max_difference(const struct bmp_image *a, const struct bmp_image *b);
+
+int main(void)
+{
+    UNITY_BEGIN();
+
+    RUN_TEST(test_parse_color_space_names);
+    RUN_TEST(test_parse_color_space_invalid);
+
+    RUN_TEST(test_to_color_space_ycbcr);
+    RUN_TEST(test_to_color_space_limited);
+    RUN_TEST(test_to_color_space_hsv);
+    RUN_TEST(test_to_color_space_round_trip);
+
+    RUN_TEST(test_from_color_space_hsv);
+
+    return UNITY_END();
+}
+
+void fill_pixels(struct bmp_image *image)
+{
+    image->data[0] = (struct pixel){255, 255, 255};
+    image->data[1] = (struct pixel){0, 0, 0};
+    image->data[2] = (struct pixel){0, 0, 255};
+}
+
+int max_difference(const struct bmp_image *a, const struct bmp_image *b)
+{
+    int max = 0;
+    for (uint32_t row = 0; row < a->header->height; row++)
+    {
+        const struct pixel *x = bmp_row(a, row);
+        const struct pixel *y = bmp_row(b, row);
+        for (uint32_t col = 0; col < a->header->width; col++)
+        {
+            int d[3] = {abs(x[col].blue - y[col].blue), abs(x[col].green - y[col].green), abs(x[col].red - y[col].red)};
+            for (int c = 0; c < 3; c++)
+            {
+                max = d[c] > max ? d[c] : max;
+            }
+        }
+    }
+    return max;
+}
+
+// TEST PARSE
+// ================================================================================
+
+void test_parse_color_space_names(void)
+{
+    struct color_space space;
+
+    TEST_ASSERT_TRUE(parse_color_space("hsv", &space));
+    TEST_ASSERT_EQUAL(MODEL_HSV, space.model);
+    TEST_ASSERT_TRUE(parse_color_space("ycbcr", &space));
+    TEST_ASSERT_EQUAL(MODEL_YCBCR, space.model);
+    TEST_ASSERT_EQUAL(MATRIX_BT601, space.matrix);
+    TEST_ASSERT_FALSE(space.limited);
+    TEST_ASSERT_TRUE(parse_color_space("ycbcr709-limited", &space));
+    TEST_ASSERT_EQUAL(MATRIX_BT709, space.matrix);
+    TEST_ASSERT_TRUE(space.limited);
+    TEST_ASSERT_TRUE(parse_color_space("luma-limited", &space));
+    TEST_ASSERT_EQUAL(MODEL_LUMA, space.model);
+    TEST_ASSERT_EQUAL(1, color_space_components(&space));
+}
+
+void test_parse_color_space_invalid(void)
+{
+    struct color_space space;
+
+    TEST_ASSERT_FALSE(parse_color_space("rgb", &space));
+    TEST_ASSERT_FALSE(parse_color_space("ycbcr2020", &space));
+    TEST_ASSERT_FALSE(parse_color_space("hsv-limited", &space));
+    TEST_ASSERT_FALSE(parse_color_space("luma709-", &space));
+    TEST_ASSERT_FALSE(parse_color_space(NULL, &space));
+}
+
+// TEST TO
+// ================================================================================
+
+void test_to_color_space_ycbcr(void)
+{
+    FILE *fp = fopen("data/tests/test_to_color_space_ycbcr.bmp", "rb");
+    struct bmp_image *image = read_bmp(fp);
+    struct color_space space = {MODEL_YCBCR, MATRIX_BT601, false};
+    fill_pixels(image);
+    struct bmp_image *ycbcr = to_color_space(image, &space);
+
+    fclose(fp);
+    // white, black and red, components are Y in red, Cb in green and Cr in blue
+    TEST_ASSERT_EQUAL(255, ycbcr->data[0].red);
+    TEST_ASSERT_EQUAL(128, ycbcr->data[0].green);
+    TEST_ASSERT_EQUAL(128, ycbcr->data[0].blue);
+    TEST_ASSERT_EQUAL(0, ycbcr->data[1].red);
+    TEST_ASSERT_EQUAL(128, ycbcr->data[1].green);
+    TEST_ASSERT_EQUAL(128, ycbcr->data[1].blue);
+    TEST_ASSERT_EQUAL(76, ycbcr->data[2].red);
+    TEST_ASSERT_EQUAL(85, ycbcr->data[2].green);
+    TEST_ASSERT_EQUAL(255, ycbcr->data[2].blue);
+}
+
+void test_to_color_space_limited(void)
+{
+    FILE *fp = fopen("data/tests/test_to_color_space_limited.bmp", "rb");
+    struct bmp_image *image = read_bmp(fp);
+    struct color_space space = {MODEL_YCBCR, MATRIX_BT709, true};
+    struct color_space luma = {MODEL_LUMA, MATRIX_BT709, true};
+    fill_pixels(image);
+    struct bmp_image *ycbcr = to_color_space(image, &space);
+    struct bmp_image *gray = to_color_space(image, &luma);
+
+    fclose(fp);
+    TEST_ASSERT_EQUAL(235, ycbcr->data[0].red);
+    TEST_ASSERT_EQUAL(16, ycbcr->data[1].red);
+    TEST_ASSERT_EQUAL(240, ycbcr->data[2].blue);
+    TEST_ASSERT_EQUAL(235, gray->data[0].blue);
+    TEST_ASSERT_EQUAL(235, gray->data[0].green);
+    TEST_ASSERT_EQUAL(235, gray->data[0].red);
+    TEST_ASSERT_EQUAL(16, gray->data[1].red);
+}
+
+void test_to_color_space_hsv(void)
+{
+    FILE *fp = fopen("data/tests/test_to_color_space_hsv.bmp", "rb");
+    struct bmp_image *image = read_bmp(fp);
+    struct color_space space = {MODEL_HSV, MATRIX_BT601, false};
+    fill_pixels(image);
+    bmp_row(image, 1)[0] = (struct pixel){0, 255, 0};
+    bmp_row(image, 1)[1] = (struct pixel){255, 0, 0};
+    struct bmp_image *hsv = to_color_space(image, &space);
+
+    fclose(fp);
+    // components are hue in red, saturation in green and value in blue
+    TEST_ASSERT_EQUAL(0, hsv->data[0].green);
+    TEST_ASSERT_EQUAL(255, hsv->data[0].blue);
+    TEST_ASSERT_EQUAL(0, hsv->data[2].red);
+    TEST_ASSERT_EQUAL(255, hsv->data[2].green);
+    TEST_ASSERT_EQUAL(85, bmp_row(hsv, 1)[0].red);
+    TEST_ASSERT_EQUAL(171, bmp_row(hsv, 1)[1].red);
+}
+
+void test_to_color_space_round_trip(void)
+{
+    FILE *fp = fopen("data/tests/test_to_color_space_round_trip.bmp", "rb");
+    struct bmp_image *image = read_bmp(fp);
+    struct bmp_image *view = crop(image, 3, 5, 100, 77);
+    const char *names[] = {"ycbcr", "ycbcr709", "ycbcr601-limited", "ycbcr709-limited"};
+
+    fclose(fp);
+    for (size_t i = 0; i < sizeof(names) / sizeof(names[0]); i++)
+    {
+        struct color_space space;
+        TEST_ASSERT_TRUE(parse_color_space(names[i], &space));
+        struct bmp_image *converted = to_color_space(view, &space);
+        struct bmp_image *back = from_color_space(converted, &space);
+        TEST_ASSERT_TRUE(max_difference(view, back) <= 2);
+        free_bmp_image(converted);
+        free_bmp_image(back);
+    }
+}
+
+// TEST FROM
+// ================================================================================
+
+void test_from_color_space_hsv(void)
+{
+    FILE *fp = fopen("data/tests/test_from_color_space_hsv.bmp", "rb");
+    struct bmp_image *image = read_bmp(fp);
+    struct color_space space = {MODEL_HSV, MATRIX_BT601, false};
+    struct bmp_image *hsv = to_color_space(image, &space);
+    struct bmp_image *back = from_color_space(hsv, &space);
+
+    fclose(fp);
+    // hue has only 256 steps per turn
+    TEST_ASSERT_TRUE(max_difference(image, back) <= 3);
+}
+
+void setUp(void)
+{
+}
+
+void tearDown(void)
+{
+}
@@ -0,0 +1,113 @@
+#include "../unity/src/unity.h"
+
+#include <string.h>
+
+#include "dedupe.h"
+#include "hash.h"
+#include "transformations.h"
+#include "bmp.h"
+
+void setUp(void);
+void tearDown(void);
+
+void test_hash_pixels_view_equals_copy(void);
+
+void test_dedupe_images_exact(void);
+void test_dedupe_images_canonical(void);
+void test_orient_image_transpose(void);
+
+int main(void)
+{
+    UNITY_BEGIN();
+
+    RUN_TEST(test_hash_pixels_view_equals_copy);
+
+    RUN_TEST(test_dedupe_images_exact);
+    RUN_TEST(test_dedupe_images_canonical);
+    RUN_TEST(test_orient_image_transpose);
+
+    return UNITY_END();
+}
+
+// TEST HASHING
+// ================================================================================
+
+void test_hash_pixels_view_equals_copy(void)
+{
+    FILE *fp = fopen("data/tests/test_hash_pixels_view_equals_copy.bmp", "rb");
+    struct bmp_image *image = read_bmp(fp);
+    struct bmp_image *view = crop(image, 2, 3, 10, 12);
+    struct bmp_image *copy = copy_bmp(view);
+
+    fclose(fp);
+    TEST_ASSERT_TRUE(bmp_make_writable(copy));
+    TEST_ASSERT_TRUE(hash_pixels(view) == hash_pixels(copy));
+    TEST_ASSERT_FALSE(hash_pixels(image) == hash_pixels(view));
+    free_bmp_image(image);
+    free_bmp_image(view);
+    free_bmp_image(copy);
+}
+
+// TEST GROUPING
+// ================================================================================
+
+void test_dedupe_images_exact(void)
+{
+    FILE *fp = fopen("data/tests/test_dedupe_images_exact.bmp", "rb");
+    struct bmp_image *image = read_bmp(fp);
+    struct bmp_image *images[] = {image, rotate_right(image), copy_bmp(image)};
+    struct dedupe_entry entries[3];
+
+    fclose(fp);
+    TEST_ASSERT_EQUAL(2, dedupe_images(images, 3, false, entries));
+    TEST_ASSERT_EQUAL(0, entries[0].group);
+    TEST_ASSERT_EQUAL(1, entries[1].group);
+    TEST_ASSERT_EQUAL(0, entries[2].group);
+    for (int i = 0; i < 3; i++)
+    {
+        free_bmp_image(images[i]);
+    }
+}
+
+void test_dedupe_images_canonical(void)
+{
+    FILE *fp = fopen("data/tests/test_dedupe_images_canonical.bmp", "rb");
+    struct bmp_image *image = read_bmp(fp);
+    struct bmp_image *images[] = {image, rotate_right(image), flip_vertically(image)};
+    struct dedupe_entry entries[3];
+
+    fclose(fp);
+    TEST_ASSERT_EQUAL(1, dedupe_images(images, 3, true, entries));
+    TEST_ASSERT_EQUAL(0, entries[1].group);
+    TEST_ASSERT_EQUAL(0, entries[2].group);
+    TEST_ASSERT_TRUE(entries[0].hash == entries[1].hash);
+    for (int i = 0; i < 3; i++)
+    {
+        free_bmp_image(images[i]);
+    }
+}
+
+void test_orient_image_transpose(void)
+{
+    FILE *fp = fopen("data/tests/test_orient_image_transpose.bmp", "rb");
+    struct bmp_image *image = read_bmp(fp);
+    struct bmp_image *transposed = orient_image(image, ORIENT_TRANSPOSE);
+    uint32_t last_row = transposed->header->height - 1;
+
+    fclose(fp);
+    TEST_ASSERT_EQUAL(image->header->height, transposed->header->width);
+    TEST_ASSERT_EQUAL(image->header->width, transposed->header->height);
+    // top-left pixel stays in place
+    TEST_ASSERT_EQUAL(0, memcmp(&bmp_row(image, image->header->height - 1)[0], &bmp_row(transposed, last_row)[0], sizeof(struct pixel)));
+    TEST_ASSERT_NULL(orient_image(image, ORIENTATIONS));
+    free_bmp_image(image);
+    free_bmp_image(transposed);
+}
+
+void setUp(void)
+{
+}
+
+void tearDown(void)
+{
+}
@@ -0,0 +1,174 @@
+#include "../unity/src/unity.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "filters.h"
+#include "transformations.h"
+#include "batch.h"
+#include "bmp.h"
+
+void setUp(void);
+void tearDown(void);
+
+void test_parse_border_mode_unknown(void);
+
+void test_convolve_separable_identity(void);
+void test_convolve_separable_heavy_weights(void);
+void test_box_blur_new_image_size(void);
+void test_gaussian_blur_negative_sigma(void);
+void test_unsharp_mask_zero_sigma_view(void);
+void test_unsharp_mask_mapped_input(void);
+
+uint8_t sharpened_channel(uint8_t before, uint8_t center, uint8_t after);
+
+int main(void)
+{
+    UNITY_BEGIN();
+
+    RUN_TEST(test_parse_border_mode_unknown);
+
+    RUN_TEST(test_convolve_separable_identity);
+    RUN_TEST(test_convolve_separable_heavy_weights);
+    RUN_TEST(test_box_blur_new_image_size);
+    RUN_TEST(test_gaussian_blur_negative_sigma);
+    RUN_TEST(test_unsharp_mask_zero_sigma_view);
+    RUN_TEST(test_unsharp_mask_mapped_input);
+
+    return UNITY_END();
+}
+
+// TEST BORDER MODES
+// ================================================================================
+
+void test_parse_border_mode_unknown(void)
+{
+    enum border_mode border = BORDER_CLAMP;
+
+    TEST_ASSERT_FALSE(parse_border_mode("wrap", &border));
+}
+
+// TEST FILTERS
+// ================================================================================
+
+void test_convolve_separable_identity(void)
+{
+    FILE *fp = fopen("data/tests/test_convolve_separable_identity.bmp", "rb");
+    struct bmp_image *image = read_bmp(fp);
+    const float kernel[] = {0.0f, 1.0f, 0.0f};
+    struct bmp_image *convolved_image = convolve_separable(image, kernel, 1, BORDER_MIRROR);
+
+    fclose(fp);
+    size_t size = image->header->width * image->header->height * sizeof(struct pixel);
+    TEST_ASSERT_EQUAL(0, memcmp(image->data, convolved_image->data, size));
+}
+
+void test_convolve_separable_heavy_weights(void)
+{
+    FILE *fp = fopen("data/tests/test_convolve_separable_heavy_weights.bmp", "rb");
+    struct bmp_image *image = read_bmp(fp);
+    const float sharpen[] = {-1.0f, 3.0f, -1.0f};
+    const float heavy[] = {0.0f, 40000.0f, 0.0f};
+    const float broken[] = {0.0f, NAN, 0.0f};
+
+    fclose(fp);
+    // center weight does not fit 14 fraction bits, the kernel still applies exactly
+    struct bmp_image *sharpened = convolve_separable(image, sharpen, 1, BORDER_CLAMP);
+    TEST_ASSERT_NOT_NULL(sharpened);
+    uint8_t *rows = malloc(256 * 256 * sizeof(struct pixel));
+    for (uint32_t row = 0; row < 256; row++)
+    {
+        const uint8_t *src = (const uint8_t *)bmp_row(image, row);
+        for (uint32_t i = 0; i < 256 * 3; i++)
+        {
+            uint8_t before = src[i < 3 ? i : i - 3], after = src[i >= 255 * 3 ? i : i + 3];
+            rows[row * 256 * 3 + i] = sharpened_channel(before, src[i], after);
+        }
+    }
+    for (uint32_t row = 0; row < 256; row++)
+    {
+        const uint8_t *out = (const uint8_t *)bmp_row(sharpened, row);
+        const uint8_t *before = rows + (row == 0 ? row : row - 1) * 256 * 3;
+        const uint8_t *after = rows + (row == 255 ? row : row + 1) * 256 * 3;
+        for (uint32_t i = 0; i < 256 * 3; i++)
+        {
+            TEST_ASSERT_EQUAL(sharpened_channel(before[i], rows[row * 256 * 3 + i], after[i]), out[i]);
+        }
+    }
+
+    // weights which do not fit even as integers
+    TEST_ASSERT_NULL(convolve_separable(image, heavy, 1, BORDER_CLAMP));
+    TEST_ASSERT_NULL(convolve_separable(image, broken, 1, BORDER_CLAMP));
+    free(rows);
+    free_bmp_image(sharpened);
+    free_bmp_image(image);
+}
+
+void test_box_blur_new_image_size(void)
+{
+    FILE *fp = fopen("data/tests/test_box_blur_new_image_size.bmp", "rb");
+    struct bmp_image *image = read_bmp(fp);
+    struct bmp_image *blurred_image = box_blur(image, 7, BORDER_CLAMP);
+
+    fclose(fp);
+    TEST_ASSERT_EQUAL(102, blurred_image->header->size);
+}
+
+void test_gaussian_blur_negative_sigma(void)
+{
+    FILE *fp = fopen("data/tests/test_gaussian_blur_negative_sigma.bmp", "rb");
+    struct bmp_image *image = read_bmp(fp);
+    struct bmp_image *blurred_image = gaussian_blur(image, -1.0f, BORDER_CLAMP);
+
+    fclose(fp);
+    TEST_ASSERT_NULL(blurred_image);
+}
+
+void test_unsharp_mask_zero_sigma_view(void)
+{
+    FILE *fp = fopen("data/tests/test_unsharp_mask_zero_sigma_view.bmp", "rb");
+    struct bmp_image *image = read_bmp(fp);
+    struct bmp_image *view = crop(image, 5, 5, 20, 20);
+
+    fclose(fp);
+    // without blur there is nothing to sharpen, rows of the view are strided
+    struct bmp_image *sharpened = unsharp_mask(view, 0.0f, 2.0f, 0, BORDER_CLAMP);
+    TEST_ASSERT_NOT_NULL(sharpened);
+    for (uint32_t row = 0; row < 20; row++)
+    {
+        TEST_ASSERT_EQUAL(0, memcmp(bmp_row(view, row), bmp_row(sharpened, row), 20 * sizeof(struct pixel)));
+    }
+    free_bmp_image(sharpened);
+    free_bmp_image(view);
+    free_bmp_image(image);
+}
+
+void test_unsharp_mask_mapped_input(void)
+{
+    struct bmp_image *image = map_bmp_file("data/tests/test_unsharp_mask_mapped_input.bmp");
+
+    // pixels are a read only mapping, result gets its own
+    struct bmp_image *sharpened = unsharp_mask(image, 0.0f, 1.0f, 0, BORDER_CLAMP);
+    TEST_ASSERT_NOT_NULL(sharpened);
+    for (uint32_t row = 0; row < 2; row++)
+    {
+        TEST_ASSERT_EQUAL(0, memcmp(bmp_row(image, row), bmp_row(sharpened, row), 3 * sizeof(struct pixel)));
+    }
+    free_bmp_image(sharpened);
+    free_bmp_image(image);
+}
+
+uint8_t sharpened_channel(uint8_t before, uint8_t center, uint8_t after)
+{
+    int value = 3 * center - before - after;
+    return (uint8_t)(value < 0 ? 0 : value > UINT8_MAX ? UINT8_MAX : value);
+}
+
+void setUp(void)
+{
+}
+
+void tearDown(void)
+{
+}
@@ -0,0 +1,151 @@
+#include "../unity/src/unity.h"
+
+#include <math.h>
+#include <string.h>
+
+#include "integral.h"
+#include "stats.h"
+#include "transformations.h"
+#include "bmp.h"
+
+void setUp(void);
+void tearDown(void);
+
+void test_region_mean_matches_stats(void);
+void test_region_sum_brute_force(void);
+void test_region_sum_invalid(void);
+
+void test_integral_box_blur_copy(void);
+void test_integral_box_blur_edges(void);
+
+int main(void)
+{
+    UNITY_BEGIN();
+
+    RUN_TEST(test_region_mean_matches_stats);
+    RUN_TEST(test_region_sum_brute_force);
+    RUN_TEST(test_region_sum_invalid);
+
+    RUN_TEST(test_integral_box_blur_copy);
+    RUN_TEST(test_integral_box_blur_edges);
+
+    return UNITY_END();
+}
+
+// TEST REGION
+// ================================================================================
+
+void test_region_mean_matches_stats(void)
+{
+    FILE *fp = fopen("data/tests/test_region_mean_matches_stats.bmp", "rb");
+    struct bmp_image *image = read_bmp(fp);
+    struct bmp_integral *integral = build_integral(image);
+    struct slice_rect rect = {3, 5, 100, 77};
+    struct bmp_stats stats;
+    double mean[CHANNELS], variance[CHANNELS];
+
+    fclose(fp);
+    TEST_ASSERT_TRUE(compute_stats(crop(image, 3, 5, 100, 77), &stats));
+    TEST_ASSERT_TRUE(region_mean(integral, &rect, mean, variance));
+    for (int c = 0; c < CHANNELS; c++)
+    {
+        TEST_ASSERT_TRUE(fabs(stats.mean[c] - mean[c]) < 1e-9);
+        TEST_ASSERT_TRUE(fabs(stats.variance[c] - variance[c]) < 1e-6);
+    }
+    free_integral(integral);
+}
+
+void test_region_sum_brute_force(void)
+{
+    FILE *fp = fopen("data/tests/test_region_sum_brute_force.bmp", "rb");
+    struct bmp_image *image = read_bmp(fp);
+    struct bmp_integral *integral = build_integral(image);
+    struct slice_rect rects[] = {{0, 0, 256, 256}, {255, 255, 1, 1}, {17, 0, 1, 256}, {0, 200, 256, 3}};
+
+    fclose(fp);
+    for (size_t i = 0; i < sizeof(rects) / sizeof(rects[0]); i++)
+    {
+        struct slice_rect *rect = &rects[i];
+        struct bmp_image *view = crop(image, rect->start_y, rect->start_x, rect->height, rect->width);
+        uint64_t expected[CHANNELS] = {0}, sums[CHANNELS];
+        for (uint32_t row = 0; row < rect->height; row++)
+        {
+            const struct pixel *pixels = bmp_row(view, row);
+            for (uint32_t col = 0; col < rect->width; col++)
+            {
+                expected[CHANNEL_BLUE] += pixels[col].blue;
+                expected[CHANNEL_GREEN] += pixels[col].green;
+                expected[CHANNEL_RED] += pixels[col].red;
+            }
+        }
+
+        TEST_ASSERT_TRUE(region_sum(integral, rect, sums, NULL));
+        TEST_ASSERT_EQUAL(0, memcmp(expected, sums, sizeof(sums)));
+        free_bmp_image(view);
+    }
+    free_integral(integral);
+}
+
+void test_region_sum_invalid(void)
+{
+    FILE *fp = fopen("data/tests/test_region_sum_invalid.bmp", "rb");
+    struct bmp_image *image = read_bmp(fp);
+    struct bmp_integral *integral = build_integral(image);
+    struct slice_rect empty = {0, 0, 0, 3};
+    struct slice_rect outside = {1, 1, 2, 1};
+    struct slice_rect whole = {0, 0, 2, 3};
+    uint64_t sums[CHANNELS];
+
+    fclose(fp);
+    TEST_ASSERT_FALSE(region_sum(integral, &empty, sums, NULL));
+    TEST_ASSERT_FALSE(region_sum(integral, &outside, sums, NULL));
+    TEST_ASSERT_FALSE(region_sum(NULL, &whole, sums, NULL));
+    TEST_ASSERT_TRUE(region_sum(integral, &whole, sums, NULL));
+    free_integral(integral);
+}
+
+// TEST BOX BLUR
+// ================================================================================
+
+void test_integral_box_blur_copy(void)
+{
+    FILE *fp = fopen("data/tests/test_integral_box_blur_copy.bmp", "rb");
+    struct bmp_image *image = read_bmp(fp);
+    struct bmp_integral *integral = build_integral(image);
+    struct bmp_image *blurred = integral_box_blur(integral, 0);
+
+    fclose(fp);
+    for (uint32_t row = 0; row < 256; row++)
+    {
+        TEST_ASSERT_EQUAL(0, memcmp(bmp_row(image, row), bmp_row(blurred, row), 256 * sizeof(struct pixel)));
+    }
+    free_integral(integral);
+}
+
+void test_integral_box_blur_edges(void)
+{
+    FILE *fp = fopen("data/tests/test_integral_box_blur_edges.bmp", "rb");
+    struct bmp_image *image = read_bmp(fp);
+    struct bmp_integral *integral = build_integral(image);
+    struct bmp_image *blurred = integral_box_blur(integral, 2);
+    struct slice_rect corner = {0, 0, 3, 3};
+    struct slice_rect inside = {8, 38, 5, 5};
+    double mean[CHANNELS];
+
+    fclose(fp);
+    // window is cut by the top left corner, pixel [0,0] is in the top row
+    TEST_ASSERT_TRUE(region_mean(integral, &corner, mean, NULL));
+    TEST_ASSERT_EQUAL((int)lround(mean[CHANNEL_RED]), bmp_row(blurred, 255)[0].red);
+    TEST_ASSERT_EQUAL((int)lround(mean[CHANNEL_BLUE]), bmp_row(blurred, 255)[0].blue);
+    TEST_ASSERT_TRUE(region_mean(integral, &inside, mean, NULL));
+    TEST_ASSERT_EQUAL((int)lround(mean[CHANNEL_GREEN]), bmp_row(blurred, 245)[40].green);
+    free_integral(integral);
+}
+
+void setUp(void)
+{
+}
+
+void tearDown(void)
+{
+}
@@ -0,0 +1,167 @@
+#include "../unity/src/unity.h"
+
+#include <string.h>
+
+#include "overlay.h"
+#include "bmp.h"
+
+void setUp(void);
+void tearDown(void);
+
+void test_read_overlay_alpha(void);
+void test_read_overlay_unused_alpha(void);
+void test_key_overlay_drops_color(void);
+
+void test_overlay_inplace_blend(void);
+void test_overlay_inplace_clip(void);
+
+uint8_t blend_channel(uint8_t src, uint8_t dst, uint8_t alpha, uint8_t opacity);
+
+int main(void)
+{
+    UNITY_BEGIN();
+
+    RUN_TEST(test_read_overlay_alpha);
+    RUN_TEST(test_read_overlay_unused_alpha);
+    RUN_TEST(test_key_overlay_drops_color);
+
+    RUN_TEST(test_overlay_inplace_blend);
+    RUN_TEST(test_overlay_inplace_clip);
+
+    return UNITY_END();
+}
+
+// TEST READ
+// ================================================================================
+
+void test_read_overlay_alpha(void)
+{
+    FILE *fp = fopen("data/tests/test_read_overlay_alpha.bmp", "rb");
+    struct bmp_overlay *overlay = read_overlay(fp);
+    const uint8_t expected[] = {0, 64, 128, 255, 255, 200, 100, 1};
+
+    fclose(fp);
+    TEST_ASSERT_NOT_NULL(overlay);
+    TEST_ASSERT_EQUAL(24, overlay->image->header->bpp);
+    TEST_ASSERT_EQUAL(0, memcmp(expected, overlay->alpha, sizeof(expected)));
+    TEST_ASSERT_EQUAL(70, bmp_row(overlay->image, 0)[2].blue);
+    TEST_ASSERT_EQUAL(90, bmp_row(overlay->image, 0)[2].red);
+    TEST_ASSERT_EQUAL(12, bmp_row(overlay->image, 1)[2].green);
+    free_overlay(overlay);
+}
+
+void test_read_overlay_unused_alpha(void)
+{
+    FILE *fp = fopen("data/tests/test_read_overlay_unused_alpha.bmp", "rb");
+    struct bmp_overlay *overlay = read_overlay(fp);
+
+    fclose(fp);
+    TEST_ASSERT_NOT_NULL(overlay);
+    for (int i = 0; i < 6; i++)
+    {
+        TEST_ASSERT_EQUAL(UINT8_MAX, overlay->alpha[i]);
+    }
+    TEST_ASSERT_NULL(read_overlay(NULL));
+    free_overlay(overlay);
+}
+
+void test_key_overlay_drops_color(void)
+{
+    FILE *fp = fopen("data/tests/test_key_overlay_drops_color.bmp", "rb");
+    struct bmp_overlay *overlay = read_overlay(fp);
+    const uint8_t expected[] = {0, 255, 0, 255, 0, 255};
+
+    fclose(fp);
+    TEST_ASSERT_NOT_NULL(overlay);
+    key_overlay(overlay, (struct pixel){255, 0, 255});
+    TEST_ASSERT_EQUAL(0, memcmp(expected, overlay->alpha, sizeof(expected)));
+    free_overlay(overlay);
+}
+
+// TEST BLEND
+// ================================================================================
+
+void test_overlay_inplace_blend(void)
+{
+    FILE *fp = fopen("data/tests/test_overlay_inplace_blend.bmp", "rb");
+    struct bmp_overlay *overlay = read_overlay(fp);
+    struct bmp_image *original = overlay->image;
+    struct bmp_image *image = copy_bmp(original);
+
+    fclose(fp);
+    // overlay shifted by one pixel right and down over its own colors
+    TEST_ASSERT_TRUE(overlay_inplace(image, overlay, 1, 1, 200));
+    for (uint32_t y = 0; y < 6; y++)
+    {
+        const struct pixel *dst = bmp_row(original, 5 - y);
+        const struct pixel *out = bmp_row(image, 5 - y);
+        for (uint32_t x = 0; x < 40; x++)
+        {
+            if (x == 0 || y == 0)
+            {
+                TEST_ASSERT_EQUAL(0, memcmp(&dst[x], &out[x], sizeof(struct pixel)));
+                continue;
+            }
+            const struct pixel *src = bmp_row(original, 6 - y) + x - 1;
+            uint8_t alpha = overlay->alpha[(size_t)(6 - y) * 40 + x - 1];
+            TEST_ASSERT_EQUAL(blend_channel(src->blue, dst[x].blue, alpha, 200), out[x].blue);
+            TEST_ASSERT_EQUAL(blend_channel(src->green, dst[x].green, alpha, 200), out[x].green);
+            TEST_ASSERT_EQUAL(blend_channel(src->red, dst[x].red, alpha, 200), out[x].red);
+        }
+    }
+    free_bmp_image(image);
+    free_overlay(overlay);
+}
+
+void test_overlay_inplace_clip(void)
+{
+    FILE *fp = fopen("data/tests/test_overlay_inplace_clip.bmp", "rb");
+    struct bmp_overlay *overlay = read_overlay(fp);
+    struct bmp_image *image = copy_bmp(overlay->image);
+
+    fclose(fp);
+    // nothing overlaps or nothing is visible
+    TEST_ASSERT_TRUE(overlay_inplace(image, overlay, -40, 0, UINT8_MAX));
+    TEST_ASSERT_TRUE(overlay_inplace(image, overlay, 0, 6, UINT8_MAX));
+    TEST_ASSERT_TRUE(overlay_inplace(image, overlay, 3, 2, 0));
+    for (uint32_t row = 0; row < 6; row++)
+    {
+        TEST_ASSERT_EQUAL(0, memcmp(bmp_row(overlay->image, row), bmp_row(image, row), 40 * sizeof(struct pixel)));
+    }
+
+    // only the top left corner is covered by the bottom right corner of the overlay
+    TEST_ASSERT_TRUE(overlay_inplace(image, overlay, -37, -4, UINT8_MAX));
+    for (uint32_t y = 0; y < 6; y++)
+    {
+        const struct pixel *dst = bmp_row(overlay->image, 5 - y);
+        const struct pixel *out = bmp_row(image, 5 - y);
+        for (uint32_t x = 0; x < 40; x++)
+        {
+            if (x >= 3 || y >= 2)
+            {
+                TEST_ASSERT_EQUAL(0, memcmp(&dst[x], &out[x], sizeof(struct pixel)));
+                continue;
+            }
+            const struct pixel *src = bmp_row(overlay->image, 1 - y) + x + 37;
+            uint8_t alpha = overlay->alpha[(size_t)(1 - y) * 40 + x + 37];
+            TEST_ASSERT_EQUAL(blend_channel(src->red, dst[x].red, alpha, UINT8_MAX), out[x].red);
+        }
+    }
+    TEST_ASSERT_FALSE(overlay_inplace(NULL, overlay, 0, 0, UINT8_MAX));
+    free_bmp_image(image);
+    free_overlay(overlay);
+}
+
+uint8_t blend_channel(uint8_t src, uint8_t dst, uint8_t alpha, uint8_t opacity)
+{
+    unsigned a = (alpha * opacity + 127) / 255;
+    return (uint8_t)((src * a + dst * (255 - a) + 127) / 255);
+}
+
+void setUp(void)
+{
+}
+
+void tearDown(void)
+{
+}
@@ -0,0 +1,113 @@
+#include "../unity/src/unity.h"
+
+#include <string.h>
+
+#include "pipeline.h"
+
+#define IMAGES 50
+
+/* images seen by the stages */
+struct trace
+{
+    const char *path;
+    size_t fail_at;
+    size_t written[IMAGES];
+    size_t count;
+    bool ordered;
+};
+
+void setUp(void);
+void tearDown(void);
+
+struct bmp_image *read_tagged(void *ctx, size_t index, struct bmp_image *spare, struct timespec *started);
+struct bmp_image *invert_tag(void *ctx, size_t index, struct bmp_image *image);
+bool record_tag(void *ctx, size_t index, const struct bmp_image *image, const struct timespec *started);
+
+void test_run_pipeline_keeps_order(void);
+void test_run_pipeline_transform_failure(void);
+
+int main(void)
+{
+    UNITY_BEGIN();
+
+    RUN_TEST(test_run_pipeline_keeps_order);
+    RUN_TEST(test_run_pipeline_transform_failure);
+
+    return UNITY_END();
+}
+
+struct bmp_image *read_tagged(void *ctx, size_t index, struct bmp_image *spare, struct timespec *started)
+{
+    const struct trace *trace = ctx;
+    (void)started;
+
+    free_bmp_image(spare);
+    if (index == IMAGES)
+    {
+        return NULL;
+    }
+
+    FILE *fp = fopen(trace->path, "rb");
+    struct bmp_image *image = read_bmp(fp);
+    fclose(fp);
+    image->data[0].red = (uint8_t)index;
+    return image;
+}
+
+struct bmp_image *invert_tag(void *ctx, size_t index, struct bmp_image *image)
+{
+    const struct trace *trace = ctx;
+    if (index == trace->fail_at)
+    {
+        free_bmp_image(image);
+        return NULL;
+    }
+
+    image->data[0].red = (uint8_t)~image->data[0].red;
+    return image;
+}
+
+bool record_tag(void *ctx, size_t index, const struct bmp_image *image, const struct timespec *started)
+{
+    struct trace *trace = ctx;
+    (void)started;
+
+    trace->ordered = trace->ordered && index == trace->count;
+    trace->written[trace->count++] = (uint8_t)~image->data[0].red;
+    return true;
+}
+
+// TEST STAGES
+// ================================================================================
+
+void test_run_pipeline_keeps_order(void)
+{
+    struct trace trace = {"data/tests/test_run_pipeline_keeps_order.bmp", IMAGES, {0}, 0, true};
+    struct pipeline_stages stages = {read_tagged, invert_tag, record_tag, &trace};
+
+    TEST_ASSERT_TRUE(run_pipeline(&stages, 2));
+    TEST_ASSERT_EQUAL(IMAGES, trace.count);
+    TEST_ASSERT_TRUE(trace.ordered);
+    for (size_t i = 0; i < IMAGES; i++)
+    {
+        TEST_ASSERT_EQUAL(i, trace.written[i]);
+    }
+}
+
+void test_run_pipeline_transform_failure(void)
+{
+    struct trace trace = {"data/tests/test_run_pipeline_transform_failure.bmp", 3, {0}, 0, true};
+    struct pipeline_stages stages = {read_tagged, invert_tag, record_tag, &trace};
+
+    TEST_ASSERT_FALSE(run_pipeline(&stages, 1));
+    TEST_ASSERT_EQUAL(3, trace.count);
+    TEST_ASSERT_TRUE(trace.ordered);
+}
+
+void setUp(void)
+{
+}
+
+void tearDown(void)
+{
+}
@@ -0,0 +1,136 @@
+#include "../unity/src/unity.h"
+
+#include <string.h>
+
+#include "planar.h"
+#include "transformations.h"
+#include "bmp.h"
+
+void setUp(void);
+void tearDown(void);
+
+void test_split_planes_round_trip(void);
+void test_split_planes_channels(void);
+
+void test_drop_planes_zeroes_channel(void);
+void test_drop_planes_invalid_color(void);
+
+void test_apply_planes_lut(void);
+
+int main(void)
+{
+    UNITY_BEGIN();
+
+    RUN_TEST(test_split_planes_round_trip);
+    RUN_TEST(test_split_planes_channels);
+
+    RUN_TEST(test_drop_planes_zeroes_channel);
+    RUN_TEST(test_drop_planes_invalid_color);
+
+    RUN_TEST(test_apply_planes_lut);
+
+    return UNITY_END();
+}
+
+// TEST SPLIT
+// ================================================================================
+
+void test_split_planes_round_trip(void)
+{
+    FILE *fp = fopen("data/tests/test_split_planes_round_trip.bmp", "rb");
+    struct bmp_image *image = read_bmp(fp);
+    struct bmp_image *view = crop(image, 3, 5, 100, 77);
+    struct bmp_planes *planes = split_planes(view);
+    struct bmp_image *merged = merge_planes(planes);
+
+    fclose(fp);
+    TEST_ASSERT_EQUAL(77, merged->header->width);
+    TEST_ASSERT_EQUAL(100, merged->header->height);
+    for (uint32_t row = 0; row < 100; row++)
+    {
+        TEST_ASSERT_EQUAL(0, memcmp(bmp_row(view, row), bmp_row(merged, row), 77 * sizeof(struct pixel)));
+    }
+}
+
+void test_split_planes_channels(void)
+{
+    FILE *fp = fopen("data/tests/test_split_planes_channels.bmp", "rb");
+    struct bmp_image *image = read_bmp(fp);
+    struct bmp_planes *planes = split_planes(image);
+    uint32_t width = image->header->width;
+
+    fclose(fp);
+    for (uint32_t row = 0; row < image->header->height; row += 17)
+    {
+        for (uint32_t col = 0; col < width; col += 5)
+        {
+            struct pixel pixel = bmp_row(image, row)[col];
+            TEST_ASSERT_EQUAL(pixel.blue, planes->blue[row * width + col]);
+            TEST_ASSERT_EQUAL(pixel.green, planes->green[row * width + col]);
+            TEST_ASSERT_EQUAL(pixel.red, planes->red[row * width + col]);
+        }
+    }
+}
+
+// TEST DROP
+// ================================================================================
+
+void test_drop_planes_zeroes_channel(void)
+{
+    FILE *fp = fopen("data/tests/test_drop_planes_zeroes_channel.bmp", "rb");
+    struct bmp_image *image = read_bmp(fp);
+    struct bmp_planes *planes = split_planes(image);
+
+    fclose(fp);
+    TEST_ASSERT_TRUE(drop_planes(planes, "gr"));
+    TEST_ASSERT_NULL(planes->blue);
+
+    struct bmp_image *merged = merge_planes(planes);
+    struct bmp_image *extracted = extract(image, "gr");
+    for (uint32_t row = 0; row < image->header->height; row++)
+    {
+        TEST_ASSERT_EQUAL(0, memcmp(bmp_row(extracted, row), bmp_row(merged, row), image->header->width * sizeof(struct pixel)));
+    }
+}
+
+void test_drop_planes_invalid_color(void)
+{
+    struct bmp_planes planes = {.blue = NULL};
+
+    TEST_ASSERT_FALSE(drop_planes(&planes, "rgx"));
+    TEST_ASSERT_FALSE(drop_planes(NULL, "r"));
+}
+
+// TEST LUT
+// ================================================================================
+
+void test_apply_planes_lut(void)
+{
+    FILE *fp = fopen("data/tests/test_apply_planes_lut.bmp", "rb");
+    struct bmp_image *image = read_bmp(fp);
+    struct bmp_planes *planes = split_planes(image);
+    struct color_lut lut;
+
+    fclose(fp);
+    for (int v = 0; v < 256; v++)
+    {
+        lut.blue[v] = (uint8_t)(255 - v);
+        lut.green[v] = (uint8_t)v;
+        lut.red[v] = 0;
+    }
+    apply_planes_lut(planes, &lut);
+
+    struct pixel pixel = bmp_row(image, 9)[11];
+    size_t i = 9 * image->header->width + 11;
+    TEST_ASSERT_EQUAL(255 - pixel.blue, planes->blue[i]);
+    TEST_ASSERT_EQUAL(pixel.green, planes->green[i]);
+    TEST_ASSERT_EQUAL(0, planes->red[i]);
+}
+
+void setUp(void)
+{
+}
+
+void tearDown(void)
+{
+}
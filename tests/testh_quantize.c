@@ -0,0 +1,208 @@
+#include "../unity/src/unity.h"
+
+#include <math.h>
+#include <string.h>
+
+#include "quantize.h"
+#include "bmp.h"
+
+void setUp(void);
+void tearDown(void);
+
+void test_build_palette_few_colors(void);
+void test_build_palette_invalid(void);
+
+void test_quantize_near_nearest(void);
+void test_quantize_dither_keeps_mean(void);
+
+void test_write_indexed_bmp(void);
+
+double color_distance(struct pixel a, struct pixel b);
+double mean_gray(const struct bmp_indexed *indexed);
+
+int main(void)
+{
+    UNITY_BEGIN();
+
+    RUN_TEST(test_build_palette_few_colors);
+    RUN_TEST(test_build_palette_invalid);
+
+    RUN_TEST(test_quantize_near_nearest);
+    RUN_TEST(test_quantize_dither_keeps_mean);
+
+    RUN_TEST(test_write_indexed_bmp);
+
+    return UNITY_END();
+}
+
+// TEST PALETTE
+// ================================================================================
+
+void test_build_palette_few_colors(void)
+{
+    FILE *fp = fopen("data/tests/test_build_palette_few_colors.bmp", "rb");
+    struct bmp_image *image = read_bmp(fp);
+    struct bmp_palette palette;
+
+    fclose(fp);
+    // every color gets its own entry and pixels keep their colors
+    TEST_ASSERT_TRUE(build_palette(image, PALETTE_SIZE, &palette));
+    TEST_ASSERT_EQUAL(5, palette.count);
+
+    struct bmp_indexed *indexed = quantize(image, &palette, DITHER_NONE);
+    TEST_ASSERT_NOT_NULL(indexed);
+    for (uint32_t row = 0; row < 2; row++)
+    {
+        for (uint32_t col = 0; col < 3; col++)
+        {
+            const struct pixel *color = &palette.colors[indexed->indices[row * 3 + col]];
+            TEST_ASSERT_EQUAL(0, memcmp(&bmp_row(image, row)[col], color, sizeof(struct pixel)));
+        }
+    }
+    free_indexed(indexed);
+    free_bmp_image(image);
+}
+
+void test_build_palette_invalid(void)
+{
+    FILE *fp = fopen("data/tests/test_build_palette_invalid.bmp", "rb");
+    struct bmp_image *image = read_bmp(fp);
+    struct bmp_palette palette = {0};
+
+    fclose(fp);
+    TEST_ASSERT_FALSE(build_palette(image, 0, &palette));
+    TEST_ASSERT_FALSE(build_palette(image, PALETTE_SIZE + 1, &palette));
+    TEST_ASSERT_FALSE(build_palette(NULL, 16, &palette));
+    TEST_ASSERT_NULL(quantize(image, &palette, DITHER_NONE));
+
+    TEST_ASSERT_TRUE(build_palette(image, 2, &palette));
+    TEST_ASSERT_EQUAL(2, palette.count);
+    free_bmp_image(image);
+}
+
+// TEST MAPPING
+// ================================================================================
+
+void test_quantize_near_nearest(void)
+{
+    FILE *fp = fopen("data/tests/test_quantize_near_nearest.bmp", "rb");
+    struct bmp_image *image = read_bmp(fp);
+    struct bmp_palette palette;
+
+    fclose(fp);
+    TEST_ASSERT_TRUE(build_palette(image, 16, &palette));
+    struct bmp_indexed *indexed = quantize(image, &palette, DITHER_NONE);
+
+    // lookup by cell center strays from the nearest entry at most by the distance to the center twice
+    double slack = 2 * sqrt(3 * 4 * 4);
+    for (uint32_t row = 0; row < 256; row++)
+    {
+        const struct pixel *pixels = bmp_row(image, row);
+        for (uint32_t col = 0; col < 256; col++)
+        {
+            double best = INFINITY;
+            for (uint32_t i = 0; i < palette.count; i++)
+            {
+                best = fmin(best, color_distance(pixels[col], palette.colors[i]));
+            }
+            uint8_t entry = indexed->indices[row * 256 + col];
+            TEST_ASSERT_TRUE(entry < palette.count);
+            TEST_ASSERT_TRUE(color_distance(pixels[col], palette.colors[entry]) <= best + slack);
+        }
+    }
+    free_indexed(indexed);
+    free_bmp_image(image);
+}
+
+void test_quantize_dither_keeps_mean(void)
+{
+    FILE *fp = fopen("data/tests/test_quantize_dither_keeps_mean.bmp", "rb");
+    struct bmp_image *image = read_bmp(fp);
+    struct bmp_palette palette = {2, {{0, 0, 0}, {255, 255, 255}}};
+
+    fclose(fp);
+    TEST_ASSERT_TRUE(bmp_make_writable(image));
+    for (uint32_t row = 0; row < 256; row++)
+    {
+        for (uint32_t col = 0; col < 256; col++)
+        {
+            bmp_row(image, row)[col] = (struct pixel){100, 100, 100};
+        }
+    }
+
+    // flat gray between the only two entries is dithered into a mixture of the same brightness
+    struct bmp_indexed *plain = quantize(image, &palette, DITHER_NONE);
+    struct bmp_indexed *ordered = quantize(image, &palette, DITHER_ORDERED);
+    struct bmp_indexed *diffused = quantize(image, &palette, DITHER_FLOYD_STEINBERG);
+    TEST_ASSERT_TRUE(mean_gray(plain) == 0);
+    TEST_ASSERT_TRUE(fabs(mean_gray(ordered) - 100) < 12);
+    TEST_ASSERT_TRUE(fabs(mean_gray(diffused) - 100) < 2);
+
+    free_indexed(plain);
+    free_indexed(ordered);
+    free_indexed(diffused);
+    free_bmp_image(image);
+}
+
+// TEST WRITE
+// ================================================================================
+
+void test_write_indexed_bmp(void)
+{
+    FILE *fp = fopen("data/tests/test_write_indexed_bmp.bmp", "rb");
+    struct bmp_image *image = read_bmp(fp);
+    struct bmp_palette palette;
+    FILE *stream = tmpfile();
+
+    fclose(fp);
+    TEST_ASSERT_TRUE(build_palette(image, 4, &palette));
+    struct bmp_indexed *indexed = quantize(image, &palette, DITHER_NONE);
+    TEST_ASSERT_TRUE(write_indexed_bmp(stream, indexed));
+    TEST_ASSERT_FALSE(write_indexed_bmp(stream, NULL));
+
+    // header, 4 palette entries and 2 rows of 3 indices padded to 4 bytes
+    uint8_t bytes[128];
+    rewind(stream);
+    size_t size = fread(bytes, 1, sizeof(bytes), stream);
+    struct bmp_header header;
+    memcpy(&header, bytes, sizeof(header));
+    TEST_ASSERT_EQUAL(54 + 16 + 8, size);
+    TEST_ASSERT_EQUAL(size, header.size);
+    TEST_ASSERT_EQUAL(54 + 16, header.offset);
+    TEST_ASSERT_EQUAL(8, header.bpp);
+    TEST_ASSERT_EQUAL(4, header.num_colors);
+    TEST_ASSERT_EQUAL(8, header.image_size);
+    TEST_ASSERT_EQUAL(palette.colors[1].green, bytes[54 + 4 + 1]);
+    TEST_ASSERT_EQUAL(0, bytes[54 + 4 + 3]);
+    TEST_ASSERT_EQUAL(indexed->indices[4], bytes[70 + 4 + 1]);
+    TEST_ASSERT_EQUAL(0, bytes[70 + 3]);
+
+    fclose(stream);
+    free_indexed(indexed);
+    free_bmp_image(image);
+}
+
+double color_distance(struct pixel a, struct pixel b)
+{
+    double db = a.blue - b.blue, dg = a.green - b.green, dr = a.red - b.red;
+    return sqrt(db * db + dg * dg + dr * dr);
+}
+
+double mean_gray(const struct bmp_indexed *indexed)
+{
+    double sum = 0;
+    size_t pixels = (size_t)indexed->header.width * indexed->header.height;
+    for (size_t i = 0; i < pixels; i++)
+    {
+        sum += indexed->palette.colors[indexed->indices[i]].green;
+    }
+    return sum / (double)pixels;
+}
+
+void setUp(void)
+{
+}
+
+void tearDown(void)
+{
+}
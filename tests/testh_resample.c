@@ -0,0 +1,115 @@
+#include "../unity/src/unity.h"
+
+#include "resample.h"
+#include "bmp.h"
+
+void setUp(void);
+void tearDown(void);
+
+void test_parse_resample_filter_known(void);
+void test_parse_resample_filter_unknown(void);
+
+void test_resample_null_image(void);
+void test_resample_new_image_size(void);
+void test_scale_filtered_new_image_size(void);
+
+void test_resample_keeps_mean(void);
+
+int main(void)
+{
+    UNITY_BEGIN();
+
+    RUN_TEST(test_parse_resample_filter_known);
+    RUN_TEST(test_parse_resample_filter_unknown);
+
+    RUN_TEST(test_resample_null_image);
+    RUN_TEST(test_resample_new_image_size);
+    RUN_TEST(test_scale_filtered_new_image_size);
+
+    RUN_TEST(test_resample_keeps_mean);
+
+    return UNITY_END();
+}
+
+// TEST FILTER NAMES
+// ================================================================================
+
+void test_parse_resample_filter_known(void)
+{
+    enum resample_filter filter = FILTER_NEAREST;
+
+    TEST_ASSERT_TRUE(parse_resample_filter("lanczos", &filter));
+    TEST_ASSERT_EQUAL(FILTER_LANCZOS, filter);
+}
+
+void test_parse_resample_filter_unknown(void)
+{
+    enum resample_filter filter = FILTER_NEAREST;
+
+    TEST_ASSERT_FALSE(parse_resample_filter("sinc", &filter));
+    TEST_ASSERT_EQUAL(FILTER_NEAREST, filter);
+}
+
+// TEST RESAMPLE
+// ================================================================================
+
+void test_resample_null_image(void)
+{
+    struct bmp_image *resampled_image = resample(NULL, 2, 2, FILTER_BILINEAR);
+
+    TEST_ASSERT_NULL(resampled_image);
+}
+
+void test_resample_new_image_size(void)
+{
+    FILE *fp = fopen("data/tests/test_resample_new_image_size.bmp", "rb");
+    struct bmp_image *image = read_bmp(fp);
+    struct bmp_image *resampled_image = resample(image, 3, 2, FILTER_BICUBIC);
+
+    fclose(fp);
+    TEST_ASSERT_EQUAL(3, resampled_image->header->width);
+    TEST_ASSERT_EQUAL(2, resampled_image->header->height);
+    TEST_ASSERT_EQUAL(24, resampled_image->header->image_size);
+}
+
+void test_scale_filtered_new_image_size(void)
+{
+    FILE *fp = fopen("data/tests/test_scale_filtered_new_image_size.bmp", "rb");
+    struct bmp_image *image = read_bmp(fp);
+    struct bmp_image *scaled_image = scale_filtered(image, 0.5f, FILTER_LANCZOS);
+
+    fclose(fp);
+    TEST_ASSERT_EQUAL(16, scaled_image->header->width);
+    TEST_ASSERT_EQUAL(16, scaled_image->header->height);
+}
+
+void test_resample_keeps_mean(void)
+{
+    FILE *fp = fopen("data/tests/test_resample_keeps_mean.bmp", "rb");
+    struct bmp_image *image = read_bmp(fp);
+    struct bmp_image *resampled_image = resample(image, 64, 64, FILTER_BOX);
+
+    fclose(fp);
+
+    // exact 4x4 box average, mean of the channel is kept up to rounding
+    uint64_t sum = 0;
+    uint64_t resampled_sum = 0;
+    for (uint32_t i = 0; i < 256 * 256; i++)
+    {
+        sum += image->data[i].green;
+    }
+    for (uint32_t i = 0; i < 64 * 64; i++)
+    {
+        resampled_sum += resampled_image->data[i].green;
+    }
+    int64_t diff = (int64_t)(sum / 16) - (int64_t)resampled_sum;
+    TEST_ASSERT_TRUE(diff > -64 * 64 && diff < 64 * 64);
+}
+
+void setUp(void)
+{
+}
+
+void tearDown(void)
+{
+}
@@ -0,0 +1,69 @@
+#include "../unity/src/unity.h"
+
+#include <string.h>
+
+#include "server.h"
+
+void setUp(void);
+void tearDown(void);
+
+bool count_words(void *ctx, char **args, size_t count, char *error, size_t size);
+
+void test_serve_stream_answers_in_order(void);
+
+int main(void)
+{
+    UNITY_BEGIN();
+
+    RUN_TEST(test_serve_stream_answers_in_order);
+
+    return UNITY_END();
+}
+
+bool count_words(void *ctx, char **args, size_t count, char *error, size_t size)
+{
+    (void)ctx;
+    snprintf(error, size, "%zu words from %s", count, args[0]);
+    return count == 2;
+}
+
+// TEST PROTOCOL
+// ================================================================================
+
+void test_serve_stream_answers_in_order(void)
+{
+    FILE *input = tmpfile();
+    FILE *output = tmpfile();
+    char answers[128] = "";
+
+    for (int i = 0; i < 40; i++)
+    {
+        fputs("-i first\n", input);
+    }
+    fputs("\n-r  second\tthird\n-x fourth\n", input);
+    rewind(input);
+
+    TEST_ASSERT_TRUE(serve_stream(input, output, count_words, NULL));
+    rewind(output);
+    for (int i = 0; i < 40; i++)
+    {
+        fgets(answers, sizeof(answers), output);
+        TEST_ASSERT_EQUAL(0, strcmp("ok\n", answers));
+    }
+    fgets(answers, sizeof(answers), output);
+    TEST_ASSERT_EQUAL(0, strcmp("error 3 words from -r\n", answers));
+    fgets(answers, sizeof(answers), output);
+    TEST_ASSERT_EQUAL(0, strcmp("ok\n", answers));
+    TEST_ASSERT_NULL(fgets(answers, sizeof(answers), output));
+
+    fclose(input);
+    fclose(output);
+}
+
+void setUp(void)
+{
+}
+
+void tearDown(void)
+{
+}
@@ -0,0 +1,64 @@
+#include "../unity/src/unity.h"
+
+#include <stdlib.h>
+
+#include "slice.h"
+#include "bmp.h"
+
+void setUp(void);
+void tearDown(void);
+
+void test_slice_grid_edge_tiles(void);
+void test_read_slice_list(void);
+
+int main(void)
+{
+    UNITY_BEGIN();
+
+    RUN_TEST(test_slice_grid_edge_tiles);
+    RUN_TEST(test_read_slice_list);
+
+    return UNITY_END();
+}
+
+// TEST AREAS
+// ================================================================================
+
+void test_slice_grid_edge_tiles(void)
+{
+    FILE *fp = fopen("data/tests/test_slice_grid_edge_tiles.bmp", "rb");
+    struct bmp_image *image = read_bmp(fp);
+    struct slice_rect *rects = NULL;
+    size_t count = slice_grid(image, 100, 200, &rects);
+
+    fclose(fp);
+    TEST_ASSERT_EQUAL(6, count);
+    TEST_ASSERT_EQUAL(200, rects[2].start_x);
+    TEST_ASSERT_EQUAL(56, rects[2].width);
+    TEST_ASSERT_EQUAL(200, rects[5].start_y);
+    TEST_ASSERT_EQUAL(56, rects[5].height);
+    free(rects);
+}
+
+void test_read_slice_list(void)
+{
+    FILE *fp = fopen("data/tests/test_read_slice_list.txt", "r");
+    struct slice_rect *rects = NULL;
+    size_t count = read_slice_list(fp, &rects);
+
+    fclose(fp);
+    TEST_ASSERT_EQUAL(2, count);
+    TEST_ASSERT_EQUAL(16, rects[1].start_x);
+    TEST_ASSERT_EQUAL(32, rects[1].start_y);
+    TEST_ASSERT_EQUAL(8, rects[1].height);
+    TEST_ASSERT_EQUAL(4, rects[1].width);
+    free(rects);
+}
+
+void setUp(void)
+{
+}
+
+void tearDown(void)
+{
+}
@@ -0,0 +1,91 @@
+#include "../unity/src/unity.h"
+
+#include "stats.h"
+#include "color.h"
+#include "bmp.h"
+
+void setUp(void);
+void tearDown(void);
+
+void test_compute_stats_null_image(void);
+void test_compute_stats_unique_colors(void);
+void test_compute_stats_channel_range(void);
+
+void test_color_ops_equalize_full_range(void);
+
+int main(void)
+{
+    UNITY_BEGIN();
+
+    RUN_TEST(test_compute_stats_null_image);
+    RUN_TEST(test_compute_stats_unique_colors);
+    RUN_TEST(test_compute_stats_channel_range);
+
+    RUN_TEST(test_color_ops_equalize_full_range);
+
+    return UNITY_END();
+}
+
+// TEST STATISTICS
+// ================================================================================
+
+void test_compute_stats_null_image(void)
+{
+    struct bmp_stats stats;
+
+    TEST_ASSERT_FALSE(compute_stats(NULL, &stats));
+}
+
+void test_compute_stats_unique_colors(void)
+{
+    FILE *fp = fopen("data/tests/test_compute_stats_unique_colors.bmp", "rb");
+    struct bmp_image *image = read_bmp(fp);
+    struct bmp_stats stats;
+
+    fclose(fp);
+    TEST_ASSERT_TRUE(compute_stats(image, &stats));
+    TEST_ASSERT_EQUAL(65536, stats.pixels);
+    TEST_ASSERT_EQUAL(31840, stats.unique_colors);
+}
+
+void test_compute_stats_channel_range(void)
+{
+    FILE *fp = fopen("data/tests/test_compute_stats_channel_range.bmp", "rb");
+    struct bmp_image *image = read_bmp(fp);
+    struct bmp_stats stats;
+
+    fclose(fp);
+    compute_stats(image, &stats);
+    TEST_ASSERT_EQUAL(15, stats.min[CHANNEL_BLUE]);
+    TEST_ASSERT_EQUAL(224, stats.max[CHANNEL_BLUE]);
+    TEST_ASSERT_FLOAT_WITHIN(0.001, 104.522, stats.mean[CHANNEL_BLUE]);
+}
+
+// TEST TRANSFORMS
+// ================================================================================
+
+void test_color_ops_equalize_full_range(void)
+{
+    FILE *fp = fopen("data/tests/test_color_ops_equalize_full_range.bmp", "rb");
+    struct bmp_image *image = read_bmp(fp);
+    struct bmp_stats stats;
+    struct color_ops ops;
+
+    fclose(fp);
+    compute_stats(image, &stats);
+    color_ops_init(&ops);
+    color_ops_equalize(&ops, &stats);
+    struct bmp_image *equalized_image = apply_color_ops(image, &ops);
+    compute_stats(equalized_image, &stats);
+
+    TEST_ASSERT_EQUAL(0, stats.min[CHANNEL_RED]);
+    TEST_ASSERT_EQUAL(255, stats.max[CHANNEL_RED]);
+}
+
+void setUp(void)
+{
+}
+
+void tearDown(void)
+{
+}
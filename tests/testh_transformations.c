@@ -1,5 +1,7 @@
 #include "../unity/src/unity.h"
 
+#include <string.h>
+
 #include "transformations.h"
 #include "bmp.h"
 
@@ -22,9 +24,29 @@ void test_left_rotate_image_size1(void);
 void test_left_rotate_image_size2(void);
 void test_left_rotate_image_size3(void);
 
+void test_rotate_bounding_box(void);
+void test_rotate_quarter_turn_header_size(void);
+
+void test_rotate_180_matches_flips(void);
+void test_transpose_matches_rotate_flip(void);
+void test_transverse_matches_rotate_flip(void);
+
 void test_crop_new_image_size1(void);
 void test_crop_new_image_size2(void);
 void test_crop_new_image_size3(void);
+void test_crop_shares_pixels(void);
+void test_crop_view_rotate(void);
+void test_crop_outlives_image(void);
+
+void test_trim_finds_content(void);
+void test_trim_tolerance(void);
+void test_trim_uniform_image(void);
+
+void test_scale_integer_replicates(void);
+void test_scale_epx_new_image_size(void);
+void test_scale_epx_invalid_factor(void);
+
+bool same_image(const struct bmp_image *a, const struct bmp_image *b);
 
 int main(void)
 {
@@ -46,13 +68,47 @@ int main(void)
     RUN_TEST(test_left_rotate_image_size2);
     RUN_TEST(test_left_rotate_image_size3);
 
+    RUN_TEST(test_rotate_bounding_box);
+    RUN_TEST(test_rotate_quarter_turn_header_size);
+
+    RUN_TEST(test_rotate_180_matches_flips);
+    RUN_TEST(test_transpose_matches_rotate_flip);
+    RUN_TEST(test_transverse_matches_rotate_flip);
+
     RUN_TEST(test_crop_new_image_size1);
     RUN_TEST(test_crop_new_image_size2);
     RUN_TEST(test_crop_new_image_size3);
+    RUN_TEST(test_crop_shares_pixels);
+    RUN_TEST(test_crop_view_rotate);
+    RUN_TEST(test_crop_outlives_image);
+
+    RUN_TEST(test_trim_finds_content);
+    RUN_TEST(test_trim_tolerance);
+    RUN_TEST(test_trim_uniform_image);
+
+    RUN_TEST(test_scale_integer_replicates);
+    RUN_TEST(test_scale_epx_new_image_size);
+    RUN_TEST(test_scale_epx_invalid_factor);
 
     return UNITY_END();
 }
 
+bool same_image(const struct bmp_image *a, const struct bmp_image *b)
+{
+    if (a->header->width != b->header->width || a->header->height != b->header->height)
+    {
+        return false;
+    }
+    for (uint32_t row = 0; row < a->header->height; row++)
+    {
+        if (memcmp(bmp_row(a, row), bmp_row(b, row), a->header->width * sizeof(struct pixel)) != 0)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
 // TEST RIGHT ROTATE
 // ================================================================================
 
@@ -179,6 +235,71 @@ void test_left_rotate_image_size3(void)
     TEST_ASSERT_EQUAL(32, rotated_image->header->image_size);
 }
 
+// TEST ROTATE
+// ================================================================================
+
+void test_rotate_bounding_box(void)
+{
+    FILE *fp = fopen("data/tests/test_rotate_bounding_box.bmp", "rb");
+    struct bmp_image *image = read_bmp(fp);
+    struct pixel fill_color = {0, 0, 0};
+    struct bmp_image *rotated_image = rotate(image, 0.7f, fill_color, FILTER_BILINEAR);
+
+    fclose(fp);
+    TEST_ASSERT_EQUAL(260, rotated_image->header->width);
+    TEST_ASSERT_EQUAL(260, rotated_image->header->height);
+}
+
+void test_rotate_quarter_turn_header_size(void)
+{
+    FILE *fp = fopen("data/tests/test_rotate_quarter_turn_header_size.bmp", "rb");
+    struct bmp_image *image = read_bmp(fp);
+    struct pixel fill_color = {0, 0, 0};
+    struct bmp_image *rotated_image = rotate(image, -270.0f, fill_color, FILTER_NEAREST);
+
+    fclose(fp);
+    TEST_ASSERT_EQUAL(78, rotated_image->header->size);
+}
+
+// TEST ORIENTATIONS
+// ================================================================================
+
+void test_rotate_180_matches_flips(void)
+{
+    FILE *fp = fopen("data/tests/test_rotate_180_matches_flips.bmp", "rb");
+    struct bmp_image *image = read_bmp(fp);
+    struct bmp_image *view = crop(image, 3, 5, 100, 77);
+    struct bmp_image *expected = flip_vertically(view);
+
+    fclose(fp);
+    TEST_ASSERT_TRUE(flip_horizontally_inplace(expected));
+    TEST_ASSERT_TRUE(same_image(expected, rotate_180(view)));
+}
+
+void test_transpose_matches_rotate_flip(void)
+{
+    FILE *fp = fopen("data/tests/test_transpose_matches_rotate_flip.bmp", "rb");
+    struct bmp_image *image = read_bmp(fp);
+    struct bmp_image *view = crop(image, 3, 5, 100, 77);
+    struct bmp_image *expected = rotate_right(view);
+
+    fclose(fp);
+    TEST_ASSERT_TRUE(flip_horizontally_inplace(expected));
+    TEST_ASSERT_TRUE(same_image(expected, transpose(view)));
+}
+
+void test_transverse_matches_rotate_flip(void)
+{
+    FILE *fp = fopen("data/tests/test_transverse_matches_rotate_flip.bmp", "rb");
+    struct bmp_image *image = read_bmp(fp);
+    struct bmp_image *view = crop(image, 3, 5, 100, 77);
+    struct bmp_image *expected = rotate_right(view);
+
+    fclose(fp);
+    TEST_ASSERT_TRUE(flip_vertically_inplace(expected));
+    TEST_ASSERT_TRUE(same_image(expected, transverse(view)));
+}
+
 // TEST CROP
 // ================================================================================
 
@@ -212,6 +333,144 @@ void test_crop_new_image_size3(void)
     TEST_ASSERT_EQUAL(8, cropped_image->header->image_size);
 }
 
+void test_crop_shares_pixels(void)
+{
+    FILE *fp = fopen("data/tests/test_crop_shares_pixels.bmp", "rb");
+    struct bmp_image *image = read_bmp(fp);
+    struct bmp_image *cropped_image = crop(image, 10, 20, 30, 40);
+
+    fclose(fp);
+    TEST_ASSERT_TRUE(cropped_image->buffer == image->buffer);
+    TEST_ASSERT_EQUAL(image->stride, cropped_image->stride);
+    TEST_ASSERT_TRUE(bmp_row(cropped_image, 29) == bmp_row(image, 255 - 10) + 20);
+}
+
+void test_crop_view_rotate(void)
+{
+    FILE *fp = fopen("data/tests/test_crop_view_rotate.bmp", "rb");
+    struct bmp_image *image = read_bmp(fp);
+    struct bmp_image *cropped_image = crop(image, 0, 0, 2, 3);
+    struct bmp_image *rotated_image = rotate_right(cropped_image);
+
+    fclose(fp);
+    TEST_ASSERT_EQUAL(2, rotated_image->header->width);
+    TEST_ASSERT_EQUAL(0, memcmp(&rotated_image->data[0], &bmp_row(image, 254)[2], sizeof(struct pixel)));
+}
+
+void test_crop_outlives_image(void)
+{
+    FILE *fp = fopen("data/tests/test_crop_outlives_image.bmp", "rb");
+    struct bmp_image *image = read_bmp(fp);
+    struct bmp_image *cropped_image = crop(image, 0, 0, 2, 3);
+    struct pixel expected = bmp_row(image, 254)[2];
+
+    fclose(fp);
+    free_bmp_image(image);
+    TEST_ASSERT_TRUE(flip_horizontally_inplace(cropped_image));
+    TEST_ASSERT_EQUAL(0, memcmp(&bmp_row(cropped_image, 0)[0], &expected, sizeof(struct pixel)));
+}
+
+// TEST TRIM
+// ================================================================================
+
+void test_trim_finds_content(void)
+{
+    FILE *fp = fopen("data/tests/test_trim_finds_content.bmp", "rb");
+    struct bmp_image *image = read_bmp(fp);
+    for (uint32_t row = 0; row < 256; row++)
+    {
+        for (uint32_t col = 0; col < 256; col++)
+        {
+            bmp_row(image, row)[col] = (struct pixel){200, 210, 220};
+        }
+    }
+    // content spans rows 20 to 99 from the top and columns 17 to 230
+    bmp_row(image, 235)[100].green = 0;
+    bmp_row(image, 156)[17].blue = 0;
+    bmp_row(image, 200)[230].red = 0;
+    struct bmp_image *trimmed = trim(image, 0);
+
+    fclose(fp);
+    TEST_ASSERT_EQUAL(214, trimmed->header->width);
+    TEST_ASSERT_EQUAL(80, trimmed->header->height);
+    TEST_ASSERT_EQUAL(0, bmp_row(trimmed, 79)[83].green);
+    TEST_ASSERT_EQUAL(0, bmp_row(trimmed, 0)[0].blue);
+    TEST_ASSERT_EQUAL(0, bmp_row(trimmed, 44)[213].red);
+}
+
+void test_trim_tolerance(void)
+{
+    FILE *fp = fopen("data/tests/test_trim_tolerance.bmp", "rb");
+    struct bmp_image *image = read_bmp(fp);
+    for (uint32_t row = 0; row < 256; row++)
+    {
+        for (uint32_t col = 0; col < 256; col++)
+        {
+            bmp_row(image, row)[col] = (struct pixel){100, 100, 100};
+        }
+    }
+    bmp_row(image, 128)[128].red = 110;
+    bmp_row(image, 3)[250].green = 95;
+
+    fclose(fp);
+    TEST_ASSERT_EQUAL(123, trim(image, 0)->header->width);
+    TEST_ASSERT_EQUAL(1, trim(image, 5)->header->width);
+    TEST_ASSERT_EQUAL(256, trim(image, 10)->header->width);
+}
+
+void test_trim_uniform_image(void)
+{
+    FILE *fp = fopen("data/tests/test_trim_uniform_image.bmp", "rb");
+    struct bmp_image *image = read_bmp(fp);
+    for (uint32_t row = 0; row < 2; row++)
+    {
+        for (uint32_t col = 0; col < 3; col++)
+        {
+            bmp_row(image, row)[col] = (struct pixel){1, 2, 3};
+        }
+    }
+    struct bmp_image *trimmed = trim(image, 0);
+
+    fclose(fp);
+    TEST_ASSERT_EQUAL(3, trimmed->header->width);
+    TEST_ASSERT_EQUAL(2, trimmed->header->height);
+    TEST_ASSERT_NULL(trim(NULL, 0));
+}
+
+void test_scale_integer_replicates(void)
+{
+    FILE *fp = fopen("data/tests/test_scale_integer_replicates.bmp", "rb");
+    struct bmp_image *image = read_bmp(fp);
+    struct bmp_image *scaled_image = scale_integer(image, 3);
+
+    fclose(fp);
+    TEST_ASSERT_EQUAL(96, scaled_image->header->width);
+    for (uint32_t i = 0; i < 9; i++)
+    {
+        TEST_ASSERT_EQUAL(0, memcmp(&bmp_row(scaled_image, 30 + i / 3)[15 + i % 3], &bmp_row(image, 10)[5], sizeof(struct pixel)));
+    }
+}
+
+void test_scale_epx_new_image_size(void)
+{
+    FILE *fp = fopen("data/tests/test_scale_epx_new_image_size.bmp", "rb");
+    struct bmp_image *image = read_bmp(fp);
+    struct bmp_image *scaled_image = scale_epx(image, 4);
+
+    fclose(fp);
+    TEST_ASSERT_EQUAL(128, scaled_image->header->width);
+    TEST_ASSERT_EQUAL(128, scaled_image->header->height);
+}
+
+void test_scale_epx_invalid_factor(void)
+{
+    FILE *fp = fopen("data/tests/test_scale_epx_invalid_factor.bmp", "rb");
+    struct bmp_image *image = read_bmp(fp);
+
+    fclose(fp);
+    TEST_ASSERT_NULL(scale_epx(image, 5));
+}
+
 void setUp(void)
 {
 }
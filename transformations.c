@@ -1,8 +1,15 @@
 #include <stdlib.h>
 #include <string.h>
 #include <math.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
 
 #include "transformations.h"
+#include "parallel.h"
 #include "bmp.h"
 
 // HELPER MACROS
@@ -16,11 +23,359 @@
         }                  \
     }
 
+#define FIXED_BITS 16 // rotation source coordinates in 16.16 fixed point
+#define FIXED_ONE ((int64_t)1 << FIXED_BITS)
+#define TILE_SIZE 64 // output tile edge in pixels
+#define MATCH_PIXELS 16 // pixels compared with border color at once, 48 bytes
+#define ROTATE_PIXELS 8 // output pixels of rotation gathered at once
+#define VECTOR_PIXELS 8 // source pixels upscaled at once, one in every 32-bit lane
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+/* arbitrary angle rotation shared by all bands */
+struct rotation
+{
+    const struct bmp_image *src;
+    struct bmp_image *dst;
+    struct pixel fill;
+    bool bilinear;
+    int64_t origin_x; // source position of output pixel [0, 0]
+    int64_t origin_y;
+    int64_t step_x_col; // source step per output column
+    int64_t step_y_col;
+    int64_t step_x_row; // source step per output row
+    int64_t step_y_row;
+};
+
+/* quarter turn or diagonal reflection shared by all bands */
+struct transposition
+{
+    const struct bmp_image *src;
+    struct bmp_image *dst;
+    bool reverse_rows; // output row r is read from source column width - 1 - r instead of r
+    bool reverse_cols; // output column c is read from source row height - 1 - c instead of c
+};
+
+/* half turn shared by all bands */
+struct half_turn
+{
+    const struct bmp_image *src;
+    struct bmp_image *dst;
+};
+
+/* border color of trim, repeated over 16 pixels */
+struct border_match
+{
+    struct pixel color;
+    uint8_t tolerance;
+#ifdef __SSE2__
+    __m128i pattern[3]; // channels of 16 pixels spread over three vectors
+    __m128i limit;      // tolerance in every byte
+#endif
+};
+
+/* integer upscaling shared by all bands */
+struct upscale
+{
+    const struct bmp_image *src;
+    struct bmp_image *dst;
+    uint32_t factor;
+};
+
+// HELPER DECLARATION
+// ================================================================================
+
+/**
+ * Rotate band of output rows tile by tile.
+ *
+ * @param ctx the `rotation` structure
+ * @param start first output row of the band
+ * @param end one past the last output row of the band
+ */
+void rotate_band(void *ctx, uint32_t start, uint32_t end);
+
+/**
+ * Fetch source pixel or fill color outside of the image.
+ *
+ * @param rotation the rotation
+ * @param col source column
+ * @param row source row
+ * @return the source pixel
+ */
+static inline struct pixel source_pixel(const struct rotation *rotation, int64_t col, int64_t row)
+{
+    uint32_t w = rotation->src->header->width;
+    uint32_t h = rotation->src->header->height;
+    if (col < 0 || row < 0 || col >= w || row >= h)
+    {
+        return rotation->fill;
+    }
+    return bmp_row(rotation->src, (uint32_t)row)[col];
+}
+
+/**
+ * Sample source image at output pixel.
+ *
+ * @param rotation the rotation
+ * @param x source column in fixed point
+ * @param y source row in fixed point
+ * @return the nearest or interpolated source pixel
+ */
+static inline struct pixel sample_pixel(const struct rotation *rotation, int64_t x, int64_t y)
+{
+    int64_t x0 = x >> FIXED_BITS; // arithmetic shift floors negative coordinates
+    int64_t y0 = y >> FIXED_BITS;
+    if (!rotation->bilinear)
+    {
+        return source_pixel(rotation, x0, y0);
+    }
+
+    // 8-bit interpolation weights
+    uint32_t fx = (uint32_t)(x >> (FIXED_BITS - 8)) & 0xFF;
+    uint32_t fy = (uint32_t)(y >> (FIXED_BITS - 8)) & 0xFF;
+    struct pixel p00 = source_pixel(rotation, x0, y0);
+    struct pixel p01 = source_pixel(rotation, x0 + 1, y0);
+    struct pixel p10 = source_pixel(rotation, x0, y0 + 1);
+    struct pixel p11 = source_pixel(rotation, x0 + 1, y0 + 1);
+
+    uint32_t w00 = (256 - fx) * (256 - fy);
+    uint32_t w01 = fx * (256 - fy);
+    uint32_t w10 = (256 - fx) * fy;
+    uint32_t w11 = fx * fy;
+    return (struct pixel){
+        (uint8_t)((p00.blue * w00 + p01.blue * w01 + p10.blue * w10 + p11.blue * w11 + 32768) >> 16),
+        (uint8_t)((p00.green * w00 + p01.green * w01 + p10.green * w10 + p11.green * w11 + 32768) >> 16),
+        (uint8_t)((p00.red * w00 + p01.red * w01 + p10.red * w10 + p11.red * w11 + 32768) >> 16),
+    };
+}
+
+#ifdef __AVX2__
+/**
+ * Sample source image at `ROTATE_PIXELS` consecutive output pixels with gathers.
+ *
+ * @param rotation the rotation
+ * @param dst the first output pixel
+ * @param x source column of the first output pixel in fixed point
+ * @param y source row of the first output pixel in fixed point
+ * @return true if the pixels were written, false if some of their source pixels lie outside of the image
+ */
+bool rotate_vector(const struct rotation *rotation, struct pixel *dst, int64_t x, int64_t y);
+#endif
+
+/**
+ * Transpose band of output rows tile by tile.
+ *
+ * @param ctx the `transposition` structure
+ * @param start first output row of the band
+ * @param end one past the last output row of the band
+ */
+void transpose_band(void *ctx, uint32_t start, uint32_t end);
+
+/**
+ * Create image with swapped dimensions and fill it by transposition.
+ *
+ * Rows are stored bottom up, so storage axes map to the image as seen:
+ * no reversal is transverse, both reversals are transpose.
+ *
+ * @param image the source image
+ * @param reverse_rows read output rows from source columns in reverse order
+ * @param reverse_cols read output columns from source rows in reverse order
+ * @return the transposed copy or NULL, if allocation failed
+ */
+struct bmp_image *transpose_image(const struct bmp_image *image, bool reverse_rows, bool reverse_cols);
+
+/**
+ * Copy band of output rows from the opposite source rows reversed.
+ *
+ * @param ctx the `half_turn` structure
+ * @param start first output row of the band
+ * @param end one past the last output row of the band
+ */
+void half_turn_band(void *ctx, uint32_t start, uint32_t end);
+
+/**
+ * Replicate band of source rows.
+ *
+ * @param ctx the `upscale` structure
+ * @param start first source row of the band
+ * @param end one past the last source row of the band
+ */
+void upscale_band(void *ctx, uint32_t start, uint32_t end);
+
+/**
+ * Scale band of source rows with Scale2x.
+ *
+ * @param ctx the `upscale` structure
+ * @param start first source row of the band
+ * @param end one past the last source row of the band
+ */
+void epx2_band(void *ctx, uint32_t start, uint32_t end);
+
+/**
+ * Scale band of source rows with Scale3x.
+ *
+ * @param ctx the `upscale` structure
+ * @param start first source row of the band
+ * @param end one past the last source row of the band
+ */
+void epx3_band(void *ctx, uint32_t start, uint32_t end);
+
+/**
+ * Compare two pixels.
+ *
+ * @param a the first pixel
+ * @param b the second pixel
+ * @return true if all channels are equal
+ */
+static inline bool same_pixel(struct pixel a, struct pixel b)
+{
+    return a.blue == b.blue && a.green == b.green && a.red == b.red;
+}
+
+#ifdef __AVX2__
+/**
+ * Load `VECTOR_PIXELS` pixels into 32-bit lanes, reading exactly their bytes.
+ *
+ * @param src the first pixel
+ * @return the pixels, the fourth byte of every lane is zero
+ */
+static inline __m256i load_pixels(const struct pixel *src)
+{
+    const uint8_t *bytes = (const uint8_t *)src;
+    __m256i raw = _mm256_set_m128i(_mm_loadl_epi64((const __m128i *)(bytes + 16)), _mm_loadu_si128((const __m128i *)bytes));
+    __m256i lanes = _mm256_permutevar8x32_epi32(raw, _mm256_setr_epi32(0, 1, 2, 0, 3, 4, 5, 0));
+    return _mm256_shuffle_epi8(lanes, _mm256_setr_epi8(0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1,
+                                                       0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1));
+}
+
+/**
+ * Store `VECTOR_PIXELS` pixels from 32-bit lanes, writing exactly their bytes.
+ *
+ * @param dst the first pixel
+ * @param pixels the pixels
+ */
+static inline void store_pixels(struct pixel *dst, __m256i pixels)
+{
+    uint8_t *bytes = (uint8_t *)dst;
+    __m256i packed = _mm256_shuffle_epi8(pixels, _mm256_setr_epi8(0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1,
+                                                                  0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1));
+    packed = _mm256_permutevar8x32_epi32(packed, _mm256_setr_epi32(0, 1, 2, 4, 5, 6, 7, 7));
+    _mm_storeu_si128((__m128i *)bytes, _mm256_castsi256_si128(packed));
+    _mm_storel_epi64((__m128i *)(bytes + 16), _mm256_extracti128_si256(packed, 1));
+}
+
+/**
+ * Compare pixels in 32-bit lanes.
+ *
+ * @param a the first pixels
+ * @param b the second pixels
+ * @return all ones in lanes of equal pixels
+ */
+static inline __m256i same_pixels(__m256i a, __m256i b)
+{
+    return _mm256_cmpeq_epi32(a, b);
+}
+
+/**
+ * Scale `VECTOR_PIXELS` source pixels with Scale2x.
+ *
+ * Neighbours left and right of the pixels must lie inside the row.
+ *
+ * @param above the pixels in the row above
+ * @param center the pixels
+ * @param below the pixels in the row below
+ * @param top the first pixel of the upper output row
+ * @param bottom the first pixel of the lower output row
+ */
+void epx2_vector(const struct pixel *above, const struct pixel *center, const struct pixel *below, struct pixel *top, struct pixel *bottom);
+
+/**
+ * Scale `VECTOR_PIXELS` source pixels with Scale3x.
+ *
+ * Neighbours left and right of the pixels must lie inside the row.
+ *
+ * @param above the pixels in the row above
+ * @param center the pixels
+ * @param below the pixels in the row below
+ * @param top the first pixel of the upper output row
+ * @param middle the first pixel of the middle output row
+ * @param bottom the first pixel of the lower output row
+ */
+void epx3_vector(const struct pixel *above, const struct pixel *center, const struct pixel *below, struct pixel *top, struct pixel *middle, struct pixel *bottom);
+#endif
+
+/**
+ * Prepare comparisons with border color.
+ *
+ * @param match receives the prepared color
+ * @param color the border color
+ * @param tolerance largest difference of a channel still matching
+ */
+void init_border_match(struct border_match *match, struct pixel color, uint8_t tolerance);
+
+/**
+ * Find the first pixel not matching border color.
+ *
+ * @param match the border color
+ * @param row the pixels
+ * @param count number of pixels
+ * @return index of the first pixel not matching or count, if all match
+ */
+uint32_t first_mismatch(const struct border_match *match, const struct pixel *row, uint32_t count);
+
+/**
+ * Find the last pixel not matching border color.
+ *
+ * @param match the border color
+ * @param row the pixels
+ * @param count number of pixels
+ * @return one past index of the last pixel not matching or 0, if all match
+ */
+uint32_t last_mismatch(const struct border_match *match, const struct pixel *row, uint32_t count);
+
+/**
+ * Compare pixel with border color.
+ *
+ * @param match the border color
+ * @param pixel the pixel
+ * @return true if no channel differs more than tolerance
+ */
+static inline bool pixel_matches(const struct border_match *match, struct pixel pixel)
+{
+    return abs(pixel.blue - match->color.blue) <= match->tolerance &&
+           abs(pixel.green - match->color.green) <= match->tolerance &&
+           abs(pixel.red - match->color.red) <= match->tolerance;
+}
+
+#ifdef __SSE2__
+/**
+ * Compare 16 pixels with border color.
+ *
+ * @param match the border color
+ * @param bytes the first byte of the pixels
+ * @return true if all pixels match
+ */
+static inline bool chunk_matches(const struct border_match *match, const uint8_t *bytes)
+{
+    __m128i matching = _mm_set1_epi8(-1);
+    for (int v = 0; v < 3; v++)
+    {
+        // unsigned absolute difference, matching bytes do not exceed the limit
+        __m128i x = _mm_loadu_si128((const __m128i *)(bytes + 16 * v));
+        __m128i diff = _mm_or_si128(_mm_subs_epu8(x, match->pattern[v]), _mm_subs_epu8(match->pattern[v], x));
+        matching = _mm_and_si128(matching, _mm_cmpeq_epi8(_mm_max_epu8(diff, match->limit), match->limit));
+    }
+    return _mm_movemask_epi8(matching) == 0xFFFF;
+}
+#endif
+
 // PUBLIC IMPLEMENTATION
 // ================================================================================
 
-extern struct bmp_image *copy_bmp(const struct bmp_image *image);
 extern struct bmp_image *create_bmp(const struct bmp_header *header, uint32_t width, uint32_t height);
+extern struct bmp_image *create_bmp_view(const struct bmp_image *image, uint32_t row, uint32_t col, uint32_t width, uint32_t height);
 
 struct bmp_image *flip_horizontally(const struct bmp_image *image)
 {
@@ -29,20 +384,36 @@ struct bmp_image *flip_horizontally(const struct bmp_image *image)
     struct bmp_image *copy = copy_bmp(image);
     CHECK_NULL(copy);
 
-    uint32_t width = copy->header->width;
-    uint32_t height = copy->header->height;
+    if (!flip_horizontally_inplace(copy))
+    {
+        free_bmp_image(copy);
+        return NULL;
+    }
+    return copy;
+}
+
+bool flip_horizontally_inplace(struct bmp_image *image)
+{
+    if (!bmp_make_writable(image))
+    {
+        return false;
+    }
+
+    uint32_t width = image->header->width;
+    uint32_t height = image->header->height;
 
     // flipping horizontally means flipping along vertical axis
-    for (uint32_t left_col = 0, right_col = width - 1; left_col < right_col; left_col++, right_col--)
+    for (uint32_t row = 0; row < height; row++)
     {
-        for (uint32_t row = 0; row < height; row++)
+        struct pixel *pixels = bmp_row(image, row);
+        for (uint32_t left_col = 0, right_col = width - 1; left_col < right_col; left_col++, right_col--)
         {
-            struct pixel tmp = copy->data[row * width + left_col];
-            copy->data[row * width + left_col] = copy->data[row * width + right_col];
-            copy->data[row * width + right_col] = tmp;
+            struct pixel tmp = pixels[left_col];
+            pixels[left_col] = pixels[right_col];
+            pixels[right_col] = tmp;
         }
     }
-    return copy;
+    return true;
 }
 
 struct bmp_image *flip_vertically(const struct bmp_image *image)
@@ -60,60 +431,148 @@ struct bmp_image *flip_vertically(const struct bmp_image *image)
     // bmp images are stored in bottom to top order
     for (uint32_t botom_row = 0, top_row = height - 1; botom_row < top_row; botom_row++, top_row--)
     {
-        memcpy(&copy->data[botom_row * width], &image->data[top_row * width], row_bytes);
-        memcpy(&copy->data[top_row * width], &image->data[botom_row * width], row_bytes);
+        memcpy(&copy->data[botom_row * width], bmp_row(image, top_row), row_bytes);
+        memcpy(&copy->data[top_row * width], bmp_row(image, botom_row), row_bytes);
     }
 
     // copy the middle row
     if (height % 2 == 1)
     {
-        memcpy(&copy->data[height / 2 * width], &image->data[height / 2 * width], row_bytes);
+        memcpy(&copy->data[height / 2 * width], bmp_row(image, height / 2), row_bytes);
     }
 
     return copy;
 }
 
+bool flip_vertically_inplace(struct bmp_image *image)
+{
+    if (!bmp_make_writable(image))
+    {
+        return false;
+    }
+
+    uint32_t height = image->header->height;
+    size_t row_bytes = image->header->width * sizeof(struct pixel);
+    struct pixel *tmp = malloc(row_bytes);
+    if (tmp == NULL)
+    {
+        return false;
+    }
+
+    for (uint32_t botom_row = 0, top_row = height - 1; botom_row < top_row; botom_row++, top_row--)
+    {
+        memcpy(tmp, bmp_row(image, botom_row), row_bytes);
+        memcpy(bmp_row(image, botom_row), bmp_row(image, top_row), row_bytes);
+        memcpy(bmp_row(image, top_row), tmp, row_bytes);
+    }
+
+    free(tmp);
+    return true;
+}
+
 struct bmp_image *rotate_right(const struct bmp_image *image)
 {
     CHECK_NULL(image);
+    return transpose_image(image, true, false);
+}
 
-    uint32_t width = image->header->width;
-    uint32_t height = image->header->height;
+struct bmp_image *rotate_left(const struct bmp_image *image)
+{
+    CHECK_NULL(image);
+    return transpose_image(image, false, true);
+}
 
-    // switch width & height
-    struct bmp_image *copy = create_bmp(image->header, height, width);
+struct bmp_image *rotate_180(const struct bmp_image *image)
+{
+    CHECK_NULL(image);
+
+    struct bmp_image *copy = create_bmp(image->header, image->header->width, image->header->height);
     CHECK_NULL(copy);
 
-    // overwrite copied pixel data with rotated data
-    for (uint32_t row = 0; row < height; row++)
-    {
-        for (uint32_t col = 0; col < width; col++)
-        {
-            memcpy(&copy->data[(width - 1 - col) * height + row], &image->data[row * width + col], sizeof(struct pixel));
-        }
-    }
+    struct half_turn turn = {image, copy};
+    parallel_rows(copy->header->height, half_turn_band, &turn);
     return copy;
 }
 
-struct bmp_image *rotate_left(const struct bmp_image *image)
+struct bmp_image *transpose(const struct bmp_image *image)
 {
     CHECK_NULL(image);
+    return transpose_image(image, true, true);
+}
 
-    uint32_t width = image->header->width;
-    uint32_t height = image->header->height;
+struct bmp_image *transverse(const struct bmp_image *image)
+{
+    CHECK_NULL(image);
+    return transpose_image(image, false, false);
+}
 
-    // switch width & height
-    struct bmp_image *copy = create_bmp(image->header, height, width);
+struct bmp_image *rotate(const struct bmp_image *image, float degrees, struct pixel fill_color, enum resample_filter filter)
+{
+    CHECK_NULL(image);
+    if (!isfinite(degrees))
+    {
+        return NULL;
+    }
+
+    // exact quarter turns
+    float turns = fmodf(degrees, 360.0f);
+    turns = turns < 0 ? turns + 360.0f : turns;
+    if (turns == 0.0f)
+    {
+        return copy_bmp(image);
+    }
+    if (turns == 90.0f)
+    {
+        return rotate_right(image);
+    }
+    if (turns == 270.0f)
+    {
+        return rotate_left(image);
+    }
+    if (turns == 180.0f)
+    {
+        return rotate_180(image);
+    }
+
+    uint32_t w = image->header->width;
+    uint32_t h = image->header->height;
+    double angle = turns * M_PI / 180.0;
+    double cos_a = cos(angle);
+    double sin_a = sin(angle);
+
+    // bounding box of rotated image, sub-pixel slack absorbs rounding of sin/cos
+    uint32_t new_w = (uint32_t)ceil(fabs(w * cos_a) + fabs(h * sin_a) - 1e-4);
+    uint32_t new_h = (uint32_t)ceil(fabs(w * sin_a) + fabs(h * cos_a) - 1e-4);
+
+    struct bmp_image *copy = create_bmp(image->header, new_w, new_h);
     CHECK_NULL(copy);
 
-    // overwrite copied pixel data with rotated data
-    for (uint32_t row = 0; row < height; row++)
+    // inverse mapping of output pixel centers to source pixel coordinates,
+    // rows are stored bottom up, so clockwise rotation is counterclockwise in storage
+    double dx = 0.5 - new_w / 2.0;
+    double dy = 0.5 - new_h / 2.0;
+    struct rotation rotation = {
+        .src = image,
+        .dst = copy,
+        .fill = fill_color,
+        .bilinear = filter != FILTER_NEAREST,
+        .origin_x = llround((cos_a * dx - sin_a * dy + w / 2.0 - 0.5) * FIXED_ONE),
+        .origin_y = llround((sin_a * dx + cos_a * dy + h / 2.0 - 0.5) * FIXED_ONE),
+        .step_x_col = llround(cos_a * FIXED_ONE),
+        .step_y_col = llround(sin_a * FIXED_ONE),
+        .step_x_row = llround(-sin_a * FIXED_ONE),
+        .step_y_row = llround(cos_a * FIXED_ONE),
+    };
+
+    // nearest sampling rounds instead of interpolating
+    if (!rotation.bilinear)
     {
-        for (uint32_t col = 0; col < width; col++)
-        {
-            memcpy(&copy->data[col * height + height - 1 - row], &image->data[row * width + col], sizeof(struct pixel));
-        }
+        rotation.origin_x += FIXED_ONE / 2;
+        rotation.origin_y += FIXED_ONE / 2;
     }
+
+    parallel_rows(new_h, rotate_band, &rotation);
+
     return copy;
 }
 
@@ -126,20 +585,53 @@ struct bmp_image *crop(const struct bmp_image *image, const uint32_t start_y, co
         return NULL;
     }
 
-    struct bmp_image *copy = create_bmp(image->header, width, height);
-    CHECK_NULL(copy);
+    // bmp is indexed bottom up
+    uint32_t start_row = image->header->height - (start_y + height);
 
-    uint32_t old_w = image->header->width;
-    uint32_t old_h = image->header->height;
-    uint32_t start_row = (old_h - (start_y + height)) * old_w; // bmp is indexed bottom up
-    size_t row_bytes = width * sizeof(struct pixel);
+    return create_bmp_view(image, start_row, start_x, width, height);
+}
 
-    for (uint32_t row = 0; row < height; row++)
+struct bmp_image *trim(const struct bmp_image *image, uint8_t tolerance)
+{
+    CHECK_NULL(image);
+
+    uint32_t width = image->header->width;
+    uint32_t height = image->header->height;
+    if (width == 0 || height == 0)
     {
-        memcpy(&copy->data[row * width], &image->data[start_row + row * old_w + start_x], row_bytes);
+        return crop(image, 0, 0, height, width);
     }
 
-    return copy;
+    // border color is the top left pixel, bmp is indexed bottom up
+    struct border_match match;
+    init_border_match(&match, bmp_row(image, height - 1)[0], tolerance);
+
+    // whole rows are skipped from the top and the bottom
+    uint32_t top = 0;
+    while (top < height && first_mismatch(&match, bmp_row(image, height - 1 - top), width) == width)
+    {
+        top++;
+    }
+    if (top == height)
+    {
+        return crop(image, 0, 0, height, width);
+    }
+    uint32_t bottom = height;
+    while (first_mismatch(&match, bmp_row(image, height - bottom), width) == width)
+    {
+        bottom--;
+    }
+
+    // every row is scanned only up to the columns found so far
+    uint32_t left = width, right = 0;
+    for (uint32_t y = top; y < bottom; y++)
+    {
+        const struct pixel *row = bmp_row(image, height - 1 - y);
+        left = first_mismatch(&match, row, left);
+        right += last_mismatch(&match, row + right, width - right);
+    }
+
+    return crop(image, top, left, bottom - top, right - left);
 }
 
 struct bmp_image *scale(const struct bmp_image *image, float factor)
@@ -150,6 +642,12 @@ struct bmp_image *scale(const struct bmp_image *image, float factor)
         return NULL;
     }
 
+    // whole factors replicate pixels exactly
+    if (factor >= 2 && factor == floorf(factor) && factor <= UINT32_MAX)
+    {
+        return scale_integer(image, (uint32_t)factor);
+    }
+
     uint32_t w = image->header->width;
     uint32_t h = image->header->height;
     uint32_t new_w = (uint32_t)roundf((float)image->header->width * factor);
@@ -165,12 +663,64 @@ struct bmp_image *scale(const struct bmp_image *image, float factor)
             uint32_t row = (uint32_t)((float)(new_row * h) / (float)new_h);
             uint32_t col = (uint32_t)((float)(new_col * w) / (float)new_w);
 
-            memcpy(&copy->data[new_row * new_w + new_col], &image->data[row * w + col], sizeof(struct pixel));
+            memcpy(&copy->data[new_row * new_w + new_col], &bmp_row(image, row)[col], sizeof(struct pixel));
         }
     }
     return copy;
 }
 
+struct bmp_image *scale_integer(const struct bmp_image *image, uint32_t factor)
+{
+    CHECK_NULL(image);
+    uint64_t new_w = (uint64_t)image->header->width * factor;
+    uint64_t new_h = (uint64_t)image->header->height * factor;
+    if (factor == 0 || new_w > UINT32_MAX || new_h > UINT32_MAX)
+    {
+        return NULL;
+    }
+
+    struct bmp_image *copy = create_bmp(image->header, (uint32_t)new_w, (uint32_t)new_h);
+    CHECK_NULL(copy);
+
+    struct upscale upscale = {image, copy, factor};
+    parallel_rows(image->header->height, upscale_band, &upscale);
+
+    return copy;
+}
+
+struct bmp_image *scale_epx(const struct bmp_image *image, uint32_t factor)
+{
+    CHECK_NULL(image);
+    if (factor != 2 && factor != 3 && factor != 4)
+    {
+        return NULL;
+    }
+
+    // Scale4x is Scale2x applied twice
+    if (factor == 4)
+    {
+        struct bmp_image *half = scale_epx(image, 2);
+        struct bmp_image *copy = scale_epx(half, 2);
+        free_bmp_image(half);
+        return copy;
+    }
+
+    uint64_t new_w = (uint64_t)image->header->width * factor;
+    uint64_t new_h = (uint64_t)image->header->height * factor;
+    if (new_w > UINT32_MAX || new_h > UINT32_MAX)
+    {
+        return NULL;
+    }
+
+    struct bmp_image *copy = create_bmp(image->header, (uint32_t)new_w, (uint32_t)new_h);
+    CHECK_NULL(copy);
+
+    struct upscale upscale = {image, copy, factor};
+    parallel_rows(image->header->height, factor == 2 ? epx2_band : epx3_band, &upscale);
+
+    return copy;
+}
+
 struct bmp_image *extract(const struct bmp_image *image, const char *colors_to_keep)
 {
     CHECK_NULL(image);
@@ -200,17 +750,528 @@ struct bmp_image *extract(const struct bmp_image *image, const char *colors_to_k
 
     struct bmp_image *copy = copy_bmp(image);
     CHECK_NULL(copy);
+    if (!bmp_make_writable(copy))
+    {
+        free_bmp_image(copy);
+        return NULL;
+    }
 
     uint32_t w = copy->header->width;
     uint32_t h = copy->header->height;
 
-    // pointer arithmetic
-    struct pixel *pixel = copy->data;
-    for (uint32_t i = 0; i < w * h; i++, pixel++)
+    for (uint32_t row = 0; row < h; row++)
     {
-        pixel->blue &= blue;
-        pixel->green &= green;
-        pixel->red &= red;
+        struct pixel *pixel = bmp_row(copy, row);
+        for (uint32_t i = 0; i < w; i++, pixel++)
+        {
+            pixel->blue &= blue;
+            pixel->green &= green;
+            pixel->red &= red;
+        }
     }
     return copy;
-}
\ No newline at end of file
+}
+
+// HELPER IMPLEMENTATION
+// ================================================================================
+
+void rotate_band(void *ctx, uint32_t start, uint32_t end)
+{
+    const struct rotation *rotation = ctx;
+    uint32_t new_w = rotation->dst->header->width;
+
+    // walk output in tiles so source reads of neighbouring rows stay in cache
+    for (uint32_t tile_row = start; tile_row < end; tile_row += TILE_SIZE)
+    {
+        uint32_t tile_end = tile_row + TILE_SIZE < end ? tile_row + TILE_SIZE : end;
+        for (uint32_t tile_col = 0; tile_col < new_w; tile_col += TILE_SIZE)
+        {
+            uint32_t tile_w = tile_col + TILE_SIZE < new_w ? TILE_SIZE : new_w - tile_col;
+            for (uint32_t row = tile_row; row < tile_end; row++)
+            {
+                int64_t x = rotation->origin_x + row * rotation->step_x_row + tile_col * rotation->step_x_col;
+                int64_t y = rotation->origin_y + row * rotation->step_y_row + tile_col * rotation->step_y_col;
+                struct pixel *dst = &rotation->dst->data[(size_t)row * new_w + tile_col];
+
+                for (uint32_t col = 0; col < tile_w;)
+                {
+#ifdef __AVX2__
+                    if (col + ROTATE_PIXELS <= tile_w && rotate_vector(rotation, dst + col, x, y))
+                    {
+                        col += ROTATE_PIXELS;
+                        x += ROTATE_PIXELS * rotation->step_x_col;
+                        y += ROTATE_PIXELS * rotation->step_y_col;
+                        continue;
+                    }
+#endif
+                    dst[col++] = sample_pixel(rotation, x, y);
+                    x += rotation->step_x_col;
+                    y += rotation->step_y_col;
+                }
+            }
+        }
+    }
+}
+
+#ifdef __AVX2__
+bool rotate_vector(const struct rotation *rotation, struct pixel *dst, int64_t x, int64_t y)
+{
+    const struct bmp_image *src = rotation->src;
+    uint32_t w = src->header->width;
+    uint32_t h = src->header->height;
+
+    // coordinates move linearly, so the first and the last pixel bound the span;
+    // 4-byte gathers reach one byte into the pixel right of the one they load
+    int64_t last_x = x + (ROTATE_PIXELS - 1) * rotation->step_x_col;
+    int64_t last_y = y + (ROTATE_PIXELS - 1) * rotation->step_y_col;
+    int64_t min_x = (x < last_x ? x : last_x) >> FIXED_BITS;
+    int64_t max_x = (x < last_x ? last_x : x) >> FIXED_BITS;
+    int64_t min_y = (y < last_y ? y : last_y) >> FIXED_BITS;
+    int64_t max_y = (y < last_y ? last_y : y) >> FIXED_BITS;
+    int64_t reach = rotation->bilinear ? 1 : 0;
+    if (min_x < 0 || min_y < 0 || max_x + reach + 1 >= w || max_y + reach >= h || (size_t)h * src->stride > INT32_MAX)
+    {
+        return false;
+    }
+
+    int32_t offsets[ROTATE_PIXELS];
+    int32_t fx[ROTATE_PIXELS];
+    int32_t fy[ROTATE_PIXELS];
+    for (int i = 0; i < ROTATE_PIXELS; i++, x += rotation->step_x_col, y += rotation->step_y_col)
+    {
+        offsets[i] = (int32_t)((size_t)(y >> FIXED_BITS) * src->stride + (size_t)(x >> FIXED_BITS) * sizeof(struct pixel));
+        fx[i] = (int32_t)(x >> (FIXED_BITS - 8)) & 0xFF;
+        fy[i] = (int32_t)(y >> (FIXED_BITS - 8)) & 0xFF;
+    }
+
+    const int *base = (const int *)src->data;
+    __m256i index = _mm256_loadu_si256((const __m256i *)offsets);
+    __m256i result = _mm256_i32gather_epi32(base, index, 1);
+    if (rotation->bilinear)
+    {
+        __m256i right = _mm256_set1_epi32(sizeof(struct pixel));
+        __m256i up = _mm256_set1_epi32((int32_t)src->stride);
+        __m256i p[4] = {
+            result,
+            _mm256_i32gather_epi32(base, _mm256_add_epi32(index, right), 1),
+            _mm256_i32gather_epi32(base, _mm256_add_epi32(index, up), 1),
+            _mm256_i32gather_epi32(base, _mm256_add_epi32(index, _mm256_add_epi32(up, right)), 1),
+        };
+
+        __m256i full = _mm256_set1_epi32(256);
+        __m256i wx = _mm256_loadu_si256((const __m256i *)fx);
+        __m256i wy = _mm256_loadu_si256((const __m256i *)fy);
+        __m256i weights[4] = {
+            _mm256_mullo_epi32(_mm256_sub_epi32(full, wx), _mm256_sub_epi32(full, wy)),
+            _mm256_mullo_epi32(wx, _mm256_sub_epi32(full, wy)),
+            _mm256_mullo_epi32(_mm256_sub_epi32(full, wx), wy),
+            _mm256_mullo_epi32(wx, wy),
+        };
+
+        // channels one by one, weights of 1 << 16 in total keep sums in 32 bits
+        __m256i mask = _mm256_set1_epi32(0xFF);
+        result = _mm256_setzero_si256();
+        for (int c = 0; c < 3; c++)
+        {
+            __m128i shift = _mm_cvtsi32_si128(8 * c);
+            __m256i sum = _mm256_set1_epi32(32768);
+            for (int k = 0; k < 4; k++)
+            {
+                __m256i channel = _mm256_and_si256(_mm256_srl_epi32(p[k], shift), mask);
+                sum = _mm256_add_epi32(sum, _mm256_mullo_epi32(channel, weights[k]));
+            }
+            result = _mm256_or_si256(result, _mm256_sll_epi32(_mm256_srli_epi32(sum, 16), shift));
+        }
+    }
+
+    // drop the fourth byte of every pixel, each lane then holds 12 bytes of 4 pixels
+    __m256i packed = _mm256_shuffle_epi8(result, _mm256_setr_epi8(0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1,
+                                                                  0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1));
+    uint8_t high[16];
+    _mm_storeu_si128((__m128i *)high, _mm256_extracti128_si256(packed, 1));
+    _mm_storeu_si128((__m128i *)dst, _mm256_castsi256_si128(packed));
+    memcpy(dst + ROTATE_PIXELS / 2, high, ROTATE_PIXELS / 2 * sizeof(struct pixel));
+    return true;
+}
+#endif
+
+void transpose_band(void *ctx, uint32_t start, uint32_t end)
+{
+    const struct transposition *transposition = ctx;
+    uint32_t src_w = transposition->src->header->width;
+    uint32_t src_h = transposition->src->header->height;
+    ptrdiff_t stride = (ptrdiff_t)transposition->src->stride;
+    ptrdiff_t step = transposition->reverse_cols ? -stride : stride;
+
+    // square tiles keep both the source rows and the output rows in cache
+    for (uint32_t tile_row = start; tile_row < end; tile_row += TILE_SIZE)
+    {
+        uint32_t tile_end = tile_row + TILE_SIZE < end ? tile_row + TILE_SIZE : end;
+        for (uint32_t tile_col = 0; tile_col < src_h; tile_col += TILE_SIZE)
+        {
+            uint32_t tile_cols = tile_col + TILE_SIZE < src_h ? tile_col + TILE_SIZE : src_h;
+            for (uint32_t row = tile_row; row < tile_end; row++)
+            {
+                struct pixel *dst = bmp_row(transposition->dst, row);
+                uint32_t src_col = transposition->reverse_rows ? src_w - 1 - row : row;
+                uint32_t src_row = transposition->reverse_cols ? src_h - 1 - tile_col : tile_col;
+                const uint8_t *src = (const uint8_t *)&bmp_row(transposition->src, src_row)[src_col];
+                for (uint32_t col = tile_col; col < tile_cols; col++, src += step)
+                {
+                    dst[col] = *(const struct pixel *)src;
+                }
+            }
+        }
+    }
+}
+
+struct bmp_image *transpose_image(const struct bmp_image *image, bool reverse_rows, bool reverse_cols)
+{
+    // switch width & height
+    struct bmp_image *copy = create_bmp(image->header, image->header->height, image->header->width);
+    CHECK_NULL(copy);
+
+    struct transposition transposition = {image, copy, reverse_rows, reverse_cols};
+    parallel_rows(copy->header->height, transpose_band, &transposition);
+    return copy;
+}
+
+void half_turn_band(void *ctx, uint32_t start, uint32_t end)
+{
+    const struct half_turn *turn = ctx;
+    uint32_t width = turn->dst->header->width;
+    uint32_t height = turn->dst->header->height;
+
+    // both rows are walked linearly, one of them backwards
+    for (uint32_t row = start; row < end; row++)
+    {
+        struct pixel *dst = bmp_row(turn->dst, row);
+        const struct pixel *src = bmp_row(turn->src, height - 1 - row) + width;
+        for (uint32_t col = 0; col < width; col++)
+        {
+            dst[col] = *--src;
+        }
+    }
+}
+
+void init_border_match(struct border_match *match, struct pixel color, uint8_t tolerance)
+{
+    match->color = color;
+    match->tolerance = tolerance;
+
+#ifdef __SSE2__
+    uint8_t bytes[3 * MATCH_PIXELS];
+    for (int i = 0; i < 3 * MATCH_PIXELS; i += 3)
+    {
+        bytes[i] = color.blue;
+        bytes[i + 1] = color.green;
+        bytes[i + 2] = color.red;
+    }
+    for (int v = 0; v < 3; v++)
+    {
+        match->pattern[v] = _mm_loadu_si128((const __m128i *)(bytes + 16 * v));
+    }
+    match->limit = _mm_set1_epi8((char)tolerance);
+#endif
+}
+
+uint32_t first_mismatch(const struct border_match *match, const struct pixel *row, uint32_t count)
+{
+    uint32_t col = 0;
+
+#ifdef __SSE2__
+    // chunk holding the mismatch is searched pixel by pixel
+    for (; col + MATCH_PIXELS <= count; col += MATCH_PIXELS)
+    {
+        if (!chunk_matches(match, (const uint8_t *)(row + col)))
+        {
+            break;
+        }
+    }
+#endif
+
+    for (; col < count; col++)
+    {
+        if (!pixel_matches(match, row[col]))
+        {
+            return col;
+        }
+    }
+    return count;
+}
+
+uint32_t last_mismatch(const struct border_match *match, const struct pixel *row, uint32_t count)
+{
+    uint32_t end = count;
+
+#ifdef __SSE2__
+    for (; end >= MATCH_PIXELS; end -= MATCH_PIXELS)
+    {
+        if (!chunk_matches(match, (const uint8_t *)(row + end - MATCH_PIXELS)))
+        {
+            break;
+        }
+    }
+#endif
+
+    for (; end > 0; end--)
+    {
+        if (!pixel_matches(match, row[end - 1]))
+        {
+            return end;
+        }
+    }
+    return 0;
+}
+
+void upscale_band(void *ctx, uint32_t start, uint32_t end)
+{
+    const struct upscale *upscale = ctx;
+    uint32_t width = upscale->src->header->width;
+    uint32_t factor = upscale->factor;
+    size_t row_bytes = (size_t)upscale->dst->header->width * sizeof(struct pixel);
+
+#ifdef __AVX2__
+    // lane j of output vector i repeats source pixel (8 * i + j) / factor
+    __m256i spread[4];
+    for (uint32_t i = 0; i < 4 && factor <= 4; i++)
+    {
+        spread[i] = _mm256_setr_epi32((int)((8 * i) / factor), (int)((8 * i + 1) / factor), (int)((8 * i + 2) / factor), (int)((8 * i + 3) / factor),
+                                      (int)((8 * i + 4) / factor), (int)((8 * i + 5) / factor), (int)((8 * i + 6) / factor), (int)((8 * i + 7) / factor));
+    }
+#endif
+
+    for (uint32_t row = start; row < end; row++)
+    {
+        const struct pixel *src = bmp_row(upscale->src, row);
+        struct pixel *dst = bmp_row(upscale->dst, row * factor);
+        uint32_t done = 0;
+
+#ifdef __AVX2__
+        for (; factor <= 4 && done + VECTOR_PIXELS <= width; done += VECTOR_PIXELS)
+        {
+            __m256i pixels = load_pixels(src + done);
+            for (uint32_t i = 0; i < factor; i++)
+            {
+                store_pixels(dst + (size_t)done * factor + VECTOR_PIXELS * i, _mm256_permutevar8x32_epi32(pixels, spread[i]));
+            }
+        }
+#endif
+
+        // common factors get constant trip counts the compiler unrolls
+        switch (factor)
+        {
+        case 2:
+            for (uint32_t col = done; col < width; col++)
+            {
+                dst[2 * col] = dst[2 * col + 1] = src[col];
+            }
+            break;
+        case 3:
+            for (uint32_t col = done; col < width; col++)
+            {
+                dst[3 * col] = dst[3 * col + 1] = dst[3 * col + 2] = src[col];
+            }
+            break;
+        case 4:
+            for (uint32_t col = done; col < width; col++)
+            {
+                dst[4 * col] = dst[4 * col + 1] = dst[4 * col + 2] = dst[4 * col + 3] = src[col];
+            }
+            break;
+        default:
+            for (uint32_t col = done; col < width; col++)
+            {
+                for (uint32_t i = 0; i < factor; i++)
+                {
+                    dst[(size_t)col * factor + i] = src[col];
+                }
+            }
+        }
+
+        // vertical replication copies whole rows
+        for (uint32_t i = 1; i < factor; i++)
+        {
+            memcpy(bmp_row(upscale->dst, row * factor + i), dst, row_bytes);
+        }
+    }
+}
+
+void epx2_band(void *ctx, uint32_t start, uint32_t end)
+{
+    const struct upscale *upscale = ctx;
+    uint32_t width = upscale->src->header->width;
+    uint32_t height = upscale->src->header->height;
+
+    for (uint32_t row = start; row < end; row++)
+    {
+        // rows are stored bottom up, neighbours are clamped at the edges
+        const struct pixel *above = bmp_row(upscale->src, row + 1 < height ? row + 1 : row);
+        const struct pixel *center = bmp_row(upscale->src, row);
+        const struct pixel *below = bmp_row(upscale->src, row > 0 ? row - 1 : row);
+        struct pixel *top = bmp_row(upscale->dst, 2 * row + 1);
+        struct pixel *bottom = bmp_row(upscale->dst, 2 * row);
+
+        for (uint32_t col = 0; col < width; col++)
+        {
+#ifdef __AVX2__
+            // away from the edges the vector kernel has all neighbours inside the row
+            for (; col > 0 && col + VECTOR_PIXELS < width; col += VECTOR_PIXELS)
+            {
+                epx2_vector(above + col, center + col, below + col, top + 2 * col, bottom + 2 * col);
+            }
+#endif
+            struct pixel b = above[col];
+            struct pixel d = center[col > 0 ? col - 1 : col];
+            struct pixel e = center[col];
+            struct pixel f = center[col + 1 < width ? col + 1 : col];
+            struct pixel h = below[col];
+
+            top[2 * col] = top[2 * col + 1] = bottom[2 * col] = bottom[2 * col + 1] = e;
+            if (!same_pixel(b, h) && !same_pixel(d, f))
+            {
+                if (same_pixel(d, b))
+                {
+                    top[2 * col] = d;
+                }
+                if (same_pixel(b, f))
+                {
+                    top[2 * col + 1] = f;
+                }
+                if (same_pixel(d, h))
+                {
+                    bottom[2 * col] = d;
+                }
+                if (same_pixel(h, f))
+                {
+                    bottom[2 * col + 1] = f;
+                }
+            }
+        }
+    }
+}
+
+void epx3_band(void *ctx, uint32_t start, uint32_t end)
+{
+    const struct upscale *upscale = ctx;
+    uint32_t width = upscale->src->header->width;
+    uint32_t height = upscale->src->header->height;
+
+    for (uint32_t row = start; row < end; row++)
+    {
+        // rows are stored bottom up, neighbours are clamped at the edges
+        const struct pixel *above = bmp_row(upscale->src, row + 1 < height ? row + 1 : row);
+        const struct pixel *center = bmp_row(upscale->src, row);
+        const struct pixel *below = bmp_row(upscale->src, row > 0 ? row - 1 : row);
+        struct pixel *top = bmp_row(upscale->dst, 3 * row + 2);
+        struct pixel *middle = bmp_row(upscale->dst, 3 * row + 1);
+        struct pixel *bottom = bmp_row(upscale->dst, 3 * row);
+
+        for (uint32_t col = 0; col < width; col++)
+        {
+#ifdef __AVX2__
+            // away from the edges the vector kernel has all neighbours inside the row
+            for (; col > 0 && col + VECTOR_PIXELS < width; col += VECTOR_PIXELS)
+            {
+                epx3_vector(above + col, center + col, below + col, top + 3 * col, middle + 3 * col, bottom + 3 * col);
+            }
+#endif
+            uint32_t left = col > 0 ? col - 1 : col;
+            uint32_t right = col + 1 < width ? col + 1 : col;
+            struct pixel a = above[left], b = above[col], c = above[right];
+            struct pixel d = center[left], e = center[col], f = center[right];
+            struct pixel g = below[left], h = below[col], i = below[right];
+            struct pixel *out = &top[3 * col];
+
+            top[3 * col] = top[3 * col + 1] = top[3 * col + 2] = e;
+            middle[3 * col] = middle[3 * col + 1] = middle[3 * col + 2] = e;
+            bottom[3 * col] = bottom[3 * col + 1] = bottom[3 * col + 2] = e;
+            if (same_pixel(b, h) || same_pixel(d, f))
+            {
+                continue;
+            }
+
+            bool db = same_pixel(d, b), bf = same_pixel(b, f);
+            bool dh = same_pixel(d, h), hf = same_pixel(h, f);
+            out[0] = db ? d : e;
+            out[1] = (db && !same_pixel(e, c)) || (bf && !same_pixel(e, a)) ? b : e;
+            out[2] = bf ? f : e;
+            out = &middle[3 * col];
+            out[0] = (db && !same_pixel(e, g)) || (dh && !same_pixel(e, a)) ? d : e;
+            out[2] = (bf && !same_pixel(e, i)) || (hf && !same_pixel(e, c)) ? f : e;
+            out = &bottom[3 * col];
+            out[0] = dh ? d : e;
+            out[1] = (dh && !same_pixel(e, i)) || (hf && !same_pixel(e, g)) ? h : e;
+            out[2] = hf ? f : e;
+        }
+    }
+}
+
+#ifdef __AVX2__
+void epx2_vector(const struct pixel *above, const struct pixel *center, const struct pixel *below, struct pixel *top, struct pixel *bottom)
+{
+    __m256i b = load_pixels(above);
+    __m256i d = load_pixels(center - 1);
+    __m256i e = load_pixels(center);
+    __m256i f = load_pixels(center + 1);
+    __m256i h = load_pixels(below);
+
+    // lanes where neither opposite pair of neighbours matches
+    __m256i active = _mm256_andnot_si256(_mm256_or_si256(same_pixels(b, h), same_pixels(d, f)), _mm256_set1_epi32(-1));
+    __m256i top_left = _mm256_blendv_epi8(e, d, _mm256_and_si256(active, same_pixels(d, b)));
+    __m256i top_right = _mm256_blendv_epi8(e, f, _mm256_and_si256(active, same_pixels(b, f)));
+    __m256i bottom_left = _mm256_blendv_epi8(e, d, _mm256_and_si256(active, same_pixels(d, h)));
+    __m256i bottom_right = _mm256_blendv_epi8(e, f, _mm256_and_si256(active, same_pixels(h, f)));
+
+    // output pixel j comes from lane j / 2 of the left (even j) or right (odd j) vector
+    __m256i first = _mm256_setr_epi32(0, 0, 1, 1, 2, 2, 3, 3);
+    __m256i second = _mm256_setr_epi32(4, 4, 5, 5, 6, 6, 7, 7);
+    store_pixels(top, _mm256_blend_epi32(_mm256_permutevar8x32_epi32(top_left, first), _mm256_permutevar8x32_epi32(top_right, first), 0xAA));
+    store_pixels(top + VECTOR_PIXELS, _mm256_blend_epi32(_mm256_permutevar8x32_epi32(top_left, second), _mm256_permutevar8x32_epi32(top_right, second), 0xAA));
+    store_pixels(bottom, _mm256_blend_epi32(_mm256_permutevar8x32_epi32(bottom_left, first), _mm256_permutevar8x32_epi32(bottom_right, first), 0xAA));
+    store_pixels(bottom + VECTOR_PIXELS, _mm256_blend_epi32(_mm256_permutevar8x32_epi32(bottom_left, second), _mm256_permutevar8x32_epi32(bottom_right, second), 0xAA));
+}
+
+void epx3_vector(const struct pixel *above, const struct pixel *center, const struct pixel *below, struct pixel *top, struct pixel *middle, struct pixel *bottom)
+{
+    __m256i a = load_pixels(above - 1), b = load_pixels(above), c = load_pixels(above + 1);
+    __m256i d = load_pixels(center - 1), e = load_pixels(center), f = load_pixels(center + 1);
+    __m256i g = load_pixels(below - 1), h = load_pixels(below), i = load_pixels(below + 1);
+
+    // lanes where neither opposite pair of neighbours matches
+    __m256i active = _mm256_andnot_si256(_mm256_or_si256(same_pixels(b, h), same_pixels(d, f)), _mm256_set1_epi32(-1));
+    __m256i db = _mm256_and_si256(active, same_pixels(d, b)), bf = _mm256_and_si256(active, same_pixels(b, f));
+    __m256i dh = _mm256_and_si256(active, same_pixels(d, h)), hf = _mm256_and_si256(active, same_pixels(h, f));
+    __m256i ea = same_pixels(e, a), ec = same_pixels(e, c), eg = same_pixels(e, g), ei = same_pixels(e, i);
+
+    __m256i rows[3][3] = {
+        {_mm256_blendv_epi8(e, d, db),
+         _mm256_blendv_epi8(e, b, _mm256_or_si256(_mm256_andnot_si256(ec, db), _mm256_andnot_si256(ea, bf))),
+         _mm256_blendv_epi8(e, f, bf)},
+        {_mm256_blendv_epi8(e, d, _mm256_or_si256(_mm256_andnot_si256(eg, db), _mm256_andnot_si256(ea, dh))),
+         e,
+         _mm256_blendv_epi8(e, f, _mm256_or_si256(_mm256_andnot_si256(ei, bf), _mm256_andnot_si256(ec, hf)))},
+        {_mm256_blendv_epi8(e, d, dh),
+         _mm256_blendv_epi8(e, h, _mm256_or_si256(_mm256_andnot_si256(ei, dh), _mm256_andnot_si256(eg, hf))),
+         _mm256_blendv_epi8(e, f, hf)},
+    };
+    struct pixel *out[3] = {top, middle, bottom};
+
+    // output pixel j comes from lane j / 3 of vector j % 3, every third lane is blended in from the same vector
+    const __m256i spread[3] = {
+        _mm256_setr_epi32(0, 0, 0, 1, 1, 1, 2, 2),
+        _mm256_setr_epi32(2, 3, 3, 3, 4, 4, 4, 5),
+        _mm256_setr_epi32(5, 5, 6, 6, 6, 7, 7, 7),
+    };
+    for (int r = 0; r < 3; r++)
+    {
+        __m256i x0 = rows[r][0], x1 = rows[r][1], x2 = rows[r][2];
+        store_pixels(out[r], _mm256_blend_epi32(_mm256_blend_epi32(_mm256_permutevar8x32_epi32(x0, spread[0]), _mm256_permutevar8x32_epi32(x1, spread[0]), 0x92),
+                                                _mm256_permutevar8x32_epi32(x2, spread[0]), 0x24));
+        store_pixels(out[r] + VECTOR_PIXELS, _mm256_blend_epi32(_mm256_blend_epi32(_mm256_permutevar8x32_epi32(x0, spread[1]), _mm256_permutevar8x32_epi32(x1, spread[1]), 0x24),
+                                                                _mm256_permutevar8x32_epi32(x2, spread[1]), 0x49));
+        store_pixels(out[r] + 2 * VECTOR_PIXELS, _mm256_blend_epi32(_mm256_blend_epi32(_mm256_permutevar8x32_epi32(x0, spread[2]), _mm256_permutevar8x32_epi32(x1, spread[2]), 0x49),
+                                                                    _mm256_permutevar8x32_epi32(x2, spread[2]), 0x92));
+    }
+}
+#endif
@@ -2,6 +2,7 @@
 #define _TRANSFORMATIONS_H
 
 #include "bmp.h"
+#include "resample.h"
 
 
 /**
@@ -14,6 +15,16 @@
 struct bmp_image* flip_horizontally(const struct bmp_image* image);
 
 
+/**
+ * Flips image horizontally in place.
+ *
+ * Pixels are copied first only if they are shared with another image.
+ * @arg image the image
+ * @return true on success, false if there is no image (NULL given) or memory allocation failed
+ */
+bool flip_horizontally_inplace(struct bmp_image* image);
+
+
 /**
  * Flips image vertically.
  *
@@ -23,6 +34,16 @@ struct bmp_image* flip_horizontally(const struct bmp_image* image);
  */
 struct bmp_image* flip_vertically(const struct bmp_image* image);
 
+
+/**
+ * Flips image vertically in place.
+ *
+ * Pixels are copied first only if they are shared with another image.
+ * @arg image the image
+ * @return true on success, false if there is no image (NULL given) or memory allocation failed
+ */
+bool flip_vertically_inplace(struct bmp_image* image);
+
 /**
  * Rotate image 90 degrees to the right.
  *
@@ -41,6 +62,54 @@ struct bmp_image* rotate_right(const struct bmp_image* image);
  */
 struct bmp_image* rotate_left(const struct bmp_image* image);
 
+/**
+ * Rotate image by 180 degrees.
+ *
+ * Creates copy of original file, which is rotated by half turn. Every row is
+ * copied from the opposite row in reverse order, in a single pass.
+ * @arg image the image
+ * @return the copy of image rotated by 180 degrees given as argument or null, if there is no image (NULL given)
+ */
+struct bmp_image* rotate_180(const struct bmp_image* image);
+
+/**
+ * Transpose image.
+ *
+ * Creates copy of original file reflected across its diagonal from the top
+ * left to the bottom right corner, width and height are swapped.
+ * @arg image the image
+ * @return the transposed copy of image given as argument or null, if there is no image (NULL given)
+ */
+struct bmp_image* transpose(const struct bmp_image* image);
+
+/**
+ * Transverse image.
+ *
+ * Creates copy of original file reflected across its diagonal from the top
+ * right to the bottom left corner, width and height are swapped.
+ * @arg image the image
+ * @return the transversed copy of image given as argument or null, if there is no image (NULL given)
+ */
+struct bmp_image* transverse(const struct bmp_image* image);
+
+/**
+ * Rotate image by arbitrary angle.
+ *
+ * Creates copy of original file rotated clockwise around its center. Created
+ * image is enlarged to the bounding box of the rotated image and uncovered
+ * area is filled with fill color. Output is sampled in tiles with fixed point
+ * incremental source coordinates, bands of rows are processed in parallel.
+ * Multiples of 90 degrees are exact and use `rotate_right()`, `rotate_left()`
+ * and `rotate_180()`.
+ *
+ * @arg image the image
+ * @arg degrees the clockwise angle, negative values rotate counterclockwise
+ * @arg fill_color color of area not covered by the original image
+ * @arg filter FILTER_NEAREST samples nearest pixel, any other filter samples bilinearly
+ * @return the copy of image rotated by degrees or null, if there is no image (NULL given) or angle is not finite
+ */
+struct bmp_image* rotate(const struct bmp_image* image, float degrees, struct pixel fill_color, enum resample_filter filter);
+
 /**
  * Resize image height and width by scale factor.
  *
@@ -52,21 +121,68 @@ struct bmp_image* rotate_left(const struct bmp_image* image);
 struct bmp_image* scale(const struct bmp_image* image, float factor);
 
 
+/**
+ * Enlarge image by whole factor.
+ *
+ * Creates copy of original file, where every pixel is replicated into
+ * factor x factor block. Output rows are built once and copied to the
+ * following factor - 1 rows. `scale()` uses it for whole factors.
+ *
+ * @arg image the image
+ * @arg factor the enlargement, factor >= 1
+ * @return the copy of image enlarged by factor or NULL, if there is no image (NULL given) or factor value is not valid
+ */
+struct bmp_image* scale_integer(const struct bmp_image* image, uint32_t factor);
+
+
+/**
+ * Enlarge pixel art by EPX.
+ *
+ * Creates copy of original file enlarged by Scale2x or Scale3x (AdvMAME),
+ * which keep the colors of image and smooth diagonal edges. Factor 4
+ * applies Scale2x twice. Pixels outside of the image repeat the edge.
+ *
+ * @arg image the image
+ * @arg factor the enlargement, 2, 3 or 4
+ * @return the copy of image enlarged by factor or NULL, if there is no image (NULL given) or factor value is not valid
+ */
+struct bmp_image* scale_epx(const struct bmp_image* image, uint32_t factor);
+
+
 /**
  * Remove unwanted outer area from image.
  *
- * Creates copy of image containing only selected rectangular area.
+ * Creates view into image containing only selected rectangular area. The view
+ * shares pixels with image, so it is created in constant time, and every
+ * transformation accepts it as input. The view holds a reference to the
+ * pixels, so image may be freed before the view.
  *
  * @arg image the image
  * @arg start_y top-left corner position on y-axis of selected area in the range <0, image->height>
  * @arg start_x top-left corner position on x-axis of selected area in the range <0, image->width>
  * @arg height the height of selected area in pixels in the range <1, image->height>
  * @arg width the width of selected area in pixels in the range <1, image->width>
- * @return the copy of image containing only selected area or null, if there is no image (NULL given) or area position is out of range
+ * @return the view of image containing only selected area or null, if there is no image (NULL given) or area position is out of range
  */
 struct bmp_image* crop(const struct bmp_image* image, const uint32_t start_y, const uint32_t start_x, const uint32_t height, const uint32_t width);
 
 
+/**
+ * Remove uniform border from image.
+ *
+ * Border color is the color of the top left pixel. Rows are skipped from
+ * the top and the bottom, columns from the left and the right, while all
+ * their pixels match border color, comparing 16 pixels at once where SSE2
+ * is available. Scanning stops at the first differing pixel, so the
+ * content inside is mostly not read. The result is a view like `crop()`.
+ *
+ * @arg image the image
+ * @arg tolerance largest difference of a channel from border color still counted as border
+ * @return the view of image containing only the content or null, if there is no image (NULL given); image made only of border is kept whole
+ */
+struct bmp_image* trim(const struct bmp_image* image, uint8_t tolerance);
+
+
 /**
  * Extract one or more color channels of image.
  *